@@ -38,6 +38,7 @@
 #include "colormaps.h"
 #include "functions.h"
 #include "events.h"
+#include "frame_index.h"
 #include "gram.tab.h"
 #include "icons.h"
 #include "iconmgr.h"
@@ -49,11 +50,14 @@
 #include "parse.h"
 #include "screen.h"
 #include "session.h"
+#include "text_extents.h"
 #include "util.h"
 #include "vscreen.h"
 #include "windowbox.h"
 #include "win_decorations.h"
+#include "win_index.h"
 #include "win_ops.h"
+#include "win_props.h"
 #include "win_regions.h"
 #include "win_resize.h"
 #include "win_utils.h"
@@ -69,6 +73,7 @@ static int PlaceX = -1;
 static int PlaceY = -1;
 static void DealWithNonSensicalGeometries(Display *dpy, Window vroot,
                 TwmWindow *tmp_win);
+static bool SmartPlace(TwmWindow *tmp_win);
 
 char NoName[] = "Untitled"; /* name if no name is specified */
 bool resizeWhenAdd;
@@ -105,7 +110,7 @@ AddWindow(Window w, AWType wtype, IconMgr *iconp, VirtualScreen *vs)
 	bool restore_iconified = false;
 	bool restore_icon_info_present = false;
 	bool restoredFromPrevSession = false;
-	int saved_occupation = 0; /* <== [ Matthew McNeill Feb 1997 ] == */
+	Occupation saved_occupation; /* <== [ Matthew McNeill Feb 1997 ] == */
 	bool random_placed = false;
 	WindowBox *winbox;
 	Window vroot;
@@ -124,6 +129,9 @@ AddWindow(Window w, AWType wtype, IconMgr *iconp, VirtualScreen *vs)
 	}
 
 
+	OccClear(&saved_occupation);
+
+
 	/*
 	 * Allocate and initialize our tracking struct
 	 */
@@ -178,6 +186,7 @@ AddWindow(Window w, AWType wtype, IconMgr *iconp, VirtualScreen *vs)
 	 * flags, etc) has to come later.
 	 */
 	XSelectInput(dpy, tmp_win->w, PropertyChangeMask);
+	WinPropsLoad(tmp_win->w);
 	XGetWindowAttributes(dpy, tmp_win->w, &tmp_win->attr);
 	FetchWmProtocols(tmp_win);
 	FetchWmColormapWindows(tmp_win);
@@ -302,12 +311,16 @@ AddWindow(Window w, AWType wtype, IconMgr *iconp, VirtualScreen *vs)
 	 * Setup WM_HINTS bits.  If we get nothing, we hardcode an
 	 * assumption.
 	 */
-	tmp_win->wmhints = XGetWMHints(dpy, tmp_win->w);
+	tmp_win->wmhints = NULL;
+	if(WinMayHaveProp(tmp_win->w, XA_WM_HINTS)) {
+		tmp_win->wmhints = XGetWMHints(dpy, tmp_win->w);
+	}
 	if(!tmp_win->wmhints) {
 		tmp_win->wmhints = gen_synthetic_wmhints(tmp_win);
 		if(!tmp_win->wmhints) {
 			fprintf(stderr, "Failed allocating memory for hints!\n");
 			free(tmp_win); // XXX leaky
+			WinPropsDone();
 			return NULL;
 		}
 	}
@@ -690,7 +703,7 @@ AddWindow(Window w, AWType wtype, IconMgr *iconp, VirtualScreen *vs)
 	 * set tmp_win->vs to NULL if it has no occupation in the current
 	 * workspace.
 	 */
-	SetupOccupation(tmp_win, saved_occupation);
+	SetupOccupation(tmp_win, &saved_occupation);
 
 
 	/* Does it go in a window box? */
@@ -769,8 +782,8 @@ AddWindow(Window w, AWType wtype, IconMgr *iconp, VirtualScreen *vs)
 	 * (setting up ctwm's own windows, taking over windows already on the
 	 * screen), or restoring defined session stuff, or otherwise
 	 * ask_user=false'd above, we just take the already set position
-	 * info.  Otherwise, we handle it via RandomPlacement or user outline
-	 * setting.
+	 * info.  Otherwise, we handle it via SmartPlacement, RandomPlacement
+	 * or user outline setting.
 	 *
 	 * XXX Somebody should go through these blocks in more detail,
 	 * they're sure to need further cleaning and commenting.  IWBNI they
@@ -778,10 +791,17 @@ AddWindow(Window w, AWType wtype, IconMgr *iconp, VirtualScreen *vs)
 	 * functions, for extra readability...
 	 */
 	if(HandlingEvents && ask_user && !restoredFromPrevSession) {
-		if((Scr->RandomPlacement == RP_ALL) ||
-		                ((Scr->RandomPlacement == RP_UNMAPPED) &&
-		                 ((tmp_win->wmhints->initial_state == IconicState) ||
-		                  (! visible(tmp_win))))) {
+		const bool auto_place = (Scr->RandomPlacement == RP_ALL) ||
+		                        ((Scr->RandomPlacement == RP_UNMAPPED) &&
+		                         ((tmp_win->wmhints->initial_state == IconicState) ||
+		                          (! visible(tmp_win))));
+
+		if(auto_place && Scr->SmartPlacement && winbox == NULL
+		                && SmartPlace(tmp_win)) {
+			/* found it a spot */
+			random_placed = true;
+		}
+		else if(auto_place) {
 			/* just stick it somewhere */
 
 #ifdef DEBUG
@@ -1029,14 +1049,14 @@ AddWindow(Window w, AWType wtype, IconMgr *iconp, VirtualScreen *vs)
 				XRectangle ink_rect;
 				XRectangle logical_rect;
 
-				XmbTextExtents(Scr->SizeFont.font_set,
-				               tmp_win->name, namelen,
-				               &ink_rect, &logical_rect);
+				CachedTextExtents(&Scr->SizeFont,
+				                  tmp_win->name, namelen,
+				                  &ink_rect, &logical_rect);
 				width = SIZE_HINDENT + ink_rect.width;
 				height = logical_rect.height + SIZE_VINDENT * 2;
 
-				XmbTextExtents(Scr->SizeFont.font_set,
-				               ": ", 2,  NULL, &logical_rect);
+				CachedTextExtents(&Scr->SizeFont,
+				                  ": ", 2,  NULL, &logical_rect);
 				Scr->SizeStringOffset = width + logical_rect.width;
 			}
 
@@ -1148,8 +1168,8 @@ AddWindow(Window w, AWType wtype, IconMgr *iconp, VirtualScreen *vs)
 					int lastx, lasty;
 					XRectangle logical_rect;
 
-					XmbTextExtents(Scr->SizeFont.font_set,
-					               ": ", 2,  NULL, &logical_rect);
+					CachedTextExtents(&Scr->SizeFont,
+					                  ": ", 2,  NULL, &logical_rect);
 					Scr->SizeStringOffset = width + logical_rect.width;
 
 					XResizeWindow(dpy, Scr->SizeWindow, Scr->SizeStringOffset +
@@ -1323,8 +1343,8 @@ AddWindow(Window w, AWType wtype, IconMgr *iconp, VirtualScreen *vs)
 	 */
 	{
 		XRectangle logical_rect;
-		XmbTextExtents(Scr->TitleBarFont.font_set, tmp_win->name, namelen,
-		               NULL, &logical_rect);
+		CachedTextExtents(&Scr->TitleBarFont, tmp_win->name, namelen,
+		                  NULL, &logical_rect);
 		tmp_win->name_width = logical_rect.width;
 	}
 
@@ -1410,6 +1430,7 @@ AddWindow(Window w, AWType wtype, IconMgr *iconp, VirtualScreen *vs)
 		/* XXX Leaky as all hell */
 		free(tmp_win);
 		XUngrabServer(dpy);
+		WinPropsDone();
 		return(NULL);
 	}
 
@@ -1422,6 +1443,8 @@ AddWindow(Window w, AWType wtype, IconMgr *iconp, VirtualScreen *vs)
 	tmp_win->prev = NULL;
 	Scr->FirstWindow = tmp_win;
 
+	/* And into the lists of what's in each workspace */
+	UpdateWorkSpaceMembers(tmp_win);
 
 
 	/*
@@ -1596,6 +1619,9 @@ AddWindow(Window w, AWType wtype, IconMgr *iconp, VirtualScreen *vs)
 	 */
 	OtpAdd(tmp_win, WinWin);
 
+	/* That's the last of the properties we look at; x-ref win_props.c */
+	WinPropsDone();
+
 
 	/*
 	 * Setup the stuff inside the titlebar window, if we have it.  If we
@@ -1726,41 +1752,39 @@ AddWindow(Window w, AWType wtype, IconMgr *iconp, VirtualScreen *vs)
 
 
 	/*
-	 * Stash up info about this TwmWindow and its screen in contexts on
-	 * the real window and our various decorations around it.  This is
-	 * how we find out what TwmWindow things like events are happening
-	 * in.
+	 * Stash up info about this TwmWindow and its screen in the window
+	 * index for the real window and our various decorations around it.
+	 * This is how we find out what TwmWindow (and what part of it)
+	 * things like events are happening in.
 	 */
-#define SETCTXS(win) do { \
-                XSaveContext(dpy, win, TwmContext, (XPointer) tmp_win); \
-                XSaveContext(dpy, win, ScreenContext, (XPointer) Scr); \
-        } while(0)
+#define SETCTXS(win, role) WinIndexAdd(win, Scr, tmp_win, role, 0)
 
 	/* The real window and our frame */
-	SETCTXS(tmp_win->w);
-	SETCTXS(tmp_win->frame);
+	SETCTXS(tmp_win->w, WR_CLIENT);
+	SETCTXS(tmp_win->frame, WR_FRAME);
 
 	/* Cram that all into any titlebar [sub]windows too */
 	if(tmp_win->title_height) {
 		int i;
 		int nb = Scr->TBInfo.nleft + Scr->TBInfo.nright;
 
-		SETCTXS(tmp_win->title_w);
+		SETCTXS(tmp_win->title_w, WR_TITLE);
 
 		for(i = 0; i < nb; i++) {
-			SETCTXS(tmp_win->titlebuttons[i].window);
+			WinIndexAdd(tmp_win->titlebuttons[i].window, Scr, tmp_win,
+			            WR_TITLEBUTTON, i);
 		}
 		if(tmp_win->hilite_wl) {
-			SETCTXS(tmp_win->hilite_wl);
+			SETCTXS(tmp_win->hilite_wl, WR_HILITE);
 		}
 		if(tmp_win->hilite_wr) {
-			SETCTXS(tmp_win->hilite_wr);
+			SETCTXS(tmp_win->hilite_wr, WR_HILITE);
 		}
 		if(tmp_win->lolite_wl) {
-			SETCTXS(tmp_win->lolite_wl);
+			SETCTXS(tmp_win->lolite_wl, WR_HILITE);
 		}
 		if(tmp_win->lolite_wr) {
-			SETCTXS(tmp_win->lolite_wr);
+			SETCTXS(tmp_win->lolite_wr, WR_HILITE);
 		}
 	}
 
@@ -1838,88 +1862,183 @@ AddWindow(Window w, AWType wtype, IconMgr *iconp, VirtualScreen *vs)
  * stay here and be staticized in the end.
  */
 
-/***********************************************************************
- *
- *  Procedure:
- *      GrabButtons - grab needed buttons for the window
- *
- *  Inputs:
- *      tmp_win - the twm window structure to use
+/*
+ * What gets grabbed on a window depends only on the bindings and
+ * IgnoreModifier, not the window, so we work it out once and keep it on
+ * the screen, rather than going through every binding for every window.
+ * Each binding gets grabbed with every combination of the ignored
+ * modifiers it doesn't already use (so they don't keep it from
+ * matching), and anything that'd come out the same, from different
+ * bindings or different combinations, only gets grabbed once.
  *
- ***********************************************************************
+ * Changing the bindings calls ForgetBindingGrabs() to have it redone.
  */
+typedef struct Grab {
+	unsigned int code;          /* keycode or button */
+	unsigned int mods;
+} Grab;
+
+typedef struct GrabList {
+	Grab *g;
+	int n, size;
+} GrabList;
+
+struct BindingGrabs {
+	unsigned int ignore;        /* Scr->IgnoreModifier they're made for */
+	GrabList win;               /* keys on the client window */
+	GrabList iconmgr;           /* same, for icon managers */
+	GrabList title;             /* keys on the title bar */
+	GrabList icon;              /* keys on the icon */
+	GrabList desktop;           /* more keys, for EWMH desktop windows */
+	GrabList frame;             /* buttons on the frame */
+};
+
+static struct {
+	unsigned long windows, requests;
+} grab_stats;
+
+#define XModMask (ShiftMask | LockMask | ControlMask | Mod1Mask \
+                  | Mod2Mask | Mod3Mask | Mod4Mask | Mod5Mask)
 
-#define grabbutton(button, modifier, window, pointer_mode) \
-        XGrabButton (dpy, button, modifier, window,  \
-                True, ButtonPressMask | ButtonReleaseMask, \
-                pointer_mode, GrabModeAsync, None,  \
-                Scr->FrameCursor);
 
-void GrabButtons(TwmWindow *tmp_win)
+static void
+gl_add(GrabList *gl, unsigned int code, unsigned int mods)
 {
-	FuncButton *tmp;
-	int i;
-	unsigned int ModifierMask[8] = { ShiftMask, ControlMask, LockMask,
-	                                 Mod1Mask, Mod2Mask, Mod3Mask, Mod4Mask,
-	                                 Mod5Mask
-	                               };
-
-	for(tmp = Scr->FuncButtonRoot.next; tmp != NULL; tmp = tmp->next) {
-		if((tmp->cont != C_WINDOW) || (tmp->func == 0)) {
-			continue;
+	if(gl->n == gl->size) {
+		const int nsize = gl->size ? gl->size * 2 : 16;
+		Grab *ng = realloc(gl->g, nsize * sizeof(Grab));
+		if(ng == NULL) {
+			fprintf(stderr, "%s: Out of memory\n", __func__);
+			Done(0);
 		}
-		grabbutton(tmp->num, tmp->mods, tmp_win->frame, GrabModeAsync);
+		gl->g    = ng;
+		gl->size = nsize;
+	}
+	gl->g[gl->n].code = code;
+	gl->g[gl->n].mods = mods;
+	gl->n++;
+}
+
 
-		for(i = 0 ; i < 8 ; i++) {
-			if((Scr->IgnoreModifier & ModifierMask [i]) && !(tmp->mods & ModifierMask [i]))
-				grabbutton(tmp->num, tmp->mods | ModifierMask [i],
-				           tmp_win->frame, GrabModeAsync);
+/* A binding, and its versions with any of the ignored modifiers too */
+static void
+gl_add_ignoring(GrabList *gl, unsigned int code, unsigned int mods,
+                unsigned int ignore)
+{
+	const unsigned int extra = ignore & ~mods & XModMask;
+
+	for(unsigned int sub = extra ; ; sub = (sub - 1) & extra) {
+		gl_add(gl, code, mods | sub);
+		if(sub == 0) {
+			break;
 		}
 	}
-	if(Scr->ClickToFocus) {
-		grabbutton(AnyButton, None, tmp_win->w, GrabModeSync);
-		for(i = 0 ; i < 8 ; i++) {
-			grabbutton(AnyButton, ModifierMask [i], tmp_win->w, GrabModeSync);
+}
+
+
+static int
+grab_cmp(const void *a, const void *b)
+{
+	const Grab *ga = a, *gb = b;
+
+	if(ga->code != gb->code) {
+		return ga->code < gb->code ? -1 : 1;
+	}
+	if(ga->mods != gb->mods) {
+		return ga->mods < gb->mods ? -1 : 1;
+	}
+	return 0;
+}
+
+static bool
+gl_has(const GrabList *gl, const Grab *g)
+{
+	return gl->n && bsearch(g, gl->g, gl->n, sizeof(Grab), grab_cmp) != NULL;
+}
+
+
+/* Sort, and drop the duplicates */
+static void
+gl_finish(GrabList *gl)
+{
+	int n = 0;
+
+	if(gl->n == 0) {
+		return;
+	}
+	qsort(gl->g, gl->n, sizeof(Grab), grab_cmp);
+	for(int i = 1 ; i < gl->n ; i++) {
+		if(grab_cmp(&gl->g[i], &gl->g[n]) != 0) {
+			gl->g[++n] = gl->g[i];
 		}
 	}
-	else if(Scr->RaiseOnClick) {
-		grabbutton(Scr->RaiseOnClickButton, None, tmp_win->w, GrabModeSync);
-		for(i = 0 ; i < 8 ; i++) {
-			grabbutton(Scr->RaiseOnClickButton,
-			           ModifierMask [i], tmp_win->w, GrabModeSync);
+	gl->n = n + 1;
+}
+
+
+/* dst = what's in src but not in minus; src and minus already finished */
+static void
+gl_diff(GrabList *dst, const GrabList *src, const GrabList *minus)
+{
+	for(int i = 0 ; i < src->n ; i++) {
+		if(!gl_has(minus, &src->g[i])) {
+			gl_add(dst, src->g[i].code, src->g[i].mods);
 		}
 	}
 }
-#undef grabbutton
 
-/***********************************************************************
- *
- *  Procedure:
- *      GrabKeys - grab needed keys for the window
- *
- *  Inputs:
- *      tmp_win - the twm window structure to use
- *
- ***********************************************************************
+
+static void
+gl_free(GrabList *gl)
+{
+	free(gl->g);
+	gl->g = NULL;
+	gl->n = gl->size = 0;
+}
+
+
+/*
+ * The bindings on the current screen have changed.
  */
+void
+ForgetBindingGrabs(void)
+{
+	struct BindingGrabs *bg = Scr->BindingGrabs;
 
-#define grabkey(funckey, modifier, window) \
-        XGrabKey(dpy, funckey->keycode, funckey->mods | modifier, window, True, \
-                GrabModeAsync, GrabModeAsync);
-#define ungrabkey(funckey, modifier, window) \
-        XUngrabKey (dpy, funckey->keycode, funckey->mods | modifier, window);
+	if(bg == NULL) {
+		return;
+	}
+	gl_free(&bg->win);
+	gl_free(&bg->iconmgr);
+	gl_free(&bg->title);
+	gl_free(&bg->icon);
+	gl_free(&bg->desktop);
+	gl_free(&bg->frame);
+	free(bg);
+	Scr->BindingGrabs = NULL;
+}
 
-void GrabKeys(TwmWindow *tmp_win)
+
+static struct BindingGrabs *
+binding_grabs(void)
 {
-	FuncKey *tmp;
-	IconMgr *p;
-	int i;
-	unsigned int ModifierMask[8] = { ShiftMask, ControlMask, LockMask,
-	                                 Mod1Mask, Mod2Mask, Mod3Mask, Mod4Mask,
-	                                 Mod5Mask
-	                               };
-
-	for(tmp = Scr->FuncKeyRoot.next; tmp != NULL; tmp = tmp->next) {
+	struct BindingGrabs *bg = Scr->BindingGrabs;
+	const unsigned int ignore = Scr->IgnoreModifier;
+	GrabList mgrkeys = { NULL, 0, 0 };
+	GrabList rootkeys = { NULL, 0, 0 };
+
+	if(bg != NULL && bg->ignore == ignore) {
+		return bg;
+	}
+	ForgetBindingGrabs();
+	bg = calloc(1, sizeof(struct BindingGrabs));
+	if(bg == NULL) {
+		fprintf(stderr, "%s: Out of memory\n", __func__);
+		Done(0);
+	}
+	bg->ignore = ignore;
+
+	for(FuncKey *tmp = Scr->FuncKeyRoot.next; tmp != NULL; tmp = tmp->next) {
 		switch(tmp->cont) {
 			case C_WINDOW:
 				/* case C_WORKSPACE: */
@@ -1928,91 +2047,30 @@ void GrabKeys(TwmWindow *tmp_win)
 					break;
 				}
 #undef AltMask
-
-				grabkey(tmp, 0, tmp_win->w);
-
-				for(i = 0 ; i < 8 ; i++) {
-					if((Scr->IgnoreModifier & ModifierMask [i]) &&
-					                !(tmp->mods & ModifierMask [i])) {
-						grabkey(tmp, ModifierMask [i], tmp_win->w);
-					}
-				}
+				gl_add_ignoring(&bg->win, tmp->keycode, tmp->mods, ignore);
 				break;
 
 			case C_ICON:
-				if(!tmp_win->icon || tmp_win->icon->w) {
-					break;
-				}
-
-				grabkey(tmp, 0, tmp_win->icon->w);
-
-				for(i = 0 ; i < 8 ; i++) {
-					if((Scr->IgnoreModifier & ModifierMask [i]) &&
-					                !(tmp->mods & ModifierMask [i])) {
-						grabkey(tmp, ModifierMask [i], tmp_win->icon->w);
-					}
-				}
+				gl_add_ignoring(&bg->icon, tmp->keycode, tmp->mods, ignore);
 				break;
 
 			case C_TITLE:
-				if(!tmp_win->title_w) {
-					break;
-				}
-
-				grabkey(tmp, 0, tmp_win->title_w);
-
-				for(i = 0 ; i < 8 ; i++) {
-					if((Scr->IgnoreModifier & ModifierMask [i]) &&
-					                !(tmp->mods & ModifierMask [i])) {
-						grabkey(tmp, ModifierMask [i], tmp_win->title_w);
-					}
-				}
+				gl_add_ignoring(&bg->title, tmp->keycode, tmp->mods, ignore);
 				break;
 
 			case C_NAME:
-				grabkey(tmp, 0, tmp_win->w);
-				for(i = 0 ; i < 8 ; i++) {
-					if((Scr->IgnoreModifier & ModifierMask [i]) &&
-					                !(tmp->mods & ModifierMask [i])) {
-						grabkey(tmp, ModifierMask [i], tmp_win->w);
-					}
-				}
-				if(tmp_win->icon && tmp_win->icon->w) {
-					grabkey(tmp, 0, tmp_win->icon->w);
-
-					for(i = 0 ; i < 8 ; i++) {
-						if((Scr->IgnoreModifier & ModifierMask [i]) &&
-						                !(tmp->mods & ModifierMask [i])) {
-							grabkey(tmp, ModifierMask [i], tmp_win->icon->w);
-						}
-					}
-				}
-				if(tmp_win->title_w) {
-					grabkey(tmp, 0, tmp_win->title_w);
+				gl_add_ignoring(&bg->win, tmp->keycode, tmp->mods, ignore);
+				gl_add_ignoring(&bg->icon, tmp->keycode, tmp->mods, ignore);
+				gl_add_ignoring(&bg->title, tmp->keycode, tmp->mods, ignore);
+				break;
 
-					for(i = 0 ; i < 8 ; i++) {
-						if((Scr->IgnoreModifier & ModifierMask [i]) &&
-						                !(tmp->mods & ModifierMask [i])) {
-							grabkey(tmp, ModifierMask [i], tmp_win->title_w);
-						}
-					}
-				}
+			case C_ICONMGR:
+				gl_add_ignoring(&mgrkeys, tmp->keycode, tmp->mods, ignore);
 				break;
 
 #ifdef EWMH_DESKTOP_ROOT
 			case C_ROOT:
-				if(tmp_win->ewmhWindowType != wt_Desktop) {
-					break;
-				}
-
-				grabkey(tmp, 0, tmp_win->w);
-
-				for(i = 0 ; i < 8 ; i++) {
-					if((Scr->IgnoreModifier & ModifierMask [i]) &&
-					                !(tmp->mods & ModifierMask [i])) {
-						grabkey(tmp, ModifierMask [i], tmp_win->w);
-					}
-				}
+				gl_add_ignoring(&rootkeys, tmp->keycode, tmp->mods, ignore);
 				break;
 #endif /* EWMH */
 
@@ -2024,23 +2082,187 @@ void GrabKeys(TwmWindow *tmp_win)
 				*/
 		}
 	}
-	for(tmp = Scr->FuncKeyRoot.next; tmp != NULL; tmp = tmp->next) {
-		if(tmp->cont == C_ICONMGR && !Scr->NoIconManagers) {
-			for(p = Scr->iconmgr; p != NULL; p = p->next) {
-				ungrabkey(tmp, 0, p->twm_win->w);
+	gl_finish(&bg->win);
+	gl_finish(&bg->icon);
+	gl_finish(&bg->title);
+	gl_finish(&mgrkeys);
+	gl_finish(&rootkeys);
 
-				for(i = 0 ; i < 8 ; i++) {
-					if((Scr->IgnoreModifier & ModifierMask [i]) &&
-					                !(tmp->mods & ModifierMask [i])) {
-						ungrabkey(tmp, ModifierMask [i], p->twm_win->w);
-					}
-				}
-			}
+	/*
+	 * Icon managers handle their own keys, so those get left off the
+	 * window (this used to grab them, then ungrab them again).  And
+	 * desktop windows only need what the window doesn't already have.
+	 */
+	gl_diff(&bg->iconmgr, &bg->win, &mgrkeys);
+	gl_diff(&bg->desktop, &rootkeys, &bg->win);
+	gl_free(&mgrkeys);
+	gl_free(&rootkeys);
+
+	for(FuncButton *tmp = Scr->FuncButtonRoot.next; tmp != NULL;
+	                tmp = tmp->next) {
+		if((tmp->cont != C_WINDOW) || (tmp->func == 0)) {
+			continue;
 		}
+		gl_add_ignoring(&bg->frame, tmp->num, tmp->mods, ignore);
+	}
+	gl_finish(&bg->frame);
+
+	Scr->BindingGrabs = bg;
+	return bg;
+}
+
+
+/***********************************************************************
+ *
+ *  Procedure:
+ *      GrabButtons - grab needed buttons for the window
+ *
+ *  Inputs:
+ *      tmp_win - the twm window structure to use
+ *
+ ***********************************************************************
+ */
+
+#define grabbutton(button, modifier, window, pointer_mode) \
+        XGrabButton (dpy, button, modifier, window,  \
+                True, ButtonPressMask | ButtonReleaseMask, \
+                pointer_mode, GrabModeAsync, None,  \
+                Scr->FrameCursor);
+
+void GrabButtons(TwmWindow *tmp_win)
+{
+	const GrabList *frame = &binding_grabs()->frame;
+
+	for(int i = 0 ; i < frame->n ; i++) {
+		grabbutton(frame->g[i].code, frame->g[i].mods, tmp_win->frame,
+		           GrabModeAsync);
+	}
+	grab_stats.requests += frame->n;
+
+	/*
+	 * Any click goes through us first, whatever modifiers are down.
+	 * Bindings on the frame still win, since it's further up.
+	 */
+	if(Scr->ClickToFocus) {
+		grabbutton(AnyButton, AnyModifier, tmp_win->w, GrabModeSync);
+		grab_stats.requests++;
+	}
+	else if(Scr->RaiseOnClick) {
+		grabbutton(Scr->RaiseOnClickButton, AnyModifier, tmp_win->w,
+		           GrabModeSync);
+		grab_stats.requests++;
+	}
+}
+#undef grabbutton
+
+/***********************************************************************
+ *
+ *  Procedure:
+ *      GrabKeys - grab needed keys for the window
+ *
+ *  Inputs:
+ *      tmp_win - the twm window structure to use
+ *
+ ***********************************************************************
+ */
+
+static void
+grabkeys(const GrabList *gl, Window window)
+{
+	for(int i = 0 ; i < gl->n ; i++) {
+		XGrabKey(dpy, gl->g[i].code, gl->g[i].mods, window, True,
+		         GrabModeAsync, GrabModeAsync);
+	}
+	grab_stats.requests += gl->n;
+}
+
+void GrabKeys(TwmWindow *tmp_win)
+{
+	const struct BindingGrabs *bg = binding_grabs();
+
+	grab_stats.windows++;
+
+	if(tmp_win->isiconmgr && !Scr->NoIconManagers) {
+		grabkeys(&bg->iconmgr, tmp_win->w);
+	}
+	else {
+		grabkeys(&bg->win, tmp_win->w);
+	}
+	if(tmp_win->title_w) {
+		grabkeys(&bg->title, tmp_win->title_w);
+	}
+	if(tmp_win->icon && tmp_win->icon->w) {
+		grabkeys(&bg->icon, tmp_win->icon->w);
 	}
+#ifdef EWMH_DESKTOP_ROOT
+	if(tmp_win->ewmhWindowType == wt_Desktop) {
+		grabkeys(&bg->desktop, tmp_win->w);
+	}
+#endif /* EWMH */
+}
+
+
+/*
+ * Grab keys on a window's icon.  Icons mostly don't exist yet when
+ * GrabKeys() is called, so this gets called when one's created.
+ */
+void
+GrabIconKeys(TwmWindow *tmp_win)
+{
+	if(tmp_win->icon && tmp_win->icon->w) {
+		grabkeys(&binding_grabs()->icon, tmp_win->icon->w);
+	}
+}
+
+
+/*
+ * How many grab requests windows are costing, for f.dumpstats.
+ */
+void
+GrabStatsDump(FILE *f)
+{
+	const struct BindingGrabs *bg = Scr->BindingGrabs;
+
+	fprintf(f, "%s: passive grabs: %lu requests for %lu windows (%.1f each)",
+	        ProgramName, grab_stats.requests, grab_stats.windows,
+	        grab_stats.windows ? (double)grab_stats.requests / grab_stats.windows
+	        : 0.0);
+	if(bg != NULL) {
+		fprintf(f, "; %d keys on windows, %d on titles, %d on icons, "
+		        "%d buttons on frames", bg->win.n, bg->title.n, bg->icon.n,
+		        bg->frame.n);
+	}
+	fprintf(f, "\n");
+	fflush(f);
+}
+
+
+/*
+ * SmartPlacement: put the window where its frame covers the least of
+ * what's already mapped on its vscreen.  Only works for windows that'll
+ * be visible; otherwise we don't know what they'll be landing on, and
+ * the caller falls back to RandomPlacement.
+ */
+static bool
+SmartPlace(TwmWindow *tmp_win)
+{
+	const int bw = tmp_win->frame_bw + tmp_win->frame_bw3D;
+	int fx, fy;
+
+	if(!visible(tmp_win)) {
+		return false;
+	}
+
+	FrameIndexFindSpace(tmp_win->vs,
+	                    tmp_win->attr.width + 2 * bw,
+	                    tmp_win->attr.height + tmp_win->title_height + 2 * bw,
+	                    &fx, &fy);
+
+	/* Back out to where the client goes; see the frame setup below */
+	tmp_win->attr.x = fx + bw - tmp_win->old_bw;
+	tmp_win->attr.y = fy + bw + tmp_win->title_height - tmp_win->old_bw;
+	return true;
 }
-#undef grabkey
-#undef ungrabkey
 
 
 /*
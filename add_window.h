@@ -17,6 +17,8 @@
 #ifndef _CTWM_ADD_WINDOW_H
 #define _CTWM_ADD_WINDOW_H
 
+#include <stdio.h>    // for FILE
+
 extern char NoName[];
 extern bool resizeWhenAdd;
 
@@ -32,6 +34,9 @@ TwmWindow *AddWindow(Window w, AWType wtype, IconMgr *iconp,
                      VirtualScreen *vs);
 void GrabButtons(TwmWindow *tmp_win);
 void GrabKeys(TwmWindow *tmp_win);
+void GrabIconKeys(TwmWindow *tmp_win);
+void ForgetBindingGrabs(void);
+void GrabStatsDump(FILE *f);
 
 extern int AddingX;
 extern int AddingY;
@@ -12,6 +12,7 @@
 #include <X11/extensions/shape.h>
 
 #include "ctwm_atoms.h"
+#include "event_sources.h"
 #include "events.h"
 #include "icons.h"
 #include "image.h"
@@ -19,6 +20,7 @@
 #include "util.h"
 #include "vscreen.h"
 #include "win_utils.h"
+#include "workspace_manager.h"
 
 #include "animate.h"
 
@@ -32,7 +34,11 @@ bool AnimationActive  = false;
 bool MaybeAnimate     = true;
 struct timeval AnimateTimeout;
 
+static int AnimateTimer = 0;    // Pending EventAddTimer() id
 
+
+static void CancelAnimation(void);
+static void AnimateTimerProc(void *_unused);
 static void Animate(void);
 static void AnimateButton(TBWindow *tbw);
 static void AnimateHighlight(TwmWindow *t);
@@ -50,36 +56,47 @@ static bool AnimateRoot(void);
  * extern FILE *tracefile;
  */
 
+
+/*
+ * Setup a timer for the next animation step, if anything might need
+ * animating and one isn't already pending.  Called from the event loop
+ * when it's about to go idle.
+ */
 void
-TryToAnimate(void)
+ScheduleAnimation(void)
 {
-	struct timeval  tp;
-	static unsigned long lastsec;
-	static long lastusec;
-	unsigned long gap;
-
-	if(Animating > 1) {
-		return;        /* rate limiting */
-	}
+	unsigned int ms;
 
-	gettimeofday(&tp, NULL);
-	gap = ((tp.tv_sec - lastsec) * 1000000) + (tp.tv_usec - lastusec);
-	if(tracefile) {
-		fprintf(tracefile, "Time = %lu, %ld, %ld, %ld, %lu\n", lastsec,
-		        lastusec, (long)tp.tv_sec, (long)tp.tv_usec, gap);
-		fflush(tracefile);
-	}
-	gap *= AnimationSpeed;
-	if(gap < 1000000) {
+	if(!AnimationActive || !MaybeAnimate || AnimationSpeed <= 0
+	                || AnimateTimer != 0) {
 		return;
 	}
+
+	ms = AnimateTimeout.tv_sec * 1000 + AnimateTimeout.tv_usec / 1000;
+	AnimateTimer = EventAddTimer(ms, AnimateTimerProc, NULL);
+}
+
+
+/*
+ * Cancel any pending animation step; used when we stop or change speed.
+ */
+static void
+CancelAnimation(void)
+{
+	EventRemoveTimer(AnimateTimer);
+	AnimateTimer = 0;
+}
+
+
+static void
+AnimateTimerProc(void *_unused)
+{
+	AnimateTimer = 0;
 	if(tracefile) {
 		fprintf(tracefile, "Animate\n");
 		fflush(tracefile);
 	}
 	Animate();
-	lastsec  = tp.tv_sec;
-	lastusec = tp.tv_usec;
 }
 
 
@@ -116,6 +133,7 @@ void
 StopAnimation(void)
 {
 	AnimationActive = false;
+	CancelAnimation();
 }
 
 
@@ -146,6 +164,7 @@ ModifyAnimationSpeed(int incr)
 	if(AnimationSpeed > MAXANIMATIONSPEED) {
 		AnimationSpeed = MAXANIMATIONSPEED;
 	}
+	CancelAnimation();
 
 	if(AnimationSpeed == 1) {
 		AnimateTimeout.tv_sec  = 1;
@@ -161,7 +180,7 @@ ModifyAnimationSpeed(int incr)
 
 
 /*
- * Only called from TryToAnimate
+ * Only called from AnimateTimerProc()
  */
 static void
 Animate(void)
@@ -310,7 +329,7 @@ static bool
 AnimateRoot(void)
 {
 	VirtualScreen *vs;
-	ScreenInfo *scr;
+	ScreenInfo *scr, *savedScr;
 	int        scrnum;
 	Image      *image;
 	WorkSpace  *ws;
@@ -343,11 +362,14 @@ AnimateRoot(void)
 			maybeanimate = true;
 		}
 	}
+	savedScr = Scr;
 	for(scrnum = 0; scrnum < NumScreens; scrnum++) {
 		if((scr = ScreenList [scrnum]) == NULL) {
 			continue;
 		}
 
+		/* The WSM map drawing works on Scr */
+		Scr = scr;
 		for(vs = scr->vScreenList; vs != NULL; vs = vs->next) {
 			if(vs->wsw->state == WMS_buttons) {
 				continue;
@@ -361,12 +383,13 @@ AnimateRoot(void)
 				if(ws == vs->wsw->currentwspc) {
 					continue;
 				}
-				XSetWindowBackgroundPixmap(dpy, vs->wsw->mswl [ws->number]->w, image->pixmap);
+				WMapSetBackground(vs, ws, image->pixmap, 0);
 				XClearWindow(dpy, vs->wsw->mswl [ws->number]->w);
 				ws->image = image->next;
 				maybeanimate = true;
 			}
 		}
 	}
+	Scr = savedScr;
 	return maybeanimate;
 }
@@ -17,6 +17,6 @@ void StartAnimation(void);
 void StopAnimation(void);
 void SetAnimationSpeed(int speed);
 void ModifyAnimationSpeed(int incr);
-void TryToAnimate(void);
+void ScheduleAnimation(void);
 
 #endif /* _CTWM_ANIMATE_H */
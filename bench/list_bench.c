@@ -0,0 +1,176 @@
+/*
+ * Microbenchmark for looking things up in name lists
+ *
+ * Builds a synthetic list of 1000 entries, a mix of plain names,
+ * prefixes, and real patterns, roughly like a big config's
+ * NoTitle/AutoRaise/Icons lists, and looks a set of names up in it,
+ * first by walking the list entry by entry like we used to, then
+ * through the compiled matcher (x-ref matcher_compile() in list.c).
+ * Lookups go through LookInNameList(), which doesn't get cached, so
+ * it's the matching itself being timed.  Compiling the list is counted
+ * in with the compiled lookups.
+ *
+ * Not built by default; "make list_bench" and run it.  An optional
+ * argument gives the number of rounds.
+ */
+
+#include "ctwm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "list.h"
+#include "screen.h"
+#include "util.h"
+
+
+#define NENTRIES 1000
+#define NPROBES  1000
+
+
+/* Bits of ctwm that list.c wants, which don't matter here */
+ScreenInfo *Scr = NULL;
+char *ProgramName = "list_bench";
+
+void
+GetColor(int kind, Pixel *what, const char *name)
+{
+	*what = 0;
+}
+
+void
+Done(int signum)
+{
+	exit(1);
+}
+
+
+static name_list *
+make_list(void)
+{
+	name_list *list = NULL;
+	char buf[64];
+
+	/* Added backwards, since AddToList() puts things at the front */
+	for(int i = NENTRIES - 1 ; i >= 0 ; i--) {
+		switch(i % 10) {
+#ifdef USE_SYS_REGEX
+			case 0:
+				snprintf(buf, sizeof(buf), "^Term%03d", i);
+				break;
+			case 1:
+				snprintf(buf, sizeof(buf), "^Browser-%03d-[0-9]+$", i);
+				break;
+#else
+			case 0:
+				snprintf(buf, sizeof(buf), "Term%03d*", i);
+				break;
+			case 1:
+				snprintf(buf, sizeof(buf), "Browser-%03d-*", i);
+				break;
+#endif
+			default:
+				snprintf(buf, sizeof(buf), "App%04d", i);
+				break;
+		}
+		AddToList(&list, buf, NULL);
+	}
+	return list;
+}
+
+
+static char **
+make_probes(void)
+{
+	char **probes = malloc(NPROBES * sizeof(char *));
+
+	if(probes == NULL) {
+		exit(1);
+	}
+	for(int i = 0 ; i < NPROBES ; i++) {
+		char buf[64];
+
+		/* About half of them match something */
+		switch(i % 4) {
+			case 0:
+				snprintf(buf, sizeof(buf), "App%04d", (i * 7) % NENTRIES);
+				break;
+			case 1:
+				snprintf(buf, sizeof(buf), "Term%03d - shell", i % NENTRIES);
+				break;
+			case 2:
+				snprintf(buf, sizeof(buf), "Unlisted client %d", i);
+				break;
+			default:
+				snprintf(buf, sizeof(buf), "xclock");
+				break;
+		}
+		probes[i] = strdup(buf);
+	}
+	return probes;
+}
+
+
+static double
+run(name_list *list, char **probes, int rounds, int *nfound)
+{
+	struct timespec start, end;
+
+	*nfound = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(int r = 0 ; r < rounds ; r++) {
+		for(int i = 0 ; i < NPROBES ; i++) {
+			if(LookInNameList(list, probes[i]) != NULL) {
+				(*nfound)++;
+			}
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (end.tv_sec - start.tv_sec) * 1e9
+	       + (end.tv_nsec - start.tv_nsec);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	const int rounds = argc > 1 ? atoi(argv[1]) : 100;
+	const long nlookups = (long)rounds * NPROBES;
+	name_list *list = make_list();
+	char **probes = make_probes();
+	double compiled, linear;
+	int cfound, lfound;
+
+	if(rounds <= 0) {
+		fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+		exit(1);
+	}
+
+	/* The old way first, walking the list */
+	list->nomatcher = true;
+	linear = run(list, probes, rounds, &lfound);
+
+	/* And then compiled, which happens on the first lookup */
+	list->nomatcher = false;
+	compiled = run(list, probes, rounds, &cfound);
+
+	printf("%d entries, %ld lookups\n", NENTRIES, nlookups);
+	printf("  compiled: %8.1f ns/lookup\n", compiled / nlookups);
+	printf("  linear:   %8.1f ns/lookup\n", linear / nlookups);
+	printf("  speedup:  %8.1fx\n", linear / compiled);
+	if(cfound != lfound) {
+		printf("MISMATCH: compiled found %d, linear found %d\n",
+		       cfound, lfound);
+		exit(1);
+	}
+
+	FreeList(&list);
+	for(int i = 0 ; i < NPROBES ; i++) {
+		free(probes[i]);
+	}
+	free(probes);
+	return 0;
+}
@@ -49,6 +49,8 @@ ctwm_cl_args CLarg = {
 #endif
 	.client_id       = NULL,
 	.restore_filename = NULL,
+	.record_events   = NULL,
+	.replay_events   = NULL,
 };
 
 
@@ -103,6 +105,10 @@ clargs_parse(int argc, char *argv[])
 		{ "clientId",  required_argument, NULL, 0 },
 		{ "restore",   required_argument, NULL, 0 },
 
+		/* Debugging/performance testing */
+		{ "record-events", required_argument, NULL, 0 },
+		{ "replay-events", required_argument, NULL, 0 },
+
 		{ NULL,        0,                 NULL, 0 },
 	};
 
@@ -242,6 +248,14 @@ clargs_parse(int argc, char *argv[])
 					CLarg.restore_filename = optarg;
 					break;
 				}
+				IFIS("record-events") {
+					CLarg.record_events = optarg;
+					break;
+				}
+				IFIS("replay-events") {
+					CLarg.replay_events = optarg;
+					break;
+				}
 
 				/* Some immediate actions */
 				IFIS("version") {
@@ -326,6 +340,13 @@ clargs_check(void)
 		usage();
 	}
 
+	/* Replaying while recording would just record the replay */
+	if(CLarg.record_events && CLarg.replay_events) {
+		fprintf(stderr, "--record-events is incompatible with "
+		        "--replay-events.\n");
+		usage();
+	}
+
 	/* Guess that's it */
 	return;
 }
@@ -363,6 +384,9 @@ usage(void)
 
 	fprintf(stderr, "%*s[(--window | -w) [win-id]]  [--name name]\n", llen, "");
 
+	fprintf(stderr, "%*s[--record-events file]  [--replay-events file]\n",
+	        llen, "");
+
 	/* Semi-intentionally not documenting --clientId/--restore */
 
 	fprintf(stderr, "%*s[--help]\n", llen, "");
@@ -24,11 +24,16 @@ set(CTWMSRC
 	ctopts.c
 	ctwm.c
 	cursor.c
+	deferred.c
 	drawing.c
 	event_core.c
 	event_handlers.c
 	event_names.c
+	event_record.c
+	event_sources.c
+	event_stats.c
 	event_utils.c
+	frame_index.c
 	functions.c
 	functions_captive.c
 	functions_icmgr_wsmgr.c
@@ -45,7 +50,10 @@ set(CTWMSRC
 	image.c
 	image_bitmap.c
 	image_bitmap_builtin.c
+	image_convert.c
+	image_scale.c
 	image_xwd.c
+	launch.c
 	list.c
 	mask_screen.c
 	menus.c
@@ -56,12 +64,15 @@ set(CTWMSRC
 	parse_be.c
 	parse_yacc.c
 	session.c
+	text_extents.c
 	util.c
 	vscreen.c
 	win_decorations.c
 	win_decorations_init.c
 	win_iconify.c
+	win_index.c
 	win_ops.c
+	win_props.c
 	win_regions.c
 	win_resize.c
 	win_utils.c
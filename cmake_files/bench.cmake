@@ -0,0 +1,9 @@
+# Microbenchmarks.  Only of interest to devs poking at performance, so
+# they're not built by default; "make list_bench" and run it.
+
+# Lookups in a big name list, compiled vs. walking it
+add_executable(list_bench EXCLUDE_FROM_ALL
+	${CMAKE_CURRENT_SOURCE_DIR}/bench/list_bench.c
+	${CMAKE_CURRENT_SOURCE_DIR}/list.c
+)
+target_link_libraries(list_bench ${CTWMLIBS})
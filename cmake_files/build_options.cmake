@@ -13,6 +13,7 @@ option(USE_M4     "Enable m4 support"                  ON )
 option(USE_RPLAY  "Enable librplay sound support"      OFF)
 option(USE_SREGEX "Use regex from libc"                ON )
 option(USE_EWMH   "Support some Extended Window Manager Hints"  ON )
+option(USE_XCB    "Use XCB to batch up startup window queries"  ON )
 
 
 
@@ -104,6 +105,23 @@ else()
 endif(USE_EWMH)
 
 
+# XCB lets us fire off all the queries about existing windows at startup
+# before waiting on any answers.  It's only a speedup though, so if we
+# can't find it just do without.
+if(USE_XCB)
+	if(X11_X11_xcb_FOUND AND X11_xcb_FOUND)
+		include_directories(${X11_X11_xcb_INCLUDE_PATH} ${X11_xcb_INCLUDE_PATH})
+		list(APPEND CTWMLIBS ${X11_X11_xcb_LIB} ${X11_xcb_LIB})
+		message(STATUS "Enabling XCB support.")
+	else()
+		set(USE_XCB OFF)
+		message(STATUS "Couldn't find Xlib-xcb; disabling XCB support.")
+	endif()
+else()
+	message(STATUS "Disabling XCB support.")
+endif(USE_XCB)
+
+
 # System provides regex stuff in libc?
 if(USE_SREGEX)
 	check_include_files(regex.h HAS_REGEX_H)
@@ -8,15 +8,13 @@
 #include <stdlib.h>
 
 #include "colormaps.h"
+#include "ctwm_atoms.h"
+#include "deferred.h"
 #include "screen.h"
+#include "win_props.h"
 
 
-/*
- * From events.c; imported manually since I'm not listing it in events.h
- * because nowhere but here needs it.
- */
-extern bool ColortableThrashing;
-
+static void ReinstallColormapsDeferred(void *unused);
 static Bool UninstallRootColormapQScanner(Display *display, XEvent *ev,
                 char *args);
 
@@ -93,7 +91,7 @@ InstallColormaps(int type, Colormaps *cmaps)
 	cwins = Scr->cmapInfo.cmaps->cwins;
 	scoreboard = Scr->cmapInfo.cmaps->scoreboard;
 
-	ColortableThrashing = false; /* in case installation aborted */
+	CancelColormapReinstall(); /* in case installation aborted */
 
 	state = CM_INSTALLED;
 
@@ -142,6 +140,41 @@ InstallColormaps(int type, Colormaps *cmaps)
 }
 
 
+/*
+ * When clients fight over the colormaps, the ones we think should be
+ * in get put back once the events have settled down.  x-ref
+ * HandleColormapNotify().
+ */
+void
+DeferColormapReinstall(void)
+{
+	DeferWork(DEFER_COLORMAPS, ReinstallColormapsDeferred, NULL);
+}
+
+bool
+ColormapReinstallPending(void)
+{
+	return DeferredPending(ReinstallColormapsDeferred, NULL);
+}
+
+void
+CancelColormapReinstall(void)
+{
+	CancelDeferred(ReinstallColormapsDeferred, NULL);
+}
+
+static void
+ReinstallColormapsDeferred(void *unused)
+{
+	if(!Scr) {
+		/* Not yet; try again next time around */
+		DeferColormapReinstall();
+		return;
+	}
+	InstallColormaps(ColormapNotify, NULL);
+}
+
+
 
 /***********************************************************************
  *
@@ -347,7 +380,8 @@ FetchWmColormapWindows(TwmWindow *tmp)
 		}
 	}
 
-	if(XGetWMColormapWindows(dpy, tmp->w, &cmap_windows,
+	if(WinMayHaveProp(tmp->w, XA_WM_COLORMAP_WINDOWS) &&
+	                XGetWMColormapWindows(dpy, tmp->w, &cmap_windows,
 	                         &number_cmap_windows) &&
 	                number_cmap_windows > 0) {
 
@@ -7,6 +7,9 @@
 
 int InstallWindowColormaps(int type, TwmWindow *tmp);
 int InstallColormaps(int type, Colormaps *cmaps);
+void DeferColormapReinstall(void);
+bool ColormapReinstallPending(void);
+void CancelColormapReinstall(void);
 void InstallRootColormap(void);
 void UninstallRootColormap(void);
 
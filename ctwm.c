@@ -28,6 +28,7 @@
 #include <locale.h>
 
 #ifdef __WAIT_FOR_CHILDS
+#  include <errno.h>
 #  include <sys/wait.h>
 #endif
 
@@ -36,6 +37,10 @@
 #include <X11/Xatom.h>
 #include <X11/Xmu/Error.h>
 #include <X11/extensions/shape.h>
+#ifdef USE_XCB
+#  include <X11/Xlib-xcb.h>
+#  include <xcb/xcb.h>
+#endif
 
 
 #include "ctwm_atoms.h"
@@ -45,13 +50,19 @@
 #include "parse.h"
 #include "version.h"
 #include "colormaps.h"
+#include "event_record.h"
+#include "event_sources.h"
+#include "event_stats.h"
 #include "events.h"
+#include "frame_index.h"
+#include "text_extents.h"
 #include "util.h"
 #include "mask_screen.h"
 #include "animate.h"
 #include "screen.h"
 #include "icons.h"
 #include "iconmgr.h"
+#include "launch.h"
 #include "list.h"
 #include "session.h"
 #include "occupation.h"
@@ -61,6 +72,7 @@
 #include "captive.h"
 #include "vscreen.h"
 #include "win_decorations_init.h"
+#include "win_index.h"
 #include "win_ops.h"
 #include "win_regions.h"
 #include "win_utils.h"
@@ -92,7 +104,8 @@ static Window CreateRootWindow(int x, int y,
                                unsigned int width, unsigned int height);
 static void InternUsefulAtoms(void);
 static void InitVariables(void);
-static bool MappedNotOverride(Window w);
+static Window *FindExistingWindows(unsigned int *nwins);
+static void AdoptExistingWindows(Window *wins, unsigned int nwins);
 
 Cursor  UpperLeftCursor;
 Cursor  TopRightCursor,
@@ -108,9 +121,6 @@ Cursor RightButt;
 Cursor MiddleButt;
 Cursor LeftButt;
 
-XContext TwmContext;            /* context for twm windows */
-XContext MenuContext;           /* context for all menu windows */
-XContext ScreenContext;         /* context to get screen data */
 XContext ColormapContext;       /* context for colormap operations */
 
 XClassHint NoClass;             /* for applications with no class */
@@ -144,6 +154,7 @@ bool RestartPreviousState = true;      /* try to restart in previous state */
 bool RestartFlag = false;
 SIGNAL_T Restart(int signum);
 SIGNAL_T Crash(int signum);
+static char **RestartArgv(void);
 #ifdef __WAIT_FOR_CHILDS
 SIGNAL_T ChildExit(int signum);
 #endif
@@ -158,9 +169,8 @@ SIGNAL_T ChildExit(int signum);
 
 int main(int argc, char **argv)
 {
-	Window croot, parent, *children;
-	unsigned int nchildren;
-	int i, j;
+	Window croot, *existing;
+	unsigned int nexisting;
 	unsigned long valuemask;    /* mask for create windows */
 	XSetWindowAttributes attributes;    /* attributes for create windows */
 	int numManaged, firstscrn, lastscrn, scrnum;
@@ -205,10 +215,13 @@ int main(int argc, char **argv)
 
 	newhandler(SIGINT, Done);
 	signal(SIGHUP, Restart);
+	newhandler(SIGUSR1, EventStatsSignal);
 	newhandler(SIGQUIT, Done);
 	newhandler(SIGTERM, Done);
 #ifdef __WAIT_FOR_CHILDS
 	newhandler(SIGCHLD, ChildExit);
+#else
+	newhandler(SIGCHLD, LaunchChildSignal);
 #endif
 	signal(SIGALRM, SIG_IGN);
 #ifdef NOTRAP
@@ -248,9 +261,6 @@ int main(int argc, char **argv)
 		ReadWinConfigFile(CLarg.restore_filename);
 	}
 	HasShape = XShapeQueryExtension(dpy, &ShapeEventBase, &ShapeErrorBase);
-	TwmContext = XUniqueContext();
-	MenuContext = XUniqueContext();
-	ScreenContext = XUniqueContext();
 	ColormapContext = XUniqueContext();
 
 	InternUsefulAtoms();
@@ -377,7 +387,7 @@ int main(int argc, char **argv)
 		Scr->XineramaRoot = croot;
 		Scr->ShowWelcomeWindow = CLarg.ShowWelcomeWindow;
 
-		XSaveContext(dpy, Scr->Root, ScreenContext, (XPointer) Scr);
+		WinIndexAdd(Scr->Root, Scr, NULL, WR_ROOT, 0);
 
 		if(CLarg.is_captive) {
 			Scr->captivename = AddToCaptiveList(CLarg.captivename);
@@ -616,37 +626,15 @@ int main(int argc, char **argv)
 		EwmhInitScreenLate(Scr);
 #endif /* EWMH */
 
-		XQueryTree(dpy, Scr->Root, &croot, &parent, &children, &nchildren);
 		/*
-		 * weed out icon windows
+		 * Once we know what's out there, nobody else can mess with it
+		 * behind our back anymore: we've got SubstructureRedirect on the
+		 * root, so anything new will come to us as a MapRequest.
 		 */
-		for(i = 0; i < nchildren; i++) {
-			if(children[i]) {
-				XWMHints *wmhintsp = XGetWMHints(dpy, children[i]);
-
-				if(wmhintsp) {
-					if(wmhintsp->flags & IconWindowHint) {
-						for(j = 0; j < nchildren; j++) {
-							if(children[j] == wmhintsp->icon_window) {
-								children[j] = None;
-								break;
-							}
-						}
-					}
-					XFree(wmhintsp);
-				}
-			}
-		}
+		existing = FindExistingWindows(&nexisting);
+		XUngrabServer(dpy);
+		AdoptExistingWindows(existing, nexisting);
 
-		/*
-		 * map all of the non-override windows
-		 */
-		for(i = 0; i < nchildren; i++) {
-			if(children[i] && MappedNotOverride(children[i])) {
-				XUnmapWindow(dpy, children[i]);
-				SimulateMapRequest(children[i]);
-			}
-		}
 		if(Scr->ShowWorkspaceManager && Scr->workSpaceManagerActive) {
 			VirtualScreen *vs;
 			if(Scr->WindowMask) {
@@ -662,6 +650,7 @@ int main(int argc, char **argv)
 					XMapWindow(dpy, vs->wsw->w);
 				}
 				vs->wsw->twm_win->mapped = true;
+				FrameIndexUpdate(vs->wsw->twm_win);
 			}
 		}
 
@@ -681,9 +670,9 @@ int main(int argc, char **argv)
 		                      CopyFromParent, CopyFromParent,
 		                      valuemask, &attributes);
 
-		XmbTextExtents(Scr->SizeFont.font_set,
-		               " 8888 x 8888 ", 13,
-		               &ink_rect, &logical_rect);
+		CachedTextExtents(&Scr->SizeFont,
+		                  " 8888 x 8888 ", 13,
+		                  &ink_rect, &logical_rect);
 		Scr->SizeStringWidth = logical_rect.width;
 		valuemask = (CWBorderPixel | CWBackPixel | CWBitGravity);
 		attributes.bit_gravity = NorthWestGravity;
@@ -714,7 +703,6 @@ int main(int argc, char **argv)
 		Scr->ShapeWindow = XCreateSimpleWindow(dpy, Scr->Root, 0, 0,
 		                                       Scr->rootw, Scr->rooth, 0, 0, 0);
 
-		XUngrabServer(dpy);
 		if(Scr->ShowWelcomeWindow) {
 			UnmaskScreen();
 		}
@@ -739,6 +727,13 @@ int main(int argc, char **argv)
 	HandlingEvents = true;
 	InitEvents();
 	StartAnimation();
+	if(CLarg.record_events) {
+		EventRecordStart(CLarg.record_events);
+	}
+	if(CLarg.replay_events) {
+		EventReplay(CLarg.replay_events);
+		Done(0);
+	}
 	HandleEvents();
 	fprintf(stderr, "Shouldn't return from HandleEvents()!\n");
 	exit(1);
@@ -888,6 +883,7 @@ static void InitVariables(void)
 	Scr->BackingStore = false;
 	Scr->SaveUnder = true;
 	Scr->RandomPlacement = RP_ALL;
+	Scr->SmartPlacement = false;
 	Scr->RandomDisplacementX = 30;
 	Scr->RandomDisplacementY = 30;
 	Scr->DoOpaqueMove = true;
@@ -925,6 +921,7 @@ static void InitVariables(void)
 	Scr->use3Dtitles = false;
 	Scr->use3Dborders = false;
 	Scr->use3Dwmap = false;
+	Scr->usePixmapWmap = false;
 	Scr->SunkFocusWindowTitle = false;
 	Scr->ClearShadowContrast = 50;
 	Scr->DarkShadowContrast  = 40;
@@ -948,6 +945,8 @@ static void InitVariables(void)
 	Scr->AutoFocusToTransients = false; /* kai */
 	Scr->use3Diconborders = false;
 	Scr->OpenWindowTimeout = 0;
+	Scr->ImageCacheSize = 4096;
+	Scr->TitleUpdateRate = 10;
 	Scr->RaiseWhenAutoUnSqueeze = false;
 	Scr->RaiseOnClick = false;
 	Scr->RaiseOnClickButton = 1;
@@ -1130,6 +1129,7 @@ SIGNAL_T Done(int signum)
 #ifdef SOUNDS
 	play_exit_sound();
 #endif
+	EventRecordStop();
 	Reborder(CurrentTime);
 #ifdef EWMH
 	EwmhTerminate();
@@ -1167,6 +1167,7 @@ SIGNAL_T Restart(int signum)
 {
 	fprintf(stderr, "%s:  setting restart flag\n", ProgramName);
 	RestartFlag = true;
+	EventWakeup();
 }
 
 void DoRestart(Time t)
@@ -1174,6 +1175,7 @@ void DoRestart(Time t)
 	RestartFlag = false;
 
 	StopAnimation();
+	EventRecordStop();
 	XSync(dpy, 0);
 	Reborder(t);
 	XSync(dpy, 0);
@@ -1184,10 +1186,56 @@ void DoRestart(Time t)
 
 	fprintf(stderr, "%s:  restarting:  %s\n",
 	        ProgramName, *Argv);
-	execvp(*Argv, Argv);
+	execvp(*Argv, RestartArgv());
 	fprintf(stderr, "%s:  unable to restart:  %s\n", ProgramName, *Argv);
 }
 
+
+/*
+ * What to restart with: our args, minus any --record-events.  Starting
+ * the recording again would truncate the file and lose everything up to
+ * the restart, so we just leave what's been recorded so far.
+ */
+static char **
+RestartArgv(void)
+{
+	char **av;
+	int n, j = 0;
+
+	for(n = 0 ; Argv[n] != NULL ; n++) {
+		/* count */;
+	}
+	av = malloc((n + 1) * sizeof(char *));
+	if(av == NULL) {
+		return Argv;
+	}
+
+	for(int i = 0 ; i < n ; i++) {
+		const char *a = Argv[i];
+
+		if(i > 0 && strcmp(a, "--") == 0) {
+			/* No more options */
+			while(i < n) {
+				av[j++] = Argv[i++];
+			}
+			break;
+		}
+		if(i > 0 && strncmp(a, "--rec", 5) == 0) {
+			/* getopt_long() takes unambiguous abbreviations too */
+			const size_t len = strcspn(a + 2, "=");
+			if(strncmp(a + 2, "record-events", len) == 0) {
+				if(a[2 + len] == '\0' && i + 1 < n) {
+					i++;    // Separate filename arg
+				}
+				continue;
+			}
+		}
+		av[j++] = Argv[i];
+	}
+	av[j] = NULL;
+	return av;
+}
+
 #ifdef __WAIT_FOR_CHILDS
 /*
  * Handler for SIGCHLD. Needed to avoid zombies when an .xinitrc
@@ -1201,6 +1249,8 @@ ChildExit(int signum)
 	int Errno = errno;
 	signal(SIGCHLD, ChildExit);  /* reestablish because we're a one-shot */
 	waitpid(-1, NULL, WNOHANG);   /* reap dead child, ignore status */
+	ChildExitFlag = 1;           /* and have ReapLaunched() catch up */
+	EventWakeup();
 	errno = Errno;               /* restore errno for interrupted sys calls */
 }
 #endif
@@ -1273,15 +1323,202 @@ static Window CreateRootWindow(int x, int y,
 
 
 /*
- * Return true if a window is not set to override_redirect ("Hey!  WM!
- * Leave those wins alone!"), and isn't unmapped.  Used during startup to
- * fake mapping for wins that should be up.
+ * Where w is in the icon window set for FindExistingWindows(), or the
+ * empty slot where it would go.
+ */
+static unsigned int
+IconSlot(const Window *icons, unsigned int nslots, Window w)
+{
+	unsigned int h = (w * 2654435761UL) & (nslots - 1);
+
+	while(icons[h] != None && icons[h] != w) {
+		h = (h + 1) & (nslots - 1);
+	}
+	return h;
+}
+
+
+/*
+ * Find out which of the root's children are mapped and not
+ * override_redirect, and which are some window's icon window.  adopt[]
+ * gets set for the former, and the latter go in the icons hash set;
+ * returns how many of those there were.
+ *
+ * With XCB, we send off the requests for every window before waiting on
+ * any answers, so the whole lot costs about one round trip instead of
+ * two per window.  Plain Xlib has no way to do that, so without it we
+ * ask one at a time.
+ */
+static unsigned int
+ScanExistingWindows(const Window *children, unsigned int nchildren,
+                    bool *adopt, Window *icons, unsigned int iconslots)
+{
+	unsigned int nicons = 0;
+
+#ifdef USE_XCB
+	xcb_connection_t *xc = XGetXCBConnection(dpy);
+	xcb_get_window_attributes_cookie_t *acook;
+	xcb_get_property_cookie_t *hcook;
+
+	acook = malloc(nchildren * sizeof(*acook));
+	hcook = malloc(nchildren * sizeof(*hcook));
+	if(acook == NULL || hcook == NULL) {
+		fprintf(stderr, "%s: Out of memory\n", __func__);
+		Done(0);
+	}
+
+	for(unsigned int i = 0 ; i < nchildren ; i++) {
+		acook[i] = xcb_get_window_attributes(xc, children[i]);
+		/* WM_HINTS is 9 CARD32's; icon_window is the 5th */
+		hcook[i] = xcb_get_property(xc, 0, children[i], XA_WM_HINTS,
+		                            XA_WM_HINTS, 0, 9);
+	}
+
+	/*
+	 * Errors (windows that went away on us) turn up in Xlib's queue,
+	 * and get the usual treatment from TwmErrorHandler().
+	 */
+	for(unsigned int i = 0 ; i < nchildren ; i++) {
+		xcb_get_window_attributes_reply_t *wa;
+		xcb_get_property_reply_t *hints;
+
+		wa = xcb_get_window_attributes_reply(xc, acook[i], NULL);
+		if(wa != NULL) {
+			adopt[i] = !wa->override_redirect
+			           && wa->map_state != XCB_MAP_STATE_UNMAPPED;
+			free(wa);
+		}
+
+		/*
+		 * Icon windows named by override_redirect windows get weeded
+		 * out too, even though we don't manage their owners.
+		 */
+		hints = xcb_get_property_reply(xc, hcook[i], NULL);
+		if(hints != NULL) {
+			if(hints->format == 32 && hints->value_len >= 5) {
+				const uint32_t *h = xcb_get_property_value(hints);
+
+				if((h[0] & IconWindowHint) && h[4] != None) {
+					unsigned int slot = IconSlot(icons, iconslots, h[4]);
+					icons[slot] = h[4];
+					nicons++;
+				}
+			}
+			free(hints);
+		}
+	}
+
+	free(hcook);
+	free(acook);
+#else
+	for(unsigned int i = 0 ; i < nchildren ; i++) {
+		XWindowAttributes wa;
+		XWMHints *wmhintsp;
+
+		if(!XGetWindowAttributes(dpy, children[i], &wa)) {
+			continue;
+		}
+		adopt[i] = !wa.override_redirect && wa.map_state != IsUnmapped;
+
+		/*
+		 * Icon windows named by override_redirect windows get weeded
+		 * out too, even though we don't manage their owners.
+		 */
+		wmhintsp = XGetWMHints(dpy, children[i]);
+		if(wmhintsp) {
+			if((wmhintsp->flags & IconWindowHint)
+			                && wmhintsp->icon_window != None) {
+				unsigned int slot;
+
+				slot = IconSlot(icons, iconslots, wmhintsp->icon_window);
+				icons[slot] = wmhintsp->icon_window;
+				nicons++;
+			}
+			XFree(wmhintsp);
+		}
+	}
+#endif
+
+	return nicons;
+}
+
+
+/*
+ * Find all the windows already up on the screen that we should take
+ * over, at startup or restart.  That's everything mapped that isn't
+ * override_redirect, except for windows that are some other window's
+ * icon window; those get handled along with their owner.
+ *
+ * We need to know about every window before picking any of them, to
+ * know which are icons.  So we gather up what we need from each, and
+ * keep the icon windows in a little hash set so picking them out
+ * doesn't mean going through the whole list again for each one.
+ *
+ * This is the part that needs the server grabbed; the caller can let go
+ * once it's done.  Returns NULL (and *nwins == 0) if there's nothing.
  */
-static bool
-MappedNotOverride(Window w)
+static Window *
+FindExistingWindows(unsigned int *nwins)
 {
-	XWindowAttributes wa;
+	Window croot, parent, *children;
+	unsigned int nchildren;
+	bool *adopt;
+	Window *icons;
+	unsigned int nicons, iconslots, n;
+
+	*nwins = 0;
+	if(!XQueryTree(dpy, Scr->Root, &croot, &parent, &children, &nchildren)
+	                || nchildren == 0) {
+		return NULL;
+	}
+
+	/* Power of 2 at least twice the size, so it never fills up */
+	for(iconslots = 16; iconslots < 2 * nchildren; iconslots <<= 1) {
+		/* nada */;
+	}
+
+	adopt = calloc(nchildren, sizeof(bool));
+	icons = calloc(iconslots, sizeof(Window));
+	if(adopt == NULL || icons == NULL) {
+		fprintf(stderr, "%s: Out of memory\n", __func__);
+		Done(0);
+	}
+
+	nicons = ScanExistingWindows(children, nchildren, adopt,
+	                             icons, iconslots);
+
+	/* Squeeze what we're taking down to the front of the list */
+	n = 0;
+	for(unsigned int i = 0 ; i < nchildren ; i++) {
+		if(!adopt[i]) {
+			continue;
+		}
+		if(nicons && icons[IconSlot(icons, iconslots, children[i])] != None) {
+			continue;
+		}
+		children[n++] = children[i];
+	}
+
+	free(icons);
+	free(adopt);
+
+	*nwins = n;
+	return children;
+}
+
 
-	XGetWindowAttributes(dpy, w, &wa);
-	return ((wa.map_state != IsUnmapped) && (wa.override_redirect != True));
+/*
+ * Bring in what FindExistingWindows() found, and free the list.
+ */
+static void
+AdoptExistingWindows(Window *wins, unsigned int nwins)
+{
+	for(unsigned int i = 0 ; i < nwins ; i++) {
+		XUnmapWindow(dpy, wins[i]);
+		SimulateMapRequest(wins[i]);
+	}
+
+	if(wins != NULL) {
+		XFree(wins);
+	}
 }
@@ -38,6 +38,7 @@
 #include <X11/Intrinsic.h>
 
 #include "types.h"
+#include "occupation_set.h"
 #ifdef EWMH
 #include "ewmh.h"
 #endif
@@ -300,6 +301,7 @@ struct WindowBox {
 	name_list           *winlist;
 	Window              window;
 	struct TwmWindow    *twmwin;
+	FrameIndex          *frameindex;
 };
 
 /* for each window that is on the display, one of these structures
@@ -398,7 +400,8 @@ struct TwmWindow {
 	bool AlwaysSqueezeToGravity;
 	bool DontSetInactive;
 	bool hasfocusvisible;      /* The window has visible focus*/
-	int  occupation;
+	Occupation occupation;
+	WorkSpaceMember *wsmembers; /* its entries in workspaces' member lists */
 	Image *HiliteImage;         /* focus highlight window background */
 	Image *LoliteImage;         /* focus lowlight window background */
 	WindowRegion *wr;
@@ -415,8 +418,13 @@ struct TwmWindow {
 	struct VirtualScreen *parent_vs;
 
 	struct VirtualScreen *savevs;       /* for ShowBackground only */
+	struct FrameIndexSlot *fislot;      /* where it's in the frame index */
 
 	bool nameChanged;  /* did WM_NAME ever change? */
+	/* Name changes held back by TitleUpdateRate */
+	int  nameTimer;             /* EventAddTimer() id, or 0 */
+	long lastNameUpdate;        /* msec, x-ref HandlePropertyNotify() */
+	bool namePending, iconNamePending;
 	/* did the user ever change the width/height? */
 	bool widthEverChangedByUser;
 	bool heightEverChangedByUser;
@@ -447,7 +455,7 @@ struct TWMWinConfigEntry {
 	 * Added this property to facilitate restoration of workspaces when
 	 * restarting a session.
 	 */
-	int occupation;
+	Occupation occupation;
 	/* ====================================================================== */
 
 };
@@ -478,9 +486,6 @@ extern Cursor LeftButt;
 
 extern XClassHint NoClass;
 
-extern XContext TwmContext;
-extern XContext MenuContext;
-extern XContext ScreenContext;
 extern XContext ColormapContext;
 
 extern char *Home;
@@ -504,7 +509,7 @@ extern bool RestartPreviousState;
 extern bool RestartFlag;        /* Flag that is set when SIGHUP is caught */
 void DoRestart(Time t);         /* Function to perform a restart */
 
-#define OCCUPY(w, b) ((b == NULL) ? 1 : (w->occupation & (1 << b->number)))
+#define OCCUPY(w, b) ((b == NULL) ? 1 : OccTest(&(w)->occupation, (b)->number))
 
 
 /*
@@ -536,6 +541,9 @@ typedef struct _ctwm_cl_args {
 
 	char  *client_id;          // --clientId, session client id
 	char  *restore_filename;   // --restore, session filename
+
+	char  *record_events;      // --record-events, file to record to
+	char  *replay_events;      // --replay-events, file to replay
 } ctwm_cl_args;
 extern ctwm_cl_args CLarg;
 
@@ -0,0 +1,179 @@
+/*
+ * Work put off until ctwm's caught up with the X server
+ *
+ * Plenty of things don't need doing on every event, just once things
+ * have settled down: repacking an icon manager after windows come and
+ * go, republishing the EWMH client lists, auto-raising the window the
+ * pointer ended up in, reinstalling colormaps after a fight over them.
+ * Doing them right away when a burst of events comes in means doing
+ * them over and over, only for the next event to undo it.
+ *
+ * So they get queued up here instead, and the main loop runs them once
+ * there are no more X events waiting.  Each piece of work is a function
+ * and its argument, and that pair is its identity; queueing the same
+ * thing again while it's still waiting does nothing, so however many
+ * times it was asked for, it gets done once.  It's run in order of
+ * priority, and in the order queued within that.
+ *
+ * Work that's queued while the queue is being run waits for the next
+ * time around, so something that keeps requeueing itself (like the
+ * auto-raise) still only goes once per trip through the loop.
+ */
+
+#include "ctwm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "deferred.h"
+
+
+typedef struct Deferred {
+	DeferPriority pri;
+	DeferredProc  proc;
+	void          *data;
+	unsigned long seq;        // When it was queued
+} Deferred;
+
+/* Kept sorted by pri, then seq.  There's rarely more than a handful. */
+static Deferred *queue;
+static int nqueued, queuesize;
+static unsigned long nextseq;
+
+
+static int
+find_deferred(DeferredProc proc, void *data)
+{
+	for(int i = 0 ; i < nqueued ; i++) {
+		if(queue[i].proc == proc && queue[i].data == data) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+static void
+remove_deferred(int i)
+{
+	nqueued--;
+	for(; i < nqueued ; i++) {
+		queue[i] = queue[i + 1];
+	}
+}
+
+
+/*
+ * Queue proc(data) to be run when things are idle, unless it already is.
+ */
+void
+DeferWork(DeferPriority pri, DeferredProc proc, void *data)
+{
+	int i;
+
+	if(find_deferred(proc, data) >= 0) {
+		return;
+	}
+
+	if(nqueued == queuesize) {
+		const int nsize = queuesize ? queuesize * 2 : 16;
+		Deferred *nq = realloc(queue, nsize * sizeof(Deferred));
+		if(nq == NULL) {
+			fprintf(stderr, "%s: Out of memory\n", __func__);
+			Done(0);
+		}
+		queue = nq;
+		queuesize = nsize;
+	}
+
+	/* After everything of the same or more urgent priority */
+	for(i = nqueued ; i > 0 && queue[i - 1].pri > pri ; i--) {
+		queue[i] = queue[i - 1];
+	}
+	queue[i].pri  = pri;
+	queue[i].proc = proc;
+	queue[i].data = data;
+	queue[i].seq  = nextseq++;
+	nqueued++;
+}
+
+
+/*
+ * Never mind about proc(data).
+ */
+void
+CancelDeferred(DeferredProc proc, void *data)
+{
+	const int i = find_deferred(proc, data);
+
+	if(i >= 0) {
+		remove_deferred(i);
+	}
+}
+
+
+/*
+ * Never mind about anything to do with data; it's going away.
+ */
+void
+CancelDeferredData(void *data)
+{
+	for(int i = nqueued - 1 ; i >= 0 ; i--) {
+		if(queue[i].data == data) {
+			remove_deferred(i);
+		}
+	}
+}
+
+
+bool
+DeferredPending(DeferredProc proc, void *data)
+{
+	return find_deferred(proc, data) >= 0;
+}
+
+
+/*
+ * If proc(data) is waiting, do it now; for when something needs its
+ * results right away.
+ */
+void
+FlushDeferred(DeferredProc proc, void *data)
+{
+	const int i = find_deferred(proc, data);
+
+	if(i >= 0) {
+		remove_deferred(i);
+		proc(data);
+	}
+}
+
+
+/*
+ * Called from the main loop.  Runs what was queued before we got here,
+ * as long as nothing's come in from X meanwhile.
+ */
+void
+RunDeferredWork(void)
+{
+	const unsigned long upto = nextseq;
+
+	while(nqueued > 0 && !QLength(dpy)) {
+		DeferredProc proc;
+		void *data;
+		int i;
+
+		for(i = 0 ; i < nqueued && queue[i].seq >= upto ; i++) {
+			/* Queued while we were running; next time */
+		}
+		if(i == nqueued) {
+			break;
+		}
+
+		/* Off the queue first, so it can put itself back on */
+		proc = queue[i].proc;
+		data = queue[i].data;
+		remove_deferred(i);
+		proc(data);
+	}
+}
@@ -0,0 +1,28 @@
+/*
+ * Work put off until ctwm's caught up with the X server
+ */
+#ifndef _CTWM_DEFERRED_H
+#define _CTWM_DEFERRED_H
+
+typedef void (*DeferredProc)(void *data);
+
+/*
+ * What runs first, when there's a choice.  Raising and lowering come
+ * first, so anything else looking at the stacking sees the result.
+ */
+typedef enum {
+	DEFER_AUTORAISE,
+	DEFER_AUTOLOWER,
+	DEFER_COLORMAPS,
+	DEFER_ICONMGR,
+	DEFER_EWMH,
+} DeferPriority;
+
+void DeferWork(DeferPriority pri, DeferredProc proc, void *data);
+void CancelDeferred(DeferredProc proc, void *data);
+void CancelDeferredData(void *data);
+bool DeferredPending(DeferredProc proc, void *data);
+void FlushDeferred(DeferredProc proc, void *data);
+void RunDeferredWork(void);
+
+#endif /* _CTWM_DEFERRED_H */
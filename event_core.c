@@ -29,24 +29,30 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <errno.h>
-#include <sys/time.h>
 
 #include <X11/extensions/shape.h>
 
+#include "add_window.h"
 #include "animate.h"
 #include "captive.h"
-#include "colormaps.h"
+#include "deferred.h"
 #include "events.h"
 #include "event_handlers.h"
 #include "event_internal.h"
 #include "event_names.h"
+#include "event_record.h"
+#include "event_sources.h"
+#include "event_stats.h"
 #include "functions.h"
 #include "iconmgr.h"
 #include "image.h"
+#include "launch.h"
+#include "list.h"
 #include "screen.h"
+#include "text_extents.h"
 #include "util.h"
 #include "version.h"
+#include "win_index.h"
 #include "win_utils.h"
 #ifdef SOUNDS
 #include "sound.h"
@@ -55,9 +61,9 @@
 
 static void CtwmNextEvent(Display *display, XEvent  *event);
 static bool StashEventTime(XEvent *ev);
+static void LookupEventWindow(Window w);
 static void dumpevent(const XEvent *e);
 
-#define MAX_X_EVENT 256
 event_proc EventHandler[MAX_X_EVENT]; /* event handler jump table */
 int Context = C_NO_CONTEXT;     /* current button press context */
 XEvent Event;                   /* the current event */
@@ -76,16 +82,18 @@ int CurrentDragY;
 Time EventTime = CurrentTime;       /* until Xlib does this for us */
 
 /* Maybe more staticizable later? */
-bool enter_flag;
-bool leave_flag;
 TwmWindow *enter_win, *raise_win, *leave_win, *lower_win;
 
+TwmWindow *Tmp_win; // the current twm window; shared with other event code
+
 /*
- * Not static because shared with colormaps.c and other events files, but
- * not listed in events.h since nowhere else needs it.
+ * What the window index knew about the event's window when we
+ * dispatched it; handlers can look at the role to see which piece of
+ * Tmp_win (or which menu, etc) it's for.  This describes the original
+ * Event.xany.window; handlers that rewrite that or Tmp_win are on their
+ * own afterward.
  */
-bool ColortableThrashing;
-TwmWindow *Tmp_win; // the current twm window; shared with other event code
+WinRef EventRef;
 
 int ButtonPressed = -1;
 bool Cancel = false;
@@ -99,12 +107,13 @@ bool Cancel = false;
 void
 InitEvents(void)
 {
+	/* Setup our non-X event sources */
+	InitEventSources();
+
 	/* Clear out vars */
 	ResizeWindow = (Window) 0;
 	DragWindow = (Window) 0;
-	enter_flag = false;
 	enter_win = raise_win = NULL;
-	leave_flag = false;
 	leave_win = lower_win = NULL;
 
 	/* Set everything to unknown to start */
@@ -172,25 +181,6 @@ void
 HandleEvents(void)
 {
 	while(1) {
-		if(enter_flag && !QLength(dpy)) {
-			if(enter_win && enter_win != raise_win) {
-				AutoRaiseWindow(enter_win);   /* sets enter_flag T */
-			}
-			else {
-				enter_flag = false;
-			}
-		}
-		if(leave_flag && !QLength(dpy)) {
-			if(leave_win && leave_win != lower_win) {
-				AutoLowerWindow(leave_win);  /* sets leave_flag T */
-			}
-			else {
-				leave_flag = false;
-			}
-		}
-		if(ColortableThrashing && !QLength(dpy) && Scr) {
-			InstallColormaps(ColormapNotify, NULL);
-		}
 		WindowMoved = false;
 
 		CtwmNextEvent(dpy, &Event);
@@ -211,77 +201,50 @@ HandleEvents(void)
 
 /*
  * Grab the next event in the queue to process.
+ *
+ * If there's nothing from X waiting, we sleep in EventWait() until there
+ * is, handling any other input sources and timers (animation, the
+ * session manager connection, etc) as they come up.  x-ref
+ * event_sources.c.
  */
 static void
 CtwmNextEvent(Display *display, XEvent *event)
 {
-	int         fd;
-	struct timeval timeout, *tout = NULL;
-	const bool animate = (AnimationActive && MaybeAnimate);
+	const int fd = ConnectionNumber(display);
 
-#define NEXTEVENT XtAppNextEvent(appContext, event)
-
-	if(RestartFlag) {
-		DoRestart(CurrentTime);
-	}
-	if(XEventsQueued(display, QueuedAfterFlush) != 0) {
-		NEXTEVENT;
-		return;
-	}
-	fd = ConnectionNumber(display);
-
-	if(animate) {
-		TryToAnimate();
-	}
-	if(RestartFlag) {
-		DoRestart(CurrentTime);
-	}
-	if(! MaybeAnimate) {
-		NEXTEVENT;
-		return;
-	}
-	if(animate) {
-		tout = (AnimationSpeed > 0) ? &timeout : NULL;
-	}
 	while(1) {
-		fd_set mask;
-		int found;
-
-		FD_ZERO(&mask);
-		FD_SET(fd, &mask);
-		if(animate) {
-			timeout = AnimateTimeout;
-		}
-		found = select(fd + 1, &mask, NULL, NULL, tout);
 		if(RestartFlag) {
 			DoRestart(CurrentTime);
 		}
-		if(found < 0) {
-			if(errno != EINTR) {
-				perror("select");
-			}
-			continue;
+		if(ChildExitFlag) {
+			ChildExitFlag = 0;
+			ReapLaunched();
 		}
-		if(FD_ISSET(fd, &mask)) {
-			NEXTEVENT;
-			return;
+		if(DumpStatsFlag) {
+			DumpStatsFlag = 0;
+			EventStatsDump(stderr);
+			TextExtentsStatsDump(stderr);
+			ListLookupsStatsDump(stderr);
+			GrabStatsDump(stderr);
 		}
-		if(found == 0) {
-			if(animate) {
-				TryToAnimate();
-			}
-			if(RestartFlag) {
-				DoRestart(CurrentTime);
-			}
-			if(! MaybeAnimate) {
-				NEXTEVENT;
-				return;
-			}
-			continue;
+
+		/*
+		 * Anything put off until things quieted down; x-ref deferred.c.
+		 * That includes what timers and fd's handled in EventWait() last
+		 * time around put off, which shouldn't have to wait for X to
+		 * wake us up.  The flush below sends whatever it does.
+		 */
+		RunDeferredWork();
+
+		if(XEventsQueued(display, QueuedAfterFlush) != 0) {
+			XtAppNextEvent(appContext, event);
+			return;
 		}
-	}
 
-#undef NEXTEVENT
+		/* Nothing from X; get anything else going, and sleep */
+		ScheduleAnimation();
+		EventWait(fd);
+	}
 
 	/* NOTREACHED */
 }
@@ -302,11 +265,16 @@ bool
 DispatchEvent(void)
 {
 	Window w = Event.xany.window;
+	const int type = Event.type;
+	const int qlen = QLength(dpy);
 	ScreenInfo *thisScr;
+	struct timespec start;
 
+	EventRecord(&Event, false);
+	EventStatsStart(&start);
 	StashEventTime(&Event);
-	Tmp_win = GetTwmWindow(w);
-	thisScr = GetTwmScreen(&Event);
+	LookupEventWindow(w);
+	thisScr = EventRef.scr ? EventRef.scr : GetTwmScreen(&Event);
 
 	dumpevent(&Event);
 
@@ -328,6 +296,7 @@ DispatchEvent(void)
 		play_sound(Event.type);
 #endif
 		(*EventHandler[Event.type])();
+		EventStatsEnd(type, &start, qlen);
 	}
 	return true;
 }
@@ -338,11 +307,16 @@ bool
 DispatchEvent2(void)
 {
 	Window w = Event.xany.window;
+	const int type = Event.type;
+	const int qlen = QLength(dpy);
 	ScreenInfo *thisScr;
+	struct timespec start;
 
+	EventRecord(&Event, true);
+	EventStatsStart(&start);
 	StashEventTime(&Event);
-	Tmp_win = GetTwmWindow(w);
-	thisScr = GetTwmScreen(&Event);
+	LookupEventWindow(w);
+	thisScr = EventRef.scr ? EventRef.scr : GetTwmScreen(&Event);
 
 	dumpevent(&Event);
 
@@ -360,11 +334,13 @@ DispatchEvent2(void)
 	if(menuFromFrameOrWindowOrTitlebar) {
 		if(Event.type == Expose) {
 			HandleExpose();
+			EventStatsEnd(type, &start, qlen);
 		}
 	}
 	else {
 		if(Event.type >= 0 && Event.type < MAX_X_EVENT) {
 			(*EventHandler[Event.type])();
+			EventStatsEnd(type, &start, qlen);
 		}
 	}
 
@@ -374,6 +350,25 @@ DispatchEvent2(void)
 
 
 
+/*
+ * Find what we know about the window an event happened in, and set up
+ * EventRef and Tmp_win from it.
+ */
+static void
+LookupEventWindow(Window w)
+{
+	const WinRef *wr = WinIndexFind(w);
+
+	if(wr) {
+		EventRef = *wr;
+	}
+	else {
+		EventRef = (WinRef) { .w = w, .role = WR_NONE };
+	}
+	Tmp_win = EventRef.twm_win;
+}
+
+
 /*
  * Stash the time of the given event in our EventTime global.  Called
  * during dispatching the event.
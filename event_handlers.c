@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/time.h>
+#include <time.h>
 
 #include <X11/Xatom.h>
 #include <X11/extensions/shape.h>
@@ -41,6 +42,8 @@
 #include "event_handlers.h"
 #include "event_internal.h"
 #include "event_names.h"
+#include "event_sources.h"
+#include "frame_index.h"
 #include "functions.h"
 #include "functions_defs.h"
 #include "gram.tab.h"
@@ -52,10 +55,12 @@
 #include "otp.h"
 #include "parse.h"
 #include "screen.h"
+#include "text_extents.h"
 #include "util.h"
 #include "vscreen.h"
 #include "win_decorations.h"
 #include "win_iconify.h"
+#include "win_index.h"
 #include "win_ops.h"
 #include "win_regions.h"
 #include "win_resize.h"
@@ -70,6 +75,11 @@ static void do_key_menu(MenuRoot *menu,         /* menu to pop up */
 /* Only called from HandleFocusChange() */
 static void HandleFocusIn(void);
 static void HandleFocusOut(void);
+static void ThrottleNameChange(TwmWindow *twm_win, bool icon);
+static void NameTimerProc(void *data);
+static void ApplyNameChanges(TwmWindow *twm_win);
+static void UpdateWindowName(TwmWindow *twm_win);
+static void UpdateWindowIconName(TwmWindow *twm_win);
 
 /*
  * This currently needs to live in the broader scope because of how it's
@@ -153,8 +163,8 @@ void HandleColormapNotify(void)
 		}
 		cmap->state &= ~CM_INSTALLED;
 
-		if(!ColortableThrashing) {
-			ColortableThrashing = true;
+		if(!ColormapReinstallPending()) {
+			DeferColormapReinstall();
 			XSync(dpy, 0);
 		}
 
@@ -238,7 +248,7 @@ void HandleColormapNotify(void)
 				InstallColormaps(ColormapNotify, NULL);
 			}
 			else {
-				ColortableThrashing = false; /* Gross Hack for HP WABI. CL. */
+				CancelColormapReinstall(); /* Gross Hack for HP WABI. CL. */
 			}
 		}
 	}
@@ -809,46 +819,59 @@ void HandleKeyPress(void)
 		XUngrabKeyboard(dpy, CurrentTime);
 		AlternateKeymap = 0;
 	}
-	for(key = Scr->FuncKeyRoot.next; key != NULL; key = key->next) {
-		if(key->keycode == Event.xkey.keycode &&
-		                key->mods == modifier &&
-		                (key->cont == Context || key->cont == C_NAME)) {
-			/* weed out the functions that don't make sense to execute
-			 * from a key press
-			 * TODO: add keyboard moving/resizing of windows.
-			 */
-			if(key->func == F_MOVE || key->func == F_RESIZE) {
-				return;
-			}
+	for(key = NextFuncKey(NULL, Event.xkey.keycode, modifier, Context);
+	                key != NULL;
+	                key = NextFuncKey(key, Event.xkey.keycode, modifier, Context)) {
+		/* weed out the functions that don't make sense to execute
+		 * from a key press
+		 * TODO: add keyboard moving/resizing of windows.
+		 */
+		if(key->func == F_MOVE || key->func == F_RESIZE) {
+			return;
+		}
 
-			if(key->cont != C_NAME) {
-				if(key->func == F_MENU) {
-					ButtonWindow = Tmp_win;
-					do_key_menu(key->menu, (Window) None);
-				}
-				else {
+		if(key->cont != C_NAME) {
+			if(key->func == F_MENU) {
+				ButtonWindow = Tmp_win;
+				do_key_menu(key->menu, (Window) None);
+			}
+			else {
 #ifdef EWMH_DESKTOP_ROOT
-					if(Context == C_ROOT && Tmp_win != NULL) {
-						Context = C_WINDOW;
-						fprintf(stderr, "HandleKeyPress: wt_Desktop -> C_WINDOW\n");
-					}
+				if(Context == C_ROOT && Tmp_win != NULL) {
+					Context = C_WINDOW;
+					fprintf(stderr, "HandleKeyPress: wt_Desktop -> C_WINDOW\n");
+				}
 #endif /* EWMH */
-					ExecuteFunction(key->func, key->action, Event.xany.window,
-					                Tmp_win, &Event, Context, false);
+				ExecuteFunction(key->func, key->action, Event.xany.window,
+				                Tmp_win, &Event, Context, false);
+				if(!AlternateKeymap && !AlternateContext) {
+					XUngrabPointer(dpy, CurrentTime);
+				}
+			}
+			return;
+		}
+		else {
+			bool matched = false;
+			len = strlen(key->win_name);
+
+			/* try and match the name first */
+			for(Tmp_win = Scr->FirstWindow; Tmp_win != NULL;
+			                Tmp_win = Tmp_win->next) {
+				if(!strncmp(key->win_name, Tmp_win->name, len)) {
+					matched = true;
+					ExecuteFunction(key->func, key->action, Tmp_win->frame,
+					                Tmp_win, &Event, C_FRAME, false);
 					if(!AlternateKeymap && !AlternateContext) {
 						XUngrabPointer(dpy, CurrentTime);
 					}
 				}
-				return;
 			}
-			else {
-				bool matched = false;
-				len = strlen(key->win_name);
 
-				/* try and match the name first */
+			/* now try the res_name */
+			if(!matched)
 				for(Tmp_win = Scr->FirstWindow; Tmp_win != NULL;
 				                Tmp_win = Tmp_win->next) {
-					if(!strncmp(key->win_name, Tmp_win->name, len)) {
+					if(!strncmp(key->win_name, Tmp_win->class.res_name, len)) {
 						matched = true;
 						ExecuteFunction(key->func, key->action, Tmp_win->frame,
 						                Tmp_win, &Event, C_FRAME, false);
@@ -858,36 +881,21 @@ void HandleKeyPress(void)
 					}
 				}
 
-				/* now try the res_name */
-				if(!matched)
-					for(Tmp_win = Scr->FirstWindow; Tmp_win != NULL;
-					                Tmp_win = Tmp_win->next) {
-						if(!strncmp(key->win_name, Tmp_win->class.res_name, len)) {
-							matched = true;
-							ExecuteFunction(key->func, key->action, Tmp_win->frame,
-							                Tmp_win, &Event, C_FRAME, false);
-							if(!AlternateKeymap && !AlternateContext) {
-								XUngrabPointer(dpy, CurrentTime);
-							}
-						}
-					}
-
-				/* now try the res_class */
-				if(!matched)
-					for(Tmp_win = Scr->FirstWindow; Tmp_win != NULL;
-					                Tmp_win = Tmp_win->next) {
-						if(!strncmp(key->win_name, Tmp_win->class.res_class, len)) {
-							matched = true;
-							ExecuteFunction(key->func, key->action, Tmp_win->frame,
-							                Tmp_win, &Event, C_FRAME, false);
-							if(!AlternateKeymap && !AlternateContext) {
-								XUngrabPointer(dpy, CurrentTime);
-							}
+			/* now try the res_class */
+			if(!matched)
+				for(Tmp_win = Scr->FirstWindow; Tmp_win != NULL;
+				                Tmp_win = Tmp_win->next) {
+					if(!strncmp(key->win_name, Tmp_win->class.res_class, len)) {
+						matched = true;
+						ExecuteFunction(key->func, key->action, Tmp_win->frame,
+						                Tmp_win, &Event, C_FRAME, false);
+						if(!AlternateKeymap && !AlternateContext) {
+							XUngrabPointer(dpy, CurrentTime);
 						}
 					}
-				if(matched) {
-					return;
 				}
+			if(matched) {
+				return;
 			}
 		}
 	}
@@ -913,6 +921,211 @@ void HandleKeyPress(void)
 
 
 
+/*
+ * Name changes.  Some clients retitle themselves many times a second
+ * (progress in the title, music players, ...), and each change means
+ * laying out and repainting the title, and updating the icon, the icon
+ * manager and the WSM map.  So each window only gets that done
+ * TitleUpdateRate times a second.  Changes coming in faster than that
+ * are just noted, and a timer picks them up when the time's up.  We
+ * fetch the property then, so however many changes there were collapse
+ * into one, and the last one always wins.
+ */
+static long
+name_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+static void
+ThrottleNameChange(TwmWindow *twm_win, bool icon)
+{
+	long wait;
+
+	if(icon) {
+		twm_win->iconNamePending = true;
+	}
+	else {
+		twm_win->namePending = true;
+	}
+
+	/* Already waiting?  It'll pick this one up too. */
+	if(twm_win->nameTimer != 0) {
+		return;
+	}
+
+	if(Scr->TitleUpdateRate > 0) {
+		wait = twm_win->lastNameUpdate + 1000 / Scr->TitleUpdateRate
+		       - name_clock();
+		if(wait > 0) {
+			twm_win->nameTimer = EventAddTimer(wait, NameTimerProc, twm_win);
+			if(twm_win->nameTimer != 0) {
+				return;
+			}
+			/* No timer for us?  Just do it now then. */
+		}
+	}
+
+	ApplyNameChanges(twm_win);
+}
+
+static void
+NameTimerProc(void *data)
+{
+	TwmWindow *twm_win = data;
+	ScreenInfo *savedScr = Scr;
+	const WinRef *wr = WinIndexFind(twm_win->w);
+
+	twm_win->nameTimer = 0;
+	if(wr && wr->scr) {
+		Scr = wr->scr;
+	}
+	ApplyNameChanges(twm_win);
+	Scr = savedScr;
+}
+
+static void
+ApplyNameChanges(TwmWindow *twm_win)
+{
+	twm_win->lastNameUpdate = name_clock();
+	if(twm_win->namePending) {
+		twm_win->namePending = false;
+		UpdateWindowName(twm_win);
+	}
+	if(twm_win->iconNamePending) {
+		twm_win->iconNamePending = false;
+		UpdateWindowIconName(twm_win);
+	}
+}
+
+
+/*
+ * Pick up a new WM_NAME.
+ */
+static void
+UpdateWindowName(TwmWindow *twm_win)
+{
+	XRectangle inc_rect;
+	XRectangle logical_rect;
+	char *prop = GetWMPropertyString(twm_win->w, XA_WM_NAME);
+
+	if(prop == NULL) {
+		return;
+	}
+
+	if(strcmp(twm_win->name, prop) == 0) {
+		/* No change, just free and skip out */
+		free(prop);
+		return;
+	}
+
+	/* It's changing, free the old */
+	FreeWMPropertyString(twm_win->name);
+
+	twm_win->name = prop;
+	twm_win->nameChanged = true;
+	CachedTextExtents(&Scr->TitleBarFont,
+	                  twm_win->name, strlen(twm_win->name),
+	                  &inc_rect, &logical_rect);
+	twm_win->name_width = logical_rect.width;
+
+	/* recompute the priority if necessary */
+	if(Scr->AutoPriority) {
+		OtpRecomputePrefs(twm_win);
+	}
+
+	SetupWindow(twm_win, twm_win->frame_x, twm_win->frame_y,
+	            twm_win->frame_width, twm_win->frame_height, -1);
+
+	if(twm_win->title_w) {
+		XClearArea(dpy, twm_win->title_w, 0, 0, 0, 0, True);
+	}
+	if(Scr->AutoOccupy) {
+		WmgrRedoOccupation(twm_win);
+	}
+
+#if 0
+	/* Experimental, not yet working. */
+	{
+		ColorPair cp;
+		int f, b;
+
+		f = GetColorFromList(Scr->TitleForegroundL, twm_win->name,
+		                     &twm_win->class, &cp.fore);
+		b = GetColorFromList(Scr->TitleBackgroundL, twm_win->name,
+		                     &twm_win->class, &cp.back);
+		if(f || b) {
+			if(Scr->use3Dtitles  && !Scr->BeNiceToColormap) {
+				GetShadeColors(&cp);
+			}
+			twm_win->title = cp;
+		}
+		f = GetColorFromList(Scr->BorderColorL, twm_win->name,
+		                     &twm_win->class, &cp.fore);
+		b = GetColorFromList(Scr->BorderColorL, twm_win->name,
+		                     &twm_win->class, &cp.back);
+		if(f || b) {
+			if(Scr->use3Dborders && !Scr->BeNiceToColormap) {
+				GetShadeColors(&cp);
+			}
+			twm_win->borderC = cp;
+		}
+
+		f = GetColorFromList(Scr->BorderTileForegroundL, twm_win->name,
+		                     &twm_win->class, &cp.fore);
+		b = GetColorFromList(Scr->BorderTileBackgroundL, twm_win->name,
+		                     &twm_win->class, &cp.back);
+		if(f || b) {
+			if(Scr->use3Dborders && !Scr->BeNiceToColormap) {
+				GetShadeColors(&cp);
+			}
+			twm_win->border_tile = cp;
+		}
+	}
+#endif
+
+	/*
+	 * if the icon name is NoName, set the name of the icon to be
+	 * the same as the window
+	 */
+	if(twm_win->icon_name == NoName) {
+		twm_win->icon_name = strdup(twm_win->name);
+		RedoIcon(twm_win);
+	}
+	AutoPopupMaybe(twm_win);
+}
+
+
+/*
+ * And a new WM_ICON_NAME.
+ */
+static void
+UpdateWindowIconName(TwmWindow *twm_win)
+{
+	char *prop = GetWMPropertyString(twm_win->w, XA_WM_ICON_NAME);
+
+	if(prop == NULL) {
+		return;
+	}
+
+	/* No change?  Nothing to do. */
+	if(strcmp(twm_win->icon_name, prop) == 0) {
+		free(prop);
+		return;
+	}
+
+	/* Else, free the old one and set it */
+	FreeWMPropertyString(twm_win->icon_name);
+	twm_win->icon_name = prop;
+	RedoIcon(twm_win);
+	AutoPopupMaybe(twm_win);
+}
+
+
+
 /***********************************************************************
  *
  *  Procedure:
@@ -929,8 +1142,6 @@ void HandlePropertyNotify(void)
 	unsigned long valuemask;            /* mask for create windows */
 	XSetWindowAttributes attributes;    /* attributes for create windows */
 	Pixmap pm;
-	XRectangle inc_rect;
-	XRectangle logical_rect;
 	Icon *icon;
 
 
@@ -982,116 +1193,13 @@ void HandlePropertyNotify(void)
 #define MAX_NAME_LEN 200L               /* truncate to this many */
 
 	switch(Event.xproperty.atom) {
-		case XA_WM_NAME: {
-			char *prop = GetWMPropertyString(Tmp_win->w, XA_WM_NAME);
-			if(prop == NULL) {
-				return;
-			}
-
-			if(strcmp(Tmp_win->name, prop) == 0) {
-				/* No change, just free and skip out */
-				free(prop);
-				return;
-			}
-
-			/* It's changing, free the old */
-			FreeWMPropertyString(Tmp_win->name);
-
-			Tmp_win->name = prop;
-			Tmp_win->nameChanged = true;
-			XmbTextExtents(Scr->TitleBarFont.font_set,
-			               Tmp_win->name, strlen(Tmp_win->name),
-			               &inc_rect, &logical_rect);
-			Tmp_win->name_width = logical_rect.width;
-
-			/* recompute the priority if necessary */
-			if(Scr->AutoPriority) {
-				OtpRecomputePrefs(Tmp_win);
-			}
-
-			SetupWindow(Tmp_win, Tmp_win->frame_x, Tmp_win->frame_y,
-			            Tmp_win->frame_width, Tmp_win->frame_height, -1);
-
-			if(Tmp_win->title_w) {
-				XClearArea(dpy, Tmp_win->title_w, 0, 0, 0, 0, True);
-			}
-			if(Scr->AutoOccupy) {
-				WmgrRedoOccupation(Tmp_win);
-			}
-
-#if 0
-			/* Experimental, not yet working. */
-			{
-				ColorPair cp;
-				int f, b;
-
-				f = GetColorFromList(Scr->TitleForegroundL, Tmp_win->name,
-				                     &Tmp_win->class, &cp.fore);
-				b = GetColorFromList(Scr->TitleBackgroundL, Tmp_win->name,
-				                     &Tmp_win->class, &cp.back);
-				if(f || b) {
-					if(Scr->use3Dtitles  && !Scr->BeNiceToColormap) {
-						GetShadeColors(&cp);
-					}
-					Tmp_win->title = cp;
-				}
-				f = GetColorFromList(Scr->BorderColorL, Tmp_win->name,
-				                     &Tmp_win->class, &cp.fore);
-				b = GetColorFromList(Scr->BorderColorL, Tmp_win->name,
-				                     &Tmp_win->class, &cp.back);
-				if(f || b) {
-					if(Scr->use3Dborders && !Scr->BeNiceToColormap) {
-						GetShadeColors(&cp);
-					}
-					Tmp_win->borderC = cp;
-				}
-
-				f = GetColorFromList(Scr->BorderTileForegroundL, Tmp_win->name,
-				                     &Tmp_win->class, &cp.fore);
-				b = GetColorFromList(Scr->BorderTileBackgroundL, Tmp_win->name,
-				                     &Tmp_win->class, &cp.back);
-				if(f || b) {
-					if(Scr->use3Dborders && !Scr->BeNiceToColormap) {
-						GetShadeColors(&cp);
-					}
-					Tmp_win->border_tile = cp;
-				}
-			}
-#endif
-
-			/*
-			 * if the icon name is NoName, set the name of the icon to be
-			 * the same as the window
-			 */
-			if(Tmp_win->icon_name == NoName) {
-				Tmp_win->icon_name = strdup(Tmp_win->name);
-				RedoIcon(Tmp_win);
-			}
-			AutoPopupMaybe(Tmp_win);
-
+		case XA_WM_NAME:
+			ThrottleNameChange(Tmp_win, false);
 			break;
-		}
-
-		case XA_WM_ICON_NAME: {
-			char *prop = GetWMPropertyString(Tmp_win->w, XA_WM_ICON_NAME);
-			if(prop == NULL) {
-				return;
-			}
-
-			/* No change?  Nothing to do. */
-			if(strcmp(Tmp_win->icon_name, prop) == 0) {
-				free(prop);
-				break;
-			}
-
-			/* Else, free the old one and set it */
-			FreeWMPropertyString(Tmp_win->icon_name);
-			Tmp_win->icon_name = prop;
-			RedoIcon(Tmp_win);
-			AutoPopupMaybe(Tmp_win);
 
+		case XA_WM_ICON_NAME:
+			ThrottleNameChange(Tmp_win, true);
 			break;
-		}
 
 		case XA_WM_HINTS: {
 			{
@@ -1160,6 +1268,7 @@ void HandlePropertyNotify(void)
 					 * Now, if the old window isn't ours, unmap it, otherwise
 					 * just get rid of it completely.
 					 */
+					WinIndexDel(icon->w);
 					if(icon->w_not_ours) {
 						if(icon->w != Tmp_win->wmhints->icon_window) {
 							XUnmapWindow(dpy, icon->w);
@@ -1184,8 +1293,7 @@ void HandlePropertyNotify(void)
 					icon->w = Tmp_win->wmhints->icon_window;
 					XSelectInput(dpy, icon->w,
 					             KeyPressMask | ButtonPressMask | ButtonReleaseMask);
-					XSaveContext(dpy, icon->w, TwmContext, (XPointer)Tmp_win);
-					XSaveContext(dpy, icon->w, ScreenContext, (XPointer)Scr);
+					WinIndexAdd(icon->w, Scr, Tmp_win, WR_ICON, 0);
 					XDefineCursor(dpy, icon->w, Scr->IconCursor);
 				}
 			}
@@ -1321,6 +1429,7 @@ void HandlePropertyNotify(void)
 			}
 			else if(Event.xproperty.atom == XA_WM_OCCUPATION) {
 				unsigned char *prop;
+				Occupation occ;
 				if(XGetWindowProperty(dpy, Tmp_win->w, Event.xproperty.atom, 0L, MAX_NAME_LEN,
 				                      False,
 				                      XA_STRING, &actual, &actual_format, &nitems,
@@ -1328,7 +1437,8 @@ void HandlePropertyNotify(void)
 				                actual == None) {
 					return;
 				}
-				ChangeOccupation(Tmp_win, GetMaskFromProperty(prop, nitems));
+				occ = GetMaskFromProperty(prop, nitems);
+				ChangeOccupation(Tmp_win, &occ);
 				XFree(prop);
 			}
 #ifdef EWMH
@@ -1399,11 +1509,10 @@ static void flush_expose(Window w);
 
 void HandleExpose(void)
 {
-	MenuRoot *tmp;
 	VirtualScreen *vs;
 
-	if(XFindContext(dpy, Event.xany.window, MenuContext, (XPointer *)&tmp) == 0) {
-		PaintMenu(tmp, &Event);
+	if(EventRef.role == WR_MENU) {
+		PaintMenu(EventRef.menu, &Event);
 		return;
 	}
 
@@ -1416,48 +1525,63 @@ void HandleExpose(void)
 		flush_expose(Event.xany.window);
 	}
 	else if(Tmp_win != NULL) {
-		if(Scr->use3Dborders && (Event.xany.window == Tmp_win->frame)) {
-			PaintBorders(Tmp_win, ((Tmp_win == Scr->Focus) ? true : false));
-			flush_expose(Event.xany.window);
-			return;
-		}
-		else if(Event.xany.window == Tmp_win->title_w) {
-			PaintTitle(Tmp_win);
-			flush_expose(Event.xany.window);
-			return;
-		}
-		else if(Tmp_win->icon && (Event.xany.window == Tmp_win->icon->w) &&
-		                ! Scr->NoIconTitlebar &&
-		                ! LookInList(Scr->NoIconTitle, Tmp_win->name, &Tmp_win->class)) {
-			PaintIcon(Tmp_win);
-			flush_expose(Event.xany.window);
-			return;
-		}
-		else if(Tmp_win->titlebuttons) {
-			int i;
-			TBWindow *tbw;
-			Window w = Event.xany.window;
-			int nb = Scr->TBInfo.nleft + Scr->TBInfo.nright;
+		/*
+		 * The window index tells us which piece of Tmp_win this is, so
+		 * we can go right to painting it.
+		 */
+		switch(EventRef.role) {
+			case WR_FRAME:
+				if(Scr->use3Dborders) {
+					PaintBorders(Tmp_win, ((Tmp_win == Scr->Focus) ? true : false));
+					flush_expose(Event.xany.window);
+					return;
+				}
+				break;
+
+			case WR_TITLE:
+				PaintTitle(Tmp_win);
+				flush_expose(Event.xany.window);
+				return;
+
+			case WR_ICON:
+				if(! Scr->NoIconTitlebar &&
+				                ! LookInList(Scr->NoIconTitle, Tmp_win->name,
+				                             &Tmp_win->class)) {
+					PaintIcon(Tmp_win);
+					flush_expose(Event.xany.window);
+					return;
+				}
+				break;
+
+			case WR_TITLEBUTTON:
+				if(Tmp_win->titlebuttons) {
+					TBWindow *tbw = &Tmp_win->titlebuttons[EventRef.index];
 
-			/*
-			 * This looks an awful lot like a manual reimplementation of
-			 * PaintTitleButtons().  It's not quite though, it's just
-			 * looking up one button to paint it.  And it would be a
-			 * little grody trying to shoehorn it in.
-			 */
-			for(i = 0, tbw = Tmp_win->titlebuttons; i < nb; i++, tbw++) {
-				if(w == tbw->window) {
 					PaintTitleButton(Tmp_win, tbw);
 					flush_expose(tbw->window);
 					return;
 				}
-			}
-		}
-		for(vs = Scr->vScreenList; vs != NULL; vs = vs->next) {
-			if(Tmp_win == vs->wsw->twm_win) {
-				WMgrHandleExposeEvent(vs, &Event);
+				break;
+
+			case WR_WSMGR_BUTTON:
+			case WR_WSMGR_MAP:
+			case WR_WSMGR_MAPWIN:
+				WMgrHandleExposeEvent(EventRef.vs, &Event);
 				flush_expose(Event.xany.window);
 				return;
+
+			default:
+				break;
+		}
+
+		/* Otherwise, the WSM's own windows need the WSM code to handle */
+		if(Tmp_win->iswspmgr) {
+			for(vs = Scr->vScreenList; vs != NULL; vs = vs->next) {
+				if(Tmp_win == vs->wsw->twm_win) {
+					WMgrHandleExposeEvent(vs, &Event);
+					flush_expose(Event.xany.window);
+					return;
+				}
 			}
 		}
 		if(Tmp_win == Scr->workSpaceMgr.occupyWindow->twm_win) {
@@ -1502,14 +1626,14 @@ static void remove_window_from_ring(TwmWindow *tmp)
 	TwmWindow *prev = tmp->ring.prev, *next = tmp->ring.next;
 
 	if(enter_win == tmp) {
-		enter_flag = false;
+		SetAutoRaisePending(false);
 		enter_win = NULL;
 	}
 	if(raise_win == Tmp_win) {
 		raise_win = NULL;
 	}
 	if(leave_win == tmp) {
-		leave_flag = false;
+		SetAutoLowerPending(false);
 		leave_win = NULL;
 	}
 	if(lower_win == Tmp_win) {
@@ -1581,43 +1705,32 @@ void HandleDestroyNotify(void)
 			}
 		}
 	}
-	XDeleteContext(dpy, Tmp_win->w, TwmContext);
-	XDeleteContext(dpy, Tmp_win->w, ScreenContext);
-	XDeleteContext(dpy, Tmp_win->frame, TwmContext);
-	XDeleteContext(dpy, Tmp_win->frame, ScreenContext);
+	WinIndexDel(Tmp_win->w);
+	WinIndexDel(Tmp_win->frame);
 	if(Tmp_win->icon && Tmp_win->icon->w) {
-		XDeleteContext(dpy, Tmp_win->icon->w, TwmContext);
-		XDeleteContext(dpy, Tmp_win->icon->w, ScreenContext);
+		WinIndexDel(Tmp_win->icon->w);
 	}
 	if(Tmp_win->title_height) {
 		int nb = Scr->TBInfo.nleft + Scr->TBInfo.nright;
 
-		XDeleteContext(dpy, Tmp_win->title_w, TwmContext);
-		XDeleteContext(dpy, Tmp_win->title_w, ScreenContext);
+		WinIndexDel(Tmp_win->title_w);
 		if(Tmp_win->hilite_wl) {
-			XDeleteContext(dpy, Tmp_win->hilite_wl, TwmContext);
-			XDeleteContext(dpy, Tmp_win->hilite_wl, ScreenContext);
+			WinIndexDel(Tmp_win->hilite_wl);
 		}
 		if(Tmp_win->hilite_wr) {
-			XDeleteContext(dpy, Tmp_win->hilite_wr, TwmContext);
-			XDeleteContext(dpy, Tmp_win->hilite_wr, ScreenContext);
+			WinIndexDel(Tmp_win->hilite_wr);
 		}
 		if(Tmp_win->lolite_wr) {
-			XDeleteContext(dpy, Tmp_win->lolite_wr, TwmContext);
-			XDeleteContext(dpy, Tmp_win->lolite_wr, ScreenContext);
+			WinIndexDel(Tmp_win->lolite_wr);
 		}
 		if(Tmp_win->lolite_wl) {
-			XDeleteContext(dpy, Tmp_win->lolite_wl, TwmContext);
-			XDeleteContext(dpy, Tmp_win->lolite_wl, ScreenContext);
+			WinIndexDel(Tmp_win->lolite_wl);
 		}
 		if(Tmp_win->titlebuttons) {
 			int i;
 
 			for(i = 0; i < nb; i++) {
-				XDeleteContext(dpy, Tmp_win->titlebuttons[i].window,
-				               TwmContext);
-				XDeleteContext(dpy, Tmp_win->titlebuttons[i].window,
-				               ScreenContext);
+				WinIndexDel(Tmp_win->titlebuttons[i].window);
 			}
 		}
 		/*
@@ -1669,8 +1782,10 @@ void HandleDestroyNotify(void)
 		DeleteIcon(icon);
 		Tmp_win->icon = NULL;
 	}
-	Tmp_win->occupation = 0;
+	EventRemoveTimer(Tmp_win->nameTimer);
+	ForgetWorkSpaceMembers(Tmp_win);
 	RemoveIconManager(Tmp_win);                                 /* 7 */
+	FrameIndexRemove(Tmp_win);
 	if(Scr->FirstWindow == Tmp_win) {
 		Scr->FirstWindow = Tmp_win->next;
 	}
@@ -1699,6 +1814,10 @@ void HandleDestroyNotify(void)
 	}
 	free_cwins(Tmp_win);                                        /* 9 */
 	if(Tmp_win->titlebuttons) {                                 /* 10 */
+		int nb = Scr->TBInfo.nleft + Scr->TBInfo.nright;
+		for(int i = 0 ; i < nb ; i++) {
+			ReleaseImage(Tmp_win->titlebuttons[i].image);
+		}
 		free(Tmp_win->titlebuttons);
 		Tmp_win->titlebuttons = NULL;
 	}
@@ -1816,6 +1935,7 @@ void HandleMapRequest(void)
 				SetMapStateProp(Tmp_win, NormalState);
 				SetRaiseWindow(Tmp_win);
 				Tmp_win->mapped = true;
+				FrameIndexUpdate(Tmp_win);
 				if(Scr->ClickToFocus && Tmp_win->wmhints->input) {
 					SetFocus(Tmp_win, CurrentTime);
 				}
@@ -1837,6 +1957,7 @@ void HandleMapRequest(void)
 					AddToWorkSpace(Scr->currentvs->wsw->currentwspc->name, Tmp_win);
 				}
 				Tmp_win->mapped = true;
+				FrameIndexUpdate(Tmp_win);
 				if(Tmp_win->UnmapByMovingFarAway) {
 					XMoveWindow(dpy, Tmp_win->frame, Scr->rootw + 1, Scr->rooth + 1);
 					XMapWindow(dpy, Tmp_win->w);
@@ -1870,6 +1991,7 @@ void HandleMapRequest(void)
 		}
 		else {
 			Tmp_win->mapped = true;
+			FrameIndexUpdate(Tmp_win);
 		}
 	}
 	if(Tmp_win->mapped) {
@@ -1925,6 +2047,7 @@ void HandleMapNotify(void)
 	XUngrabServer(dpy);
 	XFlush(dpy);
 	Tmp_win->mapped = true;
+	FrameIndexUpdate(Tmp_win);
 	Tmp_win->isicon = false;
 	Tmp_win->icon_on = false;
 }
@@ -1948,7 +2071,7 @@ void HandleUnmapNotify(void)
 	 * to WithdrawnState should send a synthetic UnmapNotify with the
 	 * event field set to (pseudo-)root, in case the window is already
 	 * unmapped (which is the case for twm for IconicState).  Unfortunately,
-	 * we looked for the TwmContext using that field, so try the window
+	 * we looked up the TwmWindow using that field, so try the window
 	 * field also.
 	 */
 	if(Tmp_win == NULL) {
@@ -2188,7 +2311,7 @@ void HandleButtonRelease(void)
 		}
 
 		if(Scr->NumAutoRaises) {
-			enter_flag = true;
+			SetAutoRaisePending(true);
 			enter_win = NULL;
 			raise_win = ((DragWindow == Tmp_win->frame && !Scr->NoRaiseMove)
 			             ? Tmp_win : NULL);
@@ -2198,7 +2321,7 @@ void HandleButtonRelease(void)
 
 #if 0
 		if(Scr->NumAutoLowers) {
-			leave_flag = true;
+			SetAutoLowerPending(true);
 			leave_win = NULL;
 			lower_win = ((DragWindow == Tmp_win->frame)
 			             ? Tmp_win : NULL);
@@ -2400,10 +2523,7 @@ void HandleButtonPress(void)
 
 	/* pop down the menu, if any */
 
-	if(XFindContext(dpy, Event.xbutton.window, MenuContext,
-	                (XPointer *) &mr) != XCSUCCESS) {
-		mr = NULL;
-	}
+	mr = (EventRef.role == WR_MENU) ? EventRef.menu : NULL;
 	if(ActiveMenu && (! ActiveMenu->pinned) &&
 	                (Event.xbutton.subwindow != ActiveMenu->w)) {
 		PopDownMenu();
@@ -2477,35 +2597,31 @@ void HandleButtonPress(void)
 	}
 
 	/* check the title bar buttons */
-	if(Tmp_win && Tmp_win->title_height && Tmp_win->titlebuttons) {
-		int i;
-		TBWindow *tbw;
+	if(Tmp_win && Tmp_win->title_height && Tmp_win->titlebuttons
+	                && EventRef.role == WR_TITLEBUTTON
+	                && EventRef.twm_win == Tmp_win) {
+		TBWindow *tbw = &Tmp_win->titlebuttons[EventRef.index];
 		TitleButtonFunc *tbf;
-		int nb = Scr->TBInfo.nleft + Scr->TBInfo.nright;
 
 		modifier = Event.xbutton.state & mods_used;
 		modifier = set_mask_ignore(modifier);
 
-		for(i = 0, tbw = Tmp_win->titlebuttons; i < nb; i++, tbw++) {
-			if(Event.xany.window == tbw->window) {
-				for(tbf = tbw->info->funs; tbf; tbf = tbf->next) {
-					if(tbf->num == ButtonPressed
-					                && tbf->mods == modifier) {
-						switch(tbf->func) {
-							case F_MENU :
-								Context = C_TITLE;
-								ButtonWindow = Tmp_win;
-								do_menu(tbf->menuroot, tbw->window);
-								break;
-
-							default :
-								ExecuteFunction(tbf->func, tbf->action,
-								                Event.xany.window, Tmp_win,
-								                &Event, C_TITLE, false);
-						}
-						return;
-					}
+		for(tbf = tbw->info->funs; tbf; tbf = tbf->next) {
+			if(tbf->num == ButtonPressed
+			                && tbf->mods == modifier) {
+				switch(tbf->func) {
+					case F_MENU :
+						Context = C_TITLE;
+						ButtonWindow = Tmp_win;
+						do_menu(tbf->menuroot, tbw->window);
+						break;
+
+					default :
+						ExecuteFunction(tbf->func, tbf->action,
+						                Event.xany.window, Tmp_win,
+						                &Event, C_TITLE, false);
 				}
+				return;
 			}
 		}
 	}
@@ -3130,17 +3246,17 @@ void HandleEnterNotify(void)
 			 */
 			if(Tmp_win->auto_raise) {
 				enter_win = Tmp_win;
-				if(enter_flag == false) {
+				if(!AutoRaisePending()) {
 					AutoRaiseWindow(Tmp_win);
 				}
 			}
-			else if(enter_flag && raise_win == Tmp_win) {
+			else if(AutoRaisePending() && raise_win == Tmp_win) {
 				enter_win = Tmp_win;
 			}
 			/*
 			 * set ring leader
 			 */
-			if(Tmp_win->ring.next && (!enter_flag || raise_win == enter_win)) {
+			if(Tmp_win->ring.next && (!AutoRaisePending() || raise_win == enter_win)) {
 				Scr->RingLeader = Tmp_win;
 			}
 			XSync(dpy, 0);
@@ -3151,8 +3267,12 @@ void HandleEnterNotify(void)
 	/*
 	 * Find the menu that we are dealing with now; punt if unknown
 	 */
-	if(XFindContext(dpy, ewp->window, MenuContext, (XPointer *)&mr) != XCSUCCESS) {
-		return;
+	{
+		const WinRef *wr = WinIndexFind(ewp->window);
+		if(wr == NULL || wr->role != WR_MENU) {
+			return;
+		}
+		mr = wr->menu;
 	}
 
 	if(! ActiveMenu && mr->pinned && (RootFunction == 0)) {
@@ -3364,11 +3484,11 @@ void HandleLeaveNotify(void)
 		/* Autolower modification. */
 		if(Tmp_win->auto_lower) {
 			leave_win = Tmp_win;
-			if(leave_flag == false) {
+			if(!AutoLowerPending()) {
 				AutoLowerWindow(Tmp_win);
 			}
 		}
-		else if(leave_flag && lower_win == Tmp_win) {
+		else if(AutoLowerPending() && lower_win == Tmp_win) {
 			leave_win = Tmp_win;
 		}
 
@@ -4,12 +4,18 @@
 #ifndef _CTWM_EVENT_INTERNAL_H
 #define _CTWM_EVENT_INTERNAL_H
 
+#include "win_index.h"
+
 
 /* event_utils.c */
 /* AutoRaiseWindow in events.h (temporarily?) */
 void SetRaiseWindow(TwmWindow *tmp);
 void AutoPopupMaybe(TwmWindow *tmp);
 void AutoLowerWindow(TwmWindow *tmp);
+bool AutoRaisePending(void);
+void SetAutoRaisePending(bool pending);
+bool AutoLowerPending(void);
+void SetAutoLowerPending(bool pending);
 Window WindowOfEvent(XEvent *e);
 ScreenInfo *GetTwmScreen(XEvent *event);
 void SynthesiseFocusOut(Window w);
@@ -17,9 +23,7 @@ void SynthesiseFocusIn(Window w);
 
 
 extern TwmWindow *Tmp_win;
-extern bool ColortableThrashing;
-extern bool enter_flag;
-extern bool leave_flag;
+extern WinRef EventRef;
 extern TwmWindow *enter_win, *raise_win, *leave_win, *lower_win;
 
 
@@ -0,0 +1,949 @@
+/*
+ * Binary event recording and replay
+ *
+ * The tracefile stuff (x-ref DebugTrace() and dumpevent()) is fine for
+ * eyeballing what's happening, but it's no help for figuring out whether
+ * some change makes things faster or slower, because sluggishness tends
+ * to only show up in real sessions with lots of windows and workspaces
+ * that nobody can reproduce by hand.  So this lets us save every event
+ * we dispatch in a compact binary form (--record-events), and later feed
+ * the same stream back through DispatchEvent() (--replay-events), timing
+ * how long it takes.
+ *
+ * The catch is that the windows and atoms in a recording are XID's from
+ * the session it was recorded in, which mean nothing on the server it's
+ * replayed against (typically an Xvfb with a pile of synthetic clients).
+ * So the first time the recording sees a window, it writes out what that
+ * window is to us (from the window index): its role, and the class and
+ * name of the TwmWindow it belongs to.  Atoms likewise get written out by
+ * name.  The replay side then matches those up against what it's
+ * managing, and rewrites the events to use its own windows.  Events
+ * involving windows it can't find a match for are skipped.
+ *
+ * Windows we don't know anything about yet (most importantly new
+ * clients, before we've managed them) just get their XID written out.
+ * On replay, those get bound to one of the replaying server's windows
+ * when they first turn up in a MapRequest or CreateNotify: the first
+ * child of the parent that isn't ours, isn't override-redirect, and
+ * hasn't been bound to anything else yet (and isn't mapped, for a
+ * MapRequest).  So the replaying side should have created matching
+ * windows for new clients, unmapped, in the same order.
+ *
+ * Some things inherently don't work out: things like interactive moves
+ * and menus run their own loops reading straight from the X server, so
+ * replaying the ButtonPress that started one will just sit and wait for
+ * real input.  And atoms or windows buried in ClientMessage data aren't
+ * rewritten.  Recordings are in host byte order, and only readable on
+ * the same sort of machine.
+ */
+
+#include "ctwm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "event_record.h"
+#include "event_stats.h"
+#include "events.h"
+#include "iconmgr.h"
+#include "icons.h"
+#include "screen.h"
+#include "vscreen.h"
+#include "win_index.h"
+
+
+/*
+ * File format.  A header, followed by a series of records.  Each record
+ * is a fixed header, then len bytes of data.
+ */
+#define EVREC_MAGIC  "CTWMEVR1"
+#define EVREC_BOM    0x01020304U
+
+typedef struct EvRecHeader {
+	char     magic[8];
+	uint32_t bom;          // Byte order check
+	uint16_t evsize;       // sizeof(XEvent)
+	uint16_t longsize;     // sizeof(long)
+} EvRecHeader;
+
+typedef enum {
+	EVR_EVENT  = 1,        // data is the start of an XEvent
+	EVR_WINDOW = 2,        // data is an EvRecWindow and strings
+	EVR_ATOM   = 3,        // data is a uint32_t atom and its name
+} EvRecKind;
+
+#define EVF_NESTED   0x01  // From DispatchEvent2()
+
+typedef struct EvRecRecord {
+	uint8_t  kind;
+	uint8_t  flags;
+	uint16_t len;
+	uint32_t delta;        // usec since the previous record
+} EvRecRecord;
+
+/*
+ * What a window is.  Followed by the owner's res_name, res_class, and
+ * name (or the menu's name for WR_MENU), each NUL-terminated.
+ */
+typedef struct EvRecWindow {
+	uint32_t xid;
+	uint32_t owner;        // TwmWindow.w of what it belongs to
+	int16_t  index;        // WinRef.index, or which hilite/iconmgr
+	uint8_t  role;         // WinRole
+	uint8_t  scrnum;
+	uint8_t  vsnum;        // Which VirtualScreen for WR_WSMGR_*
+	uint8_t  pad[3];
+} EvRecWindow;
+
+#define EVR_MAXSTR 255
+
+
+/*
+ * Both sides keep a little hash of what they've seen.  The recording
+ * side maps windows to what it last said about them (so it knows when
+ * it needs to say something new), and atoms to whether it's said
+ * anything.  The replay side maps recorded windows and atoms to its own,
+ * and remembers which of its own TwmWindows are already spoken for.
+ * XID's never have the top 3 bits set, so we use them to keep the
+ * different sorts of keys apart.
+ */
+#define XM_ATOM   (1UL << 31)
+#define XM_OWNER  (1UL << 30)
+#define XM_CLAIM  (1UL << 29)
+
+/* Value for a recorded window that we haven't bound to one of ours yet */
+#define XM_UNBOUND (1ULL << 63)
+
+typedef struct XMapEnt {
+	unsigned long key;
+	uint64_t val;
+} XMapEnt;
+static XMapEnt *xmap = NULL;
+static unsigned int xmap_size = 0;
+static unsigned int xmap_count = 0;
+
+static uint64_t *xmap_get(unsigned long key);
+static void xmap_put(unsigned long key, uint64_t val);
+static void xmap_free(void);
+
+
+/* Recording state */
+static FILE *recfile = NULL;
+static struct timespec reclast;
+
+
+static int event_windows(XEvent *ev, Window **wp, bool *req);
+static int event_atoms(XEvent *ev, Atom **ap);
+static size_t event_size(int type);
+static void record_window(Window w);
+static void record_atom(Atom a);
+static void write_record(EvRecKind kind, int flags, const void *data,
+                         size_t len);
+static Window replay_window(const EvRecWindow *rw, const char *rname,
+                            const char *rclass, char *name);
+static void replay_bind_new(const XEvent *ev, Window rparent, Window rwin);
+
+
+
+/*
+ * Start recording to a file.  Called from startup with the
+ * --record-events arg.
+ */
+bool
+EventRecordStart(const char *file)
+{
+	EvRecHeader hdr;
+
+	recfile = fopen(file, "w");
+	if(recfile == NULL) {
+		fprintf(stderr, "%s: unable to open event recording file %s\n",
+		        ProgramName, file);
+		return false;
+	}
+	setvbuf(recfile, NULL, _IOFBF, 64 * 1024);
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, EVREC_MAGIC, sizeof(hdr.magic));
+	hdr.bom      = EVREC_BOM;
+	hdr.evsize   = sizeof(XEvent);
+	hdr.longsize = sizeof(long);
+	fwrite(&hdr, sizeof(hdr), 1, recfile);
+
+	clock_gettime(CLOCK_MONOTONIC, &reclast);
+	return true;
+}
+
+
+/*
+ * Finish up any recording.  Called on the way out (and before
+ * restarting).
+ */
+void
+EventRecordStop(void)
+{
+	if(recfile == NULL) {
+		return;
+	}
+	fclose(recfile);
+	recfile = NULL;
+	xmap_free();
+}
+
+
+/*
+ * Record an event we're about to dispatch.  Called from the top of
+ * DispatchEvent() and DispatchEvent2(), before anything has fiddled
+ * with it.
+ */
+void
+EventRecord(const XEvent *ev, bool nested)
+{
+	XEvent tmp;
+	Window *wp[4];
+	Atom *ap[2];
+	bool req[4];
+	int n;
+
+	if(recfile == NULL) {
+		return;
+	}
+
+	/* Describe any windows or atoms it mentions that we haven't yet */
+	tmp = *ev;
+	n = event_windows(&tmp, wp, req);
+	for(int i = 0 ; i < n ; i++) {
+		record_window(*wp[i]);
+	}
+	n = event_atoms(&tmp, ap);
+	for(int i = 0 ; i < n ; i++) {
+		record_atom(*ap[i]);
+	}
+
+	write_record(EVR_EVENT, nested ? EVF_NESTED : 0, ev,
+	             event_size(ev->type));
+
+	if(ferror(recfile)) {
+		fprintf(stderr, "%s: error writing event recording, stopping\n",
+		        ProgramName);
+		EventRecordStop();
+	}
+}
+
+
+/*
+ * Write out a window's description, if it's changed from what we last
+ * said (or we never said anything).
+ */
+static void
+record_window(Window w)
+{
+	const WinRef *wr;
+	EvRecWindow rw;
+	const char *strs[3] = { "", "", "" };
+	char buf[sizeof(rw) + 3 * (EVR_MAXSTR + 1)];
+	size_t len;
+	uint64_t sig, *oldsig;
+
+	if(w == None) {
+		return;
+	}
+
+	memset(&rw, 0, sizeof(rw));
+	rw.xid = w;
+	wr = WinIndexFind(w);
+	if(wr) {
+		TwmWindow *t = wr->twm_win;
+
+		rw.role   = wr->role;
+		rw.index  = wr->index;
+		rw.scrnum = wr->scr ? wr->scr->screen : 0;
+
+		if(t) {
+			rw.owner = t->w;
+			strs[0] = t->class.res_name  ? t->class.res_name  : "";
+			strs[1] = t->class.res_class ? t->class.res_class : "";
+			strs[2] = t->name ? t->name : "";
+		}
+
+		/*
+		 * Some roles cover several windows with the same index;
+		 * figure out which one this is.
+		 */
+		if(t && wr->role == WR_HILITE) {
+			const Window hl[4] = { t->hilite_wl, t->hilite_wr,
+			                       t->lolite_wl, t->lolite_wr
+			                     };
+			for(int i = 0 ; i < 4 ; i++) {
+				if(hl[i] == w) {
+					rw.index = i;
+				}
+			}
+		}
+		if(t && (wr->role == WR_ICONMGR_ENTRY
+		                || wr->role == WR_ICONMGR_ICON)) {
+			int i = 0;
+			for(WList *wl = t->iconmanagerlist ; wl ; wl = wl->nextv, i++) {
+				if(wl->w == w || wl->icon == w) {
+					rw.index = i;
+					break;
+				}
+			}
+		}
+		if(wr->vs && wr->scr) {
+			int i = 0;
+			for(VirtualScreen *vs = wr->scr->vScreenList ; vs ;
+			                vs = vs->next, i++) {
+				if(vs == wr->vs) {
+					rw.vsnum = i;
+					break;
+				}
+			}
+		}
+		if(wr->role == WR_MENU && wr->menu && wr->menu->name) {
+			strs[2] = wr->menu->name;
+		}
+	}
+
+	/*
+	 * Same as last time?  The top bit is never set in an XID, so it
+	 * marks that we've said something, even if it's just the XID of a
+	 * window we don't know (which would otherwise look like nothing).
+	 */
+	sig = (1ULL << 63)
+	      | ((uint64_t)rw.owner << 32) | ((uint64_t)rw.vsnum << 24)
+	      | ((uint64_t)rw.role << 16) | (uint16_t)rw.index;
+	oldsig = xmap_get(w);
+	if((oldsig ? *oldsig : 0) == sig) {
+		return;
+	}
+	xmap_put(w, sig);
+
+	/* Nope, write it up */
+	memcpy(buf, &rw, sizeof(rw));
+	len = sizeof(rw);
+	for(int i = 0 ; i < 3 ; i++) {
+		size_t sl = strlen(strs[i]);
+		if(sl > EVR_MAXSTR) {
+			sl = EVR_MAXSTR;
+		}
+		memcpy(buf + len, strs[i], sl);
+		len += sl;
+		buf[len++] = '\0';
+	}
+	write_record(EVR_WINDOW, 0, buf, len);
+}
+
+
+/*
+ * Write out an atom's name, if we haven't already.
+ */
+static void
+record_atom(Atom a)
+{
+	char *name;
+	char buf[sizeof(uint32_t) + EVR_MAXSTR + 1];
+	uint32_t a32 = a;
+	size_t sl;
+
+	if(a == None || xmap_get(a | XM_ATOM) != NULL) {
+		return;
+	}
+	xmap_put(a | XM_ATOM, 1);
+
+	name = XGetAtomName(dpy, a);
+	if(name == NULL) {
+		return;
+	}
+	sl = strlen(name);
+	if(sl > EVR_MAXSTR) {
+		sl = EVR_MAXSTR;
+	}
+	memcpy(buf, &a32, sizeof(a32));
+	memcpy(buf + sizeof(a32), name, sl);
+	buf[sizeof(a32) + sl] = '\0';
+	XFree(name);
+
+	write_record(EVR_ATOM, 0, buf, sizeof(a32) + sl + 1);
+}
+
+
+static void
+write_record(EvRecKind kind, int flags, const void *data, size_t len)
+{
+	EvRecRecord rec;
+	struct timespec ts;
+	int64_t us;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	us = (int64_t)(ts.tv_sec - reclast.tv_sec) * 1000000
+	     + (ts.tv_nsec - reclast.tv_nsec) / 1000;
+	reclast = ts;
+
+	rec.kind  = kind;
+	rec.flags = flags;
+	rec.len   = len;
+	rec.delta = (us < 0) ? 0 : (us > UINT32_MAX ? UINT32_MAX : us);
+	fwrite(&rec, sizeof(rec), 1, recfile);
+	fwrite(data, len, 1, recfile);
+}
+
+
+
+/*
+ * Play back a recording through DispatchEvent(), as fast as we can, and
+ * say how long it took.  This is run after startup is complete, so
+ * whatever windows are going to be there are already managed.
+ */
+void
+EventReplay(const char *file)
+{
+	FILE *f;
+	EvRecHeader hdr;
+	EvRecRecord rec;
+	char buf[UINT16_MAX + 1];
+	struct timespec start, end;
+	uint64_t span = 0;
+	int nreplayed = 0, nskipped = 0;
+
+	f = fopen(file, "r");
+	if(f == NULL) {
+		fprintf(stderr, "%s: unable to open event recording %s\n",
+		        ProgramName, file);
+		return;
+	}
+	if(fread(&hdr, sizeof(hdr), 1, f) != 1
+	                || memcmp(hdr.magic, EVREC_MAGIC, sizeof(hdr.magic)) != 0) {
+		fprintf(stderr, "%s: %s isn't an event recording\n",
+		        ProgramName, file);
+		fclose(f);
+		return;
+	}
+	if(hdr.bom != EVREC_BOM || hdr.evsize != sizeof(XEvent)
+	                || hdr.longsize != sizeof(long)) {
+		fprintf(stderr, "%s: %s was recorded on an incompatible system\n",
+		        ProgramName, file);
+		fclose(f);
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while(fread(&rec, sizeof(rec), 1, f) == 1) {
+		if(rec.len > 0 && fread(buf, rec.len, 1, f) != 1) {
+			fprintf(stderr, "%s: truncated event recording\n", ProgramName);
+			break;
+		}
+		buf[rec.len] = '\0';
+		span += rec.delta;
+
+		switch(rec.kind) {
+			case EVR_WINDOW: {
+				EvRecWindow rw;
+				char *rname, *rclass, *name;
+				Window w;
+
+				if(rec.len < sizeof(rw)) {
+					break;
+				}
+				memcpy(&rw, buf, sizeof(rw));
+				rname  = buf + sizeof(rw);
+				rclass = rname + strlen(rname) + 1;
+				name   = rclass + strlen(rclass) + 1;
+				if(name >= buf + rec.len) {
+					rclass = name = buf + rec.len;
+				}
+
+				if(rw.role == WR_NONE) {
+					/* Unless we've already found it a window, it's waiting */
+					uint64_t *lw = xmap_get(rw.xid);
+					if(lw == NULL || *lw == None) {
+						xmap_put(rw.xid, XM_UNBOUND);
+					}
+					break;
+				}
+				w = replay_window(&rw, rname, rclass, name);
+				xmap_put(rw.xid, w);
+				break;
+			}
+
+			case EVR_ATOM: {
+				uint32_t a32;
+
+				if(rec.len <= sizeof(a32)) {
+					break;
+				}
+				memcpy(&a32, buf, sizeof(a32));
+				xmap_put(a32 | XM_ATOM,
+				         XInternAtom(dpy, buf + sizeof(a32), False));
+				break;
+			}
+
+			case EVR_EVENT: {
+				XEvent ev;
+				Window *wp[4];
+				Atom *ap[2];
+				bool req[4];
+				bool ok = true;
+				int n;
+
+				memset(&ev, 0, sizeof(ev));
+				memcpy(&ev, buf, rec.len < sizeof(ev) ? rec.len : sizeof(ev));
+				ev.xany.display = dpy;
+
+				/* A new window may be showing up for the first time */
+				if(ev.type == MapRequest) {
+					replay_bind_new(&ev, ev.xmaprequest.parent,
+					                ev.xmaprequest.window);
+				}
+				else if(ev.type == CreateNotify) {
+					replay_bind_new(&ev, ev.xcreatewindow.parent,
+					                ev.xcreatewindow.window);
+				}
+
+				/* Translate into our windows and atoms */
+				n = event_windows(&ev, wp, req);
+				for(int i = 0 ; i < n ; i++) {
+					uint64_t *lw = (*wp[i] != None) ? xmap_get(*wp[i]) : NULL;
+					if(*wp[i] == None) {
+						continue;
+					}
+					*wp[i] = (lw && *lw != XM_UNBOUND) ? *lw : None;
+					if(*wp[i] == None && req[i]) {
+						ok = false;
+					}
+				}
+				n = event_atoms(&ev, ap);
+				for(int i = 0 ; i < n ; i++) {
+					uint64_t *la = xmap_get(*ap[i] | XM_ATOM);
+					*ap[i] = la ? *la : None;
+				}
+
+				if(!ok || ev.type < 0 || ev.type >= MAX_X_EVENT) {
+					nskipped++;
+					break;
+				}
+				Event = ev;
+				DispatchEvent();
+				nreplayed++;
+				break;
+			}
+
+			default:
+				/* Something from the future?  Skip it. */
+				break;
+		}
+	}
+	XSync(dpy, False);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	fclose(f);
+	xmap_free();
+
+	fprintf(stderr, "%s: replayed %d events (%d skipped) in %.3f ms; "
+	        "recorded over %.3f s\n", ProgramName, nreplayed, nskipped,
+	        (end.tv_sec - start.tv_sec) * 1000.0
+	        + (end.tv_nsec - start.tv_nsec) / 1000000.0,
+	        span / 1000000.0);
+	EventStatsDump(stderr);
+}
+
+
+/*
+ * Find our equivalent of a recorded window.
+ */
+static Window
+replay_window(const EvRecWindow *rw, const char *rname, const char *rclass,
+              char *name)
+{
+	ScreenInfo *scr;
+	TwmWindow *t = NULL;
+	uint64_t *owner;
+
+	if(rw->role == WR_NONE || rw->scrnum >= NumScreens) {
+		return None;
+	}
+	scr = ScreenList[rw->scrnum];
+	if(scr == NULL) {
+		return None;
+	}
+
+	/* Things that don't belong to a TwmWindow */
+	switch(rw->role) {
+		case WR_ROOT:
+			return scr->Root;
+
+		case WR_MENU: {
+			ScreenInfo *savescr = Scr;
+			MenuRoot *mr;
+
+			Scr = scr;
+			mr = FindMenuRoot(name);
+			Scr = savescr;
+			return mr ? mr->w : None;
+		}
+
+		case WR_WSMGR_BUTTON:
+		case WR_WSMGR_MAP: {
+			VirtualScreen *vs = scr->vScreenList;
+
+			for(int i = 0 ; vs && i < rw->vsnum ; i++) {
+				vs = vs->next;
+			}
+			if(!vs || !vs->wsw || rw->index < 0
+			                || rw->index >= scr->workSpaceMgr.count) {
+				return None;
+			}
+			if(rw->role == WR_WSMGR_BUTTON) {
+				return vs->wsw->bswl[rw->index]->w;
+			}
+			return vs->wsw->mswl[rw->index]->w;
+		}
+
+		case WR_WSMGR_MAPWIN:
+		case WR_OCCUPY_BUTTON:
+			/* Too ephemeral to bother matching up */
+			return None;
+	}
+
+	/*
+	 * Find what TwmWindow we're calling the owner.  If we haven't picked
+	 * one yet, take the first one with the same class and name that
+	 * hasn't already been taken.
+	 */
+	owner = xmap_get(rw->owner | XM_OWNER);
+	if(owner == NULL) {
+		/* Maybe it's one we bound when it was new */
+		uint64_t *bound = xmap_get(rw->owner);
+		if(bound && *bound != None && *bound != XM_UNBOUND) {
+			xmap_put(rw->owner | XM_OWNER, *bound);
+			owner = xmap_get(rw->owner | XM_OWNER);
+		}
+	}
+	if(owner) {
+		const WinRef *wr = WinIndexFind(*owner);
+		t = wr ? wr->twm_win : NULL;
+	}
+	else {
+		for(t = scr->FirstWindow ; t != NULL ; t = t->next) {
+			const char *tn = t->class.res_name  ? t->class.res_name  : "";
+			const char *tc = t->class.res_class ? t->class.res_class : "";
+
+			if(xmap_get(t->w | XM_CLAIM) != NULL) {
+				continue;
+			}
+			if(strcmp(tn, rname) == 0 && strcmp(tc, rclass) == 0
+			                && strcmp(t->name ? t->name : "", name) == 0) {
+				break;
+			}
+		}
+		if(t == NULL) {
+			return None;
+		}
+		xmap_put(t->w | XM_CLAIM, 1);
+		xmap_put(rw->owner | XM_OWNER, t->w);
+	}
+	if(t == NULL) {
+		return None;
+	}
+
+	switch(rw->role) {
+		case WR_CLIENT:
+			return t->w;
+		case WR_FRAME:
+			return t->frame;
+		case WR_TITLE:
+			return t->title_w;
+		case WR_HILITE: {
+			const Window hl[4] = { t->hilite_wl, t->hilite_wr,
+			                       t->lolite_wl, t->lolite_wr
+			                     };
+			return (rw->index >= 0 && rw->index < 4) ? hl[rw->index] : None;
+		}
+		case WR_TITLEBUTTON:
+			if(t->titlebuttons && rw->index >= 0
+			                && rw->index < scr->TBInfo.nleft + scr->TBInfo.nright) {
+				return t->titlebuttons[rw->index].window;
+			}
+			return None;
+		case WR_ICON:
+			return t->icon ? t->icon->w : None;
+		case WR_ICONMGR_ENTRY:
+		case WR_ICONMGR_ICON: {
+			WList *wl = t->iconmanagerlist;
+			for(int i = 0 ; wl && i < rw->index ; i++) {
+				wl = wl->nextv;
+			}
+			if(wl == NULL) {
+				return None;
+			}
+			return (rw->role == WR_ICONMGR_ENTRY) ? wl->w : wl->icon;
+		}
+		default:
+			return None;
+	}
+
+	/* NOTREACHED */
+}
+
+
+
+/*
+ * A recorded window we've only seen the XID of is showing up in a
+ * MapRequest or CreateNotify; find it one of our windows.  x-ref
+ * comments at the top of the file.
+ */
+static void
+replay_bind_new(const XEvent *ev, Window rparent, Window rwin)
+{
+	uint64_t *lw = xmap_get(rwin);
+	uint64_t *lp = xmap_get(rparent);
+	Window parent, root, par, *kids, w = None;
+	unsigned int nkids;
+
+	if(lw == NULL || *lw != XM_UNBOUND) {
+		return;
+	}
+	if(lp == NULL || *lp == None || *lp == XM_UNBOUND) {
+		return;
+	}
+	parent = *lp;
+
+	if(!XQueryTree(dpy, parent, &root, &par, &kids, &nkids)) {
+		return;
+	}
+	for(unsigned int i = 0 ; i < nkids ; i++) {
+		XWindowAttributes wa;
+
+		if(WinIndexFind(kids[i]) != NULL
+		                || xmap_get(kids[i] | XM_CLAIM) != NULL) {
+			continue;
+		}
+		if(!XGetWindowAttributes(dpy, kids[i], &wa) || wa.override_redirect) {
+			continue;
+		}
+		if(ev->type == MapRequest && wa.map_state != IsUnmapped) {
+			continue;
+		}
+		w = kids[i];
+		break;
+	}
+	if(kids) {
+		XFree(kids);
+	}
+
+	if(w != None) {
+		xmap_put(w | XM_CLAIM, 1);
+		xmap_put(rwin, w);
+	}
+}
+
+
+
+/*
+ * Find the Window's in an event that we'll need to translate.  req[]
+ * gets set for those that the event makes no sense without; the others
+ * can just be None'd out if we don't know them.
+ */
+static int
+event_windows(XEvent *ev, Window **wp, bool *req)
+{
+	int n = 0;
+
+#define ADDW(fld, r) do { wp[n] = &(fld); req[n] = (r); n++; } while(0)
+	ADDW(ev->xany.window, true);
+	switch(ev->type) {
+		case KeyPress:
+		case KeyRelease:
+			ADDW(ev->xkey.root, true);
+			ADDW(ev->xkey.subwindow, false);
+			break;
+		case ButtonPress:
+		case ButtonRelease:
+			ADDW(ev->xbutton.root, true);
+			ADDW(ev->xbutton.subwindow, false);
+			break;
+		case MotionNotify:
+			ADDW(ev->xmotion.root, true);
+			ADDW(ev->xmotion.subwindow, false);
+			break;
+		case EnterNotify:
+		case LeaveNotify:
+			ADDW(ev->xcrossing.root, true);
+			ADDW(ev->xcrossing.subwindow, false);
+			break;
+		case MapRequest:
+			ADDW(ev->xmaprequest.window, true);
+			break;
+		case ConfigureRequest:
+			ADDW(ev->xconfigurerequest.window, true);
+			ADDW(ev->xconfigurerequest.above, false);
+			break;
+		case CirculateRequest:
+			ADDW(ev->xcirculaterequest.window, true);
+			break;
+		case CreateNotify:
+			ADDW(ev->xcreatewindow.window, true);
+			break;
+		case DestroyNotify:
+			ADDW(ev->xdestroywindow.window, true);
+			break;
+		case UnmapNotify:
+			ADDW(ev->xunmap.window, true);
+			break;
+		case MapNotify:
+			ADDW(ev->xmap.window, true);
+			break;
+		case ReparentNotify:
+			ADDW(ev->xreparent.window, true);
+			ADDW(ev->xreparent.parent, false);
+			break;
+		case ConfigureNotify:
+			ADDW(ev->xconfigure.window, true);
+			ADDW(ev->xconfigure.above, false);
+			break;
+	}
+#undef ADDW
+
+	return n;
+}
+
+
+/*
+ * Ditto for Atoms.
+ */
+static int
+event_atoms(XEvent *ev, Atom **ap)
+{
+	switch(ev->type) {
+		case PropertyNotify:
+			ap[0] = &ev->xproperty.atom;
+			return 1;
+		case ClientMessage:
+			ap[0] = &ev->xclient.message_type;
+			return 1;
+	}
+	return 0;
+}
+
+
+/*
+ * How much of an XEvent is worth saving for a given type.
+ */
+static size_t
+event_size(int type)
+{
+	switch(type) {
+		case KeyPress:
+		case KeyRelease:
+			return sizeof(XKeyEvent);
+		case ButtonPress:
+		case ButtonRelease:
+			return sizeof(XButtonEvent);
+		case MotionNotify:
+			return sizeof(XMotionEvent);
+		case EnterNotify:
+		case LeaveNotify:
+			return sizeof(XCrossingEvent);
+		case FocusIn:
+		case FocusOut:
+			return sizeof(XFocusChangeEvent);
+		case Expose:
+			return sizeof(XExposeEvent);
+		case VisibilityNotify:
+			return sizeof(XVisibilityEvent);
+		case CreateNotify:
+			return sizeof(XCreateWindowEvent);
+		case DestroyNotify:
+			return sizeof(XDestroyWindowEvent);
+		case UnmapNotify:
+			return sizeof(XUnmapEvent);
+		case MapNotify:
+			return sizeof(XMapEvent);
+		case MapRequest:
+			return sizeof(XMapRequestEvent);
+		case ReparentNotify:
+			return sizeof(XReparentEvent);
+		case ConfigureNotify:
+			return sizeof(XConfigureEvent);
+		case ConfigureRequest:
+			return sizeof(XConfigureRequestEvent);
+		case CirculateRequest:
+			return sizeof(XCirculateRequestEvent);
+		case PropertyNotify:
+			return sizeof(XPropertyEvent);
+		case ColormapNotify:
+			return sizeof(XColormapEvent);
+		case ClientMessage:
+			return sizeof(XClientMessageEvent);
+	}
+	return sizeof(XEvent);
+}
+
+
+
+/*
+ * The little hash table.  Linear probing, never deletes, key 0 is empty.
+ */
+static uint64_t *
+xmap_get(unsigned long key)
+{
+	unsigned int i;
+
+	if(xmap == NULL) {
+		return NULL;
+	}
+	i = (key * 2654435761UL) & (xmap_size - 1);
+	while(xmap[i].key != 0) {
+		if(xmap[i].key == key) {
+			return &xmap[i].val;
+		}
+		i = (i + 1) & (xmap_size - 1);
+	}
+	return NULL;
+}
+
+
+static void
+xmap_put(unsigned long key, uint64_t val)
+{
+	unsigned int i;
+
+	if(xmap == NULL || (xmap_count + 1) * 2 > xmap_size) {
+		XMapEnt *old = xmap;
+		unsigned int oldsize = xmap_size;
+
+		xmap_size = oldsize ? oldsize * 2 : 256;
+		xmap = calloc(xmap_size, sizeof(XMapEnt));
+		if(xmap == NULL) {
+			fprintf(stderr, "%s(): out of memory\n", __func__);
+			Done(0);
+		}
+		xmap_count = 0;
+		for(i = 0 ; i < oldsize ; i++) {
+			if(old[i].key != 0) {
+				xmap_put(old[i].key, old[i].val);
+			}
+		}
+		free(old);
+	}
+
+	i = (key * 2654435761UL) & (xmap_size - 1);
+	while(xmap[i].key != 0 && xmap[i].key != key) {
+		i = (i + 1) & (xmap_size - 1);
+	}
+	if(xmap[i].key == 0) {
+		xmap_count++;
+	}
+	xmap[i].key = key;
+	xmap[i].val = val;
+}
+
+
+static void
+xmap_free(void)
+{
+	free(xmap);
+	xmap = NULL;
+	xmap_size = xmap_count = 0;
+}
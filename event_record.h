@@ -0,0 +1,15 @@
+/*
+ * Binary event recording and replay
+ */
+#ifndef _CTWM_EVENT_RECORD_H
+#define _CTWM_EVENT_RECORD_H
+
+#include <stdbool.h>
+
+bool EventRecordStart(const char *file);
+void EventRecordStop(void);
+void EventRecord(const XEvent *ev, bool nested);
+
+void EventReplay(const char *file);
+
+#endif /* _CTWM_EVENT_RECORD_H */
@@ -0,0 +1,371 @@
+/*
+ * Non-X event sources for the main loop
+ *
+ * The main loop (x-ref CtwmNextEvent()) mostly just waits for the X
+ * connection.  But there are other things that need to be woken up for:
+ * the session manager's ICE connection, timed work like animation, and
+ * signals like SIGHUP asking us to restart.  Rather than teaching the
+ * loop about each of them separately, they register here, and
+ * EventWait() does the waiting for all of them at once.
+ *
+ * Signal handlers can't safely do much, so they just set a flag and
+ * call EventWakeup(), which pokes a self-pipe that we're always waiting
+ * on.  That way a signal that comes in right before we go to sleep
+ * still wakes us up, rather than waiting for the next X event.
+ */
+
+#include "ctwm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "event_sources.h"
+
+
+/* Registered fd's */
+typedef struct EvFd {
+	int fd;
+	EventFdProc proc;
+	void *data;
+} EvFd;
+static EvFd *evfds = NULL;
+static int nevfds = 0;
+static int maxevfds = 0;
+
+/* Pending timers, sorted soonest-first */
+typedef struct EvTimer {
+	struct EvTimer *next;
+	int id;
+	struct timespec when;
+	EventTimerProc proc;
+	void *data;
+} EvTimer;
+static EvTimer *timers = NULL;
+static int lasttimerid = 0;
+
+/* Self-pipe for signal handlers to wake us */
+static int wakepipe[2] = { -1, -1 };
+
+
+static void now(struct timespec *ts);
+static int tscmp(const struct timespec *a, const struct timespec *b);
+static bool RunTimers(void);
+
+
+
+/*
+ * Setup.  Called from InitEvents() during startup.
+ */
+void
+InitEventSources(void)
+{
+	if(wakepipe[0] != -1) {
+		return;
+	}
+	if(pipe(wakepipe) != 0) {
+		perror("pipe");
+		wakepipe[0] = wakepipe[1] = -1;
+		return;
+	}
+	for(int i = 0 ; i < 2 ; i++) {
+		fcntl(wakepipe[i], F_SETFL, fcntl(wakepipe[i], F_GETFL) | O_NONBLOCK);
+		fcntl(wakepipe[i], F_SETFD, FD_CLOEXEC);
+	}
+}
+
+
+
+/*
+ * Add an fd to be watched for input.  proc gets called with it when
+ * there's something to read.  Re-adding an fd replaces the existing
+ * proc/data.
+ */
+void
+EventAddFd(int fd, EventFdProc proc, void *data)
+{
+	if(fd < 0) {
+		return;
+	}
+
+	for(int i = 0 ; i < nevfds ; i++) {
+		if(evfds[i].fd == fd) {
+			evfds[i].proc = proc;
+			evfds[i].data = data;
+			return;
+		}
+	}
+
+	if(nevfds == maxevfds) {
+		int newmax = maxevfds ? maxevfds * 2 : 4;
+		EvFd *new = realloc(evfds, newmax * sizeof(EvFd));
+		if(new == NULL) {
+			fprintf(stderr, "%s(): out of memory\n", __func__);
+			return;
+		}
+		evfds = new;
+		maxevfds = newmax;
+	}
+
+	evfds[nevfds].fd   = fd;
+	evfds[nevfds].proc = proc;
+	evfds[nevfds].data = data;
+	nevfds++;
+}
+
+
+/*
+ * Stop watching an fd.
+ */
+void
+EventRemoveFd(int fd)
+{
+	for(int i = 0 ; i < nevfds ; i++) {
+		if(evfds[i].fd == fd) {
+			evfds[i] = evfds[--nevfds];
+			return;
+		}
+	}
+}
+
+
+
+/*
+ * Run proc after msecs milliseconds.  Timers are one-shot; the proc can
+ * add itself again if it wants to be periodic.  Returns an ID that can
+ * be passed to EventRemoveTimer() to cancel it; IDs are never 0, so
+ * callers can use that for "no timer".
+ *
+ * Timers only fire while the loop is idle (i.e., there are no X events
+ * waiting), so the time is a minimum, not a guarantee.
+ */
+int
+EventAddTimer(unsigned int msecs, EventTimerProc proc, void *data)
+{
+	EvTimer *t, **prev;
+
+	t = malloc(sizeof(EvTimer));
+	if(t == NULL) {
+		fprintf(stderr, "%s(): out of memory\n", __func__);
+		return 0;
+	}
+
+	if(++lasttimerid <= 0) {
+		lasttimerid = 1;
+	}
+	t->id   = lasttimerid;
+	t->proc = proc;
+	t->data = data;
+
+	now(&t->when);
+	t->when.tv_sec  += msecs / 1000;
+	t->when.tv_nsec += (long)(msecs % 1000) * 1000000;
+	if(t->when.tv_nsec >= 1000000000) {
+		t->when.tv_sec++;
+		t->when.tv_nsec -= 1000000000;
+	}
+
+	/* Slot it in after everything due at or before it */
+	for(prev = &timers ; *prev != NULL ; prev = &(*prev)->next) {
+		if(tscmp(&(*prev)->when, &t->when) > 0) {
+			break;
+		}
+	}
+	t->next = *prev;
+	*prev = t;
+
+	return t->id;
+}
+
+
+/*
+ * Cancel a pending timer.  Harmless if it already fired.
+ */
+void
+EventRemoveTimer(int id)
+{
+	EvTimer **prev;
+
+	if(id == 0) {
+		return;
+	}
+	for(prev = &timers ; *prev != NULL ; prev = &(*prev)->next) {
+		if((*prev)->id == id) {
+			EvTimer *t = *prev;
+			*prev = t->next;
+			free(t);
+			return;
+		}
+	}
+}
+
+
+/*
+ * Run any timers that are due.  Returns whether we ran any.
+ */
+static bool
+RunTimers(void)
+{
+	struct timespec ts;
+	bool ran = false;
+
+	now(&ts);
+	while(timers && tscmp(&timers->when, &ts) <= 0) {
+		EvTimer *t = timers;
+		EventTimerProc proc = t->proc;
+		void *data = t->data;
+
+		/* Unlink first; the proc may well add new timers */
+		timers = t->next;
+		free(t);
+		proc(data);
+		ran = true;
+	}
+
+	return ran;
+}
+
+
+
+/*
+ * Wait for something to happen: input on the X connection, input on
+ * any of our other fd's, a timer coming due, or a signal.  Anything but
+ * X input gets handled in here; X input is left for the caller to read.
+ * Called by the main loop when there are no X events queued.
+ *
+ * This can return without there being any X events; the caller is
+ * expected to check for them (and RestartFlag and the like), and call
+ * back in if there's still nothing to do.
+ */
+void
+EventWait(int xfd)
+{
+	int npfds, nready, timeout, found;
+
+	/*
+	 * If we fired any timers, they probably did X stuff, so let the
+	 * caller look at that before we think about sleeping.
+	 */
+	if(RunTimers()) {
+		return;
+	}
+
+	/* How long can we sleep? */
+	timeout = -1;
+	if(timers) {
+		struct timespec ts;
+		long ms;
+
+		now(&ts);
+		ms = (timers->when.tv_sec - ts.tv_sec) * 1000
+		     + (timers->when.tv_nsec - ts.tv_nsec + 999999) / 1000000;
+		timeout = (ms < 0) ? 0 : (ms > 60000 ? 60000 : (int)ms);
+	}
+
+	/* Build up what we're waiting on: X, the wakeup pipe, and the rest */
+	struct pollfd pfds[nevfds + 2];
+	npfds = 0;
+	pfds[npfds].fd = xfd;
+	pfds[npfds++].events = POLLIN;
+	if(wakepipe[0] != -1) {
+		pfds[npfds].fd = wakepipe[0];
+		pfds[npfds++].events = POLLIN;
+	}
+	for(int i = 0 ; i < nevfds ; i++) {
+		pfds[npfds].fd = evfds[i].fd;
+		pfds[npfds++].events = POLLIN;
+	}
+
+	found = poll(pfds, npfds, timeout);
+	if(found < 0) {
+		if(errno != EINTR) {
+			perror("poll");
+		}
+		return;
+	}
+	if(found == 0) {
+		/* Timeout; a timer's due, and we'll run it next time around */
+		return;
+	}
+
+	/* Clear out any wakeups; the caller will look at the flags */
+	if(wakepipe[0] != -1 && (pfds[1].revents & POLLIN)) {
+		char buf[64];
+		while(read(wakepipe[0], buf, sizeof(buf)) > 0) {
+			/* nada */;
+		}
+	}
+
+	/*
+	 * Call procs for ready fd's.  Collect them first, since a proc may
+	 * add or remove fd's (including its own) out from under us.
+	 */
+	EvFd ready[nevfds + 1];
+	nready = 0;
+	for(int i = (wakepipe[0] != -1) ? 2 : 1 ; i < npfds ; i++) {
+		if(pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+			for(int j = 0 ; j < nevfds ; j++) {
+				if(evfds[j].fd == pfds[i].fd) {
+					ready[nready++] = evfds[j];
+					break;
+				}
+			}
+		}
+	}
+	for(int i = 0 ; i < nready ; i++) {
+		/* Make sure it's still around and the same */
+		for(int j = 0 ; j < nevfds ; j++) {
+			if(evfds[j].fd == ready[i].fd && evfds[j].proc == ready[i].proc
+			                && evfds[j].data == ready[i].data) {
+				ready[i].proc(ready[i].fd, ready[i].data);
+				break;
+			}
+		}
+	}
+}
+
+
+/*
+ * Make a pending or future EventWait() return.  This is async-signal
+ * safe, and is how signal handlers get our attention.
+ */
+void
+EventWakeup(void)
+{
+	int sverrno = errno;
+
+	if(wakepipe[1] != -1) {
+		/* If the pipe's full, we're already going to wake up */
+		if(write(wakepipe[1], "", 1) < 0) {
+			/* ignore */;
+		}
+	}
+	errno = sverrno;
+}
+
+
+
+/*
+ * Time utils
+ */
+static void
+now(struct timespec *ts)
+{
+	clock_gettime(CLOCK_MONOTONIC, ts);
+}
+
+static int
+tscmp(const struct timespec *a, const struct timespec *b)
+{
+	if(a->tv_sec != b->tv_sec) {
+		return (a->tv_sec < b->tv_sec) ? -1 : 1;
+	}
+	if(a->tv_nsec != b->tv_nsec) {
+		return (a->tv_nsec < b->tv_nsec) ? -1 : 1;
+	}
+	return 0;
+}
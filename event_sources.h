@@ -0,0 +1,21 @@
+/*
+ * Non-X event sources for the main loop: file descriptors and timers.
+ */
+#ifndef _CTWM_EVENT_SOURCES_H
+#define _CTWM_EVENT_SOURCES_H
+
+typedef void (*EventFdProc)(int fd, void *data);
+typedef void (*EventTimerProc)(void *data);
+
+void InitEventSources(void);
+
+void EventAddFd(int fd, EventFdProc proc, void *data);
+void EventRemoveFd(int fd);
+
+int EventAddTimer(unsigned int msecs, EventTimerProc proc, void *data);
+void EventRemoveTimer(int id);
+
+void EventWait(int xfd);
+void EventWakeup(void);
+
+#endif /* _CTWM_EVENT_SOURCES_H */
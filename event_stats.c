@@ -0,0 +1,213 @@
+/*
+ * Event dispatch statistics
+ *
+ * When things get sluggish, it's useful to know what events we're
+ * spending our time on; is it a storm of MotionNotify's, some client
+ * hammering on its properties, something doing ConfigureRequest's in a
+ * loop?  So for every event we dispatch, we keep a count and a
+ * histogram of how long the handler took, indexed by event type like
+ * EventHandler[].  We also note how deep the X queue was when we got to
+ * it, since a deep queue means we're falling behind.
+ *
+ * This is cheap enough (a pair of clock_gettime()'s per event) to just
+ * always be running.  f.dumpstats or a SIGUSR1 writes it all out to
+ * stderr.
+ *
+ * Note that the handlers for some events (moves, menus, etc) run their
+ * own nested event loops through DispatchEvent(), so their time includes
+ * the time spent handling those nested events.
+ */
+
+#include "ctwm.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#include "event_names.h"
+#include "event_sources.h"
+#include "event_stats.h"
+#include "events.h"
+
+
+/*
+ * Latency buckets are powers of 2 in usec; bucket 0 is under 1 usec,
+ * bucket n is [2^(n-1), 2^n) usec, and the last catches everything
+ * longer (up to and past ~8 seconds).
+ */
+#define LAT_BUCKETS 24
+
+/* Queue depth buckets; 0, 1, 2-3, 4-7, ... */
+#define QLEN_BUCKETS 12
+
+typedef struct EventStat {
+	unsigned long count;
+	unsigned long long total_ns;
+	unsigned long max_us;
+	unsigned long lat[LAT_BUCKETS];
+	unsigned long long qlen_total;
+	int qlen_max;
+} EventStat;
+
+static EventStat stats[MAX_X_EVENT];
+static unsigned long qlen_hist[QLEN_BUCKETS];
+static struct timespec stats_since;
+
+/* Set by the SIGUSR1 handler; the main loop notices and dumps */
+volatile sig_atomic_t DumpStatsFlag = 0;
+
+
+static int
+log2_bucket(unsigned long v, int nbuckets)
+{
+	int b = 0;
+
+	while(v > 0 && b < nbuckets - 1) {
+		v >>= 1;
+		b++;
+	}
+	return b;
+}
+
+
+/*
+ * Grab the time before dispatching an event.
+ */
+void
+EventStatsStart(struct timespec *start)
+{
+	clock_gettime(CLOCK_MONOTONIC, start);
+	if(stats_since.tv_sec == 0 && stats_since.tv_nsec == 0) {
+		stats_since = *start;
+	}
+}
+
+
+/*
+ * Note down an event of the given type having been handled, which
+ * started at start, with the given QLength() at the time.
+ */
+void
+EventStatsEnd(int type, const struct timespec *start, int qlen)
+{
+	struct timespec end;
+	EventStat *es;
+	long long ns;
+	unsigned long us;
+
+	if(type < 0 || type >= MAX_X_EVENT) {
+		return;
+	}
+	es = &stats[type];
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ns = (end.tv_sec - start->tv_sec) * 1000000000LL
+	     + (end.tv_nsec - start->tv_nsec);
+	if(ns < 0) {
+		ns = 0;
+	}
+	us = ns / 1000;
+
+	es->count++;
+	es->total_ns += ns;
+	if(us > es->max_us) {
+		es->max_us = us;
+	}
+	es->lat[log2_bucket(us, LAT_BUCKETS)]++;
+
+	if(qlen < 0) {
+		qlen = 0;
+	}
+	es->qlen_total += qlen;
+	if(qlen > es->qlen_max) {
+		es->qlen_max = qlen;
+	}
+	qlen_hist[log2_bucket(qlen, QLEN_BUCKETS)]++;
+}
+
+
+/*
+ * Write it all out.
+ */
+void
+EventStatsDump(FILE *f)
+{
+	struct timespec now;
+	unsigned long total = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	fprintf(f, "%s: event dispatch stats over the last %ld seconds\n",
+	        ProgramName, (long)(now.tv_sec - stats_since.tv_sec));
+	fprintf(f, "%-20s %10s %10s %10s %8s %8s\n", "event", "count",
+	        "avg(us)", "max(us)", "avgq", "maxq");
+
+	for(int i = 0 ; i < MAX_X_EVENT ; i++) {
+		const EventStat *es = &stats[i];
+		const char *name;
+		char nbuf[32];
+
+		if(es->count == 0) {
+			continue;
+		}
+		total += es->count;
+
+		name = event_name_by_num(i);
+		if(name == NULL) {
+			snprintf(nbuf, sizeof(nbuf), "event#%d", i);
+			name = nbuf;
+		}
+
+		fprintf(f, "%-20s %10lu %10.1f %10lu %8.1f %8d\n", name, es->count,
+		        (double)es->total_ns / es->count / 1000.0, es->max_us,
+		        (double)es->qlen_total / es->count, es->qlen_max);
+
+		/* Histogram, skipping empty buckets */
+		fprintf(f, "%20s ", "");
+		for(int b = 0 ; b < LAT_BUCKETS ; b++) {
+			if(es->lat[b] == 0) {
+				continue;
+			}
+			if(b == 0) {
+				fprintf(f, " <1us:%lu", es->lat[b]);
+			}
+			else if(b == LAT_BUCKETS - 1) {
+				fprintf(f, " >=%luus:%lu", 1UL << (b - 1), es->lat[b]);
+			}
+			else {
+				fprintf(f, " <%luus:%lu", 1UL << b, es->lat[b]);
+			}
+		}
+		fprintf(f, "\n");
+	}
+
+	fprintf(f, "%-20s %10lu\n", "total", total);
+	fprintf(f, "queue depth at dispatch:");
+	for(int b = 0 ; b < QLEN_BUCKETS ; b++) {
+		if(qlen_hist[b] == 0) {
+			continue;
+		}
+		if(b == 0) {
+			fprintf(f, " 0:%lu", qlen_hist[b]);
+		}
+		else if(b == QLEN_BUCKETS - 1) {
+			fprintf(f, " >=%lu:%lu", 1UL << (b - 1), qlen_hist[b]);
+		}
+		else {
+			fprintf(f, " <%lu:%lu", 1UL << b, qlen_hist[b]);
+		}
+	}
+	fprintf(f, "\n");
+	fflush(f);
+}
+
+
+/*
+ * SIGUSR1 handler.  We can't safely do stdio in here, so just flag it
+ * for the main loop to do.
+ */
+SIGNAL_T
+EventStatsSignal(int signum)
+{
+	DumpStatsFlag = 1;
+	EventWakeup();
+}
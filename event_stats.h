@@ -0,0 +1,18 @@
+/*
+ * Event dispatch statistics
+ */
+#ifndef _CTWM_EVENT_STATS_H
+#define _CTWM_EVENT_STATS_H
+
+#include <signal.h>   // for sig_atomic_t
+#include <stdio.h>    // for FILE
+#include <time.h>     // for struct timespec
+
+void EventStatsStart(struct timespec *start);
+void EventStatsEnd(int type, const struct timespec *start, int qlen);
+void EventStatsDump(FILE *f);
+SIGNAL_T EventStatsSignal(int signum);
+
+extern volatile sig_atomic_t DumpStatsFlag;
+
+#endif /* _CTWM_EVENT_STATS_H */
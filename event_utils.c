@@ -9,18 +9,85 @@
 
 #include <stdio.h>
 
+#include "deferred.h"
 #include "event_handlers.h"
 #include "event_internal.h"
 #include "events.h"
+#include "frame_index.h"
 #include "list.h"
 #include "otp.h"
 #include "screen.h"
 #include "vscreen.h"
 #include "win_iconify.h"
+#include "win_index.h"
 #include "workspace_manager.h"
 
 
 static ScreenInfo *FindScreenInfo(Window w);
+static void AutoRaiseDeferred(void *unused);
+static void AutoLowerDeferred(void *unused);
+
+
+/*
+ * Auto-raising and -lowering.  Entering (leaving) an AutoRaise
+ * (AutoLower) window raises (lowers) it right off, unless one's already
+ * in progress; then it just notes the window in enter_win (leave_win),
+ * and it gets done once things settle down.  The raise itself makes a
+ * bunch of Enter/Leave events as things restack, and this keeps those
+ * from raising something else in turn.  Whether one's in progress is
+ * just whether there's a deferred raise (lower) waiting.
+ */
+bool
+AutoRaisePending(void)
+{
+	return DeferredPending(AutoRaiseDeferred, NULL);
+}
+
+void
+SetAutoRaisePending(bool pending)
+{
+	if(pending) {
+		DeferWork(DEFER_AUTORAISE, AutoRaiseDeferred, NULL);
+	}
+	else {
+		CancelDeferred(AutoRaiseDeferred, NULL);
+	}
+}
+
+static void
+AutoRaiseDeferred(void *unused)
+{
+	/* If it's still pending after this, it's because we raised again */
+	if(enter_win && enter_win != raise_win) {
+		AutoRaiseWindow(enter_win);
+	}
+}
+
+bool
+AutoLowerPending(void)
+{
+	return DeferredPending(AutoLowerDeferred, NULL);
+}
+
+void
+SetAutoLowerPending(bool pending)
+{
+	if(pending) {
+		DeferWork(DEFER_AUTOLOWER, AutoLowerDeferred, NULL);
+	}
+	else {
+		CancelDeferred(AutoLowerDeferred, NULL);
+	}
+}
+
+static void
+AutoLowerDeferred(void *unused)
+{
+	if(leave_win && leave_win != lower_win) {
+		AutoLowerWindow(leave_win);
+	}
+}
+
 
 
 void
@@ -33,7 +100,7 @@ AutoRaiseWindow(TwmWindow *tmp)
 	}
 	XSync(dpy, 0);
 	enter_win = NULL;
-	enter_flag = true;
+	SetAutoRaisePending(true);
 	raise_win = tmp;
 	WMapRaise(tmp);
 }
@@ -41,11 +108,11 @@ AutoRaiseWindow(TwmWindow *tmp)
 void
 SetRaiseWindow(TwmWindow *tmp)
 {
-	enter_flag = true;
+	SetAutoRaisePending(true);
 	enter_win = NULL;
 	raise_win = tmp;
 	leave_win = NULL;
-	leave_flag = false;
+	SetAutoLowerPending(false);
 	lower_win = NULL;
 	XSync(dpy, 0);
 }
@@ -63,6 +130,7 @@ AutoPopupMaybe(TwmWindow *tmp)
 		}
 		else {
 			tmp->mapped = true;
+			FrameIndexUpdate(tmp);
 		}
 	}
 }
@@ -77,10 +145,10 @@ AutoLowerWindow(TwmWindow *tmp)
 	}
 	XSync(dpy, 0);
 	enter_win = NULL;
-	enter_flag = false;
+	SetAutoRaisePending(false);
 	raise_win = NULL;
 	leave_win = NULL;
-	leave_flag = true;
+	SetAutoLowerPending(true);
 	lower_win = tmp;
 	WMapLower(tmp);
 }
@@ -208,14 +276,12 @@ FixRootEvent(XEvent *e)
 ScreenInfo *
 GetTwmScreen(XEvent *event)
 {
-	ScreenInfo *scr;
+	const WinRef *wr = WinIndexFind(event->xany.window);
 
-	if(XFindContext(dpy, event->xany.window, ScreenContext,
-	                (XPointer *)&scr) == XCNOENT) {
-		scr = FindScreenInfo(WindowOfEvent(event));
+	if(wr && wr->scr) {
+		return wr->scr;
 	}
-
-	return scr;
+	return FindScreenInfo(WindowOfEvent(event));
 }
 
 
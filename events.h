@@ -20,6 +20,8 @@
 
 typedef void (*event_proc)(void);
 
+#define MAX_X_EVENT 256
+
 void InitEvents(void);
 bool DispatchEvent(void);
 bool DispatchEvent2(void);
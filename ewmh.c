@@ -29,11 +29,12 @@
 #include <stdlib.h>
 #include <time.h>
 #include <stdint.h>
-#include <assert.h>
+#include <limits.h>
 
 #include <X11/Xatom.h>
 #include <X11/extensions/shape.h>
 
+#include "deferred.h"
 #include "ewmh_atoms.h"
 #include "screen.h"
 #include "events.h"
@@ -42,6 +43,8 @@
 #include "icons.h"
 #include "otp.h"
 #include "image.h"
+#include "image_convert.h"
+#include "image_scale.h"
 #include "list.h"
 #include "functions.h"
 #include "occupation.h"
@@ -49,6 +52,7 @@
 #include "win_iconify.h"
 #include "win_ops.h"
 #include "win_resize.h"
+#include "win_props.h"
 #include "win_utils.h"
 #include "workspace_utils.h"
 
@@ -73,6 +77,8 @@ Atom XEWMHAtom[NUM_EWMH_XATOMS];
 #define _NET_WM_MOVERESIZE_MOVE_KEYBOARD    10   /* move via keyboard */
 #define _NET_WM_MOVERESIZE_CANCEL           11   /* cancel operation */
 
+static Image *GetScaledIcon(ScreenInfo *scr, unsigned long *prop, int width,
+                            int height);
 static Image *ExtractIcon(ScreenInfo *scr, unsigned long *prop, int width,
                           int height);
 static void EwmhClientMessage_NET_WM_DESKTOP(XClientMessageEvent *msg);
@@ -84,6 +90,8 @@ static unsigned long EwmhGetWindowProperty(Window w, Atom name, Atom type);
 static void EwmhGetStrut(TwmWindow *twm_win, bool update);
 static void EwmhRemoveStrut(TwmWindow *twm_win);
 static void EwmhSet_NET_WORKAREA(ScreenInfo *scr);
+static void EwmhPublish_NET_CLIENT_LIST(void *data);
+static void EwmhPublish_NET_CLIENT_LIST_STACKING(void *data);
 static int EwmhGet_NET_WM_STATE(TwmWindow *twm_win);
 static void EwmhClientMessage_NET_WM_STATEchange(TwmWindow *twm_win, int change,
                 int newVal);
@@ -625,46 +633,78 @@ bool EwmhClientMessage(XClientMessageEvent *msg)
  *                      pixel: ARGB
  * repeat for next size.
  *
- * Some icons can be 256x256 CARDINALs which is 65536 CARDINALS!
- * Therefore we fetch in pieces and skip the pixels of large icons
- * until needed.
- *
- * First scan all sizes. Keep a record of the closest smaller and larger
- * size. At the end, choose from one of those.
- * Finally, go and fetch the pixel data.
+ * Some icons can be 256x256 CARDINALs which is 65536 CARDINALS, and
+ * apps often provide several sizes up to 512x512.  So rather than
+ * pulling the whole thing over, we read just the width/height header of
+ * each icon (skipping over the pixels), keeping a record of the closest
+ * smaller and larger size.  At the end, choose from one of those, and
+ * go fetch only its pixel data.
  */
 
-Image *EwmhGetIcon(ScreenInfo *scr, TwmWindow *twm_win)
+/* Properties this small we just grab all at once */
+#define NET_WM_ICON_SMALL 1024
+
+/*
+ * Read len CARDINALs of _NET_WM_ICON starting at offset.  Returns NULL
+ * unless we got all of them.  *total gets how long the whole property
+ * is.
+ */
+static unsigned long *
+FetchIconData(Window w, long offset, long len, long *total)
 {
-	int fetch_offset;
 	Atom actual_type;
 	int actual_format;
 	unsigned long nitems, bytes_after;
 	unsigned long *prop;
 
-	int wanted_area;
-	int smaller, larger;
-	int offset;
-	int smaller_offset, larger_offset;
-	int i;
-
-	int area, width, height;
-
-	fetch_offset = 0;
-	if(XGetWindowProperty(dpy, twm_win->w, XA__NET_WM_ICON,
-	                      fetch_offset, 8 * 1024, False, XA_CARDINAL,
-	                      &actual_type, &actual_format, &nitems,
-	                      &bytes_after, (unsigned char **)&prop) != Success || nitems == 0) {
+	if(XGetWindowProperty(dpy, w, XA__NET_WM_ICON, offset, len, False,
+	                      XA_CARDINAL, &actual_type, &actual_format, &nitems,
+	                      &bytes_after, (unsigned char **)&prop) != Success) {
+		return NULL;
+	}
+	if(actual_format != 32 || nitems < (unsigned long)len) {
+		if(prop) {
+			XFree(prop);
+		}
 		return NULL;
 	}
+	if(total) {
+		*total = offset + nitems + bytes_after / 4;
+	}
+	return prop;
+}
 
-	if(actual_format != 32) {
-		XFree(prop);
+
+Image *EwmhGetIcon(ScreenInfo *scr, TwmWindow *twm_win)
+{
+	unsigned long *prop, *whole;
+	long total, offset;
+
+	long wanted_area;
+	long smaller, larger;
+	long smaller_offset, larger_offset;
+	long area;
+	int width, height;
+
+	/*
+	 * Start with the first header.  That tells us how big the whole
+	 * thing is, and if it's small, we may as well just get it all.
+	 */
+	prop = FetchIconData(twm_win->w, 0, 2, &total);
+	if(prop == NULL) {
 		return NULL;
 	}
+	XFree(prop);
+	whole = NULL;
+	if(total <= NET_WM_ICON_SMALL) {
+		whole = FetchIconData(twm_win->w, 0, total, NULL);
+		if(whole == NULL) {
+			return NULL;
+		}
+	}
 
 #ifdef DEBUG_EWMH
-	fprintf(stderr, "_NET_WM_ICON data fetched\n");
+	fprintf(stderr, "_NET_WM_ICON is %ld long\n", total);
 #endif
 	/*
 	 * Usually the icons are square, but that is not a rule.
@@ -673,34 +713,51 @@ Image *EwmhGetIcon(ScreenInfo *scr, TwmWindow *twm_win)
 	 * Approach wanted size from both directions and at the end,
 	 * choose the "nearest".
 	 */
-	wanted_area = Scr->PreferredIconWidth * Scr->PreferredIconHeight;
+	wanted_area = (long)Scr->PreferredIconWidth * Scr->PreferredIconHeight;
 	smaller = 0;
-	larger = 999999;
-	offset = 0;
+	larger = LONG_MAX;
 	smaller_offset = -1;
 	larger_offset = -1;
-	i = 0;
 
-	for(;;) {
-		offset = i;
+	for(offset = 0 ; offset + 2 <= total ; offset += 2 + area) {
+		unsigned long w, h;
 
-		int w = prop[i++];
-		int h = prop[i++];
-		int size = w * h;
+		if(whole) {
+			w = whole[offset];
+			h = whole[offset + 1];
+		}
+		else {
+			prop = FetchIconData(twm_win->w, offset, 2, NULL);
+			if(prop == NULL) {
+				break;
+			}
+			w = prop[0];
+			h = prop[1];
+			XFree(prop);
+		}
 
+		/* Sanity check before we believe it */
+		if(w == 0 || h == 0 || w > 0xFFFF || h > 0xFFFF) {
+			break;
+		}
 		area = w * h;
+		if(offset + 2 + area > total) {
+#ifdef DEBUG_EWMH
+			fprintf(stderr, "not enough data: %ld + 2 + %ld > %ld\n",
+			        offset, area, total);
+#endif /* DEBUG_EWMH */
+			break;
+		}
 
 #ifdef DEBUG_EWMH
-		fprintf(stderr, "[%d+%d] w=%d h=%d\n", fetch_offset, offset, w, h);
+		fprintf(stderr, "[%ld] w=%lu h=%lu\n", offset, w, h);
 #endif
 
-
 		if(area == wanted_area) {
 #ifdef DEBUG_EWMH
-			fprintf(stderr, "exact match [%d+%d=%d] w=%d h=%d\n", fetch_offset, offset,
-			        fetch_offset + offset, w, h);
+			fprintf(stderr, "exact match [%ld] w=%lu h=%lu\n", offset, w, h);
 #endif /* DEBUG_EWMH */
-			smaller_offset = fetch_offset + offset;
+			smaller_offset = offset;
 			smaller = area;
 			larger_offset = -1;
 			break;
@@ -708,152 +765,174 @@ Image *EwmhGetIcon(ScreenInfo *scr, TwmWindow *twm_win)
 		else if(area < wanted_area) {
 			if(area > smaller) {
 #ifdef DEBUG_EWMH
-				fprintf(stderr, "increase smaller, was [%d]\n", smaller_offset);
+				fprintf(stderr, "increase smaller, was [%ld]\n", smaller_offset);
 #endif /* DEBUG_EWMH */
 				smaller = area;
-				smaller_offset = fetch_offset + offset;
+				smaller_offset = offset;
 			}
 		}
 		else {   /* area > wanted_area */
 			if(area < larger) {
 #ifdef DEBUG_EWMH
-				fprintf(stderr, "decrease larger, was [%d]\n", larger_offset);
+				fprintf(stderr, "decrease larger, was [%ld]\n", larger_offset);
 #endif /* DEBUG_EWMH */
 				larger = area;
-				larger_offset = fetch_offset + offset;
+				larger_offset = offset;
 			}
 		}
-
-		if(i + size + 2 > nitems) {
-#ifdef DEBUG_EWMH
-			fprintf(stderr, "not enough data: %d + %d > %ld \n", i, size, nitems);
-#endif /* DEBUG_EWMH */
-
-			if(i + size + 2 <= nitems + bytes_after / 4) {
-				/* we can fetch some more... */
-				XFree(prop);
-				fetch_offset += i + size;
-				if(XGetWindowProperty(dpy, twm_win->w, XA__NET_WM_ICON,
-				                      fetch_offset, 8 * 1024, False, XA_CARDINAL,
-				                      &actual_type, &actual_format, &nitems,
-				                      &bytes_after, (unsigned char **)&prop) != Success) {
-					continue;
-				}
-				i = 0;
-				continue;
-			}
-			break;
-		}
-		i += size;
 	}
 
 	/*
 	 * Choose which icon approximates our desired size best.
 	 */
-	area = 0;
-
 	if(smaller_offset >= 0) {
 		if(larger_offset >= 0) {
 			/* choose the nearest */
 #ifdef DEBUG_EWMH
-			fprintf(stderr, "choose nearest %d %d\n", smaller, larger);
+			fprintf(stderr, "choose nearest %ld %ld\n", smaller, larger);
 #endif /* DEBUG_EWMH */
 			if((double)larger / wanted_area > (double)wanted_area / smaller) {
 				offset = smaller_offset;
-				area = smaller;
 			}
 			else {
 				offset = larger_offset;
-				area = larger;
 			}
 		}
 		else {
 			/* choose smaller */
 #ifdef DEBUG_EWMH
-			fprintf(stderr, "choose smaller (only) %d\n", smaller);
+			fprintf(stderr, "choose smaller (only) %ld\n", smaller);
 #endif /* DEBUG_EWMH */
 			offset = smaller_offset;
-			area = smaller;
 		}
 	}
 	else if(larger_offset >= 0) {
 		/* choose larger */
 #ifdef DEBUG_EWMH
-		fprintf(stderr, "choose larger (only) %d\n", larger);
+		fprintf(stderr, "choose larger (only) %ld\n", larger);
 #endif /* DEBUG_EWMH */
 		offset = larger_offset;
-		area = larger;
 	}
 	else {
 		/* no icons found at all? */
 #ifdef DEBUG_EWMH
 		fprintf(stderr, "nothing to choose from\n");
 #endif /* DEBUG_EWMH */
-		XFree(prop);
+		if(whole) {
+			XFree(whole);
+		}
 		return NULL;
 	}
 
 	/*
-	 * Now fetch the pixels.
+	 * Now get the pixels, if we don't already have them.
 	 */
-
-#ifdef DEBUG_EWMH
-	fprintf(stderr, "offset = %d fetch_offset = %d\n", offset, fetch_offset);
-	fprintf(stderr, "offset + 2 + area = %d fetch_offset + nitems = %ld\n",
-	        offset + 2 + area, fetch_offset + nitems);
-#endif /* DEBUG_EWMH */
-	if(offset < fetch_offset ||
-	                offset + 2 + area > fetch_offset + nitems) {
-		XFree(prop);
-		fetch_offset = offset;
-#ifdef DEBUG_EWMH
-		fprintf(stderr, "refetching from %d\n", fetch_offset);
-#endif /* DEBUG_EWMH */
-		if(XGetWindowProperty(dpy, twm_win->w, XA__NET_WM_ICON,
-		                      fetch_offset, 2 + area, False, XA_CARDINAL,
-		                      &actual_type, &actual_format, &nitems,
-		                      &bytes_after, (unsigned char **)&prop) != Success) {
+	if(whole) {
+		prop = whole + offset;
+	}
+	else {
+		area = (offset == smaller_offset) ? smaller : larger;
+		whole = FetchIconData(twm_win->w, offset, 2 + area, NULL);
+		if(whole == NULL) {
 			return NULL;
 		}
+		prop = whole;
+	}
+	width  = prop[0];
+	height = prop[1];
+	if((long)width * height != ((offset == smaller_offset) ? smaller : larger)) {
+		/* Changed out from under us; we'll get a PropertyNotify */
+		XFree(whole);
+		return NULL;
 	}
-
-	i = offset - fetch_offset;
-	width = prop[i++];
-	height = prop[i++];
 #ifdef DEBUG_EWMH
-	fprintf(stderr, "Chosen [%d] w=%d h=%d area=%d\n", offset, width, height, area);
+	fprintf(stderr, "Chosen [%ld] w=%d h=%d\n", offset, width, height);
 #endif /* DEBUG_EWMH */
-	assert(width * height == area);
 
-	Image *image = ExtractIcon(scr, &prop[i], width, height);
+	Image *image = GetScaledIcon(scr, prop + 2, width, height);
 
-	XFree(prop);
+	XFree(whole);
 
 	return image;
 }
 
-static uint16_t *buffer_16bpp;
-static uint32_t *buffer_32bpp;
-
-static void convert_for_16(int w, int x, int y, int argb)
+/*
+ * Get the Image for some _NET_WM_ICON data, shrunk to fit in
+ * PreferredIconWidth x PreferredIconHeight if it's bigger.  These are
+ * shared through the image cache, under a name made from a hash of the
+ * data, so all the windows of an app showing the same icon share one
+ * Pixmap.  The caller gets a reference, to give back with
+ * ReleaseImage().
+ */
+static Image *GetScaledIcon(ScreenInfo *scr, unsigned long *prop, int width,
+                            int height)
 {
-	int r = (argb >> 16) & 0xFF;
-	int g = (argb >>  8) & 0xFF;
-	int b = (argb >>  0) & 0xFF;
-	buffer_16bpp [y * w + x] = ((r >> 3) << 11) + ((g >> 2) << 5) + (b >> 3);
-}
+	const int pw = scr->PreferredIconWidth;
+	const int ph = scr->PreferredIconHeight;
+	const long npix = (long)width * height;
+	uint64_t hash = 14695981039346656037ULL;
+	int dw = width, dh = height;
+	char name[80];
+	Image *image;
 
-static void convert_for_32(int w, int x, int y, int argb)
-{
-	buffer_32bpp [y * w + x] = argb & 0x00FFFFFF;
+	/* Shrink to fit, keeping the aspect ratio */
+	if(pw > 0 && ph > 0 && (width > pw || height > ph)) {
+		if((long)width * ph > (long)height * pw) {
+			dw = pw;
+			dh = (int)((long)height * pw / width);
+		}
+		else {
+			dh = ph;
+			dw = (int)((long)width * ph / height);
+		}
+		if(dw < 1) {
+			dw = 1;
+		}
+		if(dh < 1) {
+			dh = 1;
+		}
+	}
+
+	/* Already got one? */
+	for(long i = 0 ; i < npix ; i++) {
+		hash = (hash ^ (uint32_t)prop[i]) * 1099511628211ULL;
+	}
+	snprintf(name, sizeof(name), ":net_wm_icon:%dx%d:%016llx:%dx%d",
+	         width, height, (unsigned long long)hash, dw, dh);
+	if((image = GetCachedImage(name)) != NULL) {
+		return image;
+	}
+
+	/* Nope, make it */
+	if(dw != width || dh != height) {
+		unsigned long *scaled = malloc(sizeof(unsigned long) * dw * dh);
+
+		if(scaled == NULL) {
+			return NULL;
+		}
+		if(!ScaleARGB(prop, width, height, scaled, dw, dh)) {
+			free(scaled);
+			return NULL;
+		}
+		image = ExtractIcon(scr, scaled, dw, dh);
+		free(scaled);
+	}
+	else {
+		image = ExtractIcon(scr, prop, width, height);
+	}
+
+	if(image != NULL) {
+		AddCachedImage(name, image);
+	}
+	return image;
 }
 
 static Image *ExtractIcon(ScreenInfo *scr, unsigned long *prop, int width,
                           int height)
 {
+	PixelLayout pl;
 	XImage *ximage;
-	void (*store_data)(int w, int x, int y, int argb);
-	int x, y, transparency;
+	bool transparency;
 	int rowbytes;
 	unsigned char *maskbits;
 
@@ -861,68 +940,46 @@ static Image *ExtractIcon(ScreenInfo *scr, unsigned long *prop, int width,
 	Pixmap pixret;
 	Pixmap mask;
 	Image *image;
-	int i;
 
-	ximage = NULL;
-
-	/** XXX sort of duplicated from util.c:LoadJpegImage() */
-	if(scr->d_depth == 16) {
-		store_data = convert_for_16;
-		buffer_16bpp = malloc(width * height * sizeof(buffer_16bpp[0]));
-		buffer_32bpp = NULL;
-		ximage = XCreateImage(dpy, CopyFromParent, scr->d_depth, ZPixmap, 0,
-		                      (char *) buffer_16bpp, width, height, 16, width * 2);
-	}
-	else if(scr->d_depth == 24 || scr->d_depth == 32) {
-		store_data = convert_for_32;
-		buffer_32bpp = malloc(width * height * sizeof(buffer_32bpp[0]));
-		buffer_16bpp = NULL;
-		ximage = XCreateImage(dpy, CopyFromParent, scr->d_depth, ZPixmap, 0,
-		                      (char *) buffer_32bpp, width, height, 32, width * 4);
-	}
-	else {
+	if(!GetPixelLayout(scr, &pl)) {
 #ifdef DEBUG_EWMH
 		fprintf(stderr, "Screen unsupported depth for 32-bit icon: %d\n", scr->d_depth);
 #endif /* DEBUG_EWMH */
-		XFree(prop);
 		return NULL;
 	}
+	ximage = CreateConvertImage(scr, &pl, width, height);
 	if(ximage == NULL) {
 #ifdef DEBUG_EWMH
 		fprintf(stderr, "cannot create image for icon\n");
 #endif /* DEBUG_EWMH */
-		XFree(prop);
 		return NULL;
 	}
 
-	transparency = 0;
 	rowbytes = (width + 7) / 8;
-	maskbits = calloc(height, rowbytes);
+	maskbits = malloc(height * rowbytes);
+	if(maskbits == NULL) {
+		XDestroyImage(ximage);
+		return NULL;
+	}
 
 	/*
-	 * Copy all ARGB pixels to the pixmap (the RGB part), and the bitmap (the
-	 * Alpha, or opaqueness part). If any pixels are transparent, we're going
-	 * to need a shape.
+	 * Convert the ARGB pixels into the pixmap (the RGB part), and the
+	 * bitmap (the Alpha, or opaqueness part), a row at a time.  If any
+	 * pixels are transparent, we're going to need a shape.
 	 */
-	i = 0;
-	for(y = 0; y < height; y++) {
-		for(x = 0; x < width; x++) {
-			unsigned long argb = prop[i++];
-			store_data(width, x, y, argb);
-			int opaque = ((argb >> 24) & 0xFF) >= 0x80; /* arbitrary cutoff */
-			if(opaque) {
-				maskbits [rowbytes * y + (x / 8)] |= 0x01 << (x % 8);
-			}
-			else {
-				transparency = 1;
-			}
+	transparency = false;
+	for(int y = 0; y < height; y++) {
+		if(ConvertARGBRow(&pl, prop + y * width, width,
+		                  ximage->data + y * ximage->bytes_per_line,
+		                  maskbits + y * rowbytes)) {
+			transparency = true;
 		}
 	}
 
 	gc = DefaultGC(dpy, scr->screen);
 	pixret = XCreatePixmap(dpy, scr->Root, width, height, scr->d_depth);
 	XPutImage(dpy, pixret, gc, ximage, 0, 0, 0, 0, width, height);
-	XDestroyImage(ximage);  /* also frees buffer_{16,32}bpp */
+	XDestroyImage(ximage);  /* also frees the pixel data */
 	ximage = NULL;
 
 	mask = None;
@@ -967,12 +1024,25 @@ static void EwmhHandle_NET_WM_ICONNotify(XPropertyEvent *event,
 	}
 
 	Image *image = EwmhGetIcon(Scr, twm_win);
+	if(image == NULL) {
+		/* Went away or broke; keep what we've got */
+		return;
+	}
+
+	/*
+	 * Apps tend to re-set the property with the same contents; in that
+	 * case we get back the same shared Image, and there's nothing to do.
+	 */
+	if(image == icon->image) {
+		ReleaseImage(image);
+		return;
+	}
 
 	/* TODO: de-duplicate with handling of XA_WM_HINTS */
 	{
 		Image *old_image = icon->image;
 		icon->image = image;
-		FreeImage(old_image);
+		ReleaseImage(old_image);
 	}
 
 
@@ -1416,7 +1486,7 @@ void EwmhSet_NET_WM_DESKTOP_ws(TwmWindow *twm_win, WorkSpace *ws)
 	if(!Scr->workSpaceManagerActive) {
 		workspaces[n++] = 0;
 	}
-	else if(twm_win->occupation == fullOccupation) {
+	else if(OccEqual(&twm_win->occupation, &fullOccupation)) {
 		workspaces[n++] = ALL_WORKSPACES;
 	}
 	else {
@@ -1427,7 +1497,7 @@ void EwmhSet_NET_WM_DESKTOP_ws(TwmWindow *twm_win, WorkSpace *ws)
 		 * Put the currently visible workspace (if any) first, since typical
 		 * pager apps don't know about this.
 		 */
-		int occupation = twm_win->occupation;
+		Occupation occupation = twm_win->occupation;
 
 		/*
 		 * Set visible workspace number.
@@ -1436,22 +1506,15 @@ void EwmhSet_NET_WM_DESKTOP_ws(TwmWindow *twm_win, WorkSpace *ws)
 			int wsn = ws->number;
 
 			workspaces[n++] = wsn;
-			occupation &= ~(1 << wsn);
+			OccUnset(&occupation, wsn);
 		}
 
 		/*
 		 * Set any other workspace numbers.
 		 */
-		if(occupation != 0) {
-			int i;
-			int mask = 1;
-
-			for(i = 0; i < MAXWORKSPACE; i++) {
-				if(occupation & mask) {
-					workspaces[n++] = i;
-				}
-				mask <<= 1;
-			}
+		for(int i = OccNext(&occupation, 0); i >= 0;
+		                i = OccNext(&occupation, i + 1)) {
+			workspaces[n++] = i;
 		}
 	}
 
@@ -1470,6 +1533,9 @@ static unsigned long EwmhGetWindowProperty(Window w, Atom name, Atom type)
 	unsigned long *prop;
 	unsigned long value;
 
+	if(!WinMayHaveProp(w, name)) {
+		return 0;
+	}
 	if(XGetWindowProperty(dpy, w, name,
 	                      0, 1, False, type,
 	                      &actual_type, &actual_format, &nitems,
@@ -1506,6 +1572,10 @@ static unsigned long *EwmhGetWindowProperties(Window w, Atom name, Atom type,
 	unsigned long bytes_after;
 	unsigned long *prop;
 
+	if(!WinMayHaveProp(w, name)) {
+		*nitems_return = 0;
+		return NULL;
+	}
 	if(XGetWindowProperty(dpy, w, name,
 	                      0, 8192, False, type,
 	                      &actual_type, &actual_format, nitems_return,
@@ -1523,13 +1593,13 @@ static unsigned long *EwmhGetWindowProperties(Window w, Atom name, Atom type,
 	return prop;
 }
 
-int EwmhGetOccupation(TwmWindow *twm_win)
+Occupation EwmhGetOccupation(TwmWindow *twm_win)
 {
 	unsigned long nitems;
 	unsigned long *prop;
-	int occupation;
+	Occupation occupation;
 
-	occupation = 0;
+	OccClear(&occupation);
 
 	prop = EwmhGetWindowProperties(twm_win->w,
 	                               XA__NET_WM_DESKTOP, XA_CARDINAL, &nitems);
@@ -1542,14 +1612,14 @@ int EwmhGetOccupation(TwmWindow *twm_win)
 				occupation = fullOccupation;
 			}
 			else if(val < Scr->workSpaceMgr.count) {
-				occupation |= 1 << val;
+				OccSet(&occupation, val);
 			}
 			else {
-				occupation |= 1 << (Scr->workSpaceMgr.count - 1);
+				OccSet(&occupation, Scr->workSpaceMgr.count - 1);
 			}
 		}
 
-		occupation &= fullOccupation;
+		OccIntersect(&occupation, &occupation, &fullOccupation);
 
 		XFree(prop);
 	}
@@ -1573,7 +1643,7 @@ static void EwmhClientMessage_NET_WM_DESKTOP(XClientMessageEvent *msg)
 {
 	Window w = msg->window;
 	TwmWindow *twm_win;
-	int occupation;
+	Occupation occupation;
 	VirtualScreen *vs;
 	unsigned int val;
 
@@ -1587,7 +1657,7 @@ static void EwmhClientMessage_NET_WM_DESKTOP(XClientMessageEvent *msg)
 
 	/* Remove from visible workspace */
 	if((vs = twm_win->vs) != NULL) {
-		occupation &= ~(1 << vs->wsw->currentwspc->number);
+		OccUnset(&occupation, vs->wsw->currentwspc->number);
 	}
 
 	val = (unsigned int)msg->data.l[0];
@@ -1597,13 +1667,13 @@ static void EwmhClientMessage_NET_WM_DESKTOP(XClientMessageEvent *msg)
 		occupation = fullOccupation;
 	}
 	else if(val < Scr->workSpaceMgr.count) {
-		occupation |= 1 << val;
+		OccSet(&occupation, val);
 	}
 	else {
-		occupation |= 1 << (Scr->workSpaceMgr.count - 1);
+		OccSet(&occupation, Scr->workSpaceMgr.count - 1);
 	}
 
-	ChangeOccupation(twm_win, occupation);
+	ChangeOccupation(twm_win, &occupation);
 }
 
 /*
@@ -1653,9 +1723,7 @@ void EwmhAddClientWindow(TwmWindow *new_win)
 			fprintf(stderr, "Unable to allocate memory for EWMH client list.\n");
 			return;
 		}
-		XChangeProperty(dpy, Scr->Root, XA__NET_CLIENT_LIST, XA_WINDOW, 32,
-		                PropModeReplace, (unsigned char *)Scr->ewmh_CLIENT_LIST,
-		                Scr->ewmh_CLIENT_LIST_used);
+		DeferWork(DEFER_EWMH, EwmhPublish_NET_CLIENT_LIST, Scr);
 	}
 }
 
@@ -1691,10 +1759,25 @@ void EwmhDeleteClientWindow(TwmWindow *old_win)
 	}
 	/* If window was not found, there is no need to update the property. */
 	if(i >= 0) {
-		XChangeProperty(dpy, Scr->Root, XA__NET_CLIENT_LIST, XA_WINDOW, 32,
-		                PropModeReplace, (unsigned char *)Scr->ewmh_CLIENT_LIST,
-		                Scr->ewmh_CLIENT_LIST_used);
+		DeferWork(DEFER_EWMH, EwmhPublish_NET_CLIENT_LIST, Scr);
+	}
+}
+
+/*
+ * The client lists change a window at a time, but the properties only
+ * get set once things quiet down; a bunch of windows coming or going
+ * or restacking together then only means rewriting them once.
+ */
+static void EwmhPublish_NET_CLIENT_LIST(void *data)
+{
+	ScreenInfo *scr = data;
+
+	if(scr->ewmh_CLIENT_LIST_size == 0) {
+		return;
 	}
+	XChangeProperty(dpy, scr->Root, XA__NET_CLIENT_LIST, XA_WINDOW, 32,
+	                PropModeReplace, (unsigned char *)scr->ewmh_CLIENT_LIST,
+	                scr->ewmh_CLIENT_LIST_used);
 }
 
 /*
@@ -1705,15 +1788,24 @@ void EwmhDeleteClientWindow(TwmWindow *old_win)
 
 void EwmhSet_NET_CLIENT_LIST_STACKING(void)
 {
+	DeferWork(DEFER_EWMH, EwmhPublish_NET_CLIENT_LIST_STACKING, Scr);
+}
+
+static void EwmhPublish_NET_CLIENT_LIST_STACKING(void *data)
+{
+	ScreenInfo *savedScr = Scr;
 	int size;
 	unsigned long *prop;
 	TwmWindow *twm_win;
 	int i;
 
+	Scr = data;
+
 	/* Expect the same number of windows as in the _NET_CLIENT_LIST */
 	size = Scr->ewmh_CLIENT_LIST_used + 10;
 	prop = calloc(size, sizeof(unsigned long));
 	if(prop == NULL) {
+		Scr = savedScr;
 		return;
 	}
 
@@ -1742,6 +1834,7 @@ void EwmhSet_NET_CLIENT_LIST_STACKING(void)
 	                PropModeReplace, (unsigned char *)prop, i);
 
 	free(prop);
+	Scr = savedScr;
 }
 
 void EwmhSet_NET_ACTIVE_WINDOW(Window w)
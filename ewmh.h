@@ -66,7 +66,7 @@ Image *EwmhGetIcon(ScreenInfo *scr, TwmWindow *twm_win);
 int EwmhHandlePropertyNotify(XPropertyEvent *event, TwmWindow *twm_win);
 void EwmhSet_NET_WM_DESKTOP(TwmWindow *twm_win);
 void EwmhSet_NET_WM_DESKTOP_ws(TwmWindow *twm_win, WorkSpace *ws);
-int EwmhGetOccupation(TwmWindow *twm_win);
+Occupation EwmhGetOccupation(TwmWindow *twm_win);
 void EwmhUnmapNotify(TwmWindow *twm_win);
 void EwmhAddClientWindow(TwmWindow *new_win);
 void EwmhDeleteClientWindow(TwmWindow *old_win);
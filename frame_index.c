@@ -0,0 +1,577 @@
+/*
+ * Spatial index of window frames
+ *
+ * f.movepack and f.movepush, and the f.jump* and f.fill functions, need
+ * to know what other frames are in some rectangle.  Rather than looking
+ * at every window for that, each virtual screen and window box keeps a
+ * grid of which frames are in what part of it.  The grid is hashed,
+ * since frames can be anywhere, including off the screen; colliding
+ * cells just give us a few extra candidates to check.  Frames big enough
+ * to cover lots of cells go on a separate list that always gets checked.
+ *
+ * A window is filed in the index of the window box it's in, or
+ * otherwise of the virtual screen it's displayed on.  Windows not
+ * displayed anywhere aren't filed.  SetupFrame() and the things that
+ * move windows between virtual screens keep it up to date.
+ *
+ * For SmartPlacement, the index of each virtual screen also keeps a
+ * coarser grid over the screen, counting how many mapped frames cover
+ * each cell.  That's kept up as windows map, unmap and move, so finding
+ * the least covered spot for a new window only has to look at the grid,
+ * however many windows there are.
+ */
+
+#include "ctwm.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "frame_index.h"
+#include "screen.h"
+#include "util.h"
+#include "vscreen.h"
+
+
+#define FI_CELL_SIZE   128   // Pixels on a side of a grid cell
+#define FI_NBUCKETS    256   // Hash buckets per index
+#define FI_MAXCELLS    32    // Frames covering more cells go on the big list
+#define FI_COVER_CELL  16    // Pixels on a side of a coverage grid cell
+
+typedef struct FrameIndexEnt FrameIndexEnt;
+struct FrameIndexEnt {
+	FrameIndexEnt  *next;
+	FrameIndexEnt **prevp;
+	TwmWindow      *win;
+};
+
+struct FrameIndex {
+	FrameIndexEnt *buckets[FI_NBUCKETS];
+	FrameIndexEnt *big;
+	unsigned short *cover;      // Coverage grid, for vscreens
+	int            coverw, coverh;
+};
+
+/* What each window keeps about where it's filed */
+struct FrameIndexSlot {
+	FrameIndex    *fi;          // Where it's filed; NULL if nowhere
+	int            cx0, cy0;    // Range of cells it's filed in
+	int            cx1, cy1;
+	unsigned int   serial;      // Order it was added in
+	unsigned int   stamp;       // Last search that found it
+	int            nents, maxents;
+	FrameIndexEnt *ents;
+	FrameIndex    *cfi;         // Whose coverage grid it counts in
+	int            ccx0, ccy0;  // Range of coverage cells it counts in
+	int            ccx1, ccy1;
+};
+
+/* What a search has turned up */
+typedef struct FrameIndexHits {
+	TwmWindow **wins;
+	int         n, max;
+} FrameIndexHits;
+
+
+static void file_frame(TwmWindow *tmp_win, struct FrameIndexSlot *slot);
+static FrameIndex **home_of(TwmWindow *tmp_win);
+static void unfile(struct FrameIndexSlot *slot);
+static void update_cover(TwmWindow *tmp_win, struct FrameIndexSlot *slot);
+static void add_cover(struct FrameIndexSlot *slot, int delta);
+static FrameIndex *cover_grid(VirtualScreen *vs);
+static void search(FrameIndex *fi, int x, int y, int w, int h,
+                   FrameIndexHits *hits);
+static TwmWindow **finish_search(FrameIndexHits *hits, int *nfound);
+
+static unsigned int last_serial = 0;
+static unsigned int last_stamp = 0;
+
+
+/* Which cell a coordinate is in; rounds down for negatives too */
+static inline int
+cell_of(int v, int size)
+{
+	return (v >= 0) ? (v / size) : -((-v - 1) / size) - 1;
+}
+
+static inline int
+cell(int v)
+{
+	return cell_of(v, FI_CELL_SIZE);
+}
+
+static inline unsigned int
+bucket(int cx, int cy)
+{
+	return ((unsigned int)cx * 73856093u ^ (unsigned int)cy * 19349663u)
+	       % FI_NBUCKETS;
+}
+
+static inline void
+link_ent(FrameIndexEnt *ent, FrameIndexEnt **head)
+{
+	ent->next = *head;
+	ent->prevp = head;
+	if(*head != NULL) {
+		(*head)->prevp = &ent->next;
+	}
+	*head = ent;
+}
+
+
+/*
+ * Make sure a window is filed where it should be.  Cheap if it already
+ * is, so it's fine to call on every little move, and whenever it maps
+ * or unmaps.
+ */
+void
+FrameIndexUpdate(TwmWindow *tmp_win)
+{
+	struct FrameIndexSlot *slot = tmp_win->fislot;
+
+	if(slot == NULL) {
+		slot = calloc(1, sizeof(*slot));
+		if(slot == NULL) {
+			fprintf(stderr, "%s: Out of memory\n", __func__);
+			Done(0);
+		}
+		slot->serial = ++last_serial;
+		tmp_win->fislot = slot;
+	}
+
+	file_frame(tmp_win, slot);
+	update_cover(tmp_win, slot);
+}
+
+
+static void
+file_frame(TwmWindow *tmp_win, struct FrameIndexSlot *slot)
+{
+	const int bw2 = 2 * tmp_win->frame_bw;
+	FrameIndex **homep, *fi;
+	int cx0, cy0, cx1, cy1, ncells;
+	bool big;
+
+	homep = home_of(tmp_win);
+	if(homep == NULL) {
+		unfile(slot);
+		return;
+	}
+	if(*homep == NULL) {
+		*homep = calloc(1, sizeof(FrameIndex));
+		if(*homep == NULL) {
+			fprintf(stderr, "%s: Out of memory\n", __func__);
+			Done(0);
+		}
+	}
+	fi = *homep;
+
+	cx0 = cell(tmp_win->frame_x);
+	cy0 = cell(tmp_win->frame_y);
+	cx1 = cell(tmp_win->frame_x + (int)tmp_win->frame_width + bw2 - 1);
+	cy1 = cell(tmp_win->frame_y + (int)tmp_win->frame_height + bw2 - 1);
+	if(slot->fi == fi && slot->cx0 == cx0 && slot->cy0 == cy0
+	                && slot->cx1 == cx1 && slot->cy1 == cy1) {
+		return;
+	}
+
+	unfile(slot);
+	ncells = (cx1 - cx0 + 1) * (cy1 - cy0 + 1);
+	big = (ncells > FI_MAXCELLS);
+	if(big) {
+		ncells = 1;
+	}
+	if(ncells > slot->maxents) {
+		FrameIndexEnt *ents = realloc(slot->ents, ncells * sizeof(*ents));
+		if(ents == NULL) {
+			fprintf(stderr, "%s: Out of memory\n", __func__);
+			Done(0);
+		}
+		slot->ents = ents;
+		slot->maxents = ncells;
+	}
+
+	if(big) {
+		slot->ents[0].win = tmp_win;
+		link_ent(&slot->ents[0], &fi->big);
+	}
+	else {
+		int i = 0;
+		for(int cy = cy0 ; cy <= cy1 ; cy++) {
+			for(int cx = cx0 ; cx <= cx1 ; cx++, i++) {
+				slot->ents[i].win = tmp_win;
+				link_ent(&slot->ents[i], &fi->buckets[bucket(cx, cy)]);
+			}
+		}
+	}
+	slot->nents = ncells;
+	slot->fi = fi;
+	slot->cx0 = cx0;
+	slot->cy0 = cy0;
+	slot->cx1 = cx1;
+	slot->cy1 = cy1;
+}
+
+
+/* Forget about a window; it's going away */
+void
+FrameIndexRemove(TwmWindow *tmp_win)
+{
+	struct FrameIndexSlot *slot = tmp_win->fislot;
+
+	if(slot == NULL) {
+		return;
+	}
+	unfile(slot);
+	add_cover(slot, -1);
+	free(slot->ents);
+	free(slot);
+	tmp_win->fislot = NULL;
+}
+
+
+/* Where a window should be filed, or NULL if it shouldn't be */
+static FrameIndex **
+home_of(TwmWindow *tmp_win)
+{
+	if(tmp_win->vs == NULL) {
+		return NULL;
+	}
+	if(tmp_win->winbox != NULL) {
+		return &tmp_win->winbox->frameindex;
+	}
+	return &tmp_win->vs->frameindex;
+}
+
+
+static void
+unfile(struct FrameIndexSlot *slot)
+{
+	for(int i = 0 ; i < slot->nents ; i++) {
+		FrameIndexEnt *ent = &slot->ents[i];
+
+		*ent->prevp = ent->next;
+		if(ent->next != NULL) {
+			ent->next->prevp = ent->prevp;
+		}
+	}
+	slot->nents = 0;
+	slot->fi = NULL;
+}
+
+
+/*
+ * Count a window in the coverage grid of the virtual screen it's on, if
+ * it's mapped there.
+ */
+static void
+update_cover(TwmWindow *tmp_win, struct FrameIndexSlot *slot)
+{
+	const int bw2 = 2 * tmp_win->frame_bw;
+	FrameIndex *cfi = NULL;
+	int cx0 = 0, cy0 = 0, cx1 = -1, cy1 = -1;
+
+	if(tmp_win->mapped && tmp_win->vs != NULL && tmp_win->winbox == NULL) {
+		cfi = cover_grid(tmp_win->vs);
+		cx0 = MAX(cell_of(tmp_win->frame_x, FI_COVER_CELL), 0);
+		cy0 = MAX(cell_of(tmp_win->frame_y, FI_COVER_CELL), 0);
+		cx1 = cell_of(tmp_win->frame_x + (int)tmp_win->frame_width + bw2 - 1,
+		              FI_COVER_CELL);
+		cy1 = cell_of(tmp_win->frame_y + (int)tmp_win->frame_height + bw2 - 1,
+		              FI_COVER_CELL);
+		cx1 = MIN(cx1, cfi->coverw - 1);
+		cy1 = MIN(cy1, cfi->coverh - 1);
+		if(cx0 > cx1 || cy0 > cy1) {
+			/* Entirely off the screen */
+			cfi = NULL;
+		}
+	}
+	if(cfi == NULL) {
+		cx0 = cy0 = 0;
+		cx1 = cy1 = -1;
+	}
+
+	if(slot->cfi == cfi && slot->ccx0 == cx0 && slot->ccy0 == cy0
+	                && slot->ccx1 == cx1 && slot->ccy1 == cy1) {
+		return;
+	}
+	add_cover(slot, -1);
+	slot->cfi = cfi;
+	slot->ccx0 = cx0;
+	slot->ccy0 = cy0;
+	slot->ccx1 = cx1;
+	slot->ccy1 = cy1;
+	add_cover(slot, 1);
+}
+
+
+static void
+add_cover(struct FrameIndexSlot *slot, int delta)
+{
+	FrameIndex *cfi = slot->cfi;
+
+	if(cfi == NULL) {
+		return;
+	}
+	for(int cy = slot->ccy0 ; cy <= slot->ccy1 ; cy++) {
+		unsigned short *row = cfi->cover + cy * cfi->coverw;
+		for(int cx = slot->ccx0 ; cx <= slot->ccx1 ; cx++) {
+			row[cx] += delta;
+		}
+	}
+	if(delta < 0) {
+		slot->cfi = NULL;
+	}
+}
+
+
+/* The index for a vscreen, with its coverage grid set up */
+static FrameIndex *
+cover_grid(VirtualScreen *vs)
+{
+	FrameIndex *fi = vs->frameindex;
+
+	if(fi == NULL) {
+		fi = vs->frameindex = calloc(1, sizeof(FrameIndex));
+		if(fi == NULL) {
+			fprintf(stderr, "%s: Out of memory\n", __func__);
+			Done(0);
+		}
+	}
+	if(fi->cover == NULL) {
+		fi->coverw = (vs->w + FI_COVER_CELL - 1) / FI_COVER_CELL;
+		fi->coverh = (vs->h + FI_COVER_CELL - 1) / FI_COVER_CELL;
+		fi->cover = calloc((size_t)fi->coverw * fi->coverh,
+		                   sizeof(unsigned short));
+		if(fi->cover == NULL) {
+			fprintf(stderr, "%s: Out of memory\n", __func__);
+			Done(0);
+		}
+	}
+	return fi;
+}
+
+
+/*
+ * Where the top left of something w x h should go along one axis to be
+ * placed: flush against the start, on each grid line past it, and flush
+ * against the end.  Returns how many.
+ */
+static int
+place_candidates(int start, int end, int len, int *pos)
+{
+	int n = 0;
+
+	pos[n++] = start;
+	for(int p = (cell_of(start, FI_COVER_CELL) + 1) * FI_COVER_CELL ;
+	                p + len < end ; p += FI_COVER_CELL) {
+		pos[n++] = p;
+	}
+	if(end - len > start) {
+		pos[n++] = end - len;
+	}
+	return n;
+}
+
+
+/*
+ * Find where on a vscreen a frame w x h (border included) would cover
+ * the least of the mapped windows already there, staying inside the
+ * Border* areas.  Ties go to the highest, then leftmost, spot.
+ */
+void
+FrameIndexFindSpace(VirtualScreen *vs, int w, int h, int *x, int *y)
+{
+	const int bx0 = Scr->BorderLeft, bx1 = vs->w - Scr->BorderRight;
+	const int by0 = Scr->BorderTop,  by1 = vs->h - Scr->BorderBottom;
+	FrameIndex *fi = cover_grid(vs);
+	const int gw = fi->coverw, gh = fi->coverh;
+	unsigned int *sat, best = UINT_MAX;
+	int *xs, *ys, nxs, nys;
+
+	/*
+	 * Summed-area table of the grid: sat[(y+1)*(gw+1) + x+1] is the
+	 * total of everything above and left of cell (x, y) inclusive.
+	 */
+	sat = calloc((size_t)(gw + 1) * (gh + 1), sizeof(unsigned int));
+	xs = malloc((gw + 2) * sizeof(int));
+	ys = malloc((gh + 2) * sizeof(int));
+	if(sat == NULL || xs == NULL || ys == NULL) {
+		fprintf(stderr, "%s: Out of memory\n", __func__);
+		Done(0);
+	}
+	for(int cy = 0 ; cy < gh ; cy++) {
+		unsigned int rowsum = 0;
+		for(int cx = 0 ; cx < gw ; cx++) {
+			rowsum += fi->cover[cy * gw + cx];
+			sat[(cy + 1) * (gw + 1) + cx + 1] = sat[cy * (gw + 1) + cx + 1]
+			                                    + rowsum;
+		}
+	}
+
+	nxs = place_candidates(bx0, bx1, w, xs);
+	nys = place_candidates(by0, by1, h, ys);
+	*x = xs[0];
+	*y = ys[0];
+	for(int j = 0 ; j < nys && best > 0 ; j++) {
+		const int cy0 = MIN(MAX(cell_of(ys[j], FI_COVER_CELL), 0), gh);
+		const int cy1 = MIN(MAX(cell_of(ys[j] + h - 1, FI_COVER_CELL) + 1, 0), gh);
+
+		for(int i = 0 ; i < nxs ; i++) {
+			const int cx0 = MIN(MAX(cell_of(xs[i], FI_COVER_CELL), 0), gw);
+			const int cx1 = MIN(MAX(cell_of(xs[i] + w - 1, FI_COVER_CELL) + 1, 0),
+			                    gw);
+			const unsigned int covered = sat[cy1 * (gw + 1) + cx1]
+			                             - sat[cy0 * (gw + 1) + cx1]
+			                             - sat[cy1 * (gw + 1) + cx0]
+			                             + sat[cy0 * (gw + 1) + cx0];
+
+			if(covered < best) {
+				best = covered;
+				*x = xs[i];
+				*y = ys[j];
+				if(best == 0) {
+					break;
+				}
+			}
+		}
+	}
+
+	free(sat);
+	free(xs);
+	free(ys);
+}
+
+
+/*
+ * Find the windows filed alongside tmp_win (in the same window box or
+ * virtual screen) whose frames overlap a rectangle.  tmp_win itself may
+ * be among them.  They come back in the same order as Scr->FirstWindow,
+ * in a malloc()'d array that the caller frees; NULL if there are none.
+ */
+TwmWindow **
+FrameIndexFind(TwmWindow *tmp_win, int x, int y, int w, int h, int *nfound)
+{
+	FrameIndexHits hits = { NULL, 0, 0 };
+	FrameIndex **homep = home_of(tmp_win);
+
+	last_stamp++;
+	if(homep != NULL && *homep != NULL) {
+		search(*homep, x, y, w, h, &hits);
+	}
+	return finish_search(&hits, nfound);
+}
+
+
+/*
+ * Like FrameIndexFind(), but looking at every virtual screen and window
+ * box.
+ */
+TwmWindow **
+FrameIndexFindAll(int x, int y, int w, int h, int *nfound)
+{
+	FrameIndexHits hits = { NULL, 0, 0 };
+
+	last_stamp++;
+	for(VirtualScreen *vs = Scr->vScreenList ; vs != NULL ; vs = vs->next) {
+		if(vs->frameindex != NULL) {
+			search(vs->frameindex, x, y, w, h, &hits);
+		}
+	}
+	for(WindowBox *wb = Scr->FirstWindowBox ; wb != NULL ; wb = wb->next) {
+		if(wb->frameindex != NULL) {
+			search(wb->frameindex, x, y, w, h, &hits);
+		}
+	}
+	return finish_search(&hits, nfound);
+}
+
+
+static void
+check_ent(FrameIndexEnt *ent, int x, int y, int w, int h,
+          FrameIndexHits *hits)
+{
+	for( ; ent != NULL ; ent = ent->next) {
+		TwmWindow *t = ent->win;
+		const int tw = t->frame_width  + 2 * t->frame_bw;
+		const int th = t->frame_height + 2 * t->frame_bw;
+
+		if(t->fislot->stamp == last_stamp) {
+			continue;
+		}
+		t->fislot->stamp = last_stamp;
+
+		if(x >= t->frame_x + tw || t->frame_x >= x + w
+		                || y >= t->frame_y + th || t->frame_y >= y + h) {
+			continue;
+		}
+
+		if(hits->n == hits->max) {
+			TwmWindow **wins;
+
+			hits->max = hits->max ? hits->max * 2 : 16;
+			wins = realloc(hits->wins, hits->max * sizeof(TwmWindow *));
+			if(wins == NULL) {
+				fprintf(stderr, "%s: Out of memory\n", __func__);
+				Done(0);
+			}
+			hits->wins = wins;
+		}
+		hits->wins[hits->n++] = t;
+	}
+}
+
+
+static void
+search(FrameIndex *fi, int x, int y, int w, int h, FrameIndexHits *hits)
+{
+	int cx0, cy0, cx1, cy1;
+
+	if(w <= 0 || h <= 0) {
+		return;
+	}
+
+	check_ent(fi->big, x, y, w, h, hits);
+
+	cx0 = cell(x);
+	cy0 = cell(y);
+	cx1 = cell(x + w - 1);
+	cy1 = cell(y + h - 1);
+	if((long)(cx1 - cx0 + 1) * (cy1 - cy0 + 1) > FI_NBUCKETS) {
+		/* Cheaper to just look at everything */
+		for(int i = 0 ; i < FI_NBUCKETS ; i++) {
+			check_ent(fi->buckets[i], x, y, w, h, hits);
+		}
+		return;
+	}
+
+	for(int cy = cy0 ; cy <= cy1 ; cy++) {
+		for(int cx = cx0 ; cx <= cx1 ; cx++) {
+			check_ent(fi->buckets[bucket(cx, cy)], x, y, w, h, hits);
+		}
+	}
+}
+
+
+/* Newest first, like Scr->FirstWindow */
+static int
+cmp_serial(const void *a, const void *b)
+{
+	const TwmWindow *ta = *(TwmWindow * const *)a;
+	const TwmWindow *tb = *(TwmWindow * const *)b;
+
+	if(ta->fislot->serial == tb->fislot->serial) {
+		return 0;
+	}
+	return (ta->fislot->serial < tb->fislot->serial) ? 1 : -1;
+}
+
+static TwmWindow **
+finish_search(FrameIndexHits *hits, int *nfound)
+{
+	if(hits->n > 1) {
+		qsort(hits->wins, hits->n, sizeof(TwmWindow *), cmp_serial);
+	}
+	*nfound = hits->n;
+	return hits->wins;
+}
@@ -0,0 +1,16 @@
+/*
+ * Spatial index of window frames
+ */
+#ifndef _CTWM_FRAME_INDEX_H
+#define _CTWM_FRAME_INDEX_H
+
+void FrameIndexUpdate(TwmWindow *tmp_win);
+void FrameIndexRemove(TwmWindow *tmp_win);
+
+TwmWindow **FrameIndexFind(TwmWindow *tmp_win, int x, int y, int w, int h,
+                           int *nfound);
+TwmWindow **FrameIndexFindAll(int x, int y, int w, int h, int *nfound);
+
+void FrameIndexFindSpace(VirtualScreen *vs, int w, int h, int *x, int *y);
+
+#endif /* _CTWM_FRAME_INDEX_H */
@@ -4,6 +4,7 @@
 
 #include "ctwm.h"
 
+#include "frame_index.h"
 #include "functions_internal.h"
 #include "iconmgr.h"
 #include "icons.h"
@@ -112,6 +113,7 @@ DFHANDLER(showiconmgr)
 
 			/* Mark as shown */
 			i->twm_win->mapped = true;
+			FrameIndexUpdate(i->twm_win);
 			i->twm_win->isicon = false;
 		}
 	}
@@ -156,6 +158,7 @@ HideIconManager(void)
 
 			/* Mark as pretend-iconified, even though the icon is hidden */
 			i->twm_win->mapped = false;
+			FrameIndexUpdate(i->twm_win);
 			i->twm_win->isicon = true;
 		}
 	}
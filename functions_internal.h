@@ -157,6 +157,7 @@ DFHANDLER(quit);
 DFHANDLER(restart);
 DFHANDLER(beep);
 DFHANDLER(trace);
+DFHANDLER(dumpstats);
 DFHANDLER(fittocontent);
 DFHANDLER(showbackground);
 DFHANDLER(raiseicons);
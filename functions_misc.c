@@ -10,16 +10,21 @@
 
 #include <stdlib.h>
 
+#include "add_window.h"
 #include "animate.h"
+#include "event_stats.h"
 #include "functions.h"
 #include "functions_defs.h"
 #include "functions_internal.h"
 #include "icons.h"
+#include "launch.h"
+#include "list.h"
 #include "otp.h"
 #include "screen.h"
 #ifdef SOUNDS
 #include "sound.h"
 #endif
+#include "text_extents.h"
 #include "util.h"
 #include "win_iconify.h"
 #include "windowbox.h"
@@ -190,6 +195,14 @@ DFHANDLER(trace)
 	DebugTrace(action);
 }
 
+DFHANDLER(dumpstats)
+{
+	EventStatsDump(stderr);
+	TextExtentsStatsDump(stderr);
+	ListLookupsStatsDump(stderr);
+	GrabStatsDump(stderr);
+}
+
 
 
 /*
@@ -336,9 +349,6 @@ static void
 Execute(const char *_s)
 {
 	char *s;
-	char *_ds;
-	char *orig_display;
-	int restorevar = 0;
 	char *subs;
 
 	/* Seatbelt */
@@ -352,59 +362,6 @@ Execute(const char *_s)
 		return;
 	}
 
-	/* Stash up current $DISPLAY value for resetting */
-	orig_display = getenv("DISPLAY");
-
-
-	/*
-	 * Build a display string using the current screen number, so that
-	 * X programs which get fired up from a menu come up on the screen
-	 * that they were invoked from, unless specifically overridden on
-	 * their command line.
-	 *
-	 * Which is to say, given that we're on display "foo.bar:1.2", we
-	 * want to translate that into "foo.bar:1.{Scr->screen}".
-	 *
-	 * We strdup() because DisplayString() is a macro returning into the
-	 * dpy structure, and we're going to mutate the value we get from it.
-	 */
-	_ds = DisplayString(dpy);
-	if(_ds) {
-		char *ds;
-		char *colon;
-
-		ds = strdup(_ds);
-		if(!ds) {
-			goto end_execute;
-		}
-
-		/* If it's not host:dpy, we don't have anything to do here */
-		colon = strrchr(ds, ':');
-		if(colon) {
-			char *dot, *new_display;
-
-			/* Find the . in display.screen and chop it off */
-			dot = strchr(colon, '.');
-			if(dot) {
-				*dot = '\0';
-			}
-
-			/* Build a new string with our correct screen info */
-			asprintf(&new_display, "%s.%d", ds, Scr->screen);
-			if(!new_display) {
-				free(ds);
-				goto end_execute;
-			}
-
-			/* And set */
-			setenv("DISPLAY", new_display, 1);
-			free(new_display);
-			restorevar = 1;
-		}
-		free(ds);
-	}
-
-
 	/*
 	 * We replace a couple placeholders in the string.  $currentworkspace
 	 * is documented in the manual; $redirect is not.
@@ -452,29 +409,12 @@ Execute(const char *_s)
 
 
 	/*
-	 * Call it.  Return value doesn't really matter, since whatever
-	 * happened we're done.  Maybe someday if we develop a "show user
-	 * message" generalized func, we can tell the user if executing
-	 * failed somehow.
-	 */
-	system(s);
-
-
-	/*
-	 * Restore $DISPLAY if we changed it.  It's probably only necessary
-	 * in edge cases (it might be used by ctwm restarting itself, for
-	 * instance) and it's not quite clear whether the DisplayString()
-	 * result would even be wrong for that, but what the heck, setenv()
-	 * is cheap.
+	 * Start it up, and get right back to work; x-ref launch.c.
+	 * Whatever happened, we're done.  Maybe someday if we develop a
+	 * "show user message" generalized func, we can tell the user if
+	 * executing failed somehow.
 	 */
-	if(restorevar) {
-		if(orig_display) {
-			setenv("DISPLAY", orig_display, 1);
-		}
-		else {
-			unsetenv("DISPLAY");
-		}
-	}
+	LaunchCommand(s);
 
 
 	/* Clean up */
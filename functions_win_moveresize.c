@@ -10,6 +10,7 @@
 #include "colormaps.h"
 #include "events.h"
 #include "event_handlers.h"
+#include "frame_index.h"
 #include "functions.h"
 #include "functions_defs.h"
 #include "functions_internal.h"
@@ -480,7 +481,7 @@ movewindow(EF_FULLPROTO)
 			 */
 
 			/* Find TwmWindow bits related to what we're dragging */
-			if(XFindContext(dpy, DragWindow, TwmContext, (XPointer *) &t) == XCNOENT) {
+			if((t = GetTwmWindow(DragWindow)) == NULL) {
 				fprintf(stderr, "%s(): Can't find TwmWindow.\n", __func__);
 				/* XXX abort? */
 				t = NULL;
@@ -1280,8 +1281,9 @@ DFHANDLER(restoregeometry)
 static int
 FindConstraint(TwmWindow *tmp_win, MoveFillDir direction)
 {
-	TwmWindow  *t;
-	int ret;
+	TwmWindow  **near;
+	int ret, i, nnear;
+	int qx, qy, qw, qh;
 	const int winx = tmp_win->frame_x;
 	const int winy = tmp_win->frame_y;
 	const int winw = tmp_win->frame_width  + 2 * tmp_win->frame_bw;
@@ -1293,29 +1295,49 @@ FindConstraint(TwmWindow *tmp_win, MoveFillDir direction)
 				return -1;
 			}
 			ret = Scr->BorderLeft;
+			qx = ret;
+			qy = winy;
+			qw = winx - ret;
+			qh = winh;
 			break;
 		case MFD_RIGHT:
 			if(winx + winw > Scr->rootw - Scr->BorderRight) {
 				return -1;
 			}
 			ret = Scr->rootw - Scr->BorderRight;
+			qx = winx + winw;
+			qy = winy;
+			qw = ret - qx;
+			qh = winh;
 			break;
 		case MFD_TOP:
 			if(winy < Scr->BorderTop) {
 				return -1;
 			}
 			ret = Scr->BorderTop;
+			qx = winx;
+			qy = ret;
+			qw = winw;
+			qh = winy - ret;
 			break;
 		case MFD_BOTTOM:
 			if(winy + winh > Scr->rooth - Scr->BorderBottom) {
 				return -1;
 			}
 			ret = Scr->rooth - Scr->BorderBottom;
+			qx = winx;
+			qy = winy + winh;
+			qw = winw;
+			qh = ret - qy;
 			break;
 		default:
 			return -1;
 	}
-	for(t = Scr->FirstWindow; t != NULL; t = t->next) {
+
+	/* Only what's between us and the edge can be in the way */
+	near = FrameIndexFindAll(qx, qy, qw, qh, &nnear);
+	for(i = 0; i < nnear; i++) {
+		TwmWindow *const t = near[i];
 		const int w = t->frame_width  + 2 * t->frame_bw;
 		const int h = t->frame_height + 2 * t->frame_bw;
 
@@ -1380,6 +1402,7 @@ FindConstraint(TwmWindow *tmp_win, MoveFillDir direction)
 				break;
 		}
 	}
+	free(near);
 	return ret;
 }
 
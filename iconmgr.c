@@ -28,18 +28,22 @@
 
 #include <X11/Xatom.h>
 
+#include "text_extents.h"
 #include "util.h"
 #include "iconmgr.h"
 #include "icons_builtin.h"
 #include "screen.h"
 #include "drawing.h"
+#include "frame_index.h"
 #include "functions_defs.h"
 #include "list.h"
 #include "occupation.h"
 #include "otp.h"
 #include "add_window.h"
+#include "deferred.h"
 #include "gram.tab.h"
 #include "win_decorations.h"
+#include "win_index.h"
 #include "win_resize.h"
 #include "win_utils.h"
 
@@ -51,6 +55,8 @@ static WList *Active = NULL;
 static WList *Current = NULL;
 WList *DownIconManager = NULL;
 
+static void PackIconManagerDeferred(void *data);
+
 /***********************************************************************
  *
  *  Procedure:
@@ -167,18 +173,19 @@ void CreateIconManagers(void)
 			 * ctwm.
 			 */
 			if(ws) {
-				p->twm_win->occupation = 1 << ws->number;
+				p->twm_win->occupation = OccOnly(ws->number);
 				if(ws->number > 0) {
 					p->twm_win->vs = NULL;
 				}
 			}
 			else {
-				p->twm_win->occupation = 1;
+				p->twm_win->occupation = OccOnly(0);
 			}
+			UpdateWorkSpaceMembers(p->twm_win);
 #ifdef DEBUG_ICONMGR
 			fprintf(stderr,
-			        "CreateIconManagers: IconMgr %p: x=%d y=%d w=%d h=%d occupation=%x\n",
-			        p, gx, gy,  p->width, p->height, p->twm_win->occupation);
+			        "CreateIconManagers: IconMgr %p: x=%d y=%d w=%d h=%d occupation=%lx...\n",
+			        p, gx, gy,  p->width, p->height, p->twm_win->occupation.w[0]);
 #endif
 
 			sizehints.flags       = PWinGravity;
@@ -186,6 +193,7 @@ void CreateIconManagers(void)
 			XSetWMSizeHints(dpy, p->w, &sizehints, XA_WM_NORMAL_HINTS);
 
 			p->twm_win->mapped = false;
+			FrameIndexUpdate(p->twm_win);
 			SetMapStateProp(p->twm_win, WithdrawnState);
 			if(p->twm_win && (p->twm_win->wmhints->initial_state == IconicState)) {
 				p->twm_win->isicon = true;
@@ -392,9 +400,12 @@ void MoveIconManager(int dir)
 		return;
 	}
 
+	/* Rows and columns need to be up to date */
+	ip = Current->iconmgr;
+	FlushDeferred(PackIconManagerDeferred, ip);
+
 	cur_row = Current->row;
 	cur_col = Current->col;
-	ip = Current->iconmgr;
 
 	row_inc = 0;
 	col_inc = 0;
@@ -717,7 +728,7 @@ WList *AddIconManager(TwmWindow *tmp_win)
 		XSetWindowAttributes attributes; /* attributes for create windows */
 
 		/* Is the window in this workspace? */
-		if((tmp_win->occupation & ip->twm_win->occupation) == 0) {
+		if(!OccIntersects(&tmp_win->occupation, &ip->twm_win->occupation)) {
 			/* Nope, skip onward */
 			ip = ip->nextv;
 			continue;
@@ -806,16 +817,14 @@ WList *AddIconManager(TwmWindow *tmp_win)
 
 		/* Bump housekeeping for the IM */
 		ip->count += 1;
-		PackIconManager(ip);
+		DeferPackIconManager(ip);
 		if(Scr->WindowMask) {
 			XRaiseWindow(dpy, Scr->WindowMask);
 		}
 		XMapWindow(dpy, tmp->w);
 
-		XSaveContext(dpy, tmp->w, TwmContext, (XPointer) tmp_win);
-		XSaveContext(dpy, tmp->w, ScreenContext, (XPointer) Scr);
-		XSaveContext(dpy, tmp->icon, TwmContext, (XPointer) tmp_win);
-		XSaveContext(dpy, tmp->icon, ScreenContext, (XPointer) Scr);
+		WinIndexAdd(tmp->w, Scr, tmp_win, WR_ICONMGR_ENTRY, 0);
+		WinIndexAdd(tmp->icon, Scr, tmp_win, WR_ICONMGR_ICON, 0);
 
 		if(!ip->twm_win->isicon) {
 			if(visible(ip->twm_win)) {
@@ -824,6 +833,7 @@ WList *AddIconManager(TwmWindow *tmp_win)
 				XMapWindow(dpy, ip->twm_win->frame);
 			}
 			ip->twm_win->mapped = true;
+			FrameIndexUpdate(ip->twm_win);
 		}
 
 
@@ -971,26 +981,25 @@ void RemoveIconManager(TwmWindow *tmp_win)
 
 	while(tmp != NULL) {
 		ip = tmp->iconmgr;
-		if((tmp_win->occupation & ip->twm_win->occupation) != 0) {
+		if(OccIntersects(&tmp_win->occupation, &ip->twm_win->occupation)) {
 			tmp1 = tmp;
 			tmp  = tmp->nextv;
 			continue;
 		}
 		RemoveFromIconManager(ip, tmp);
 
-		XDeleteContext(dpy, tmp->icon, TwmContext);
-		XDeleteContext(dpy, tmp->icon, ScreenContext);
+		WinIndexDel(tmp->icon);
 		XDestroyWindow(dpy, tmp->icon);
-		XDeleteContext(dpy, tmp->w, TwmContext);
-		XDeleteContext(dpy, tmp->w, ScreenContext);
+		WinIndexDel(tmp->w);
 		XDestroyWindow(dpy, tmp->w);
 		ip->count -= 1;
 
-		PackIconManager(ip);
+		DeferPackIconManager(ip);
 
 		if(ip->count == 0) {
 			XUnmapWindow(dpy, ip->twm_win->frame);
 			ip->twm_win->mapped = false;
+			FrameIndexUpdate(ip->twm_win);
 		}
 		if(tmp1 == NULL) {
 			tmp_win->iconmanagerlist = tmp_win->iconmanagerlist->nextv;
@@ -1092,7 +1101,30 @@ void SortIconManager(IconMgr *ip)
 		}
 	}
 	while(!done);
+	DeferPackIconManager(ip);
+}
+
+/*
+ * Windows coming and going, and renames, want the icon manager packed
+ * again, but there's no need to do it for each one when a bunch come
+ * through together (like at startup); it just gets done once they're
+ * through.
+ */
+void
+DeferPackIconManager(IconMgr *ip)
+{
+	DeferWork(DEFER_ICONMGR, PackIconManagerDeferred, ip);
+}
+
+static void
+PackIconManagerDeferred(void *data)
+{
+	IconMgr *ip = data;
+	ScreenInfo *savedScr = Scr;
+
+	Scr = ip->scr;
 	PackIconManager(ip);
+	Scr = savedScr;
 }
 
 /***********************************************************************
@@ -1126,6 +1158,9 @@ void PackIconManager(IconMgr *ip)
 	WList *tmp;
 	int mask;
 
+	/* Doing it now covers any later one */
+	CancelDeferred(PackIconManagerDeferred, ip);
+
 	wheight = Scr->IconManagerFont.avg_height
 	          + 2 * (ICON_MGR_OBORDER + ICON_MGR_IBORDER);
 	if(wheight < (im_iconified_icon_height + 4)) {
@@ -1227,9 +1262,9 @@ DrawIconManagerIconName(TwmWindow *tmp_win)
 	WList *iconmanagerlist = tmp_win->iconmanagerlist;
 	XRectangle ink_rect, logical_rect;
 
-	XmbTextExtents(Scr->IconManagerFont.font_set,
-	               tmp_win->icon_name, strlen(tmp_win->icon_name),
-	               &ink_rect, &logical_rect);
+	CachedTextExtents(&Scr->IconManagerFont,
+	                  tmp_win->icon_name, strlen(tmp_win->icon_name),
+	                  &ink_rect, &logical_rect);
 
 	if(UpdateFont(&Scr->IconManagerFont, logical_rect.height)) {
 		PackIconManagers();
@@ -72,6 +72,7 @@ void NotActiveIconManager(WList *active);
 void DrawIconManagerBorder(WList *tmp, bool fill);
 void SortIconManager(IconMgr *ip);
 void PackIconManager(IconMgr *ip);
+void DeferPackIconManager(IconMgr *ip);
 void PackIconManagers(void);
 void dump_iconmanager(IconMgr *mgr, char *label);
 void DrawIconManagerIconName(TwmWindow *tmp_win);
@@ -26,6 +26,7 @@
 
 #include <X11/extensions/shape.h>
 
+#include "add_window.h"
 #include "drawing.h"
 #include "screen.h"
 #include "iconmgr.h"
@@ -33,9 +34,11 @@
 #include "otp.h"
 #include "list.h"
 #include "parse.h"
+#include "text_extents.h"
 #include "util.h"
 #include "animate.h"
 #include "image.h"
+#include "win_index.h"
 #include "win_utils.h"
 #include "workspace_manager.h"
 
@@ -591,9 +594,9 @@ CreateIconWindow(TwmWindow *tmp_win, int def_x, int def_y)
 		XRectangle inc_rect;
 		XRectangle logical_rect;
 
-		XmbTextExtents(Scr->IconFont.font_set,
-		               tmp_win->icon_name, strlen(tmp_win->icon_name),
-		               &inc_rect, &logical_rect);
+		CachedTextExtents(&Scr->IconFont,
+		                  tmp_win->icon_name, strlen(tmp_win->icon_name),
+		                  &inc_rect, &logical_rect);
 		icon->w_width = logical_rect.width;
 
 		icon->w_width += 2 * (Scr->IconManagerShadowDepth + ICON_MGR_IBORDER);
@@ -764,8 +767,8 @@ CreateIconWindow(TwmWindow *tmp_win, int def_x, int def_y)
 	OtpAdd(tmp_win, IconWin);
 
 	XMapSubwindows(dpy, icon->w);
-	XSaveContext(dpy, icon->w, TwmContext, (XPointer)tmp_win);
-	XSaveContext(dpy, icon->w, ScreenContext, (XPointer)Scr);
+	WinIndexAdd(icon->w, Scr, tmp_win, WR_ICON, 0);
+	GrabIconKeys(tmp_win);
 	XDefineCursor(dpy, icon->w, Scr->IconCursor);
 	MaybeAnimate = true;
 }
@@ -796,8 +799,7 @@ DeleteIconsList(TwmWindow *tmp_win)
 		if(icon != tmp_win->icon) {
 			DeleteIcon(icon);
 		}
-		free(nptr->name);
-		free(nptr);
+		FreeListEntry(nptr);
 		nptr = next;
 	}
 	tmp_win->iconslist = NULL;
@@ -811,6 +813,9 @@ DeleteIconsList(TwmWindow *tmp_win)
 void
 DeleteIcon(Icon *icon)
 {
+	if(icon->w) {
+		WinIndexDel(icon->w);
+	}
 	if(icon->w && !icon->w_not_ours) {
 		XDestroyWindow(dpy, icon->w);
 	}
@@ -821,17 +826,18 @@ DeleteIcon(Icon *icon)
 
 /*
  * Delete the Image from an icon, if it is not a shared one.  match_list
- * ands match_unknown_default need not be freed.
- *
- * Formerly ReleaseImage()
+ * and match_net_wm_icon images go back to the image cache;
+ * match_unknown_default need not be freed.
  */
 void
 ReleaseIconImage(Icon *icon)
 {
-	if(icon->match == match_icon_pixmap_hint ||
-	                icon->match == match_net_wm_icon) {
+	if(icon->match == match_icon_pixmap_hint) {
 		FreeImage(icon->image);
 	}
+	else if(icon->match == match_list || icon->match == match_net_wm_icon) {
+		ReleaseImage(icon->image);
+	}
 }
 
 
@@ -984,9 +990,9 @@ PaintIcon(TwmWindow *tmp_win)
 		width = icon->width;
 	}
 	len    = strlen(tmp_win->icon_name);
-	XmbTextExtents(Scr->IconFont.font_set,
-	               tmp_win->icon_name, len,
-	               &ink_rect, &logical_rect);
+	CachedTextExtents(&Scr->IconFont,
+	                  tmp_win->icon_name, len,
+	                  &ink_rect, &logical_rect);
 	twidth = logical_rect.width;
 	mwidth = width - 2 * (Scr->IconManagerShadowDepth + ICON_MGR_IBORDER);
 	if(Scr->use3Diconmanagers) {
@@ -1270,9 +1276,9 @@ RedoIconName(TwmWindow *win)
 		return;
 	}
 
-	XmbTextExtents(Scr->IconFont.font_set,
-	               win->icon_name, strlen(win->icon_name),
-	               &ink_rect, &logical_rect);
+	CachedTextExtents(&Scr->IconFont,
+	                  win->icon_name, strlen(win->icon_name),
+	                  &ink_rect, &logical_rect);
 	win->icon->w_width = logical_rect.width;
 	win->icon->w_width += 2 * (Scr->IconManagerShadowDepth + ICON_MGR_IBORDER);
 	if(win->icon->w_width > Scr->MaxIconTitleWidth) {
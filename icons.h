@@ -19,7 +19,7 @@ typedef enum {
 	match_none,
 	match_list,                 /* shared Image: iconslist and Scr->ImageCache */
 	match_icon_pixmap_hint,     /* Pixmap copied from IconPixmapHint */
-	match_net_wm_icon,          /* Pixmap created from NET_WM_ICON */
+	match_net_wm_icon,          /* shared Image: scaled NET_WM_ICON cache */
 	match_unknown_default,      /* shared Image: Scr->UnknownImage */
 } Matchtype;
 
@@ -8,10 +8,10 @@
 #include "ctwm.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
-#include "list.h"
 #include "screen.h"
 
 #include "image.h"
@@ -30,119 +30,435 @@ bool reportfilenotfound = false;
 Colormap AlternateCmap = None;
 
 
+/*
+ * Image cache.
+ *
+ * Everything GetImage() loads is kept around in a per-Screen cache, so
+ * that e.g. every window's titlebar buttons share one set of pixmaps,
+ * rather than loading a new copy for each.  Entries are keyed on the
+ * name along with the colors (for those image types where the colors
+ * matter), and hashed for lookup.
+ *
+ * GetImage() takes a reference to what it returns, and users give it
+ * back with ReleaseImage() when they're done with it.  Images that
+ * nobody has a reference to are kept around on an LRU list in case
+ * they're wanted again, until the total size of what we're holding on
+ * the X server goes over ImageCacheSize.  At that point the least
+ * recently used unreferenced ones get thrown out.
+ */
+typedef struct ImageCacheEnt {
+	struct ImageCacheEnt *hnext;        // Hash chain
+	struct ImageCacheEnt *lprev, *lnext;  // LRU list, if unreferenced
+	char         *name;
+	Pixel         fore, back;
+	unsigned int  hash;
+	int           refs;
+	size_t        bytes;
+	Image        *image;
+	ImageCache   *cache;
+} ImageCacheEnt;
+
+struct ImageCache {
+	ScreenInfo     *scr;
+	ImageCacheEnt **buckets;
+	unsigned int    nbuckets;           // Always a power of 2
+	unsigned int    count;
+	size_t          bytes;              // Held on the server, all entries
+	ImageCacheEnt  *lru_head;           // Most recently released
+	ImageCacheEnt  *lru_tail;           // Next to be evicted
+};
+
+static Image *LoadImage(const char *name, ColorPair cp);
+static ImageCache *cache_get(void);
+static Image *cache_find(ImageCache *ic, const char *name, Pixel fore,
+                         Pixel back, unsigned int hash);
+static void cache_add(ImageCache *ic, const char *name, Pixel fore,
+                      Pixel back, unsigned int hash, Image *image);
+static unsigned int image_hash(const char *name, Pixel fore, Pixel back);
+static size_t image_bytes(const Image *image);
+static void lru_unlink(ImageCache *ic, ImageCacheEnt *ent);
+static void cache_trim(ImageCache *ic);
+static void cache_resize(ImageCache *ic);
+
+
 /*
  * Find (load/generate) an image by name
  */
 Image *
 GetImage(const char *name, ColorPair cp)
 {
-	name_list **list;
-#define GIFNLEN 256
-	char fullname[GIFNLEN];
+	ImageCache *ic;
 	Image *image;
+	Pixel fore = cp.fore, back = cp.back;
+	unsigned int hash;
 
 	if(name == NULL) {
 		return NULL;
 	}
-	image = NULL;
 
-	list = &Scr->ImageCache;
-	if(0)
-		/* dummy */ ;
-	else if((name [0] == '@') || (strncmp(name, "xpm:", 4) == 0)) {
-#ifdef XPM
-		snprintf(fullname, GIFNLEN, "%s%dx%d", name, (int) cp.fore, (int) cp.back);
+	/* Full-color images come out the same whatever colors we ask for */
+	if(strncmp(name, "jpeg:", 5) == 0 || strncmp(name, "xwd:", 4) == 0
+	                || name[0] == '|') {
+		fore = back = 0;
+	}
+
+	/* Already got it? */
+	ic = cache_get();
+	hash = image_hash(name, fore, back);
+	if((image = cache_find(ic, name, fore, back, hash)) != NULL) {
+		return image;
+	}
+
+	/* Nope, go get it */
+	image = LoadImage(name, cp);
+	if(image == NULL) {
+		return NULL;
+	}
+	cache_add(ic, name, fore, back, hash, image);
+	return image;
+}
+
+
+/*
+ * Images we generate ourselves rather than load by name (e.g., scaled
+ * _NET_WM_ICON's) can be shared through the cache too, under some name
+ * the caller makes up.  GetCachedImage() returns one if we have it, with
+ * a reference.  AddCachedImage() hands one over to the cache, and gives
+ * the caller a reference to it.  Either way, it gets given back with
+ * ReleaseImage().
+ */
+Image *
+GetCachedImage(const char *name)
+{
+	return cache_find(cache_get(), name, 0, 0, image_hash(name, 0, 0));
+}
+
+void
+AddCachedImage(const char *name, Image *image)
+{
+	cache_add(cache_get(), name, 0, 0, image_hash(name, 0, 0), image);
+}
+
 
-		if((image = LookInNameList(*list, fullname)) == NULL) {
-			int startn = (name [0] == '@') ? 1 : 4;
-			if((image = GetXpmImage(name + startn, cp)) != NULL) {
-				AddToList(list, fullname, image);
+/*
+ * Get the current screen's cache, setting it up if need be.
+ */
+static ImageCache *
+cache_get(void)
+{
+	ImageCache *ic;
+
+	if(Scr->ImageCache != NULL) {
+		return Scr->ImageCache;
+	}
+
+	ic = calloc(1, sizeof(ImageCache));
+	if(ic == NULL) {
+		fprintf(stderr, "%s(): out of memory\n", __func__);
+		Done(0);
+	}
+	ic->scr = Scr;
+	Scr->ImageCache = ic;
+	cache_resize(ic);
+	return ic;
+}
+
+
+/*
+ * Look something up, and take a reference to it if it's there.
+ */
+static Image *
+cache_find(ImageCache *ic, const char *name, Pixel fore, Pixel back,
+           unsigned int hash)
+{
+	ImageCacheEnt *ent;
+
+	for(ent = ic->buckets[hash & (ic->nbuckets - 1)] ; ent != NULL ;
+	                ent = ent->hnext) {
+		if(ent->hash == hash && ent->fore == fore && ent->back == back
+		                && strcmp(ent->name, name) == 0) {
+			if(ent->refs++ == 0) {
+				lru_unlink(ic, ent);
 			}
+			return ent->image;
+		}
+	}
+	return NULL;
+}
+
+
+/*
+ * Stash a new image, with one reference for the caller.
+ */
+static void
+cache_add(ImageCache *ic, const char *name, Pixel fore, Pixel back,
+          unsigned int hash, Image *image)
+{
+	ImageCacheEnt *ent;
+
+	ent = calloc(1, sizeof(ImageCacheEnt));
+	if(ent == NULL || (ent->name = strdup(name)) == NULL) {
+		/* Just don't cache it, then */
+		free(ent);
+		return;
+	}
+	ent->fore  = fore;
+	ent->back  = back;
+	ent->hash  = hash;
+	ent->refs  = 1;
+	ent->bytes = image_bytes(image);
+	ent->image = image;
+	ent->cache = ic;
+
+	/* Animations are a loop of Image's, any of which may be handed back */
+	for(Image *im = image ; im != NULL ; im = im->next) {
+		im->cached = ent;
+		if(im->next == image) {
+			break;
+		}
+	}
+
+	if(ic->count + 1 > ic->nbuckets) {
+		cache_resize(ic);
+	}
+	ent->hnext = ic->buckets[hash & (ic->nbuckets - 1)];
+	ic->buckets[hash & (ic->nbuckets - 1)] = ent;
+	ic->count++;
+	ic->bytes += ent->bytes;
+
+	cache_trim(ic);
+}
+
+
+/*
+ * Give back an Image gotten from GetImage().  Images not from there are
+ * left alone.
+ */
+void
+ReleaseImage(Image *image)
+{
+	ImageCacheEnt *ent;
+	ImageCache *ic;
+
+	if(image == NULL || image->cached == NULL) {
+		return;
+	}
+	ent = image->cached;
+	ic = ent->cache;
+
+	if(ent->refs <= 0) {
+		fprintf(stderr, "%s(): image '%s' released too many times\n",
+		        __func__, ent->name);
+		return;
+	}
+	if(--ent->refs > 0) {
+		return;
+	}
+
+	/* Nobody's using it now; it goes on the front of the LRU */
+	ent->lprev = NULL;
+	ent->lnext = ic->lru_head;
+	if(ic->lru_head) {
+		ic->lru_head->lprev = ent;
+	}
+	else {
+		ic->lru_tail = ent;
+	}
+	ic->lru_head = ent;
+
+	cache_trim(ic);
+}
+
+
+/*
+ * Throw out unused images until we're within our budget.
+ */
+static void
+cache_trim(ImageCache *ic)
+{
+	const size_t budget = (size_t)ic->scr->ImageCacheSize * 1024;
+
+	while(ic->bytes > budget && ic->lru_tail != NULL) {
+		ImageCacheEnt *ent = ic->lru_tail;
+		ImageCacheEnt **prev;
+
+		lru_unlink(ic, ent);
+		for(prev = &ic->buckets[ent->hash & (ic->nbuckets - 1)] ;
+		                *prev != ent ; prev = &(*prev)->hnext) {
+			/* nada */;
+		}
+		*prev = ent->hnext;
+		ic->count--;
+		ic->bytes -= ent->bytes;
+
+		FreeImage(ent->image);
+		free(ent->name);
+		free(ent);
+	}
+}
+
+
+static void
+lru_unlink(ImageCache *ic, ImageCacheEnt *ent)
+{
+	if(ent->lprev) {
+		ent->lprev->lnext = ent->lnext;
+	}
+	else {
+		ic->lru_head = ent->lnext;
+	}
+	if(ent->lnext) {
+		ent->lnext->lprev = ent->lprev;
+	}
+	else {
+		ic->lru_tail = ent->lprev;
+	}
+	ent->lprev = ent->lnext = NULL;
+}
+
+
+/*
+ * Grow the hash table (or set it up the first time).
+ */
+static void
+cache_resize(ImageCache *ic)
+{
+	unsigned int nsize = ic->nbuckets ? ic->nbuckets * 2 : 64;
+	ImageCacheEnt **nb;
+
+	nb = calloc(nsize, sizeof(ImageCacheEnt *));
+	if(nb == NULL) {
+		if(ic->buckets != NULL) {
+			/* Just live with longer chains */
+			return;
+		}
+		fprintf(stderr, "%s(): out of memory\n", __func__);
+		Done(0);
+	}
+
+	for(unsigned int i = 0 ; i < ic->nbuckets ; i++) {
+		ImageCacheEnt *ent, *next;
+		for(ent = ic->buckets[i] ; ent != NULL ; ent = next) {
+			next = ent->hnext;
+			ent->hnext = nb[ent->hash & (nsize - 1)];
+			nb[ent->hash & (nsize - 1)] = ent;
+		}
+	}
+	free(ic->buckets);
+	ic->buckets = nb;
+	ic->nbuckets = nsize;
+}
+
+
+/*
+ * FNV-1a over the name, with the colors mixed in.
+ */
+static unsigned int
+image_hash(const char *name, Pixel fore, Pixel back)
+{
+	unsigned int h = 2166136261U;
+
+	for(const unsigned char *p = (const unsigned char *)name ; *p ; p++) {
+		h = (h ^ *p) * 16777619U;
+	}
+	h = (h ^ (unsigned int)fore) * 16777619U;
+	h = (h ^ (unsigned int)back) * 16777619U;
+	return h;
+}
+
+
+/*
+ * About how much server memory an Image (and any further frames of an
+ * animation) takes up.  Pixmaps are stored padded out to 8/16/32 bits
+ * per pixel; masks are 1 bit.
+ */
+static size_t
+image_bytes(const Image *image)
+{
+	const int depth = Scr->d_depth;
+	const size_t bpp = depth > 16 ? 4 : (depth > 8 ? 2 : 1);
+	size_t bytes = 0;
+
+	for(const Image *im = image ; im != NULL ; im = im->next) {
+		const size_t npix = (size_t)im->width * im->height;
+
+		if(im->pixmap) {
+			bytes += npix * bpp;
+		}
+		if(im->mask) {
+			bytes += (npix + 7) / 8;
 		}
+		if(im->next == image) {
+			break;
+		}
+	}
+	return bytes;
+}
+
+
+/*
+ * Actually load up an image; GetImage() has already checked the cache.
+ */
+static Image *
+LoadImage(const char *name, ColorPair cp)
+{
+	Image *image = NULL;
+
+	if((name [0] == '@') || (strncmp(name, "xpm:", 4) == 0)) {
+#ifdef XPM
+		int startn = (name [0] == '@') ? 1 : 4;
+		image = GetXpmImage(name + startn, cp);
 #else
 		fprintf(stderr, "XPM support disabled, ignoring image %s\n", name);
-		return NULL;
 #endif
 	}
 	else if(strncmp(name, "jpeg:", 5) == 0) {
 #ifdef JPEG
-		if((image = LookInNameList(*list, name)) == NULL) {
-			if((image = GetJpegImage(&name [5])) != NULL) {
-				AddToList(list, name, image);
-			}
-		}
+		image = GetJpegImage(&name [5]);
 #else
 		fprintf(stderr, "JPEG support disabled, ignoring image %s\n", name);
-		return NULL;
 #endif
 	}
 	else if((strncmp(name, "xwd:", 4) == 0) || (name [0] == '|')) {
 		int startn = (name [0] == '|') ? 0 : 4;
-		if((image = LookInNameList(*list, name)) == NULL) {
-			if((image = GetXwdImage(&name [startn], cp)) != NULL) {
-				AddToList(list, name, image);
-			}
-		}
+		image = GetXwdImage(&name [startn], cp);
 	}
 	else if(strncmp(name, ":xpm:", 5) == 0) {
-		snprintf(fullname, GIFNLEN, "%s%dx%d", name, (int) cp.fore, (int) cp.back);
-		if((image = LookInNameList(*list, fullname)) == NULL) {
-			image = get_builtin_scalable_pixmap(name, cp);
-			if(image == NULL) {
-				/* g_b_s_p() already warned */
-				return NULL;
-			}
-			AddToList(list, fullname, image);
-		}
+		/* If NULL, g_b_s_p() already warned */
+		image = get_builtin_scalable_pixmap(name, cp);
 	}
 	else if(strncmp(name, "%xpm:", 5) == 0) {
-		snprintf(fullname, GIFNLEN, "%s%dx%d", name, (int) cp.fore, (int) cp.back);
-		if((image = LookInNameList(*list, fullname)) == NULL) {
-			image = get_builtin_animated_pixmap(name, cp);
-			if(image == NULL) {
-				/* g_b_a_p() already warned */
-				return NULL;
-			}
-			AddToList(list, fullname, image);
-		}
+		/* If NULL, g_b_a_p() already warned */
+		image = get_builtin_animated_pixmap(name, cp);
 	}
 	else if(name [0] == ':') {
 		unsigned int    width, height;
 		Pixmap          pm = 0;
 		XGCValues       gcvalues;
 
-		snprintf(fullname, GIFNLEN, "%s%dx%d", name, (int) cp.fore, (int) cp.back);
-		if((image = LookInNameList(*list, fullname)) == NULL) {
-			pm = get_builtin_plain_pixmap(name, &width, &height);
-			if(pm == None) {
-				/* g_b_p_p() already warned */
-				return NULL;
-			}
-			image = AllocImage();
-			image->pixmap = XCreatePixmap(dpy, Scr->Root, width, height, Scr->d_depth);
-			if(Scr->rootGC == (GC) 0) {
-				Scr->rootGC = XCreateGC(dpy, Scr->Root, 0, &gcvalues);
-			}
-			gcvalues.background = cp.back;
-			gcvalues.foreground = cp.fore;
-			XChangeGC(dpy, Scr->rootGC, GCForeground | GCBackground, &gcvalues);
-			XCopyPlane(dpy, pm, image->pixmap, Scr->rootGC, 0, 0, width, height, 0, 0,
-			           (unsigned long) 1);
-			image->width  = width;
-			image->height = height;
-			AddToList(list, fullname, image);
+		pm = get_builtin_plain_pixmap(name, &width, &height);
+		if(pm == None) {
+			/* g_b_p_p() already warned */
+			return NULL;
 		}
+		image = AllocImage();
+		image->pixmap = XCreatePixmap(dpy, Scr->Root, width, height, Scr->d_depth);
+		if(Scr->rootGC == (GC) 0) {
+			Scr->rootGC = XCreateGC(dpy, Scr->Root, 0, &gcvalues);
+		}
+		gcvalues.background = cp.back;
+		gcvalues.foreground = cp.fore;
+		XChangeGC(dpy, Scr->rootGC, GCForeground | GCBackground, &gcvalues);
+		XCopyPlane(dpy, pm, image->pixmap, Scr->rootGC, 0, 0, width, height, 0, 0,
+		           (unsigned long) 1);
+		image->width  = width;
+		image->height = height;
 	}
 	else {
-		snprintf(fullname, GIFNLEN, "%s%dx%d", name, (int) cp.fore, (int) cp.back);
-		if((image = LookInNameList(*list, fullname)) == NULL) {
-			if((image = GetBitmapImage(name, cp)) != NULL) {
-				AddToList(list, fullname, image);
-			}
-		}
+		image = GetBitmapImage(name, cp);
 	}
+
 	return image;
-#undef GIFNLEN
 }
 
 
@@ -12,10 +12,14 @@ struct Image {
 	int    width;
 	int    height;
 	Image *next;
+	struct ImageCacheEnt *cached;  // Cache entry, if from GetImage()
 };
 
 
 Image *GetImage(const char *name, ColorPair cp);
+void ReleaseImage(Image *image);
+Image *GetCachedImage(const char *name);
+void AddCachedImage(const char *name, Image *image);
 Image *AllocImage(void);
 void FreeImage(Image *image);
 
@@ -0,0 +1,290 @@
+/*
+ * Converting RGB data into the screen's pixel format
+ *
+ * Both _NET_WM_ICON's (ARGB) and JPEG's (packed RGB) come to us as
+ * 8-bit-per-channel data that has to be turned into the screen's pixel
+ * format to XPutImage() it.  These do that a whole row at a time, using
+ * the channel layout from the Visual's masks rather than assuming a
+ * particular one.  The ARGB conversion builds up the 1-bit shape mask
+ * for the row at the same time.
+ *
+ * The overwhelmingly common case is 32bpp with the channels at 16/8/0;
+ * when we're built for a CPU with SSE2 we do that 8 pixels at a time
+ * for ARGB input.  Everything else goes through the plain loop.
+ */
+
+#include "ctwm.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "image_convert.h"
+#include "screen.h"
+
+
+static void mask_layout(unsigned long mask, int *shift, int *bits);
+#ifdef __SSE2__
+static int argb_to_xrgb_sse2(const unsigned long *src, int n, uint32_t *dst,
+                             unsigned char *mask, bool *transparent);
+#endif
+
+
+/*
+ * Figure out how pixels are laid out on a screen.  Returns false if
+ * it's something we can't handle.
+ */
+bool
+GetPixelLayout(ScreenInfo *scr, PixelLayout *pl)
+{
+	XPixmapFormatValues *fmts;
+	unsigned long rm, gm, bm;
+	int nfmts;
+
+	pl->bpp = 0;
+	fmts = XListPixmapFormats(dpy, &nfmts);
+	for(int i = 0 ; fmts && i < nfmts ; i++) {
+		if(fmts[i].depth == scr->d_depth) {
+			pl->bpp = fmts[i].bits_per_pixel;
+			break;
+		}
+	}
+	if(fmts) {
+		XFree(fmts);
+	}
+	if(pl->bpp != 16 && pl->bpp != 32) {
+		return false;
+	}
+
+	rm = scr->d_visual->red_mask;
+	gm = scr->d_visual->green_mask;
+	bm = scr->d_visual->blue_mask;
+	if(rm == 0 || gm == 0 || bm == 0) {
+		/* Not a TrueColor-ish visual; guess like we always used to */
+		if(pl->bpp == 16) {
+			rm = 0xf800;
+			gm = 0x07e0;
+			bm = 0x001f;
+		}
+		else {
+			rm = 0xff0000;
+			gm = 0x00ff00;
+			bm = 0x0000ff;
+		}
+	}
+	mask_layout(rm, &pl->rshift, &pl->rbits);
+	mask_layout(gm, &pl->gshift, &pl->gbits);
+	mask_layout(bm, &pl->bshift, &pl->bbits);
+
+	pl->xrgb = (pl->bpp == 32
+	            && pl->rshift == 16 && pl->rbits == 8
+	            && pl->gshift == 8  && pl->gbits == 8
+	            && pl->bshift == 0  && pl->bbits == 8);
+	return true;
+}
+
+
+static void
+mask_layout(unsigned long mask, int *shift, int *bits)
+{
+	*shift = *bits = 0;
+	while(mask && !(mask & 1)) {
+		mask >>= 1;
+		(*shift)++;
+	}
+	while(mask & 1) {
+		mask >>= 1;
+		(*bits)++;
+	}
+}
+
+
+/*
+ * Make an XImage to convert into.  We fill it in host byte order, and
+ * let Xlib swap it if the server wants something else.  The data gets
+ * freed along with the XImage by XDestroyImage().
+ */
+XImage *
+CreateConvertImage(ScreenInfo *scr, const PixelLayout *pl,
+                   int width, int height)
+{
+	const uint16_t one = 1;
+	const int bpl = width * (pl->bpp / 8);
+	XImage *ximage;
+	char *data;
+
+	data = malloc((size_t)bpl * height);
+	if(data == NULL) {
+		return NULL;
+	}
+	ximage = XCreateImage(dpy, scr->d_visual, scr->d_depth, ZPixmap, 0,
+	                      data, width, height, pl->bpp, bpl);
+	if(ximage == NULL) {
+		free(data);
+		return NULL;
+	}
+	ximage->byte_order = *(const unsigned char *)&one ? LSBFirst : MSBFirst;
+	return ximage;
+}
+
+
+/*
+ * Scale an 8-bit channel value to its width in the pixel, and put it in
+ * place.
+ */
+static inline unsigned long
+chan(unsigned int c, int bits, int shift)
+{
+	if(bits <= 8) {
+		return (unsigned long)(c >> (8 - bits)) << shift;
+	}
+	return (unsigned long)((c << (bits - 8)) | (c >> (16 - bits))) << shift;
+}
+
+static inline unsigned long
+pack(const PixelLayout *pl, unsigned int r, unsigned int g, unsigned int b)
+{
+	return chan(r, pl->rbits, pl->rshift)
+	       | chan(g, pl->gbits, pl->gshift)
+	       | chan(b, pl->bbits, pl->bshift);
+}
+
+
+/*
+ * Convert a row of n ARGB pixels (as found in _NET_WM_ICON) into dst.
+ * If mask isn't NULL, the (n+7)/8 bytes there get the LSB-first bitmap
+ * of which pixels are opaque enough to show.  Returns whether any
+ * weren't.
+ */
+bool
+ConvertARGBRow(const PixelLayout *pl, const unsigned long *src, int n,
+               char *dst, unsigned char *mask)
+{
+	bool transparent = false;
+	unsigned int mbits = 0;
+	int x = 0;
+
+#ifdef __SSE2__
+	if(pl->xrgb) {
+		x = argb_to_xrgb_sse2(src, n, (uint32_t *)dst, mask, &transparent);
+	}
+#endif
+
+	for( ; x < n ; x++) {
+		const unsigned long argb = src[x];
+		const unsigned long pix = pack(pl, (argb >> 16) & 0xFF,
+		                               (argb >> 8) & 0xFF, argb & 0xFF);
+
+		if(pl->bpp == 16) {
+			((uint16_t *)dst)[x] = pix;
+		}
+		else {
+			((uint32_t *)dst)[x] = pix;
+		}
+
+		/* Arbitrary cutoff */
+		if(((argb >> 24) & 0xFF) >= 0x80) {
+			mbits |= 1 << (x & 7);
+		}
+		else {
+			transparent = true;
+		}
+		if((x & 7) == 7 || x == n - 1) {
+			if(mask) {
+				mask[x >> 3] = mbits;
+			}
+			mbits = 0;
+		}
+	}
+
+	return transparent;
+}
+
+
+#ifdef __SSE2__
+/*
+ * The common case, 8 pixels at a time so each gives a byte of mask.
+ * Returns how many pixels it did; the caller finishes up the rest.
+ */
+static int
+argb_to_xrgb_sse2(const unsigned long *src, int n, uint32_t *dst,
+                  unsigned char *mask, bool *transparent)
+{
+	const __m128i rgbmask = _mm_set1_epi32(0x00FFFFFF);
+	const __m128i cutoff  = _mm_set1_epi32(0x7F);
+	int x;
+
+	for(x = 0 ; x + 8 <= n ; x += 8) {
+		__m128i p[2];
+		int bits = 0;
+
+		/* Get 8 pixels as 32-bit values, however big a long is */
+		if(sizeof(long) == 8) {
+			for(int i = 0 ; i < 2 ; i++) {
+				const __m128i *s = (const __m128i *)(src + x + i * 4);
+				__m128i a = _mm_loadu_si128(s);
+				__m128i b = _mm_loadu_si128(s + 1);
+				a = _mm_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 2, 0));
+				b = _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 1, 2, 0));
+				p[i] = _mm_unpacklo_epi64(a, b);
+			}
+		}
+		else {
+			p[0] = _mm_loadu_si128((const __m128i *)(src + x));
+			p[1] = _mm_loadu_si128((const __m128i *)(src + x + 4));
+		}
+
+		for(int i = 0 ; i < 2 ; i++) {
+			const __m128i opaque = _mm_cmpgt_epi32(_mm_srli_epi32(p[i], 24),
+			                                       cutoff);
+			_mm_storeu_si128((__m128i *)(dst + x + i * 4),
+			                 _mm_and_si128(p[i], rgbmask));
+			bits |= _mm_movemask_ps(_mm_castsi128_ps(opaque)) << (i * 4);
+		}
+
+		if(mask) {
+			mask[x >> 3] = bits;
+		}
+		if(bits != 0xFF) {
+			*transparent = true;
+		}
+	}
+
+	return x;
+}
+#endif
+
+
+/*
+ * Convert a row of n pixels of 8-bit RGB (as from libjpeg) into dst.
+ * ncomp is the number of bytes per pixel in src; 1 means greyscale.
+ */
+void
+ConvertRGBRow(const PixelLayout *pl, const unsigned char *src, int ncomp,
+              int n, char *dst)
+{
+	if(pl->xrgb && ncomp >= 3) {
+		uint32_t *d = (uint32_t *)dst;
+		for(int x = 0 ; x < n ; x++, src += ncomp) {
+			d[x] = ((uint32_t)src[0] << 16) | ((uint32_t)src[1] << 8) | src[2];
+		}
+		return;
+	}
+
+	for(int x = 0 ; x < n ; x++, src += ncomp) {
+		const unsigned int r = src[0];
+		const unsigned int g = (ncomp >= 3) ? src[1] : r;
+		const unsigned int b = (ncomp >= 3) ? src[2] : r;
+		const unsigned long pix = pack(pl, r, g, b);
+
+		if(pl->bpp == 16) {
+			((uint16_t *)dst)[x] = pix;
+		}
+		else {
+			((uint32_t *)dst)[x] = pix;
+		}
+	}
+}
@@ -0,0 +1,25 @@
+/*
+ * Converting RGB data into the screen's pixel format
+ */
+#ifndef _CTWM_IMAGE_CONVERT_H
+#define _CTWM_IMAGE_CONVERT_H
+
+#include <stdbool.h>
+
+typedef struct PixelLayout {
+	int  bpp;                     // Bits per pixel in a ZPixmap; 16 or 32
+	int  rshift, gshift, bshift;  // Bit position of each channel
+	int  rbits, gbits, bbits;     // Width of each channel
+	bool xrgb;                    // 32bpp with R/G/B at 16/8/0
+} PixelLayout;
+
+bool GetPixelLayout(ScreenInfo *scr, PixelLayout *pl);
+XImage *CreateConvertImage(ScreenInfo *scr, const PixelLayout *pl,
+                           int width, int height);
+
+bool ConvertARGBRow(const PixelLayout *pl, const unsigned long *src, int n,
+                    char *dst, unsigned char *mask);
+void ConvertRGBRow(const PixelLayout *pl, const unsigned char *src,
+                   int ncomp, int n, char *dst);
+
+#endif /* _CTWM_IMAGE_CONVERT_H */
@@ -7,10 +7,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <stdint.h>
 
 #include "screen.h"
 #include "image.h"
+#include "image_convert.h"
 #include "image_jpeg.h"
 
 /* Bits needed for libjpeg and interaction */
@@ -24,8 +24,6 @@
 /* Various internal bits */
 static Image *LoadJpegImage(const char *name);
 static Image *LoadJpegImageCp(const char *name, ColorPair cp);
-static void convert_for_16(int w, int x, int y, int r, int g, int b);
-static void convert_for_32(int w, int x, int y, int r, int g, int b);
 static void jpeg_error_exit(j_common_ptr cinfo);
 
 struct jpeg_error {
@@ -35,9 +33,6 @@ struct jpeg_error {
 
 typedef struct jpeg_error *jerr_ptr;
 
-static uint16_t *buffer_16bpp;
-static uint32_t *buffer_32bpp;
-
 
 /*
  * External entry point
@@ -77,14 +72,12 @@ LoadJpegImage(const char *name)
 	FILE   *infile;
 	Image  *image;
 	Pixmap pixret;
-	void (*store_data)(int w, int x, int y, int r, int g, int b);
+	PixelLayout pl;
 	struct jpeg_decompress_struct cinfo;
 	struct jpeg_error jerr;
 	JSAMPARRAY buffer;
 	int width, height;
 	int row_stride;
-	int g, i, a;
-	int bpix;
 	GC  gc;
 
 	fullname = ExpandPixmapPath(name);
@@ -126,44 +119,31 @@ LoadJpegImage(const char *name)
 	width  = cinfo.output_width;
 	height = cinfo.output_height;
 
-	if(Scr->d_depth == 16) {
-		store_data = &convert_for_16;
-		buffer_16bpp = malloc((width) * (height) * 2);
-		ximage = XCreateImage(dpy, CopyFromParent, Scr->d_depth, ZPixmap, 0,
-		                      (char *) buffer_16bpp, width, height, 16, width * 2);
-	}
-	else if(Scr->d_depth == 24 || Scr->d_depth == 32) {
-		store_data = &convert_for_32;
-		buffer_32bpp = malloc(width * height * 4);
-		ximage = XCreateImage(dpy, CopyFromParent, Scr->d_depth, ZPixmap, 0,
-		                      (char *) buffer_32bpp, width, height, 32, width * 4);
-	}
-	else {
+	if(!GetPixelLayout(Scr, &pl)) {
 		fprintf(stderr, "Image %s unsupported depth : %d\n", name, Scr->d_depth);
+		jpeg_destroy_decompress(&cinfo);
 		free(image);
 		fclose(infile);
 		return NULL;
 	}
+	ximage = CreateConvertImage(Scr, &pl, width, height);
 	if(ximage == NULL) {
 		fprintf(stderr, "cannot create image for %s\n", name);
+		jpeg_destroy_decompress(&cinfo);
 		free(image);
 		fclose(infile);
 		return NULL;
 	}
-	g = 0;
 	row_stride = cinfo.output_width * cinfo.output_components;
 	buffer = (*cinfo.mem->alloc_sarray)
 	         ((j_common_ptr) & cinfo, JPOOL_IMAGE, row_stride, 1);
 
-	bpix = cinfo.output_components;
 	while(cinfo.output_scanline < cinfo.output_height) {
+		const int y = cinfo.output_scanline;
+
 		jpeg_read_scanlines(&cinfo, buffer, 1);
-		a = 0;
-		for(i = 0; i < bpix * cinfo.output_width; i += bpix) {
-			(*store_data)(width, a, g, buffer[0][i],  buffer[0][i + 1], buffer[0][i + 2]);
-			a++;
-		}
-		g++;
+		ConvertRGBRow(&pl, buffer[0], cinfo.output_components, width,
+		              ximage->data + y * ximage->bytes_per_line);
 	}
 	jpeg_finish_decompress(&cinfo);
 	jpeg_destroy_decompress(&cinfo);
@@ -200,18 +180,6 @@ LoadJpegImage(const char *name)
 /*
  * Utils
  */
-static void
-convert_for_16(int w, int x, int y, int r, int g, int b)
-{
-	buffer_16bpp [y * w + x] = ((r >> 3) << 11) + ((g >> 2) << 5) + (b >> 3);
-}
-
-static void
-convert_for_32(int w, int x, int y, int r, int g, int b)
-{
-	buffer_32bpp [y * w + x] = ((r << 16) + (g << 8) + b) & 0xFFFFFFFF;
-}
-
 static void
 jpeg_error_exit(j_common_ptr cinfo)
 {
@@ -0,0 +1,110 @@
+/*
+ * Resampling ARGB image data
+ *
+ * Apps tend to provide big _NET_WM_ICON's (128x128, 256x256, and up)
+ * for the benefit of docks and the like; we want them at our
+ * PreferredIconWidth/Height.  This is a box filter: each destination
+ * pixel is the average of the source area it covers, counting partial
+ * pixels at the edges by how much of them is covered.  That's the right
+ * thing for shrinking, which is all we use it for; blowing things up
+ * with it just gives you nearest-neighbor.
+ *
+ * Color channels are averaged weighted by alpha, so transparent pixels
+ * (whose colors are usually junk, often black) don't bleed dark fringes
+ * into the edges of the result.
+ */
+
+#include "ctwm.h"
+
+#include <stdlib.h>
+
+#include "image_scale.h"
+
+
+/* Accumulated alpha, and alpha-weighted colors */
+typedef struct Accum {
+	float a, r, g, b;
+} Accum;
+
+
+/*
+ * Scale sw x sh pixels of ARGB in src into dw x dh in dst.  Returns
+ * false (leaving dst untouched) if we couldn't get the memory to do it.
+ */
+bool
+ScaleARGB(const unsigned long *src, int sw, int sh,
+          unsigned long *dst, int dw, int dh)
+{
+	const double xscale = (double)sw / dw;
+	const double yscale = (double)sh / dh;
+	Accum *rows;
+
+	/*
+	 * Do it in two passes: across each source row into rows[], then
+	 * down the columns of that into dst.
+	 */
+	rows = calloc((size_t)dw * sh, sizeof(Accum));
+	if(rows == NULL) {
+		return false;
+	}
+
+	for(int dx = 0 ; dx < dw ; dx++) {
+		const double x0 = dx * xscale;
+		const double x1 = (dx + 1) * xscale;
+
+		for(int sx = (int)x0 ; sx < sw && sx < x1 ; sx++) {
+			const double l = (sx > x0) ? sx : x0;
+			const double r = (sx + 1 < x1) ? sx + 1 : x1;
+			const float w = (float)(r - l);
+
+			for(int y = 0 ; y < sh ; y++) {
+				const unsigned long argb = src[y * sw + sx];
+				const float a = w * ((argb >> 24) & 0xFF);
+				Accum *acc = &rows[y * dw + dx];
+
+				acc->a += a;
+				acc->r += a * ((argb >> 16) & 0xFF);
+				acc->g += a * ((argb >>  8) & 0xFF);
+				acc->b += a * (argb & 0xFF);
+			}
+		}
+	}
+
+	for(int dy = 0 ; dy < dh ; dy++) {
+		const double y0 = dy * yscale;
+		const double y1 = (dy + 1) * yscale;
+
+		for(int dx = 0 ; dx < dw ; dx++) {
+			Accum sum = { 0, 0, 0, 0 };
+			float wsum = 0;
+			unsigned long a = 0, r = 0, g = 0, b = 0;
+
+			for(int sy = (int)y0 ; sy < sh && sy < y1 ; sy++) {
+				const double t = (sy > y0) ? sy : y0;
+				const double u = (sy + 1 < y1) ? sy + 1 : y1;
+				const float w = (float)(u - t);
+				const Accum *acc = &rows[sy * dw + dx];
+
+				sum.a += w * acc->a;
+				sum.r += w * acc->r;
+				sum.g += w * acc->g;
+				sum.b += w * acc->b;
+				wsum  += w;
+			}
+
+			if(sum.a > 0) {
+				a = (unsigned long)(sum.a / (wsum * xscale) + 0.5f);
+				r = (unsigned long)(sum.r / sum.a + 0.5f);
+				g = (unsigned long)(sum.g / sum.a + 0.5f);
+				b = (unsigned long)(sum.b / sum.a + 0.5f);
+				if(a > 0xFF) {
+					a = 0xFF;
+				}
+			}
+			dst[dy * dw + dx] = (a << 24) | (r << 16) | (g << 8) | b;
+		}
+	}
+
+	free(rows);
+	return true;
+}
@@ -0,0 +1,10 @@
+/*
+ * Resampling ARGB image data
+ */
+#ifndef _CTWM_IMAGE_SCALE_H
+#define _CTWM_IMAGE_SCALE_H
+
+bool ScaleARGB(const unsigned long *src, int sw, int sh,
+                unsigned long *dst, int dw, int dh);
+
+#endif /* _CTWM_IMAGE_SCALE_H */
@@ -0,0 +1,301 @@
+/*
+ * Running external programs
+ *
+ * f.exec used to system() its command, which meant forking all of ctwm
+ * and then sitting there until the shell exited; anything that didn't
+ * background itself froze the window manager until it was done.  Now
+ * they're started with posix_spawn() and left to run, and we pick them
+ * up when they exit: the SIGCHLD handler flags it for the main loop
+ * (x-ref CtwmNextEvent()), which calls ReapLaunched().
+ *
+ * Commands that don't need a shell (just words separated by spaces,
+ * nothing for sh to expand or interpret) get run directly, skipping
+ * starting a shell just to have it start the program.  If there's no
+ * such program, it may be a shell builtin or keyword (like "exec xterm"
+ * or "umask 077; ..."), so those go to sh after all.
+ *
+ * Programs are pointed at the screen they were started from, via
+ * $DISPLAY.  That's worked out once per screen, and put into a copy of
+ * the environment for the child, rather than changing ours around each
+ * one.
+ */
+
+#include "ctwm.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "event_sources.h"
+#include "launch.h"
+#include "screen.h"
+
+#ifndef _GNU_SOURCE
+/* unistd.h declares it for us with glibc */
+extern char **environ;
+#endif
+
+volatile sig_atomic_t ChildExitFlag = 0;
+
+/* What we've started and not yet reaped */
+static pid_t *children = NULL;
+static int nchildren = 0;
+static int maxchildren = 0;
+
+/* "DISPLAY=..." for each screen; "" if we leave it alone */
+static char **display_envs = NULL;
+
+/* Anything in here means it's a job for sh */
+static const char shell_chars[] = "|&;<>()$`\\\"'*?[]{}#~=%!\n";
+
+
+/*
+ * $DISPLAY for programs started from the current screen.  Given that
+ * we're on display "foo.bar:1.2", that's "foo.bar:1.{Scr->screen}", so
+ * X programs come up on the screen they were invoked from, unless
+ * specifically overridden on their command line.
+ */
+static char *
+display_env(void)
+{
+	char *ds, *colon, *dot;
+
+	if(display_envs == NULL) {
+		display_envs = calloc(NumScreens, sizeof(char *));
+		if(display_envs == NULL) {
+			return "";
+		}
+	}
+	if(display_envs[Scr->screen] != NULL) {
+		return display_envs[Scr->screen];
+	}
+
+	/* If it's not host:dpy, we don't have anything to do here */
+	ds = DisplayString(dpy);
+	colon = ds ? strrchr(ds, ':') : NULL;
+	if(colon == NULL) {
+		return display_envs[Scr->screen] = "";
+	}
+
+	/* Chop the .screen off display.screen, and put ours on */
+	dot = strchr(colon, '.');
+	if(asprintf(&display_envs[Scr->screen], "DISPLAY=%.*s.%d",
+	                (int)(dot ? dot - ds : strlen(ds)), ds, Scr->screen) < 0) {
+		display_envs[Scr->screen] = NULL;
+		return "";
+	}
+	return display_envs[Scr->screen];
+}
+
+
+/*
+ * Our environment, with the screen's $DISPLAY in place of ours.  Just
+ * the array is allocated; the strings are environ's.
+ */
+static char **
+child_env(void)
+{
+	char *disp = display_env();
+	char **env;
+	int n = 0;
+
+	for(char **e = environ; *e != NULL; e++) {
+		n++;
+	}
+	env = malloc((n + 2) * sizeof(char *));
+	if(env == NULL) {
+		return NULL;
+	}
+
+	n = 0;
+	for(char **e = environ; *e != NULL; e++) {
+		if(*disp && strncmp(*e, "DISPLAY=", 8) == 0) {
+			continue;
+		}
+		env[n++] = *e;
+	}
+	if(*disp) {
+		env[n++] = disp;
+	}
+	env[n] = NULL;
+	return env;
+}
+
+
+/*
+ * Split a command with no shell_chars in it into words.  Mangles cmd,
+ * which the returned argv points into.
+ */
+static char **
+split_words(char *cmd)
+{
+	char **argv;
+	char *w;
+	int n = 0;
+
+	/* Can't be more words than every other char */
+	argv = malloc((strlen(cmd) / 2 + 2) * sizeof(char *));
+	if(argv == NULL) {
+		return NULL;
+	}
+	for(w = strtok(cmd, " \t"); w != NULL; w = strtok(NULL, " \t")) {
+		argv[n++] = w;
+	}
+	argv[n] = NULL;
+	return argv;
+}
+
+
+/*
+ * If we were started with SIGCHLD ignored, it stays that way (x-ref
+ * newhandler() in ctwm.c), and the kernel cleans up after children
+ * itself; there's nothing for us to wait for.
+ */
+static bool
+sigchld_ignored(void)
+{
+	struct sigaction sa;
+
+	return sigaction(SIGCHLD, NULL, &sa) == 0 && sa.sa_handler == SIG_IGN;
+}
+
+
+/*
+ * Note something we started, to wait for later.
+ */
+static void
+remember_child(pid_t pid)
+{
+	if(nchildren == maxchildren) {
+		const int newmax = maxchildren ? maxchildren * 2 : 8;
+		pid_t *new = realloc(children, newmax * sizeof(pid_t));
+		if(new == NULL) {
+			/* It'll just hang around as a zombie */
+			fprintf(stderr, "%s: Out of memory\n", __func__);
+			return;
+		}
+		children = new;
+		maxchildren = newmax;
+	}
+	children[nchildren++] = pid;
+}
+
+
+/*
+ * Start running cmd, the way sh would, and don't wait for it.
+ */
+void
+LaunchCommand(const char *cmd)
+{
+	char *shargv[] = { "sh", "-c", NULL, NULL };
+	char *words;
+	char **argv, **env;
+	posix_spawnattr_t attr;
+	sigset_t sigs;
+	pid_t pid;
+	int ret;
+
+	words = strdup(cmd);
+	if(words == NULL) {
+		return;
+	}
+	if(strpbrk(cmd, shell_chars) == NULL) {
+		argv = split_words(words);
+		if(argv == NULL || argv[0] == NULL) {
+			/* Out of memory, or nothing but whitespace */
+			free(argv);
+			free(words);
+			return;
+		}
+	}
+	else {
+		shargv[2] = words;
+		argv = shargv;
+	}
+
+	env = child_env();
+	if(env == NULL) {
+		env = environ;
+	}
+
+	/*
+	 * It shouldn't inherit anything we've blocked, or our ignoring
+	 * SIGALRM.  Handled signals go back to default on exec anyway.
+	 */
+	posix_spawnattr_init(&attr);
+	sigemptyset(&sigs);
+	posix_spawnattr_setsigmask(&attr, &sigs);
+	sigaddset(&sigs, SIGALRM);
+	sigaddset(&sigs, SIGCHLD);
+	posix_spawnattr_setsigdefault(&attr, &sigs);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK
+	                         | POSIX_SPAWN_SETSIGDEF);
+
+	if(argv != shargv) {
+		ret = posix_spawnp(&pid, argv[0], NULL, &attr, argv, env);
+		if(ret == ENOENT && strchr(argv[0], '/') == NULL) {
+			/* Maybe a builtin; let sh figure it out */
+			free(argv);
+			strcpy(words, cmd);    // split_words() chopped it up
+			shargv[2] = words;
+			argv = shargv;
+		}
+	}
+	if(argv == shargv) {
+		ret = posix_spawn(&pid, "/bin/sh", NULL, &attr, argv, env);
+	}
+	posix_spawnattr_destroy(&attr);
+
+	if(ret != 0) {
+		fprintf(stderr, "%s: can't run \"%s\": %s\n", ProgramName, cmd,
+		        strerror(ret));
+	}
+	else if(!sigchld_ignored()) {
+		remember_child(pid);
+	}
+
+	if(env != environ) {
+		free(env);
+	}
+	if(argv != shargv) {
+		free(argv);
+	}
+	free(words);
+}
+
+
+/*
+ * Clean up after whatever's exited.  We only wait for what we started;
+ * other bits of ctwm that run things (like m4 for the config file) wait
+ * for their own, and we'd be stealing their exit status.
+ */
+void
+ReapLaunched(void)
+{
+	for(int i = 0 ; i < nchildren ; ) {
+		const pid_t ret = waitpid(children[i], NULL, WNOHANG);
+
+		if(ret == children[i] || (ret < 0 && errno == ECHILD)) {
+			children[i] = children[--nchildren];
+		}
+		else {
+			i++;
+		}
+	}
+}
+
+
+/*
+ * SIGCHLD handler.  Just flag it for the main loop.
+ */
+SIGNAL_T
+LaunchChildSignal(int signum)
+{
+	ChildExitFlag = 1;
+	EventWakeup();
+}
@@ -0,0 +1,15 @@
+/*
+ * Running external programs
+ */
+#ifndef _CTWM_LAUNCH_H
+#define _CTWM_LAUNCH_H
+
+#include <signal.h>   // for sig_atomic_t
+
+void LaunchCommand(const char *cmd);
+void ReapLaunched(void);
+SIGNAL_T LaunchChildSignal(int signum);
+
+extern volatile sig_atomic_t ChildExitFlag;
+
+#endif /* _CTWM_LAUNCH_H */
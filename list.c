@@ -26,17 +26,28 @@
 
 #include "ctwm.h"
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "screen.h"
 #include "list.h"
 #include "util.h"
 #include "parse.h"
 
+
+static bool match_entry(const name_list *nptr, const char *string);
+static const name_list *find_entry(name_list *list_head, const char *name,
+                                   XClassHint *class);
+static const name_list *scan_list(name_list *list_head, const char *name,
+                                  XClassHint *class);
+static int matcher_lookup(const ListMatcher *lm, const char *string);
+static ListMatcher *matcher_compile(const name_list *list_head);
+static void matcher_free(ListMatcher *lm);
 #ifdef USE_SYS_REGEX
-# include <regex.h>
-#endif /* USE_SYS_REGEX */
+static bool compile_pattern(regex_t *preg, const char *pattern);
+#endif
 
 
 
@@ -56,6 +67,9 @@
  *      and procedures calling LookInList will check for a non-null
  *      return value as an indication of success.
  *
+ *      With USE_SYS_REGEX, the name is compiled here once, so that
+ *      lookups only have to run regexec().
+ *
  ***********************************************************************
  */
 
@@ -77,6 +91,11 @@ void AddToList(name_list **list_head, const char *name, void *ptr)
 	nptr->next = *list_head;
 	nptr->name = strdup(name);
 	nptr->ptr = (ptr == NULL) ? (char *)1 : ptr;
+	nptr->matcher = NULL;
+	nptr->nomatcher = false;
+#ifdef USE_SYS_REGEX
+	nptr->re_valid = compile_pattern(&nptr->re, nptr->name);
+#endif
 	*list_head = nptr;
 }
 
@@ -99,31 +118,9 @@ void AddToList(name_list **list_head, const char *name, void *ptr)
 
 void *LookInList(name_list *list_head, const char *name, XClassHint *class)
 {
-	name_list *nptr;
-
-	/* look for the name first */
-	for(nptr = list_head; nptr != NULL; nptr = nptr->next) {
-		if(match(nptr->name, name)) {
-			return (nptr->ptr);
-		}
-	}
+	const name_list *nptr = find_entry(list_head, name, class);
 
-	if(class) {
-		/* look for the res_name next */
-		for(nptr = list_head; nptr != NULL; nptr = nptr->next) {
-			if(match(nptr->name, class->res_name)) {
-				return (nptr->ptr);
-			}
-		}
-
-		/* finally look for the res_class */
-		for(nptr = list_head; nptr != NULL; nptr = nptr->next) {
-			if(match(nptr->name, class->res_class)) {
-				return (nptr->ptr);
-			}
-		}
-	}
-	return (NULL);
+	return (nptr ? nptr->ptr : NULL);
 }
 
 void *LookInNameList(name_list *list_head, const char *name)
@@ -144,25 +141,9 @@ bool IsInList(name_list *list_head, TwmWindow *twin)
 void *LookPatternInList(name_list *list_head, const char *name,
                         XClassHint *class)
 {
-	name_list *nptr;
+	const name_list *nptr = find_entry(list_head, name, class);
 
-	for(nptr = list_head; nptr != NULL; nptr = nptr->next)
-		if(match(nptr->name, name)) {
-			return (nptr->name);
-		}
-
-	if(class) {
-		for(nptr = list_head; nptr != NULL; nptr = nptr->next)
-			if(match(nptr->name, class->res_name)) {
-				return (nptr->name);
-			}
-
-		for(nptr = list_head; nptr != NULL; nptr = nptr->next)
-			if(match(nptr->name, class->res_class)) {
-				return (nptr->name);
-			}
-	}
-	return (NULL);
+	return (nptr ? nptr->name : NULL);
 }
 
 void *LookPatternInNameList(name_list *list_head, const char *name)
@@ -194,37 +175,17 @@ bool GetColorFromList(name_list *list_head, char *name,
                       XClassHint *class, Pixel *ptr)
 {
 	bool save;
-	name_list *nptr;
-
-	for(nptr = list_head; nptr != NULL; nptr = nptr->next)
-		if(match(nptr->name, name)) {
-			save = Scr->FirstTime;
-			Scr->FirstTime = true;
-			GetColor(Scr->Monochrome, ptr, nptr->ptr);
-			Scr->FirstTime = save;
-			return true;
-		}
+	const name_list *nptr = find_entry(list_head, name, class);
 
-	if(class) {
-		for(nptr = list_head; nptr != NULL; nptr = nptr->next)
-			if(match(nptr->name, class->res_name)) {
-				save = Scr->FirstTime;
-				Scr->FirstTime = true;
-				GetColor(Scr->Monochrome, ptr, nptr->ptr);
-				Scr->FirstTime = save;
-				return true;
-			}
-
-		for(nptr = list_head; nptr != NULL; nptr = nptr->next)
-			if(match(nptr->name, class->res_class)) {
-				save = Scr->FirstTime;
-				Scr->FirstTime = true;
-				GetColor(Scr->Monochrome, ptr, nptr->ptr);
-				Scr->FirstTime = save;
-				return true;
-			}
+	if(nptr == NULL) {
+		return false;
 	}
-	return false;
+
+	save = Scr->FirstTime;
+	Scr->FirstTime = true;
+	GetColor(Scr->Monochrome, ptr, nptr->ptr);
+	Scr->FirstTime = save;
+	return true;
 }
 
 /***********************************************************************
@@ -240,17 +201,706 @@ void FreeList(name_list **list)
 	name_list *nptr;
 	name_list *tmp;
 
+	/* Anything we remember about it is about to be dangling */
+	if(*list != NULL) {
+		ListLookupsForget();
+	}
+
 	for(nptr = *list; nptr != NULL;) {
 		tmp = nptr->next;
-		free(nptr->name);
-		free(nptr);
+		FreeListEntry(nptr);
 		nptr = tmp;
 	}
 	*list = NULL;
 }
 
+
+/*
+ * Free a single entry, for things managing their own lists.  Its ptr is
+ * the caller's business.
+ */
+void FreeListEntry(name_list *nptr)
+{
+#ifdef USE_SYS_REGEX
+	if(nptr->re_valid) {
+		regfree(&nptr->re);
+	}
+#endif
+	matcher_free(nptr->matcher);
+	free(nptr->name);
+	free(nptr);
+}
+
+
+/*
+ * Compiled lists.
+ *
+ * Most patterns in the config are plain names ("xterm"), or names with
+ * a trailing wildcard; going through them one at a time running each
+ * through the full pattern matcher is a lot of work for that.  So a
+ * list that's long enough gets sorted out the first time it's used:
+ * patterns that are really just a literal name go in a hash table,
+ * ones that just match a prefix go in a trie, and with system regexes
+ * (which match anywhere in the string) plain strings are just looked
+ * for with strstr().  Only what's left needs the real matcher.
+ *
+ * The list still has to give the same answer as going through it in
+ * order, so everything's tracked by its position in the list, and we
+ * want the earliest that matches.  The literal and prefix lookups find
+ * their earliest candidates directly, and the rest only need trying as
+ * long as they'd come before the best so far.
+ *
+ * Lists only grow at the front, so a compiled list stays good for as
+ * long as its head entry is around; it's hung off that, and freed with
+ * it.
+ */
+#define LM_MINLEN 8   // Shorter lists aren't worth it
+
+typedef struct ListTrie {
+	struct ListTrie *kids;     // First child
+	struct ListTrie *sib;      // Next sibling
+	int             idx;       // Earliest prefix ending here, or INT_MAX
+	unsigned char   c;
+} ListTrie;
+
+struct ListMatcher {
+	int             n;
+	const name_list **ents;    // The list, in order
+	char            **lits;    // Literal text of entries that have one
+	int             *exact;    // Hash of exact literals; -1 for empty
+	int             exactslots;
+	ListTrie        *prefixes;
+	int             *substr;   // Entries matching a substring, in order
+	int             nsubstr;
+	int             *other;    // Everything else, in order
+	int             nother;
+};
+
+typedef enum { LM_NEVER, LM_EXACT, LM_PREFIX, LM_SUBSTR, LM_OTHER } LMKind;
+
+
+static unsigned long
+lm_hash(const char *s)
+{
+	unsigned long h = 2166136261UL;
+
+	for(; *s; s++) {
+		h ^= (unsigned char)*s;
+		h *= 16777619UL;
+	}
+	return h;
+}
+
+
+/*
+ * Is this stretch of the pattern just plain characters?
+ */
+static bool
+lm_literal(const char *p, size_t len)
+{
+#ifdef USE_SYS_REGEX
+	static const char specials[] = ".[]()*+?{}|^$\\";
+#else
+	static const char specials[] = "*?[\\";
+#endif
+
+	for(size_t i = 0 ; i < len ; i++) {
+		if(p[i] == '\0' || strchr(specials, p[i]) != NULL) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+/*
+ * Figure out what sort of pattern an entry is, and the literal part of
+ * it if that's all that matters.
+ */
+static LMKind
+lm_classify(const name_list *nptr, char **lit)
+{
+	const char *p = nptr->name;
+	size_t len = strlen(p);
+
+	*lit = NULL;
+
+#ifdef USE_SYS_REGEX
+	if(!nptr->re_valid) {
+		return LM_NEVER;
+	}
+	if(len >= 1 && p[0] == '^') {
+		p++;
+		len--;
+		if(len >= 1 && p[len - 1] == '$' && lm_literal(p, len - 1)) {
+			*lit = strndup(p, len - 1);
+			return *lit ? LM_EXACT : LM_OTHER;
+		}
+		if(len >= 2 && p[len - 2] == '.' && p[len - 1] == '*') {
+			len -= 2;
+		}
+		if(lm_literal(p, len)) {
+			*lit = strndup(p, len);
+			return *lit ? LM_PREFIX : LM_OTHER;
+		}
+		return LM_OTHER;
+	}
+	if(lm_literal(p, len)) {
+		*lit = strndup(p, len);
+		return *lit ? LM_SUBSTR : LM_OTHER;
+	}
+#else
+	if(lm_literal(p, len)) {
+		*lit = strndup(p, len);
+		return *lit ? LM_EXACT : LM_OTHER;
+	}
+	if(len >= 1 && p[len - 1] == '*' && lm_literal(p, len - 1)) {
+		*lit = strndup(p, len - 1);
+		return *lit ? LM_PREFIX : LM_OTHER;
+	}
+#endif
+	return LM_OTHER;
+}
+
+
+static void
+lm_trie_free(ListTrie *t)
+{
+	while(t != NULL) {
+		ListTrie *sib = t->sib;
+		lm_trie_free(t->kids);
+		free(t);
+		t = sib;
+	}
+}
+
+
+/*
+ * Put the prefix for entry idx in the trie.  Entries are added in
+ * order, so the first one to end at a node is the earliest.
+ */
+static bool
+lm_trie_add(ListTrie **root, const char *prefix, int idx)
+{
+	ListTrie *t;
+
+	if(*root == NULL) {
+		*root = calloc(1, sizeof(ListTrie));
+		if(*root == NULL) {
+			return false;
+		}
+		(*root)->idx = INT_MAX;
+	}
+	t = *root;
+
+	for(; *prefix; prefix++) {
+		const unsigned char c = *prefix;
+		ListTrie *k;
+
+		for(k = t->kids; k != NULL && k->c != c; k = k->sib) {
+			/* look */;
+		}
+		if(k == NULL) {
+			k = calloc(1, sizeof(ListTrie));
+			if(k == NULL) {
+				return false;
+			}
+			k->c   = c;
+			k->idx = INT_MAX;
+			k->sib = t->kids;
+			t->kids = k;
+		}
+		t = k;
+	}
+	if(t->idx == INT_MAX) {
+		t->idx = idx;
+	}
+	return true;
+}
+
+
+static ListMatcher *
+matcher_compile(const name_list *list_head)
+{
+	ListMatcher *lm;
+	const name_list *nptr;
+	int n, nexact, i;
+	int *exact;
+
+	for(n = 0, nptr = list_head; nptr != NULL; nptr = nptr->next) {
+		n++;
+	}
+	if(n < LM_MINLEN) {
+		return NULL;
+	}
+
+	lm = calloc(1, sizeof(ListMatcher));
+	if(lm == NULL) {
+		return NULL;
+	}
+	lm->n      = n;
+	lm->ents   = calloc(n, sizeof(name_list *));
+	lm->lits   = calloc(n, sizeof(char *));
+	lm->exact  = calloc(n, sizeof(int));
+	lm->substr = calloc(n, sizeof(int));
+	lm->other  = calloc(n, sizeof(int));
+	if(!lm->ents || !lm->lits || !lm->exact || !lm->substr || !lm->other) {
+		matcher_free(lm);
+		return NULL;
+	}
+
+	nexact = 0;
+	for(i = 0, nptr = list_head; nptr != NULL; i++, nptr = nptr->next) {
+		lm->ents[i] = nptr;
+		switch(lm_classify(nptr, &lm->lits[i])) {
+			case LM_NEVER:
+				break;
+			case LM_EXACT:
+				lm->exact[nexact++] = i;
+				break;
+			case LM_PREFIX:
+				if(!lm_trie_add(&lm->prefixes, lm->lits[i], i)) {
+					matcher_free(lm);
+					return NULL;
+				}
+				break;
+			case LM_SUBSTR:
+				lm->substr[lm->nsubstr++] = i;
+				break;
+			case LM_OTHER:
+				lm->other[lm->nother++] = i;
+				break;
+		}
+	}
+
+	/*
+	 * Exact names go in a hash table, replacing the list of them we
+	 * gathered up above.  They're in order, so if the same name's in
+	 * there twice, the first one in wins.
+	 */
+	for(lm->exactslots = 16; lm->exactslots < 2 * nexact; lm->exactslots <<= 1) {
+		/* nada */;
+	}
+	exact = lm->exact;
+	lm->exact = malloc(lm->exactslots * sizeof(int));
+	if(lm->exact == NULL) {
+		free(exact);
+		matcher_free(lm);
+		return NULL;
+	}
+	for(i = 0 ; i < lm->exactslots ; i++) {
+		lm->exact[i] = -1;
+	}
+	for(i = 0 ; i < nexact ; i++) {
+		const char *lit = lm->lits[exact[i]];
+		int h = lm_hash(lit) & (lm->exactslots - 1);
+
+		while(lm->exact[h] >= 0 && strcmp(lm->lits[lm->exact[h]], lit) != 0) {
+			h = (h + 1) & (lm->exactslots - 1);
+		}
+		if(lm->exact[h] < 0) {
+			lm->exact[h] = exact[i];
+		}
+	}
+	free(exact);
+
+	return lm;
+}
+
+
+/*
+ * Earliest entry in the list that matches string, or -1.
+ */
+static int
+matcher_lookup(const ListMatcher *lm, const char *string)
+{
+	int best = INT_MAX;
+	const ListTrie *t;
+	const char *s;
+
+	if(string == NULL) {
+		return -1;
+	}
+
+	/* Exactly the name */
+	for(int h = lm_hash(string) & (lm->exactslots - 1);
+	                lm->exact[h] >= 0; h = (h + 1) & (lm->exactslots - 1)) {
+		if(strcmp(lm->lits[lm->exact[h]], string) == 0) {
+			best = lm->exact[h];
+			break;
+		}
+	}
+
+	/* Prefixes, following the string down the trie */
+	for(t = lm->prefixes, s = string; t != NULL; s++) {
+		const ListTrie *k;
+
+		if(t->idx < best) {
+			best = t->idx;
+		}
+		if(*s == '\0') {
+			break;
+		}
+		for(k = t->kids; k != NULL && k->c != (unsigned char)*s; k = k->sib) {
+			/* look */;
+		}
+		t = k;
+	}
+
+	/* Anything else, so long as it's earlier */
+	for(int i = 0 ; i < lm->nsubstr && lm->substr[i] < best ; i++) {
+		if(strstr(string, lm->lits[lm->substr[i]]) != NULL) {
+			best = lm->substr[i];
+			break;
+		}
+	}
+	for(int i = 0 ; i < lm->nother && lm->other[i] < best ; i++) {
+		if(match_entry(lm->ents[lm->other[i]], string)) {
+			best = lm->other[i];
+			break;
+		}
+	}
+
+	return (best == INT_MAX ? -1 : best);
+}
+
+
+static void
+matcher_free(ListMatcher *lm)
+{
+	if(lm == NULL) {
+		return;
+	}
+	if(lm->lits != NULL) {
+		for(int i = 0 ; i < lm->n ; i++) {
+			free(lm->lits[i]);
+		}
+	}
+	lm_trie_free(lm->prefixes);
+	free(lm->ents);
+	free(lm->lits);
+	free(lm->exact);
+	free(lm->substr);
+	free(lm->other);
+	free(lm);
+}
+
+
+/*
+ * Cache of lookups.
+ *
+ * Adding a window (or renaming one) looks it up in dozens of lists:
+ * NoTitle, AutoRaise, IconManagerDontShow, the color lists, and so on.
+ * Each of those goes through the whole list up to three times, matching
+ * the name, then the res_name, then the res_class against every pattern.
+ * But the answers only depend on the strings, and most windows share
+ * them with others (the 30th xterm looks just like the first 29).
+ *
+ * So for each set of name/res_name/res_class we keep a record of which
+ * entry each list turned up (or that none did), and later lookups just
+ * find that.  It's a fixed-size table of records indexed by a hash of
+ * the strings; a new set of strings takes over whatever was in its slot,
+ * so things that retitle themselves constantly can't make it grow
+ * without bound.  Lists are only ever added to at the front, so an
+ * existing head always means the same entries, and anything freeing
+ * lists throws the whole thing out.
+ */
+#define LC_SLOTS 256   // Power of 2
+
+typedef struct ListLookup {
+	const name_list *list;
+	const name_list *found;    // NULL if nothing matched
+} ListLookup;
+
+typedef struct ListDecisions {
+	unsigned long hash;
+	char          *name;
+	char          *res_name;
+	char          *res_class;
+	int           nlookups;
+	int           size;
+	ListLookup    *lookups;
+} ListDecisions;
+
+static ListDecisions *decisions[LC_SLOTS];
+
+static struct {
+	unsigned long hits, misses, replaced;
+} lcstats;
+
+
+static unsigned long
+lc_hash_str(unsigned long h, const char *str)
+{
+	/* FNV-1a, with a separator so "ab","c" != "a","bc" */
+	if(str != NULL) {
+		for(; *str; str++) {
+			h ^= (unsigned char)*str;
+			h *= 16777619UL;
+		}
+	}
+	h ^= 0xff;
+	h *= 16777619UL;
+	return h;
+}
+
+static bool
+lc_streq(const char *a, const char *b)
+{
+	if(a == NULL || b == NULL) {
+		return a == b;
+	}
+	return strcmp(a, b) == 0;
+}
+
+static char *
+lc_strdup(const char *s)
+{
+	char *r;
+
+	if(s == NULL) {
+		return NULL;
+	}
+	r = strdup(s);
+	if(r == NULL) {
+		fprintf(stderr, "%s: Out of memory\n", __func__);
+		Done(0);
+	}
+	return r;
+}
+
+static void
+lc_free_record(ListDecisions *ld)
+{
+	free(ld->name);
+	free(ld->res_name);
+	free(ld->res_class);
+	free(ld->lookups);
+	free(ld);
+}
+
+
+/*
+ * Find (or start) the record for these strings.
+ */
+static ListDecisions *
+lc_record(const char *name, const XClassHint *class)
+{
+	const char *res_name  = class->res_name;
+	const char *res_class = class->res_class;
+	unsigned long hash = 2166136261UL;
+	ListDecisions *ld;
+
+	hash = lc_hash_str(hash, name);
+	hash = lc_hash_str(hash, res_name);
+	hash = lc_hash_str(hash, res_class);
+
+	ld = decisions[hash & (LC_SLOTS - 1)];
+	if(ld != NULL && ld->hash == hash
+	                && lc_streq(ld->name, name)
+	                && lc_streq(ld->res_name, res_name)
+	                && lc_streq(ld->res_class, res_class)) {
+		return ld;
+	}
+
+	if(ld != NULL) {
+		lcstats.replaced++;
+		lc_free_record(ld);
+	}
+	ld = calloc(1, sizeof(ListDecisions));
+	if(ld == NULL) {
+		fprintf(stderr, "%s: Out of memory\n", __func__);
+		Done(0);
+	}
+	ld->hash      = hash;
+	ld->name      = lc_strdup(name);
+	ld->res_name  = lc_strdup(res_name);
+	ld->res_class = lc_strdup(res_class);
+	decisions[hash & (LC_SLOTS - 1)] = ld;
+	return ld;
+}
+
+
+/*
+ * The entry in list_head that name or class matches, if any.  This is
+ * what everything looking things up in a list goes through.
+ */
+static const name_list *
+find_entry(name_list *list_head, const char *name, XClassHint *class)
+{
+	ListDecisions *ld;
+	const name_list *found;
+
+	/* Plenty of lists are empty; no point remembering that */
+	if(list_head == NULL) {
+		return NULL;
+	}
+
+	/*
+	 * Only windows' name/class lookups are worth remembering.  Name-only
+	 * lookups are mostly in short-lived lists (like a window's
+	 * iconslist) that don't go through FreeList().
+	 */
+	if(class == NULL) {
+		return scan_list(list_head, name, class);
+	}
+
+	ld = lc_record(name, class);
+	for(int i = 0 ; i < ld->nlookups ; i++) {
+		if(ld->lookups[i].list == list_head) {
+			lcstats.hits++;
+			return ld->lookups[i].found;
+		}
+	}
+
+	lcstats.misses++;
+	found = scan_list(list_head, name, class);
+
+	if(ld->nlookups == ld->size) {
+		const int nsize = ld->size ? ld->size * 2 : 16;
+		ListLookup *nl = realloc(ld->lookups, nsize * sizeof(ListLookup));
+		if(nl == NULL) {
+			fprintf(stderr, "%s: Out of memory\n", __func__);
+			Done(0);
+		}
+		ld->lookups = nl;
+		ld->size    = nsize;
+	}
+	ld->lookups[ld->nlookups].list  = list_head;
+	ld->lookups[ld->nlookups].found = found;
+	ld->nlookups++;
+	return found;
+}
+
+
+/*
+ * Actually go through the list: the name first, then the res_name, and
+ * finally the res_class.
+ */
+static const name_list *
+scan_list(name_list *list_head, const char *name, XClassHint *class)
+{
+	name_list *nptr;
+
+	/* Long lists get compiled; x-ref matcher_compile() */
+	if(list_head->matcher == NULL && !list_head->nomatcher) {
+		list_head->matcher = matcher_compile(list_head);
+		list_head->nomatcher = (list_head->matcher == NULL);
+	}
+	if(list_head->matcher != NULL) {
+		const ListMatcher *lm = list_head->matcher;
+		int i = matcher_lookup(lm, name);
+
+		if(i < 0 && class) {
+			i = matcher_lookup(lm, class->res_name);
+			if(i < 0) {
+				i = matcher_lookup(lm, class->res_class);
+			}
+		}
+		return (i >= 0 ? lm->ents[i] : NULL);
+	}
+
+	for(nptr = list_head; nptr != NULL; nptr = nptr->next) {
+		if(match_entry(nptr, name)) {
+			return nptr;
+		}
+	}
+
+	if(class) {
+		for(nptr = list_head; nptr != NULL; nptr = nptr->next) {
+			if(match_entry(nptr, class->res_name)) {
+				return nptr;
+			}
+		}
+
+		for(nptr = list_head; nptr != NULL; nptr = nptr->next) {
+			if(match_entry(nptr, class->res_class)) {
+				return nptr;
+			}
+		}
+	}
+	return NULL;
+}
+
+
+/*
+ * Lists are being freed (config being reloaded); forget everything.
+ */
+void
+ListLookupsForget(void)
+{
+	for(int i = 0 ; i < LC_SLOTS ; i++) {
+		if(decisions[i] != NULL) {
+			lc_free_record(decisions[i]);
+			decisions[i] = NULL;
+		}
+	}
+}
+
+
+/*
+ * How it's doing, for f.dumpstats.
+ */
+void
+ListLookupsStatsDump(FILE *f)
+{
+	const unsigned long lookups = lcstats.hits + lcstats.misses;
+	int used = 0;
+
+	for(int i = 0 ; i < LC_SLOTS ; i++) {
+		if(decisions[i] != NULL) {
+			used++;
+		}
+	}
+
+	fprintf(f, "%s: list lookup cache: %lu hits, %lu misses (%.1f%% hit), "
+	        "%lu replaced; %d/%d slots used\n", ProgramName,
+	        lcstats.hits, lcstats.misses,
+	        lookups ? 100.0 * lcstats.hits / lookups : 0.0,
+	        lcstats.replaced, used, LC_SLOTS);
+	fflush(f);
+}
+
+
+/*
+ * Match a string against a list entry.  With system regex, this uses the
+ * pattern compiled when the entry was added; entries whose pattern
+ * failed to compile (or which weren't built by AddToList()) never match.
+ */
+static bool
+match_entry(const name_list *nptr, const char *string)
+{
+#ifdef USE_SYS_REGEX
+	if(!nptr->re_valid || string == NULL) {
+		return false;
+	}
+	return (regexec(&nptr->re, string, 0, NULL, 0) == 0);
+#else
+	return match(nptr->name, string);
+#endif
+}
+
+
 #ifdef USE_SYS_REGEX
 
+/*
+ * Compile a name pattern, complaining if it's broken.
+ */
+static bool
+compile_pattern(regex_t *preg, const char *pattern)
+{
+	int error;
+
+	error = regcomp(preg, pattern, REG_EXTENDED | REG_NOSUB);
+	if(error != 0) {
+		char buf [256];
+		regerror(error, preg, buf, sizeof buf);
+		fprintf(stderr, "%s : %s\n", buf, pattern);
+		return false;
+	}
+	return true;
+}
+
 bool match(const char *pattern, const char *string)
 {
 	regex_t preg;
@@ -259,14 +909,10 @@ bool match(const char *pattern, const char *string)
 	if((pattern == NULL) || (string == NULL)) {
 		return false;
 	}
-	error = regcomp(&preg, pattern, REG_EXTENDED | REG_NOSUB);
-	if(error != 0) {
-		char buf [256];
-		regerror(error, &preg, buf, sizeof buf);
-		fprintf(stderr, "%s : %s\n", buf, pattern);
+	if(!compile_pattern(&preg, pattern)) {
 		return false;
 	}
-	error = regexec(&preg, string, 5, 0, 0);
+	error = regexec(&preg, string, 0, NULL, 0);
 	regfree(&preg);
 	if(error == 0) {
 		return true;
@@ -17,10 +17,24 @@
 #ifndef _CTWM_LIST_H
 #define _CTWM_LIST_H
 
+#include <stdio.h>    // for FILE
+
+#ifdef USE_SYS_REGEX
+# include <regex.h>
+#endif
+
+typedef struct ListMatcher ListMatcher;
+
 struct name_list {
 	name_list *next;            /* pointer to the next name */
 	char      *name;            /* the name of the window */
 	void      *ptr;             /* list dependent data */
+	ListMatcher *matcher;       /* the list from here, compiled */
+	bool      nomatcher;        /* not worth compiling */
+#ifdef USE_SYS_REGEX
+	regex_t   re;               /* name, precompiled by AddToList() */
+	bool      re_valid;         /* re holds a successfully compiled regex */
+#endif
 };
 
 void AddToList(name_list **list_head, const char *name, void *ptr);
@@ -35,6 +49,9 @@ void *LookPatternInNameList(name_list *list_head, const char *name);
 bool GetColorFromList(name_list *list_head, char *name,
                       XClassHint *class, Pixel *ptr);
 void FreeList(name_list **list);
+void FreeListEntry(name_list *nptr);
+void ListLookupsForget(void);
+void ListLookupsStatsDump(FILE *f);
 
 bool match(const char *pattern, const char *string);
 
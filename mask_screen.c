@@ -154,7 +154,7 @@ UnmaskScreen(void)
 		}
 		XFreeColors(dpy, cmap, pixels, 256, 0L);
 		XFreeGC(dpy, Scr->WelcomeGC);
-		FreeImage(Scr->WelcomeImage);
+		ReleaseImage(Scr->WelcomeImage);
 	}
 	if(Scr->Monochrome != COLOR) {
 		goto fin;
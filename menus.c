@@ -51,6 +51,7 @@
 #include "util.h"
 #include "vscreen.h"
 #include "win_iconify.h"
+#include "win_index.h"
 #include "win_resize.h"
 #include "win_utils.h"
 #include "workspace_manager.h"
@@ -99,10 +100,30 @@ void InitMenus(void)
 	Scr->IconifyFunction.func  = 0;
 
 	Scr->FuncKeyRoot.next = NULL;
+	Scr->FuncKeyIndex = NULL;
 	Scr->FuncButtonRoot.next = NULL;
 }
 
 
+/*
+ * Function keys are also hashed on keycode, modifiers, and context, so a
+ * key press only has to look at the bindings that could possibly be for
+ * it, rather than walking all of them.  Each bucket is chained newest
+ * first, the same order as the list.
+ */
+#define FK_BUCKETS 256   // Power of 2
+
+static unsigned int
+fk_hash(KeyCode keycode, int mods, int cont)
+{
+	unsigned int h = keycode;
+
+	h = h * 31 + (unsigned int)mods;
+	h = h * 31 + (unsigned int)cont;
+	return h & (FK_BUCKETS - 1);
+}
+
+
 /***********************************************************************
  *
  *  Procedure:
@@ -123,7 +144,8 @@ bool
 AddFuncKey(char *name, int cont, int nmods, int func,
            MenuRoot *menu, char *win_name, char *action)
 {
-	FuncKey *tmp;
+	static unsigned int seq = 0;
+	FuncKey *tmp, **bucket;
 	KeySym keysym;
 	KeyCode keycode;
 
@@ -136,8 +158,20 @@ AddFuncKey(char *name, int cont, int nmods, int func,
 		return false;
 	}
 
-	/* see if there already is a key defined for this context */
-	for(tmp = Scr->FuncKeyRoot.next; tmp != NULL; tmp = tmp->next) {
+	if(Scr->FuncKeyIndex == NULL) {
+		Scr->FuncKeyIndex = calloc(FK_BUCKETS, sizeof(FuncKey *));
+		if(Scr->FuncKeyIndex == NULL) {
+			fprintf(stderr, "%s: Out of memory\n", __func__);
+			Done(0);
+		}
+	}
+	bucket = &Scr->FuncKeyIndex[fk_hash(keycode, nmods, cont)];
+
+	/*
+	 * See if there already is a key defined for this context.  The same
+	 * keysym always gives the same keycode, so it'd be in this bucket.
+	 */
+	for(tmp = *bucket; tmp != NULL; tmp = tmp->hnext) {
 		if(tmp->keysym == keysym &&
 		                tmp->cont == cont &&
 		                tmp->mods == nmods) {
@@ -147,8 +181,15 @@ AddFuncKey(char *name, int cont, int nmods, int func,
 
 	if(tmp == NULL) {
 		tmp = malloc(sizeof(FuncKey));
+		if(tmp == NULL) {
+			fprintf(stderr, "%s: Out of memory\n", __func__);
+			Done(0);
+		}
 		tmp->next = Scr->FuncKeyRoot.next;
 		Scr->FuncKeyRoot.next = tmp;
+		tmp->hnext = *bucket;
+		*bucket = tmp;
+		tmp->seq = ++seq;
 	}
 
 	tmp->name = name;
@@ -161,9 +202,48 @@ AddFuncKey(char *name, int cont, int nmods, int func,
 	tmp->win_name = win_name;
 	tmp->action = action;
 
+	ForgetBindingGrabs();
 	return true;
 }
 
+
+/*
+ * The next function key after prev (or the first, if prev is NULL) that
+ * a press of keycode with mods in context cont could trigger; that is,
+ * bound either in cont or to a window name (C_NAME).  They come back in
+ * the same order as walking Scr->FuncKeyRoot would find them.
+ */
+FuncKey *
+NextFuncKey(FuncKey *prev, KeyCode keycode, int mods, int cont)
+{
+	const int conts[2] = { cont, C_NAME };
+	FuncKey *best = NULL;
+
+	if(Scr->FuncKeyIndex == NULL) {
+		return NULL;
+	}
+
+	for(int i = 0 ; i < (cont == C_NAME ? 1 : 2) ; i++) {
+		FuncKey *key = Scr->FuncKeyIndex[fk_hash(keycode, mods, conts[i])];
+
+		/* Buckets are newest first, so the first one past prev will do */
+		for(; key != NULL; key = key->hnext) {
+			if(prev != NULL && key->seq >= prev->seq) {
+				continue;
+			}
+			if(key->keycode == keycode && key->mods == mods
+			                && key->cont == conts[i]) {
+				if(best == NULL || key->seq > best->seq) {
+					best = key;
+				}
+				break;
+			}
+		}
+	}
+
+	return best;
+}
+
 /***********************************************************************
  *
  *  Procedure:
@@ -217,6 +297,7 @@ AddFuncButton(int num, int cont, int nmods, int func,
 	tmp->menu = menu;
 	tmp->item = item;
 
+	ForgetBindingGrabs();
 	return;
 }
 
@@ -547,7 +628,12 @@ void UpdateMenu(void)
 			continue;
 		}
 
-		XFindContext(dpy, ActiveMenu->w, ScreenContext, (XPointer *)&Scr);
+		{
+			const WinRef *wr = WinIndexFind(ActiveMenu->w);
+			if(wr) {
+				Scr = wr->scr;
+			}
+		}
 
 		if(x < 0 || y < 0 ||
 		                x >= ActiveMenu->width || y >= ActiveMenu->height) {
@@ -954,8 +1040,7 @@ void MakeMenu(MenuRoot *mr)
 		                      valuemask, &attributes);
 
 
-		XSaveContext(dpy, mr->w, MenuContext, (XPointer)mr);
-		XSaveContext(dpy, mr->w, ScreenContext, (XPointer)Scr);
+		WinIndexAddMenu(mr->w, Scr, mr);
 
 		mr->mapped = MRM_UNMAPPED;
 	}
@@ -1546,8 +1631,7 @@ static void DestroyMenu(MenuRoot *menu)
 	MenuItem *item;
 
 	if(menu->w) {
-		XDeleteContext(dpy, menu->w, MenuContext);
-		XDeleteContext(dpy, menu->w, ScreenContext);
+		WinIndexDel(menu->w);
 		if(Scr->Shadow) {
 			XDestroyWindow(dpy, menu->shadow);
 		}
@@ -115,6 +115,8 @@ struct FuncKey {
 	char *win_name;             /* window name (if any) */
 	char *action;               /* action string (if any) */
 	MenuRoot *menu;             /* menu if func is F_MENU */
+	struct FuncKey *hnext;      /* next in its Scr->FuncKeyIndex bucket */
+	unsigned int seq;           /* order added; later ones come first */
 };
 
 extern MenuRoot *ActiveMenu;
@@ -145,6 +147,7 @@ void MakeWorkspacesMenu(void);
 MenuRoot *FindMenuRoot(char *name);
 bool AddFuncKey(char *name, int cont, int mods, int func,
                 MenuRoot *menu, char *win_name, char *action);
+FuncKey *NextFuncKey(FuncKey *prev, KeyCode keycode, int mods, int cont);
 void AddFuncButton(int num, int cont, int mods, int func,
                    MenuRoot *menu, MenuItem *item);
 void AddDefaultFuncButtons(void);
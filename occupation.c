@@ -21,6 +21,7 @@
 #include "ctwm_atoms.h"
 #include "drawing.h"
 #include "events.h"
+#include "frame_index.h"
 #include "iconmgr.h"
 #include "list.h"
 #include "screen.h"
@@ -29,18 +30,20 @@
 #include "util.h"
 #include "vscreen.h"
 #include "win_iconify.h"
+#include "win_index.h"
+#include "win_props.h"
 #include "win_regions.h"
 #include "win_utils.h"
 #include "workspace_manager.h"
 #include "workspace_utils.h"
 
 
-static int GetMaskFromResource(TwmWindow *win, char *res);
+static Occupation GetMaskFromResource(TwmWindow *win, char *res);
 static char *mk_nullsep_string(const char *prop, int len);
 
 static bool CanChangeOccupation(TwmWindow **twm_winp);
 
-int fullOccupation = 0;
+Occupation fullOccupation;
 
 /*
  * The window whose occupation is currently being manipulated.
@@ -77,7 +80,7 @@ static XrmOptionDescRec table [] = {
  * what, or which things should expand/contract on others...
  */
 void
-SetupOccupation(TwmWindow *twm_win, int occupation_hint)
+SetupOccupation(TwmWindow *twm_win, const Occupation *occupation_hint)
 {
 	char      **cliargv = NULL;
 	int       cliargc;
@@ -85,7 +88,7 @@ SetupOccupation(TwmWindow *twm_win, int occupation_hint)
 
 	/* If there aren't any config'd workspaces, there's only 0 */
 	if(! Scr->workSpaceManagerActive) {
-		twm_win->occupation = 1 << 0;   /* occupy workspace #0 */
+		twm_win->occupation = OccOnly(0);   /* occupy workspace #0 */
 		/* more?... */
 
 		return;
@@ -97,12 +100,12 @@ SetupOccupation(TwmWindow *twm_win, int occupation_hint)
 	}
 
 	/*twm_win->occupation = twm_win->iswinbox ? fullOccupation : 0;*/
-	twm_win->occupation = 0;
+	OccClear(&twm_win->occupation);
 
 	/* Specified in any Occupy{} config params? */
 	for(ws = Scr->workSpaceMgr.workSpaceList; ws != NULL; ws = ws->next) {
 		if(LookInList(ws->clientlist, twm_win->name, &twm_win->class)) {
-			twm_win->occupation |= 1 << ws->number;
+			OccSet(&twm_win->occupation, ws->number);
 		}
 	}
 
@@ -133,7 +136,7 @@ SetupOccupation(TwmWindow *twm_win, int occupation_hint)
 	}
 
 	/* Does it have a property telling us */
-	if(RestartPreviousState) {
+	if(RestartPreviousState && WinMayHaveProp(twm_win->w, XA_WM_OCCUPATION)) {
 		Atom actual_type;
 		int actual_format;
 		unsigned long nitems, bytesafter;
@@ -151,7 +154,7 @@ SetupOccupation(TwmWindow *twm_win, int occupation_hint)
 
 #ifdef EWMH
 	/* Maybe EWMH has something to tell us? */
-	if(twm_win->occupation == 0) {
+	if(OccEmpty(&twm_win->occupation)) {
 		twm_win->occupation = EwmhGetOccupation(twm_win);
 	}
 #endif /* EWMH */
@@ -186,13 +189,13 @@ SetupOccupation(TwmWindow *twm_win, int occupation_hint)
 
 
 	/* If we were told something specific, go with that */
-	if(occupation_hint != 0) {
-		twm_win->occupation = occupation_hint;
+	if(!OccEmpty(occupation_hint)) {
+		twm_win->occupation = *occupation_hint;
 	}
 
 	/* If it's apparently-nonsensical, put it in its vs's workspace */
-	if((twm_win->occupation & fullOccupation) == 0) {
-		twm_win->occupation = 1 << twm_win->vs->wsw->currentwspc->number;
+	if(!OccIntersects(&twm_win->occupation, &fullOccupation)) {
+		twm_win->occupation = OccOnly(twm_win->vs->wsw->currentwspc->number);
 	}
 
 	/*
@@ -231,7 +234,7 @@ SetupOccupation(TwmWindow *twm_win, int occupation_hint)
 		}
 
 		/* Set the property for the occupation */
-		len = GetPropertyFromMask(twm_win->occupation, &wsstr);
+		len = GetPropertyFromMask(&twm_win->occupation, &wsstr);
 		XChangeProperty(dpy, twm_win->w, XA_WM_OCCUPATION, XA_STRING, 8,
 		                PropModeReplace, (unsigned char *) wsstr, len);
 		free(wsstr);
@@ -281,7 +284,7 @@ void
 AddToWorkSpace(char *wname, TwmWindow *twm_win)
 {
 	WorkSpace *ws;
-	int newoccupation;
+	Occupation newoccupation;
 
 	if(!CanChangeOccupation(&twm_win)) {
 		return;
@@ -291,11 +294,12 @@ AddToWorkSpace(char *wname, TwmWindow *twm_win)
 		return;
 	}
 
-	if(twm_win->occupation & (1 << ws->number)) {
+	if(OccTest(&twm_win->occupation, ws->number)) {
 		return;
 	}
-	newoccupation = twm_win->occupation | (1 << ws->number);
-	ChangeOccupation(twm_win, newoccupation);
+	newoccupation = twm_win->occupation;
+	OccSet(&newoccupation, ws->number);
+	ChangeOccupation(twm_win, &newoccupation);
 }
 
 
@@ -307,7 +311,7 @@ void
 RemoveFromWorkSpace(char *wname, TwmWindow *twm_win)
 {
 	WorkSpace *ws;
-	int newoccupation;
+	Occupation newoccupation;
 
 	if(!CanChangeOccupation(&twm_win)) {
 		return;
@@ -317,11 +321,12 @@ RemoveFromWorkSpace(char *wname, TwmWindow *twm_win)
 		return;
 	}
 
-	newoccupation = twm_win->occupation & ~(1 << ws->number);
-	if(!newoccupation) {
+	newoccupation = twm_win->occupation;
+	OccUnset(&newoccupation, ws->number);
+	if(OccEmpty(&newoccupation)) {
 		return;
 	}
-	ChangeOccupation(twm_win, newoccupation);
+	ChangeOccupation(twm_win, &newoccupation);
 }
 
 
@@ -330,7 +335,7 @@ void
 ToggleOccupation(char *wname, TwmWindow *twm_win)
 {
 	WorkSpace *ws;
-	int newoccupation;
+	Occupation newoccupation;
 
 	if(!CanChangeOccupation(&twm_win)) {
 		return;
@@ -340,12 +345,13 @@ ToggleOccupation(char *wname, TwmWindow *twm_win)
 		return;
 	}
 
-	newoccupation = twm_win->occupation ^ (1 << ws->number);
-	if(!newoccupation) {
+	newoccupation = twm_win->occupation;
+	OccFlip(&newoccupation, ws->number);
+	if(OccEmpty(&newoccupation)) {
 		/* Don't allow de-occupying _every_ ws */
 		return;
 	}
-	ChangeOccupation(twm_win, newoccupation);
+	ChangeOccupation(twm_win, &newoccupation);
 }
 
 
@@ -354,7 +360,7 @@ void
 MoveToNextWorkSpace(VirtualScreen *vs, TwmWindow *twm_win)
 {
 	WorkSpace *wlist1, *wlist2;
-	int newoccupation;
+	Occupation newoccupation;
 
 	if(!CanChangeOccupation(&twm_win)) {
 		return;
@@ -365,9 +371,10 @@ MoveToNextWorkSpace(VirtualScreen *vs, TwmWindow *twm_win)
 	wlist2 = wlist2 ? wlist2 : Scr->workSpaceMgr.workSpaceList;
 
 	/* Out of (here), into (here+1) */
-	newoccupation = (twm_win->occupation ^ (1 << wlist1->number))
-	                | (1 << wlist2->number);
-	ChangeOccupation(twm_win, newoccupation);
+	newoccupation = twm_win->occupation;
+	OccFlip(&newoccupation, wlist1->number);
+	OccSet(&newoccupation, wlist2->number);
+	ChangeOccupation(twm_win, &newoccupation);
 }
 
 
@@ -392,7 +399,7 @@ void
 MoveToPrevWorkSpace(VirtualScreen *vs, TwmWindow *twm_win)
 {
 	WorkSpace *wlist1, *wlist2;
-	int newoccupation;
+	Occupation newoccupation;
 
 	if(!CanChangeOccupation(&twm_win)) {
 		return;
@@ -409,9 +416,10 @@ MoveToPrevWorkSpace(VirtualScreen *vs, TwmWindow *twm_win)
 	}
 
 	/* Out of (here), into (here-1) */
-	newoccupation = (twm_win->occupation ^ (1 << wlist2->number))
-	                | (1 << wlist1->number);
-	ChangeOccupation(twm_win, newoccupation);
+	newoccupation = twm_win->occupation;
+	OccFlip(&newoccupation, wlist2->number);
+	OccSet(&newoccupation, wlist1->number);
+	ChangeOccupation(twm_win, &newoccupation);
 }
 
 
@@ -440,21 +448,21 @@ void
 WmgrRedoOccupation(TwmWindow *win)
 {
 	WorkSpace *ws;
-	int       newoccupation;
+	Occupation newoccupation;
 
 	if(LookInList(Scr->OccupyAll, win->name, &win->class)) {
 		newoccupation = fullOccupation;
 	}
 	else {
-		newoccupation = 0;
+		OccClear(&newoccupation);
 		for(ws = Scr->workSpaceMgr.workSpaceList; ws != NULL; ws = ws->next) {
 			if(LookInList(ws->clientlist, win->name, &win->class)) {
-				newoccupation |= 1 << ws->number;
+				OccSet(&newoccupation, ws->number);
 			}
 		}
 	}
-	if(newoccupation != 0) {
-		ChangeOccupation(win, newoccupation);
+	if(!OccEmpty(&newoccupation)) {
+		ChangeOccupation(win, &newoccupation);
 	}
 }
 
@@ -464,7 +472,7 @@ void
 WMgrRemoveFromCurrentWorkSpace(VirtualScreen *vs, TwmWindow *win)
 {
 	WorkSpace *ws;
-	int       newoccupation;
+	Occupation newoccupation;
 
 	ws = vs->wsw->currentwspc;
 	if(!ws) {
@@ -475,12 +483,13 @@ WMgrRemoveFromCurrentWorkSpace(VirtualScreen *vs, TwmWindow *win)
 		return;
 	}
 
-	newoccupation = win->occupation & ~(1 << ws->number);
-	if(newoccupation == 0) {
+	newoccupation = win->occupation;
+	OccUnset(&newoccupation, ws->number);
+	if(OccEmpty(&newoccupation)) {
 		return;
 	}
 
-	ChangeOccupation(win, newoccupation);
+	ChangeOccupation(win, &newoccupation);
 }
 
 
@@ -489,7 +498,7 @@ void
 WMgrAddToCurrentWorkSpaceAndWarp(VirtualScreen *vs, char *winname)
 {
 	TwmWindow *tw;
-	int       newoccupation;
+	Occupation newoccupation;
 
 	/* Find named window on this screen */
 	for(tw = Scr->FirstWindow; tw != NULL; tw = tw->next) {
@@ -528,8 +537,9 @@ WMgrAddToCurrentWorkSpaceAndWarp(VirtualScreen *vs, char *winname)
 
 	/* Move it here if it's not */
 	if(! OCCUPY(tw, vs->wsw->currentwspc)) {
-		newoccupation = tw->occupation | (1 << vs->wsw->currentwspc->number);
-		ChangeOccupation(tw, newoccupation);
+		newoccupation = tw->occupation;
+		OccSet(&newoccupation, vs->wsw->currentwspc->number);
+		ChangeOccupation(tw, &newoccupation);
 	}
 
 	/* If we get here, WarpUnmapped is set, so map it if we need to */
@@ -559,7 +569,7 @@ OccupyAll(TwmWindow *twm_win)
 	 */
 	save = Scr->iconmgr;
 	Scr->iconmgr = Scr->workSpaceMgr.workSpaceList->iconmgr;
-	ChangeOccupation(twm_win, fullOccupation);
+	ChangeOccupation(twm_win, &fullOccupation);
 	Scr->iconmgr = save;
 }
 
@@ -803,7 +813,8 @@ CreateOccupyWindow(void)
 		exit(1);
 	}
 	tmp_win->vs = NULL;
-	tmp_win->occupation = 0;
+	OccClear(&tmp_win->occupation);
+	UpdateWorkSpaceMembers(tmp_win);
 
 	/* tmp_win is more convenient the rest of the func, but put in place */
 	occwin->twm_win = tmp_win;
@@ -838,8 +849,7 @@ CreateOccupyWindow(void)
 #define EVT (ButtonPressMask | ButtonReleaseMask | ExposureMask)
 #define BTN_IPT_CTX(win) \
         XSelectInput(dpy, (win), EVT); \
-        XSaveContext(dpy, (win), TwmContext, (XPointer) tmp_win); \
-        XSaveContext(dpy, (win), ScreenContext, (XPointer) Scr);
+        WinIndexAdd((win), Scr, tmp_win, WR_OCCUPY_BUTTON, 0);
 
 	for(WorkSpace *ws = Scr->workSpaceMgr.workSpaceList
 	                    ; ws != NULL ; ws = ws->next) {
@@ -963,7 +973,7 @@ PaintOccupyWindow(void)
 
 	for(ws = Scr->workSpaceMgr.workSpaceList; ws != NULL; ws = ws->next) {
 		Window bw = occwin->obuttonw [ws->number];
-		ButtonState bs = (occwin->tmpOccupation & (1 << ws->number)) ? on : off;
+		ButtonState bs = OccTest(&occwin->tmpOccupation, ws->number) ? on : off;
 
 		PaintWsButton(OCCUPYWINDOW, NULL, bw, ws->label, ws->cp, bs);
 	}
@@ -1021,22 +1031,23 @@ OccupyHandleButtonEvent(XEvent *event)
 
 	if(ws != NULL) {
 		/* If one was, toggle it */
-		int mask = 1 << ws->number;
-		ButtonState bs = (occupyW->tmpOccupation & mask) ? off : on;
+		ButtonState bs = OccTest(&occupyW->tmpOccupation, ws->number) ? off : on;
 
 		PaintWsButton(OCCUPYWINDOW, NULL, occupyW->obuttonw [ws->number],
 		              ws->label, ws->cp, bs);
-		occupyW->tmpOccupation ^= mask;
+		OccFlip(&occupyW->tmpOccupation, ws->number);
 	}
 	else if(buttonW == occupyW->OK) {
 		/* Else if we clicked OK, set things and close the window */
-		if(occupyW->tmpOccupation == 0) {
+		if(OccEmpty(&occupyW->tmpOccupation)) {
 			return;
 		}
-		ChangeOccupation(occupyWin, occupyW->tmpOccupation);
+		ChangeOccupation(occupyWin, &occupyW->tmpOccupation);
 		XUnmapWindow(dpy, occupyW->twm_win->frame);
 		occupyW->twm_win->mapped = false;
-		occupyW->twm_win->occupation = 0;
+		FrameIndexUpdate(occupyW->twm_win);
+		OccClear(&occupyW->twm_win->occupation);
+		UpdateWorkSpaceMembers(occupyW->twm_win);
 		occupyWin = NULL;
 		XSync(dpy, 0);
 	}
@@ -1044,7 +1055,9 @@ OccupyHandleButtonEvent(XEvent *event)
 		/* Or cancel, do nothing and close the window */
 		XUnmapWindow(dpy, occupyW->twm_win->frame);
 		occupyW->twm_win->mapped = false;
-		occupyW->twm_win->occupation = 0;
+		FrameIndexUpdate(occupyW->twm_win);
+		OccClear(&occupyW->twm_win->occupation);
+		UpdateWorkSpaceMembers(occupyW->twm_win);
 		occupyWin = NULL;
 		XSync(dpy, 0);
 	}
@@ -1113,6 +1126,7 @@ Occupy(TwmWindow *twm_win)
 
 	occupy_twm = occupyWindow->twm_win;
 	occupy_twm->occupation = twm_win->occupation;
+	UpdateWorkSpaceMembers(occupy_twm);
 
 	/* Move the occupy window to where it should be */
 	if(occupy_twm->parent_vs != twm_win->parent_vs) {
@@ -1124,6 +1138,7 @@ Occupy(TwmWindow *twm_win)
 		 * rather than manually grubbing beneath it?
 		 */
 		ReparentFrameAndIcon(occupy_twm);
+		FrameIndexUpdate(occupy_twm);
 	}
 	else {
 		XMoveWindow(dpy, occupyWindow->twm_win->frame, x, y);
@@ -1139,6 +1154,7 @@ Occupy(TwmWindow *twm_win)
 
 	/* Mark it shown, and stash what window we're showing it for */
 	occupyWindow->twm_win->mapped = true;
+	FrameIndexUpdate(occupyWindow->twm_win);
 	occupyWin = twm_win;
 }
 
@@ -1161,15 +1177,16 @@ Occupy(TwmWindow *twm_win)
  * called something more like "SetOccupation()".
  */
 void
-ChangeOccupation(TwmWindow *tmp_win, int newoccupation)
+ChangeOccupation(TwmWindow *tmp_win, const Occupation *newocc)
 {
 	TwmWindow *t;
 	WorkSpace *ws;
-	int oldoccupation;
-	int changedoccupation;
+	Occupation newoccupation = *newocc;
+	Occupation oldoccupation;
+	Occupation changedoccupation;
 
-	if((newoccupation == 0)
-	                || (newoccupation == tmp_win->occupation)) {
+	if(OccEmpty(&newoccupation)
+	                || OccEqual(&newoccupation, &tmp_win->occupation)) {
 		/*
 		 * occupation=0 we interpret as "leave it alone".  == current,
 		 * ditto.  Go ahead and re-set the WM_OCCUPATION property though,
@@ -1182,7 +1199,7 @@ ChangeOccupation(TwmWindow *tmp_win, int newoccupation)
 		/* Mask out the PropertyChange events while we change the prop */
 		eventMask = mask_out_event(tmp_win->w, PropertyChangeMask);
 
-		len = GetPropertyFromMask(tmp_win->occupation, &namelist);
+		len = GetPropertyFromMask(&tmp_win->occupation, &namelist);
 		XChangeProperty(dpy, tmp_win->w, XA_WM_OCCUPATION, XA_STRING, 8,
 		                PropModeReplace, (unsigned char *) namelist, len);
 		free(namelist);
@@ -1209,9 +1226,10 @@ ChangeOccupation(TwmWindow *tmp_win, int newoccupation)
 	 * don't match the current occupation, so it can just be told "here's
 	 * where I should be".
 	 */
-	tmp_win->occupation = newoccupation & ~oldoccupation;
+	OccDiff(&tmp_win->occupation, &newoccupation, &oldoccupation);
 	AddIconManager(tmp_win);
 	tmp_win->occupation = newoccupation;
+	UpdateWorkSpaceMembers(tmp_win);
 	RemoveIconManager(tmp_win);
 
 	/* If it shouldn't be "here", vanish it */
@@ -1244,9 +1262,8 @@ ChangeOccupation(TwmWindow *tmp_win, int newoccupation)
 	 * unconditionally Remove/Place'ing would have the same effect?
 	 */
 	for(ws = Scr->workSpaceMgr.workSpaceList; ws != NULL; ws = ws->next) {
-		int mask = 1 << ws->number;
-		if(oldoccupation & mask) {
-			if(!(newoccupation & mask)) {
+		if(OccTest(&oldoccupation, ws->number)) {
+			if(!OccTest(&newoccupation, ws->number)) {
 				int final_x, final_y;
 				RemoveWindowFromRegion(tmp_win);
 				if(PlaceWindowInRegion(tmp_win, &final_x, &final_y)) {
@@ -1265,7 +1282,7 @@ ChangeOccupation(TwmWindow *tmp_win, int newoccupation)
 
 		eventMask = mask_out_event(tmp_win->w, PropertyChangeMask);
 
-		len = GetPropertyFromMask(newoccupation, &namelist);
+		len = GetPropertyFromMask(&newoccupation, &namelist);
 		XChangeProperty(dpy, tmp_win->w, XA_WM_OCCUPATION, XA_STRING, 8,
 		                PropModeReplace, (unsigned char *) namelist, len);
 		free(namelist);
@@ -1289,7 +1306,7 @@ ChangeOccupation(TwmWindow *tmp_win, int newoccupation)
 	 */
 	if(!WMapWindowMayBeAdded(tmp_win)) {
 		/* Not showing in the map, so pretend it's nowhere */
-		newoccupation = 0;
+		OccClear(&newoccupation);
 	}
 	if(Scr->workSpaceMgr.noshowoccupyall) {
 		/*
@@ -1298,17 +1315,16 @@ ChangeOccupation(TwmWindow *tmp_win, int newoccupation)
 		 * don't have to adjust newoccupation, because the above
 		 * conditional would have caught it, so we only need to edit old.
 		 */
-		if(oldoccupation == fullOccupation) {
-			oldoccupation = 0;
+		if(OccEqual(&oldoccupation, &fullOccupation)) {
+			OccClear(&oldoccupation);
 		}
 	}
 
 	/* Flip the ones that need flipping */
-	changedoccupation = oldoccupation ^ newoccupation;
+	OccSymDiff(&changedoccupation, &oldoccupation, &newoccupation);
 	for(ws = Scr->workSpaceMgr.workSpaceList; ws != NULL; ws = ws->next) {
-		int mask = 1 << ws->number;
-		if(changedoccupation & mask) {
-			if(newoccupation & mask) {
+		if(OccTest(&changedoccupation, ws->number)) {
+			if(OccTest(&newoccupation, ws->number)) {
 				/* Add to WS */
 				WMapAddWindowToWorkspace(tmp_win, ws);
 			}
@@ -1336,7 +1352,7 @@ ChangeOccupation(TwmWindow *tmp_win, int newoccupation)
 			if(t != tmp_win &&
 			                ((t->istransient && t->transientfor == tmp_win->w) ||
 			                 t->group == tmp_win->w)) {
-				ChangeOccupation(t, tmp_win->occupation);
+				ChangeOccupation(t, &tmp_win->occupation);
 			}
 		}
 	}
@@ -1346,6 +1362,74 @@ ChangeOccupation(TwmWindow *tmp_win, int newoccupation)
 }
 
 
+/*
+ * Each workspace keeps a list of the windows occupying it, so things
+ * like GotoWorkSpace() can look at just those rather than everything.
+ * A window has an entry for each workspace, linked into the lists of
+ * the ones it occupies.  Anything that changes ->occupation calls this
+ * afterward to bring the lists up to date.
+ */
+void
+UpdateWorkSpaceMembers(TwmWindow *twm_win)
+{
+	WorkSpace *ws;
+
+	if(twm_win->wsmembers == NULL) {
+		if(OccEmpty(&twm_win->occupation)) {
+			return;
+		}
+		twm_win->wsmembers = calloc(Scr->workSpaceMgr.count,
+		                            sizeof(WorkSpaceMember));
+		if(twm_win->wsmembers == NULL) {
+			fprintf(stderr, "%s: Out of memory\n", __func__);
+			Done(0);
+		}
+	}
+
+	for(ws = Scr->workSpaceMgr.workSpaceList; ws != NULL; ws = ws->next) {
+		WorkSpaceMember *m = &twm_win->wsmembers[ws->number];
+		const bool in = (m->twm_win != NULL);
+
+		if(OCCUPY(twm_win, ws) && !in) {
+			m->twm_win = twm_win;
+			m->prev = NULL;
+			m->next = ws->members;
+			if(ws->members != NULL) {
+				ws->members->prev = m;
+			}
+			ws->members = m;
+		}
+		else if(!OCCUPY(twm_win, ws) && in) {
+			if(m->prev != NULL) {
+				m->prev->next = m->next;
+			}
+			else {
+				ws->members = m->next;
+			}
+			if(m->next != NULL) {
+				m->next->prev = m->prev;
+			}
+			m->twm_win = NULL;
+		}
+	}
+}
+
+
+/*
+ * Take a window that's going away out of all the workspaces' lists.
+ */
+void
+ForgetWorkSpaceMembers(TwmWindow *twm_win)
+{
+	OccClear(&twm_win->occupation);
+	if(twm_win->wsmembers != NULL) {
+		UpdateWorkSpaceMembers(twm_win);
+		free(twm_win->wsmembers);
+		twm_win->wsmembers = NULL;
+	}
+}
+
+
 /*
  * There are various reasons you might not be able to change the
  * occupation of a window (either due to attributes of it, or the state
@@ -1453,11 +1537,11 @@ AddToClientsList(char *workspace, char *client)
  * Turn a ctwm.workspace resource string into an occupation mask.  n.b.;
  * this changes the 'res' arg in-place.
  */
-static int
+static Occupation
 GetMaskFromResource(TwmWindow *win, char *res)
 {
-	WorkSpace *ws;
-	int       mask;
+	WorkSpace  *ws;
+	Occupation mask, result;
 	enum { O_SET, O_ADD, O_REM } mode;
 	char *wrkSpcName, *tokst;
 
@@ -1482,7 +1566,7 @@ GetMaskFromResource(TwmWindow *win, char *res)
 	 * Walk through the string adding the workspaces specified into the
 	 * mask of what we're doing.
 	 */
-	mask = 0;
+	OccClear(&mask);
 	for(wrkSpcName = strtok_r(res, " ", &tokst) ; wrkSpcName
 	                ; wrkSpcName = strtok_r(NULL, " ", &tokst)) {
 		if(strcmp(wrkSpcName, "all") == 0) {
@@ -1492,14 +1576,14 @@ GetMaskFromResource(TwmWindow *win, char *res)
 		if(strcmp(wrkSpcName, "current") == 0) {
 			VirtualScreen *vs = Scr->currentvs;
 			if(vs) {
-				mask |= (1 << vs->wsw->currentwspc->number);
+				OccSet(&mask, vs->wsw->currentwspc->number);
 			}
 			continue;
 		}
 
 		ws = GetWorkspace(wrkSpcName);
 		if(ws != NULL) {
-			mask |= (1 << ws->number);
+			OccSet(&mask, ws->number);
 		}
 		else {
 			fprintf(stderr, "unknown workspace : %s\n", wrkSpcName);
@@ -1514,31 +1598,34 @@ GetMaskFromResource(TwmWindow *win, char *res)
 		case O_SET:
 			return (mask);
 		case O_ADD:
-			return (mask | win->occupation);
+			OccUnion(&result, &mask, &win->occupation);
+			return (result);
 		case O_REM:
-			return (win->occupation & ~mask);
+			OccDiff(&result, &win->occupation, &mask);
+			return (result);
 	}
 
 	/* Can't get here */
 	fprintf(stderr, "%s(): Unreachable.\n", __func__);
-	return 0;
+	OccClear(&result);
+	return result;
 }
 
 
 /*
  * Turns a \0-separated buffer of workspace names into an occupation
- * bitmask.
+ * set.
  */
-unsigned int
+Occupation
 GetMaskFromProperty(unsigned char *_prop, unsigned long len)
 {
 	char         wrkSpcName[256];
 	WorkSpace    *ws;
-	unsigned int mask;
+	Occupation   mask;
 	int          l;
 	char         *prop;
 
-	mask = 0;
+	OccClear(&mask);
 	l = 0;
 	prop = (char *) _prop;
 	while(l < len) {
@@ -1553,7 +1640,7 @@ GetMaskFromProperty(unsigned char *_prop, unsigned long len)
 
 		ws = GetWorkspace(wrkSpcName);
 		if(ws != NULL) {
-			mask |= (1 << ws->number);
+			OccSet(&mask, ws->number);
 		}
 		else {
 			fprintf(stderr, "unknown workspace : %s\n", wrkSpcName);
@@ -1563,7 +1650,7 @@ GetMaskFromProperty(unsigned char *_prop, unsigned long len)
 #if 0
 	{
 		char *dbs = mk_nullsep_string((char *)_prop, len);
-		fprintf(stderr, "%s('%s') -> 0x%x\n", __func__, dbs, mask);
+		fprintf(stderr, "%s('%s') -> 0x%lx...\n", __func__, dbs, mask.w[0]);
 		free(dbs);
 	}
 #endif
@@ -1573,11 +1660,11 @@ GetMaskFromProperty(unsigned char *_prop, unsigned long len)
 
 
 /*
- * Turns an occupation mask into a \0-separated buffer (not really a
+ * Turns an occupation set into a \0-separated buffer (not really a
  * string) of the workspace names.
  */
 int
-GetPropertyFromMask(unsigned int mask, char **prop)
+GetPropertyFromMask(const Occupation *mask, char **prop)
 {
 	WorkSpace *ws;
 	int       len;
@@ -1585,7 +1672,7 @@ GetPropertyFromMask(unsigned int mask, char **prop)
 	int       i;
 
 	/* If it's everything, just say 'all' */
-	if(mask == fullOccupation) {
+	if(OccEqual(mask, &fullOccupation)) {
 		*prop = strdup("all");
 		return 3;
 	}
@@ -1595,7 +1682,7 @@ GetPropertyFromMask(unsigned int mask, char **prop)
 	i = 0;
 	len = 0;
 	for(ws = Scr->workSpaceMgr.workSpaceList; ws != NULL; ws = ws->next) {
-		if(mask & (1 << ws->number)) {
+		if(OccTest(mask, ws->number)) {
 			wss[i++] = ws->label;
 			len += strlen(ws->label) + 1;
 		}
@@ -1612,7 +1699,8 @@ GetPropertyFromMask(unsigned int mask, char **prop)
 #if 0
 	{
 		char *dbs = mk_nullsep_string(*prop, len);
-		fprintf(stderr, "%s(0x%x) -> %d:'%s'\n", __func__, mask, len, dbs);
+		fprintf(stderr, "%s(0x%lx...) -> %d:'%s'\n", __func__, mask->w[0], len,
+		        dbs);
 		free(dbs);
 	}
 #endif
@@ -22,12 +22,18 @@ struct OccupyWindow {
 	int           owidth;                 /* oheight == bheight */
 	ColorPair     cp;
 	MyFont        font;
-	int           tmpOccupation;
+	Occupation    tmpOccupation;
+};
+
+/* A window's entry in the list of what occupies a workspace */
+struct WorkSpaceMember {
+	TwmWindow       *twm_win;      // NULL when it's not in the list
+	WorkSpaceMember *prev, *next;
 };
 
 
 /* Setting occupation bits */
-void SetupOccupation(TwmWindow *twm_win, int occupation_hint);
+void SetupOccupation(TwmWindow *twm_win, const Occupation *occupation_hint);
 void AddToWorkSpace(char *wname, TwmWindow *twm_win);
 void RemoveFromWorkSpace(char *wname, TwmWindow *twm_win);
 void ToggleOccupation(char *wname, TwmWindow *twm_win);
@@ -48,15 +54,17 @@ void OccupyHandleButtonEvent(XEvent *event);
 void Occupy(TwmWindow *twm_win);
 
 /* Backend/util */
-void ChangeOccupation(TwmWindow *tmp_win, int newoccupation);
+void ChangeOccupation(TwmWindow *tmp_win, const Occupation *newocc);
+void UpdateWorkSpaceMembers(TwmWindow *twm_win);
+void ForgetWorkSpaceMembers(TwmWindow *twm_win);
 bool AddToClientsList(char *workspace, char *client);
-unsigned int GetMaskFromProperty(unsigned char *_prop, unsigned long len);
-int GetPropertyFromMask(unsigned int mask, char **prop);
+Occupation GetMaskFromProperty(unsigned char *_prop, unsigned long len);
+int GetPropertyFromMask(const Occupation *mask, char **prop);
 
 
 
 /* Various other code needs to look at this */
-extern int fullOccupation;
+extern Occupation fullOccupation;
 
 /* Hopefully temporary; x-ref comment in .c */
 extern TwmWindow *occupyWin;
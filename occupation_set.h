@@ -0,0 +1,169 @@
+/*
+ * Sets of workspaces, for window occupation
+ *
+ * Which workspaces a window is in used to be bits in an int, which
+ * capped us at 32 workspaces.  This is the same idea spread over however
+ * many words it takes to hold MAXWORKSPACE bits, with the set operations
+ * done a word at a time.  It's a plain value; copy it with =.
+ */
+#ifndef _CTWM_OCCUPATION_SET_H
+#define _CTWM_OCCUPATION_SET_H
+
+#include <limits.h>
+#include <stdbool.h>
+
+#define MAXWORKSPACE 256
+
+#define OCC_WORDBITS  (sizeof(unsigned long) * CHAR_BIT)
+#define OCC_NWORDS    ((MAXWORKSPACE + OCC_WORDBITS - 1) / OCC_WORDBITS)
+
+typedef struct Occupation {
+	unsigned long w[OCC_NWORDS];
+} Occupation;
+
+
+/* Individual workspaces */
+static inline void
+OccClear(Occupation *o)
+{
+	for(unsigned i = 0; i < OCC_NWORDS; i++) {
+		o->w[i] = 0;
+	}
+}
+
+static inline void
+OccSet(Occupation *o, int n)
+{
+	o->w[n / OCC_WORDBITS] |= 1UL << (n % OCC_WORDBITS);
+}
+
+static inline void
+OccUnset(Occupation *o, int n)
+{
+	o->w[n / OCC_WORDBITS] &= ~(1UL << (n % OCC_WORDBITS));
+}
+
+static inline void
+OccFlip(Occupation *o, int n)
+{
+	o->w[n / OCC_WORDBITS] ^= 1UL << (n % OCC_WORDBITS);
+}
+
+static inline bool
+OccTest(const Occupation *o, int n)
+{
+	return (o->w[n / OCC_WORDBITS] >> (n % OCC_WORDBITS)) & 1;
+}
+
+/* Just workspace n */
+static inline Occupation
+OccOnly(int n)
+{
+	Occupation o;
+
+	OccClear(&o);
+	OccSet(&o, n);
+	return o;
+}
+
+
+/* Whole sets */
+static inline bool
+OccEmpty(const Occupation *o)
+{
+	unsigned long any = 0;
+
+	for(unsigned i = 0; i < OCC_NWORDS; i++) {
+		any |= o->w[i];
+	}
+	return any == 0;
+}
+
+static inline bool
+OccEqual(const Occupation *a, const Occupation *b)
+{
+	unsigned long diff = 0;
+
+	for(unsigned i = 0; i < OCC_NWORDS; i++) {
+		diff |= a->w[i] ^ b->w[i];
+	}
+	return diff == 0;
+}
+
+static inline bool
+OccIntersects(const Occupation *a, const Occupation *b)
+{
+	unsigned long both = 0;
+
+	for(unsigned i = 0; i < OCC_NWORDS; i++) {
+		both |= a->w[i] & b->w[i];
+	}
+	return both != 0;
+}
+
+/* dst = a | b */
+static inline void
+OccUnion(Occupation *dst, const Occupation *a, const Occupation *b)
+{
+	for(unsigned i = 0; i < OCC_NWORDS; i++) {
+		dst->w[i] = a->w[i] | b->w[i];
+	}
+}
+
+/* dst = a & b */
+static inline void
+OccIntersect(Occupation *dst, const Occupation *a, const Occupation *b)
+{
+	for(unsigned i = 0; i < OCC_NWORDS; i++) {
+		dst->w[i] = a->w[i] & b->w[i];
+	}
+}
+
+/* dst = a & ~b */
+static inline void
+OccDiff(Occupation *dst, const Occupation *a, const Occupation *b)
+{
+	for(unsigned i = 0; i < OCC_NWORDS; i++) {
+		dst->w[i] = a->w[i] & ~b->w[i];
+	}
+}
+
+/* dst = a ^ b */
+static inline void
+OccSymDiff(Occupation *dst, const Occupation *a, const Occupation *b)
+{
+	for(unsigned i = 0; i < OCC_NWORDS; i++) {
+		dst->w[i] = a->w[i] ^ b->w[i];
+	}
+}
+
+
+/*
+ * The first workspace at or after n in the set, or -1.  For walking
+ * through them:
+ *
+ *     for(n = OccNext(&occ, 0); n >= 0; n = OccNext(&occ, n + 1))
+ */
+static inline int
+OccNext(const Occupation *o, int n)
+{
+	unsigned i = n / OCC_WORDBITS;
+	unsigned long word;
+
+	if(n < 0 || n >= MAXWORKSPACE) {
+		return -1;
+	}
+	word = o->w[i] & (~0UL << (n % OCC_WORDBITS));
+	while(word == 0) {
+		if(++i >= OCC_NWORDS) {
+			return -1;
+		}
+		word = o->w[i];
+	}
+	for(n = i * OCC_WORDBITS; !(word & 1); n++) {
+		word >>= 1;
+	}
+	return n;
+}
+
+#endif /* _CTWM_OCCUPATION_SET_H */
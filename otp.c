@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <limits.h>
 #include <X11/Xatom.h>
 
 #include "otp.h"
@@ -27,6 +28,7 @@
 #include "events.h"
 #include "event_handlers.h"
 #include "vscreen.h"
+#include "win_props.h"
 
 #define DEBUG_OTP       0
 #if DEBUG_OTP
@@ -41,6 +43,16 @@
 # define CHECK_OTP      1
 #endif
 
+/*
+ * Checking our list against the server's stacking order takes a round
+ * trip every time, so only do it when we're debugging OTP itself.
+ */
+#if CHECK_OTP && DEBUG_OTP
+# define CHECK_OTP_XSTACK 1
+#else
+# define CHECK_OTP_XSTACK 0
+#endif
+
 /* number of priorities known to ctwm: [0..ONTOP_MAX] */
 #define OTP_ZERO 8
 #define OTP_MAX (OTP_ZERO * 2)
@@ -52,6 +64,16 @@
             to->pri_aflags = from->pri_aflags; \
         } while(0)
 
+/*
+ * All the windows and icons are kept in one list, bottom to top.  The
+ * list is cut into runs by priority, and we keep track of the ends of
+ * each run, so finding where a given priority starts or ends doesn't
+ * need to walk the list.  Each owl remembers which run it's filed under.
+ *
+ * Moving things in the list doesn't touch the X server right away; the
+ * moved owls get queued up, and RestackPending() works out what to tell
+ * the server once the whole operation is done.
+ */
 struct OtpWinList {
 	OtpWinList *above;
 	OtpWinList *below;
@@ -61,6 +83,10 @@ struct OtpWinList {
 	int         pri_base;   // Base priority
 	unsigned    pri_aflags; // Flags that might alter it; OTP_AFLAG_*
 	bool        stashed_aflags;
+	int         bucket;     // Priority run it's filed in
+	bool        restack;    // Queued for RestackPending()
+	OtpWinList *restack_next;
+	unsigned long stackpos; // Grows going up the list; see SetStackPos()
 };
 
 struct OtpPreferences {
@@ -87,6 +113,9 @@ static unsigned OwlGetStashedAflags(OtpWinList *owl, bool *gotit);
 static int OwlEffectivePriority(OtpWinList *owl);
 
 static OtpWinList *bottomOwl = NULL;
+static OtpWinList *bucketBottom[OTP_MAX + 1];
+static OtpWinList *bucketTop[OTP_MAX + 1];
+static OtpWinList *restackQueue = NULL;
 
 static Box BoxOfOwl(OtpWinList *owl)
 {
@@ -207,13 +236,16 @@ static bool OtpCheckConsistencyVS(VirtualScreen *currentvs, Window vroot)
 #if CHECK_OTP
 	OtpWinList *owl;
 	TwmWindow *twm_win;
+	int priority = 0;
+	int bucket = -1;
+	int nwins = 0;
+#if CHECK_OTP_XSTACK
 	Window root, parent, *children;
 	unsigned int nchildren;
-	int priority = 0;
 	int stack = -1;
-	int nwins = 0;
 
 	XQueryTree(dpy, vroot, &root, &parent, &children, &nchildren);
+#endif
 
 #if DEBUG_OTP
 	{
@@ -240,6 +272,7 @@ static bool OtpCheckConsistencyVS(VirtualScreen *currentvs, Window vroot)
 		}
 		else {
 			assert(owl->below->above == owl);
+			assert(owl->below->stackpos < owl->stackpos);
 		}
 
 		/* Code already ensures this */
@@ -249,14 +282,28 @@ static bool OtpCheckConsistencyVS(VirtualScreen *currentvs, Window vroot)
 		assert(PRI(owl) >= priority);
 		priority = PRI(owl);
 
+		/* And the runs better be where the index says they are */
+		assert(owl->bucket >= bucket);
+		if(owl->bucket != bucket) {
+			for(bucket++; bucket < owl->bucket; bucket++) {
+				assert(bucketBottom[bucket] == NULL);
+				assert(bucketTop[bucket] == NULL);
+			}
+			assert(bucketBottom[bucket] == owl);
+		}
+		if(owl->above == NULL || owl->above->bucket != bucket) {
+			assert(bucketTop[bucket] == owl);
+		}
+		assert(!owl->restack);
+
 #if DEBUG_OTP
 
 		fprintf(stderr, "checking owl: pri %d w=%x stack=%d",
 		        priority, (unsigned int)WindowOfOwl(owl), stack);
 		if(twm_win) {
-			fprintf(stderr, " title=%s occupation=%x ",
+			fprintf(stderr, " title=%s occupation=%lx... ",
 			        twm_win->name,
-			        (unsigned int)twm_win->occupation);
+			        twm_win->occupation.w[0]);
 			if(owl->twm_win->vs) {
 				fprintf(stderr, " vs:(x,y)=(%d,%d)",
 				        twm_win->vs->x,
@@ -282,6 +329,7 @@ static bool OtpCheckConsistencyVS(VirtualScreen *currentvs, Window vroot)
 			nwins++;
 		}
 
+#if CHECK_OTP_XSTACK
 		if(twm_win->winbox) {
 			/*
 			 * We can't check windows in a WindowBox, since they are
@@ -326,9 +374,16 @@ static bool OtpCheckConsistencyVS(VirtualScreen *currentvs, Window vroot)
 			while(windowOfOwl != children[stack]);
 #endif /* DEBUG_OTP */
 		}
+#endif /* CHECK_OTP_XSTACK */
+	}
+	for(bucket++; bucket <= OTP_MAX; bucket++) {
+		assert(bucketBottom[bucket] == NULL);
+		assert(bucketTop[bucket] == NULL);
 	}
 
+#if CHECK_OTP_XSTACK
 	XFree(children);
+#endif
 
 	/* by decrementing nwins, check that all the wins are in our list */
 	for(twm_win = Scr->FirstWindow; twm_win != NULL; twm_win = twm_win->next) {
@@ -343,6 +398,21 @@ static bool OtpCheckConsistencyVS(VirtualScreen *currentvs, Window vroot)
 
 static void RemoveOwl(OtpWinList *owl)
 {
+	int b = owl->bucket;
+
+	/* Pull it out of its run */
+	if(bucketTop[b] == owl) {
+		if(bucketBottom[b] == owl) {
+			bucketBottom[b] = bucketTop[b] = NULL;
+		}
+		else {
+			bucketTop[b] = owl->below;
+		}
+	}
+	else if(bucketBottom[b] == owl) {
+		bucketBottom[b] = owl->above;
+	}
+
 	if(owl->above != NULL) {
 		owl->above->below = owl->below;
 	}
@@ -357,20 +427,222 @@ static void RemoveOwl(OtpWinList *owl)
 }
 
 
-/**
- * For the purpose of putting a window above another,
- * they need to have the same parent, i.e. be in the same
- * VirtualScreen.
+/*
+ * Give a newly linked owl a stackpos between its neighbors'.  We leave
+ * gaps so that usually there's room; when there isn't, renumber the
+ * whole list evenly.  That lets other code put a bunch of windows in
+ * stacking order without walking the whole list.
  */
-static OtpWinList *GetOwlAtOrBelowInVS(OtpWinList *owl, VirtualScreen *vs)
+static void SetStackPos(OtpWinList *owl)
 {
-	while(owl != NULL && owl->twm_win->parent_vs != vs) {
-		owl = owl->below;
+	const unsigned long lo = (owl->below != NULL) ? owl->below->stackpos : 0;
+	const unsigned long hi = (owl->above != NULL) ? owl->above->stackpos
+	                         : ULONG_MAX;
+	unsigned long n = 0, step;
+
+	if(hi > lo && hi - lo >= 2) {
+		owl->stackpos = lo + (hi - lo) / 2;
+		return;
 	}
 
-	return owl;
+	for(OtpWinList *o = bottomOwl; o != NULL; o = o->above) {
+		n++;
+	}
+	step = ULONG_MAX / (n + 1);
+	n = 0;
+	for(OtpWinList *o = bottomOwl; o != NULL; o = o->above) {
+		o->stackpos = ++n * step;
+	}
+}
+
+
+/*
+ * Put owl into the list just above other_owl (or at the very bottom if
+ * that's NULL), and queue it up to be restacked on the server.  It gets
+ * filed in the run for its priority, unless the neighbors it's been put
+ * between say otherwise; the runs always have to stay in order.
+ */
+static void LinkOwlAbove(OtpWinList *owl, OtpWinList *other_owl)
+{
+	OtpWinList *above = (other_owl != NULL) ? other_owl->above : bottomOwl;
+	int b = PRI(owl);
+
+	if(other_owl != NULL && b < other_owl->bucket) {
+		b = other_owl->bucket;
+	}
+	if(above != NULL && b > above->bucket) {
+		b = above->bucket;
+	}
+	owl->bucket = b;
+
+	owl->below = other_owl;
+	owl->above = above;
+	if(above != NULL) {
+		above->below = owl;
+	}
+	if(other_owl != NULL) {
+		other_owl->above = owl;
+	}
+	else {
+		bottomOwl = owl;
+	}
+
+	/* Since the runs are in order, a neighbor has to be in ours */
+	if(bucketBottom[b] == NULL) {
+		bucketBottom[b] = bucketTop[b] = owl;
+	}
+	else {
+		if(other_owl == bucketTop[b]) {
+			bucketTop[b] = owl;
+		}
+		if(above == bucketBottom[b]) {
+			bucketBottom[b] = owl;
+		}
+	}
+
+	SetStackPos(owl);
+
+	if(!owl->restack) {
+		owl->restack = true;
+		owl->restack_next = restackQueue;
+		restackQueue = owl;
+	}
+}
+
+
+/* The topmost thing in the list */
+static OtpWinList *TopOwl(void)
+{
+	for(int b = OTP_MAX; b >= 0; b--) {
+		if(bucketTop[b] != NULL) {
+			return bucketTop[b];
+		}
+	}
+	return NULL;
+}
+
+
+/*
+ * Are these two stacked as siblings on the server?  That is, in the same
+ * WindowBox, or if not in one, on the same VirtualScreen.
+ */
+static bool SameStack(OtpWinList *owl, OtpWinList *other_owl)
+{
+	TwmWindow *twm_win = owl->twm_win;
+	TwmWindow *other_win = other_owl->twm_win;
+
+	if(twm_win->winbox != NULL || other_win->winbox != NULL) {
+		return (twm_win->winbox == other_win->winbox);
+	}
+	return (twm_win->parent_vs == other_win->parent_vs);
+}
+
+
+/*
+ * Tell the server about everything that's moved in the list since last
+ * time.  For each set of siblings with something queued, we take the
+ * stretch from the highest moved window to the lowest, and hand it to
+ * XRestackWindows() in one go, headed by the unmoved window just above
+ * it.  If nothing is above it, we instead put the top of the stretch
+ * right over the unmoved window just below it, and stack the rest under
+ * that.
+ */
+static void RestackPending(void)
+{
+	while(restackQueue != NULL) {
+		OtpWinList *first = restackQueue;
+		OtpWinList *owl, *top, *bot, *over, *under, **qp;
+		Window *wins;
+		int nwins;
+
+		/* Find the stretch of this stack that moved */
+		top = bot = over = under = NULL;
+		nwins = 0;
+		for(owl = TopOwl(); owl != NULL; owl = owl->below) {
+			if(!SameStack(owl, first)) {
+				continue;
+			}
+			if(owl->restack) {
+				if(top == NULL) {
+					top = owl;
+					nwins = 0;
+				}
+				bot = owl;
+				under = NULL;
+			}
+			else if(top == NULL) {
+				over = owl;
+			}
+			else if(under == NULL) {
+				under = owl;
+			}
+			nwins++;
+		}
+		assert(top != NULL);
+
+		/* nwins counted from top on down, so it's plenty; +1 for over */
+		wins = malloc((nwins + 1) * sizeof(Window));
+		if(wins == NULL) {
+			fprintf(stderr, "%s: Out of memory\n", __func__);
+			Done(0);
+		}
+		nwins = 0;
+		if(over != NULL) {
+			wins[nwins++] = WindowOfOwl(over);
+		}
+		for(owl = top; owl != NULL; owl = owl->below) {
+			if(SameStack(owl, first)) {
+				wins[nwins++] = WindowOfOwl(owl);
+			}
+			if(owl == bot) {
+				break;
+			}
+		}
+
+		if(over == NULL && under != NULL) {
+			XWindowChanges xwc;
+
+			xwc.sibling = WindowOfOwl(under);
+			xwc.stack_mode = Above;
+			XConfigureWindow(dpy, wins[0], CWStackMode | CWSibling, &xwc);
+		}
+		if(nwins > 1) {
+			XRestackWindows(dpy, wins, nwins);
+		}
+		free(wins);
+
+		/* Done with everything queued on this stack */
+		for(qp = &restackQueue; *qp != NULL;) {
+			owl = *qp;
+			if(SameStack(owl, first)) {
+				owl->restack = false;
+				*qp = owl->restack_next;
+				owl->restack_next = NULL;
+			}
+			else {
+				qp = &owl->restack_next;
+			}
+		}
+	}
 }
 
+
+/* Drop something from the restack queue; it's going away */
+static void UnqueueRestack(OtpWinList *owl)
+{
+	OtpWinList **qp;
+
+	for(qp = &restackQueue; *qp != NULL; qp = &(*qp)->restack_next) {
+		if(*qp == owl) {
+			*qp = owl->restack_next;
+			break;
+		}
+	}
+	owl->restack = false;
+	owl->restack_next = NULL;
+}
+
+
 /*
  * Windows in a box don't really occur in the stacking order of the
  * root window.
@@ -378,7 +650,7 @@ static OtpWinList *GetOwlAtOrBelowInVS(OtpWinList *owl, VirtualScreen *vs)
  * respective order of course.
  * Therefore we may need to update the owl we're going to be above.
  */
-static OtpWinList *GetOwlAtOrBelowInWinbox(OtpWinList **owlp, WindowBox *wb)
+static void GetOwlAtOrBelowInWinbox(OtpWinList **owlp, WindowBox *wb)
 {
 	OtpWinList *owl = *owlp;
 
@@ -393,7 +665,6 @@ static OtpWinList *GetOwlAtOrBelowInWinbox(OtpWinList **owlp, WindowBox *wb)
 	else {
 		*owlp = owl;
 	}
-	return owl;
 }
 
 
@@ -423,63 +694,22 @@ static void InsertOwlAbove(OtpWinList *owl, OtpWinList *other_owl)
 		DPRINTF((stderr, "Bottom-most window overall\n"));
 		/* special case for the lowest window overall */
 		assert(PRI(owl) <= PRI(bottomOwl));
-
-		/* pass the action to the Xserver */
-		XLowerWindow(dpy, WindowOfOwl(owl));
-
-		/* update the list */
-		owl->above = bottomOwl;
-		owl->above->below = owl;
-		bottomOwl = owl;
 	}
 	else {
 		WindowBox *winbox = owl->twm_win->winbox;
-		OtpWinList *vs_owl;
 
 		if(winbox != NULL) {
-			vs_owl = GetOwlAtOrBelowInWinbox(&other_owl, winbox);
-		}
-		else {
-
-			vs_owl = GetOwlAtOrBelowInVS(other_owl, owl->twm_win->parent_vs);
+			GetOwlAtOrBelowInWinbox(&other_owl, winbox);
 		}
 
 		assert(PRI(owl) >= PRI(other_owl));
 		if(other_owl->above != NULL) {
 			assert(PRI(owl) <= PRI(other_owl->above));
 		}
-
-		if(vs_owl == NULL) {
-			DPRINTF((stderr, "Bottom-most window in VirtualScreen or window box\n"));
-			/* special case for the lowest window in this virtual screen or window box */
-
-			/* pass the action to the Xserver */
-			XLowerWindow(dpy, WindowOfOwl(owl));
-		}
-		else {
-			XWindowChanges xwc;
-			int xwcm;
-
-			DPRINTF((stderr, "General case\n"));
-			/* general case */
-			assert(PRI(vs_owl) <= PRI(other_owl));
-			assert(owl->twm_win->parent_vs == vs_owl->twm_win->parent_vs);
-
-			/* pass the action to the Xserver */
-			xwcm = CWStackMode | CWSibling;
-			xwc.sibling = WindowOfOwl(vs_owl);
-			xwc.stack_mode = Above;
-			XConfigureWindow(dpy, WindowOfOwl(owl), xwcm, &xwc);
-		}
-
-		/* update the list */
-		owl->below = other_owl;
-		owl->above = other_owl->above;
-		owl->below->above = owl;
-		if(owl->above != NULL) {
-			owl->above->below = owl;
-		}
 	}
+
+	/* update the list; the server hears about it in RestackPending() */
+	LinkOwlAbove(owl, other_owl);
 }
 
 
@@ -513,27 +743,15 @@ static void RaiseSmallTransientsOfAbove(OtpWinList *owl, OtpWinList *other_owl)
 }
 
 
+/* The topmost owl of lower priority than given, or NULL if none */
 static OtpWinList *OwlRightBelow(int priority)
 {
-	OtpWinList *owl1, *owl2;
-
-	/* in case there isn't anything below */
-	if(priority <= PRI(bottomOwl)) {
-		return NULL;
-	}
-
-	for(owl1 = bottomOwl, owl2 = owl1->above;
-	                (owl2 != NULL) && (PRI(owl2) < priority);
-	                owl1 = owl2, owl2 = owl2->above) {
-		/* nada */;
+	for(int b = MIN(priority, OTP_MAX + 1) - 1; b >= 0; b--) {
+		if(bucketTop[b] != NULL) {
+			return bucketTop[b];
+		}
 	}
-
-	assert(owl2 == owl1->above);
-	assert(PRI(owl1) < priority);
-	assert((owl2 == NULL) || (PRI(owl2) >= priority));
-
-
-	return owl1;
+	return NULL;
 }
 
 static void InsertOwl(OtpWinList *owl, int where)
@@ -553,7 +771,7 @@ static void InsertOwl(OtpWinList *owl, int where)
 
 	if(bottomOwl == NULL) {
 		/* for the first window: just insert it in the list */
-		bottomOwl = owl;
+		LinkOwlAbove(owl, NULL);
 	}
 	else {
 		other_owl = OwlRightBelow(priority + 1);
@@ -612,12 +830,11 @@ static void TryToMoveTransientsOfTo(OtpWinList *owl, int priority, int where)
 	 * We start looking for transients of owl at the bottom of its OTP
 	 * layer.
 	 */
-	other_owl = OwlRightBelow(PRI(owl));
-	other_owl = (other_owl == NULL) ? bottomOwl : other_owl->above;
-	assert(PRI(other_owl) >= PRI(owl));
+	other_owl = bucketBottom[owl->bucket];
+	assert(other_owl != NULL);
 
 	/* !beware! we're changing the list as we scan it, hence the tmp_owl */
-	while((other_owl != NULL) && (PRI(other_owl) == PRI(owl))) {
+	while((other_owl != NULL) && (other_owl->bucket == owl->bucket)) {
 		OtpWinList *tmp_owl = other_owl->above;
 		if((other_owl->type == WinWin)
 		                && isTransientOf(other_owl->twm_win, owl->twm_win)) {
@@ -745,6 +962,7 @@ void OtpRaise(TwmWindow *twm_win, WinType wintype)
 
 	RaiseOwl(owl);
 
+	RestackPending();
 	OtpCheckConsistency();
 #ifdef EWMH
 	EwmhSet_NET_CLIENT_LIST_STACKING();
@@ -759,6 +977,7 @@ void OtpLower(TwmWindow *twm_win, WinType wintype)
 
 	LowerOwl(owl);
 
+	RestackPending();
 	OtpCheckConsistency();
 #ifdef EWMH
 	EwmhSet_NET_CLIENT_LIST_STACKING();
@@ -773,6 +992,7 @@ void OtpRaiseLower(TwmWindow *twm_win, WinType wintype)
 
 	RaiseLowerOwl(owl);
 
+	RestackPending();
 	OtpCheckConsistency();
 #ifdef EWMH
 	EwmhSet_NET_CLIENT_LIST_STACKING();
@@ -787,6 +1007,7 @@ void OtpTinyRaise(TwmWindow *twm_win, WinType wintype)
 
 	TinyRaiseOwl(owl);
 
+	RestackPending();
 	OtpCheckConsistency();
 #ifdef EWMH
 	EwmhSet_NET_CLIENT_LIST_STACKING();
@@ -801,6 +1022,7 @@ void OtpTinyLower(TwmWindow *twm_win, WinType wintype)
 
 	TinyLowerOwl(owl);
 
+	RestackPending();
 	OtpCheckConsistency();
 #ifdef EWMH
 	EwmhSet_NET_CLIENT_LIST_STACKING();
@@ -889,6 +1111,7 @@ void OtpSetPriority(TwmWindow *twm_win, WinType wintype, int new_pri, int where)
 		SetOwlPriority(owl, priority, where);
 	}
 
+	RestackPending();
 	OtpCheckConsistency();
 }
 
@@ -908,6 +1131,7 @@ void OtpChangePriority(TwmWindow *twm_win, WinType wintype, int relpriority)
 	TryToMoveTransientsOfTo(owl, priority, where);
 	SetOwlPriority(owl, priority, where);
 
+	RestackPending();
 	OtpCheckConsistency();
 }
 
@@ -928,6 +1152,7 @@ void OtpSwitchPriority(TwmWindow *twm_win, WinType wintype)
 	TryToMoveTransientsOfTo(owl, priority, where);
 	SetOwlPriority(owl, priority, where);
 
+	RestackPending();
 	OtpCheckConsistency();
 }
 
@@ -943,6 +1168,7 @@ void OtpToggleSwitching(TwmWindow *twm_win, WinType wintype)
 
 	owl->switching = !owl->switching;
 
+	RestackPending();
 	OtpCheckConsistency();
 }
 
@@ -987,6 +1213,7 @@ void OtpForcePlacement(TwmWindow *twm_win, int where, TwmWindow *other_win)
 	}
 	InsertOwlAbove(owl, other_owl);
 
+	RestackPending();
 	OtpCheckConsistency();
 }
 
@@ -1049,6 +1276,7 @@ void OtpRecomputePrefs(TwmWindow *twm_win)
 		RecomputeOwlPrefs(Scr->IconOTP, twm_win->icon->otp);
 	}
 
+	RestackPending();
 	OtpCheckConsistency();
 }
 
@@ -1069,9 +1297,13 @@ void OtpRemove(TwmWindow *twm_win, WinType wintype)
 	assert(*owlp != NULL);
 
 	RemoveOwl(*owlp);
+	if((*owlp)->restack) {
+		UnqueueRestack(*owlp);
+	}
 	free_OtpWinList(*owlp);
 	*owlp = NULL;
 
+	RestackPending();
 	OtpCheckConsistency();
 }
 
@@ -1090,6 +1322,9 @@ static OtpWinList *new_OtpWinList(TwmWindow *twm_win,
 	owl->switching = switching;
 	owl->pri_base = priority;
 	owl->pri_aflags = 0;
+	owl->bucket = 0;
+	owl->restack = false;
+	owl->restack_next = NULL;
 
 	/*
 	 * We never need to stash anything for icons, they don't persist
@@ -1221,6 +1456,7 @@ void OtpAdd(TwmWindow *twm_win, WinType wintype)
 	*owlp = AddNewOwl(twm_win, wintype, parent);
 
 	assert(*owlp != NULL);
+	RestackPending();
 	OtpCheckConsistency();
 }
 
@@ -1356,6 +1592,7 @@ int ReparentWindow(Display *display, TwmWindow *twm_win, WinType wintype,
 	   and enforces priority settings. */
 	RemoveOwl(owl);
 	InsertOwlAbove(owl, other);
+	RestackPending();
 	OtpCheckConsistency();
 	return result;
 }
@@ -1394,6 +1631,7 @@ ReparentWindowAndIcon(Display *display, TwmWindow *twm_win,
 		InsertOwlAbove(icon_owl, below_icon);
 		InsertOwlAbove(win_owl, below_win);
 	}
+	RestackPending();
 	OtpCheckConsistency();
 	return;
 }
@@ -1410,14 +1648,11 @@ TwmWindow *OtpBottomWin()
 
 TwmWindow *OtpTopWin()
 {
-	OtpWinList *owl = bottomOwl, *top = NULL;
-	while(owl) {
-		if(owl->type == WinWin) {
-			top = owl;
-		}
-		owl = owl->above;
+	OtpWinList *owl = TopOwl();
+	while(owl && owl->type != WinWin) {
+		owl = owl->below;
 	}
-	return top ? top->twm_win : NULL;
+	return owl ? owl->twm_win : NULL;
 }
 
 TwmWindow *OtpNextWinUp(TwmWindow *twm_win)
@@ -1540,8 +1775,9 @@ OwlGetStashedAflags(OtpWinList *owl, bool *gotit)
 	unsigned long nitems, d_after;
 	unsigned long aflags, *aflags_p;
 
-	/* Only on real windows */
-	if(owl->type != WinWin) {
+	/* Only on real windows, and only if it's there */
+	if(owl->type != WinWin
+	                || !WinMayHaveProp(owl->twm_win->w, XA_CTWM_OTP_AFLAGS)) {
 		*gotit = false;
 		return 0;
 	}
@@ -1576,6 +1812,7 @@ OtpRestackWindow(TwmWindow *twm_win)
 
 	RemoveOwl(owl);
 	InsertOwl(owl, Above);
+	RestackPending();
 	OtpCheckConsistency();
 }
 
@@ -1652,6 +1889,24 @@ OwlEffectivePriority(OtpWinList *owl)
 }
 
 
+/*
+ * Where a window is in the stack, as a number that's bigger the higher
+ * up it is.  The numbers themselves mean nothing, and change as things
+ * get restacked; they're only good for comparing against each other
+ * until the next change.
+ */
+unsigned long
+OtpStackingPosition(TwmWindow *twm_win)
+{
+	assert(twm_win != NULL);
+
+	if(twm_win->otp == NULL) {
+		return 0;
+	}
+	return twm_win->otp->stackpos;
+}
+
+
 /*
  * Does the priority of a window depend on its focus state?  External
  * code needs to know, to know when it might need restacking.
@@ -126,6 +126,8 @@ typedef struct _TwmKeyword {
 #define kw0_NoRestartPreviousState      74
 #define kw0_NoDecorateTransients        75
 #define kw0_GrabServer                  76
+#define kw0_SmartPlacement              77
+#define kw0_UsePixmapWMap               78
 
 #define kws_UsePPosition                1
 #define kws_IconFont                    2
@@ -189,6 +191,9 @@ typedef struct _TwmKeyword {
 #define kwn_BorderLeft                  35
 #define kwn_BorderRight                 36
 
+#define kwn_ImageCacheSize              37
+#define kwn_TitleUpdateRate             38
+
 #define kwcl_BorderColor                1
 #define kwcl_IconManagerHighlight       2
 #define kwcl_BorderTileForeground       3
@@ -316,6 +321,7 @@ static const TwmKeyword keytable[] = {
 	{ "ignorelockmodifier",     KEYWORD, kw0_IgnoreLockModifier },
 	{ "ignoremodifier",         IGNOREMODIFIER, 0 },
 	{ "ignoretransient",        IGNORE_TRANSIENT, 0 },
+	{ "imagecachesize",         NKEYWORD, kwn_ImageCacheSize },
 	{ "interpolatemenucolors",  KEYWORD, kw0_InterpolateMenuColors },
 	{ "l",                      LOCK, 0 },
 	{ "left",                   SIJENUM, SIJ_LEFT },
@@ -414,6 +420,7 @@ static const TwmKeyword keytable[] = {
 	{ "showworkspacemanager",   KEYWORD, kw0_ShowWorkspaceManager },
 	{ "shrinkicontitles",       KEYWORD, kw0_ShrinkIconTitles },
 	{ "sloppyfocus",            KEYWORD, kw0_SloppyFocus },
+	{ "smartplacement",         KEYWORD, kw0_SmartPlacement },
 	{ "sorticonmanager",        KEYWORD, kw0_SortIconManager },
 	{ "soundhost",              SKEYWORD, kws_SoundHost },
 	{ "south",                  GRAVITY, GRAV_SOUTH },
@@ -436,10 +443,12 @@ static const TwmKeyword keytable[] = {
 	{ "titlejustification",     SKEYWORD, kws_TitleJustification },
 	{ "titlepadding",           NKEYWORD, kwn_TitlePadding },
 	{ "titleshadowdepth",       NKEYWORD, kwn_TitleShadowDepth },
+	{ "titleupdaterate",        NKEYWORD, kwn_TitleUpdateRate },
 	{ "transienthasoccupation", KEYWORD, kw0_TransientHasOccupation },
 	{ "transientontop",         NKEYWORD, kwn_TransientOnTop },
 	{ "unknownicon",            SKEYWORD, kws_UnknownIcon },
 	{ "unmapbymovingfaraway",   UNMAPBYMOVINGFARAWAY, 0 },
+	{ "usepixmapwmap",          KEYWORD, kw0_UsePixmapWMap },
 	{ "usepposition",           SKEYWORD, kws_UsePPosition },
 	{ "usesunktitlepixmap",     KEYWORD, kw0_UseSunkTitlePixmap },
 	{ "usethreedborders",       KEYWORD, kw0_Use3DBorders },
@@ -610,6 +619,10 @@ do_single_keyword(int keyword)
 			Scr->NoGrabServer = false;
 			return true;
 
+		case kw0_SmartPlacement:
+			Scr->SmartPlacement = true;
+			return true;
+
 		case kw0_NoGrabServer:
 			Scr->NoGrabServer = true;
 			return true;
@@ -740,6 +753,10 @@ do_single_keyword(int keyword)
 			Scr->use3Dwmap = true;
 			return true;
 
+		case kw0_UsePixmapWMap:
+			Scr->usePixmapWmap = true;
+			return true;
+
 		case kw0_SunkFocusWindowTitle:
 			Scr->SunkFocusWindowTitle = true;
 			return true;
@@ -1430,6 +1447,22 @@ do_number_keyword(int keyword, int num)
 			}
 			return true;
 
+		case kwn_ImageCacheSize:
+			if(Scr->FirstTime) {
+				Scr->ImageCacheSize = num;
+			}
+			if(Scr->ImageCacheSize < 0) {
+				Scr->ImageCacheSize = 0;
+			}
+			return true;
+
+		case kwn_TitleUpdateRate:
+			Scr->TitleUpdateRate = num;
+			if(Scr->TitleUpdateRate < 0) {
+				Scr->TitleUpdateRate = 0;
+			}
+			return true;
+
 
 	}
 
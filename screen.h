@@ -109,7 +109,7 @@ struct ScreenInfo {
 	Colormap WelcomeCmap;
 	Visual  *WelcomeVisual;
 
-	name_list *ImageCache;      /* list of pixmaps */
+	ImageCache *ImageCache;     /* cache of loaded images */
 	TitlebarPixmaps tbpm;       /* titlebar pixmaps */
 	Image *UnknownImage;        /* the unknown icon pixmap */
 	Pixmap siconifyPm;          /* the icon manager iconify pixmap */
@@ -227,6 +227,7 @@ struct ScreenInfo {
 	bool        use3Diconmanagers;
 	bool        use3Dborders;
 	bool        use3Dwmap;
+	bool        usePixmapWmap;
 	bool        use3Diconborders;
 	bool        SunkFocusWindowTitle;
 	short       WMgrVertButtonIndent;
@@ -373,6 +374,7 @@ struct ScreenInfo {
 	bool  BackingStore;         /* use backing store for menus */
 	bool  SaveUnder;            /* use save under's for menus */
 	RandPlac RandomPlacement;   /* randomly place windows that no give hints */
+	bool  SmartPlacement;       /* place them where they overlap least */
 	short RandomDisplacementX;  /* randomly displace by this much horizontally */
 	short RandomDisplacementY;  /* randomly displace by this much vertically */
 	bool  OpaqueMove;           /* move the window rather than outline */
@@ -407,6 +409,8 @@ struct ScreenInfo {
 	bool  WarpRingAnyWhere;     /* warp to ring even if window is not visible */
 	bool  ShortAllWindowsMenus; /* Eliminates Icon and Workspace Managers */
 	short OpenWindowTimeout;    /* Timeout when a window tries to open */
+	int   ImageCacheSize;       /* KB of unused images to keep around */
+	int   TitleUpdateRate;      /* most name changes/sec per window, or 0 */
 	bool  RaiseWhenAutoUnSqueeze;
 	bool  RaiseOnClick;         /* Raise a window when clieked into */
 	short RaiseOnClickButton;           /* Raise a window when clieked into */
@@ -422,7 +426,9 @@ struct ScreenInfo {
 	name_list *ForceFocusL;
 
 	FuncKey FuncKeyRoot;
+	FuncKey **FuncKeyIndex;     /* FuncKeyRoot by keycode/mods/context */
 	FuncButton FuncButtonRoot;
+	struct BindingGrabs *BindingGrabs;  /* what GrabKeys() et al grab */
 
 #ifdef EWMH
 	Window icccm_Window;        /* ICCCM sections 4.3, 2.8 */
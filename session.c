@@ -67,13 +67,15 @@
 #include <X11/Xatom.h>
 
 #include "ctwm_atoms.h"
+#include "event_sources.h"
 #include "icons.h"
 #include "list.h"
 #include "screen.h"
 #include "session.h"
+#include "win_props.h"
 
 SmcConn smcConn = NULL;
-static XtInputId iceInputId;
+static int iceFd = -1;
 static char *twm_clientId;
 static TWMWinConfigEntry *winConfigHead = NULL;
 static bool sent_save_done = false;
@@ -82,7 +84,11 @@ static void SaveYourselfCB(SmcConn smcCon, SmPointer clientData,
                            int saveType, Bool shutdown, int interactStyle,
                            Bool fast);
 
-#define SAVEFILE_VERSION 2
+/*
+ * 3: occupation is a count of 32-bit pieces, then the pieces, rather
+ *    than a single int
+ */
+#define SAVEFILE_VERSION 3
 
 
 /*===[ Get Client SM_CLIENT_ID ]=============================================*/
@@ -102,6 +108,9 @@ char *GetClientID(Window window)
 	unsigned long bytes_after;
 	Window *prop = NULL;
 
+	if(!WinMayHaveProp(window, XA_WM_CLIENT_LEADER)) {
+		return NULL;
+	}
 	if(XGetWindowProperty(dpy, window, XA_WM_CLIENT_LEADER,
 	                      0L, 1L, False, AnyPropertyType, &actual_type, &actual_format,
 	                      &nitems, &bytes_after, (unsigned char **)&prop) == Success) {
@@ -133,6 +142,9 @@ char *GetWindowRole(Window window)
 {
 	XTextProperty tp;
 
+	if(!WinMayHaveProp(window, XA_WM_WINDOW_ROLE)) {
+		return NULL;
+	}
 	if(XGetTextProperty(dpy, window, &tp, XA_WM_WINDOW_ROLE)) {
 		if(tp.encoding == XA_STRING && tp.format == 8 && tp.nitems != 0) {
 			return ((char *) tp.value);
@@ -277,6 +289,59 @@ static int read_int(FILE *file, int *intp)
 	return 1;
 }
 
+/*---------------------------------------------------------------------------*
+ * Occupation sets go as a byte saying how many 32-bit pieces follow, then
+ * the pieces, lowest workspaces first.
+ */
+
+#define OCC_PIECES ((MAXWORKSPACE + 31) / 32)
+
+static int write_occupation(FILE *file, const Occupation *occ)
+{
+	if(!write_byte(file, OCC_PIECES)) {
+		return 0;
+	}
+	for(int p = 0; p < OCC_PIECES; p++) {
+		unsigned int piece = 0;
+		for(int b = 0; b < 32; b++) {
+			if(OccTest(occ, p * 32 + b)) {
+				piece |= 1U << b;
+			}
+		}
+		if(!write_int(file, piece)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static int read_occupation(FILE *file, unsigned short version,
+                           Occupation *occ)
+{
+	unsigned char npieces = 1;
+
+	/* Before version 3, it was just the one */
+	if(version > 2 && !read_byte(file, &npieces)) {
+		return 0;
+	}
+
+	OccClear(occ);
+	for(int p = 0; p < npieces; p++) {
+		int piece;
+		if(!read_int(file, &piece)) {
+			return 0;
+		}
+		for(int b = 0; b < 32 && p * 32 + b < MAXWORKSPACE; b++) {
+			if(piece & (1U << b)) {
+				OccSet(occ, p * 32 + b);
+			}
+		}
+	}
+	return 1;
+}
+
 /*---------------------------------------------------------------------------*/
 
 static int read_counted_string(FILE *file, char **stringp)
@@ -347,7 +412,13 @@ static int read_counted_string(FILE *file, char **stringp)
  *
  * ------------------[ Matthew McNeill Feb 1997 ]----------------------------
  *
- * Workspace Occupation                 4
+ * Workspace Occupation (version 3 and later):
+ *   piece count                        1               (OCC_PIECES)
+ *   For each piece, lowest workspaces first
+ *      occupation bits                 4               (32 workspaces)
+ *
+ * Workspace Occupation (before version 3)
+ *   occupation bits                    4               (32 workspaces)
  *
  */
 
@@ -485,7 +556,7 @@ int WriteWinConfigEntry(FILE *configFile, TwmWindow *theWindow,
 	 * number and is a bit field of the workspaces occupied by the client.
 	 */
 
-	if(!write_int(configFile, theWindow->occupation)) {
+	if(!write_occupation(configFile, &theWindow->occupation)) {
 		return 0;
 	}
 
@@ -607,7 +678,7 @@ int ReadWinConfigEntry(FILE *configFile, unsigned short version,
 	 * correct workspaces.
 	 */
 
-	if(!read_int(configFile, &entry->occupation)) {
+	if(!read_occupation(configFile, version, &entry->occupation)) {
 		goto give_up;
 	}
 
@@ -694,7 +765,7 @@ int GetWindowConfig(TwmWindow *theWindow, short *x, short *y,
                     short *icon_x, short *icon_y,
                     bool *width_ever_changed_by_user,
                     bool *height_ever_changed_by_user,
-                    int *occupation) /* <== [ Matthew McNeill Feb 1997 ] == */
+                    Occupation *occupation) /* <== [ Matthew McNeill Feb 1997 ] == */
 /* This function attempts to extract all the relevant information from the
  * given window and return values via the rest of the parameters to the
  * function
@@ -1064,8 +1135,8 @@ void DieCB(SmcConn smcCon, SmPointer clientData)
  * application shut istelf down
  */
 {
+	EventRemoveFd(iceFd);
 	SmcCloseConnection(smcCon, 0, NULL);
-	XtRemoveInput(iceInputId);
 	Done(0);
 }
 
@@ -1092,7 +1163,7 @@ void ShutdownCancelledCB(SmcConn smcCon, SmPointer clientData)
 
 /*===[ Process ICE Message ]=================================================*/
 
-void ProcessIceMsgProc(XtPointer client_data, int *source, XtInputId *id)
+void ProcessIceMsgProc(int fd, void *client_data)
 
 {
 	IceConn     ice_conn = (IceConn) client_data;
@@ -1149,10 +1220,6 @@ void ConnectToSessionManager(char *previous_id)
 
 	iceConn = SmcGetIceConnection(smcConn);
 
-	iceInputId = XtAppAddInput(
-	                     appContext,
-	                     IceConnectionNumber(iceConn),
-	                     (XtPointer) XtInputReadMask,
-	                     ProcessIceMsgProc,
-	                     (XtPointer) iceConn);
+	iceFd = IceConnectionNumber(iceConn);
+	EventAddFd(iceFd, ProcessIceMsgProc, iceConn);
 }
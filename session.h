@@ -27,13 +27,13 @@ int GetWindowConfig(TwmWindow *theWindow,
                     short *icon_x, short *icon_y,
                     bool *width_ever_changed_by_user,
                     bool *height_ever_changed_by_user,
-                    int *occupation /* <== [ Matthew McNeill Feb 1997 ] == */
+                    Occupation *occupation /* <== [ Matthew McNeill Feb 1997 ] == */
                    );
 void SaveYourselfPhase2CB(SmcConn smcCon, SmPointer clientData);
 void DieCB(SmcConn smcCon, SmPointer clientData);
 void SaveCompleteCB(SmcConn smcCon, SmPointer clientData);
 void ShutdownCancelledCB(SmcConn smcCon, SmPointer clientData);
-void ProcessIceMsgProc(XtPointer client_data, int *source, XtInputId *id);
+void ProcessIceMsgProc(int fd, void *client_data);
 void ConnectToSessionManager(char *previous_id);
 
 #endif /* _CTWM_SESSION_H */
@@ -0,0 +1,163 @@
+/*
+ * Cache of measured text
+ *
+ * The same strings get XmbTextExtents()'d over and over: a window's name
+ * when it's added, again each time the title is drawn, its icon name for
+ * the icon, the icon manager and the WSM map...  And a client that
+ * retitles itself constantly (terminals, browsers) sets off all of those
+ * every time.  Each measurement walks through the fontset's metrics for
+ * every character, so we keep the results around.
+ *
+ * It's a fixed-size table indexed by a hash of the font and string, one
+ * entry per slot; a new string just replaces whatever was in its slot.
+ * So it can't grow without bound, and what's in use keeps getting put
+ * back.  Really long strings aren't worth keeping, and just get measured.
+ */
+
+#include "ctwm.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text_extents.h"
+
+
+#define TE_SLOTS   1024   // Power of 2
+#define TE_MAXLEN  256    // Longest string we bother keeping
+
+typedef struct TextExtentsEnt {
+	XFontSet      font_set;     // NULL if the slot's empty
+	unsigned long hash;
+	int           len;
+	int           size;         // Allocated size of str
+	char          *str;
+	XRectangle    ink;
+	XRectangle    logical;
+} TextExtentsEnt;
+
+static TextExtentsEnt cache[TE_SLOTS];
+
+static struct {
+	unsigned long hits, misses, replaced, uncached;
+} stats;
+
+
+static unsigned long
+te_hash(XFontSet fs, const char *str, int len)
+{
+	/* FNV-1a, starting from the font */
+	unsigned long h = 2166136261UL ^ (unsigned long)(uintptr_t)fs;
+
+	for(int i = 0 ; i < len ; i++) {
+		h ^= (unsigned char)str[i];
+		h *= 16777619UL;
+	}
+	return h;
+}
+
+
+/*
+ * Like XmbTextExtents() on font, but remembering the answer.  Either
+ * rect may be NULL.
+ */
+void
+CachedTextExtents(const MyFont *font, const char *str, int len,
+                  XRectangle *ink_rect, XRectangle *logical_rect)
+{
+	XFontSet fs = font->font_set;
+	unsigned long hash;
+	TextExtentsEnt *ent;
+	XRectangle ink, logical;
+
+	if(len > TE_MAXLEN) {
+		stats.uncached++;
+		XmbTextExtents(fs, str, len, ink_rect, logical_rect);
+		return;
+	}
+
+	hash = te_hash(fs, str, len);
+	ent = &cache[hash & (TE_SLOTS - 1)];
+	if(ent->font_set == fs && ent->hash == hash && ent->len == len
+	                && memcmp(ent->str, str, len) == 0) {
+		stats.hits++;
+		if(ink_rect) {
+			*ink_rect = ent->ink;
+		}
+		if(logical_rect) {
+			*logical_rect = ent->logical;
+		}
+		return;
+	}
+
+	/* Not there; measure it, and it takes over the slot */
+	stats.misses++;
+	XmbTextExtents(fs, str, len, &ink, &logical);
+	if(ink_rect) {
+		*ink_rect = ink;
+	}
+	if(logical_rect) {
+		*logical_rect = logical;
+	}
+
+	if(ent->font_set != NULL) {
+		stats.replaced++;
+	}
+	if(ent->str == NULL || ent->size < len) {
+		const int nsize = len > 32 ? len : 32;
+		char *nstr = realloc(ent->str, nsize);
+		if(nstr == NULL) {
+			/* We measured it anyway, so no need to go dying */
+			ent->font_set = NULL;
+			return;
+		}
+		ent->str  = nstr;
+		ent->size = nsize;
+	}
+	memcpy(ent->str, str, len);
+	ent->font_set = fs;
+	ent->hash     = hash;
+	ent->len      = len;
+	ent->ink      = ink;
+	ent->logical  = logical;
+}
+
+
+/*
+ * A fontset is going away; anything measured in it is no good (its
+ * address could well get reused for the next one).
+ */
+void
+TextExtentsForgetFont(XFontSet fs)
+{
+	for(int i = 0 ; i < TE_SLOTS ; i++) {
+		if(cache[i].font_set == fs) {
+			cache[i].font_set = NULL;
+		}
+	}
+}
+
+
+/*
+ * How it's doing, for f.dumpstats.
+ */
+void
+TextExtentsStatsDump(FILE *f)
+{
+	const unsigned long lookups = stats.hits + stats.misses;
+	int used = 0;
+
+	for(int i = 0 ; i < TE_SLOTS ; i++) {
+		if(cache[i].font_set != NULL) {
+			used++;
+		}
+	}
+
+	fprintf(f, "%s: text extents cache: %lu hits, %lu misses (%.1f%% hit), "
+	        "%lu replaced, %lu too long; %d/%d slots used\n", ProgramName,
+	        stats.hits, stats.misses,
+	        lookups ? 100.0 * stats.hits / lookups : 0.0,
+	        stats.replaced, stats.uncached, used, TE_SLOTS);
+	fflush(f);
+}
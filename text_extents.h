@@ -0,0 +1,14 @@
+/*
+ * Cache of measured text
+ */
+#ifndef _CTWM_TEXT_EXTENTS_H
+#define _CTWM_TEXT_EXTENTS_H
+
+#include <stdio.h>    // for FILE
+
+void CachedTextExtents(const MyFont *font, const char *str, int len,
+                       XRectangle *ink_rect, XRectangle *logical_rect);
+void TextExtentsForgetFont(XFontSet fs);
+void TextExtentsStatsDump(FILE *f);
+
+#endif /* _CTWM_TEXT_EXTENTS_H */
@@ -45,8 +45,12 @@ typedef struct WindowBox WindowBox;
 typedef struct TwmWindow TwmWindow;
 typedef struct TWMWinConfigEntry TWMWinConfigEntry;
 
+/* From frame_index.h */
+typedef struct FrameIndex FrameIndex;
+
 /* From image.h */
 typedef struct Image Image;
+typedef struct ImageCache ImageCache;
 
 /* From vscreen.h */
 typedef struct VirtualScreen VirtualScreen;
@@ -61,6 +65,7 @@ typedef struct WorkSpaceWindow WorkSpaceWindow;
 
 /* From occupation.h */
 typedef struct OccupyWindow OccupyWindow;
+typedef struct WorkSpaceMember WorkSpaceMember;
 
 /* From otp.h */
 typedef struct OtpWinList OtpWinList;
@@ -50,6 +50,7 @@
 #include "image.h"
 #include "screen.h"
 #include "util.h"
+#include "text_extents.h"
 #include "vscreen.h"
 #include "win_decorations.h"
 #include "win_resize.h"
@@ -287,6 +288,7 @@ void GetFont(MyFont *font)
 	char *basename2;
 
 	if(font->font_set != NULL) {
+		TextExtentsForgetFont(font->font_set);
 		XFreeFontSet(dpy, font->font_set);
 	}
 
@@ -11,6 +11,7 @@
 
 #include "ctwm_atoms.h"
 #include "cursor.h"
+#include "frame_index.h"
 #include "icons.h"
 #include "list.h"
 #include "otp.h"
@@ -19,7 +20,6 @@
 #include "win_utils.h"
 
 
-static void DisplayWinUnchecked(VirtualScreen *vs, TwmWindow *tmp_win);
 
 
 void InitVirtualScreens(ScreenInfo *scr)
@@ -42,6 +42,7 @@ void InitVirtualScreens(ScreenInfo *scr)
 			vs->w      = scr->rootw;
 			vs->h      = scr->rooth;
 			vs->window = scr->Root;
+			vs->frameindex = NULL;
 			vs->next   = NULL;
 			vs->wsw    = 0;
 			scr->vScreenList = vs;
@@ -52,6 +53,11 @@ void InitVirtualScreens(ScreenInfo *scr)
 		else {
 			scr->VirtualScreens = malloc(sizeof(name_list));
 			scr->VirtualScreens->next = NULL;
+			scr->VirtualScreens->matcher = NULL;
+			scr->VirtualScreens->nomatcher = false;
+#ifdef USE_SYS_REGEX
+			scr->VirtualScreens->re_valid = false;
+#endif
 			asprintf(&scr->VirtualScreens->name, "%dx%d+0+0",
 			         scr->rootw, scr->rooth);
 		}
@@ -90,6 +96,7 @@ void InitVirtualScreens(ScreenInfo *scr)
 		                           0, CopyFromParent, CopyFromParent,
 		                           CopyFromParent, valuemask, &attributes);
 		vs->wsw = 0;
+		vs->frameindex = NULL;
 
 		XSync(dpy, 0);
 		XMapWindow(dpy, vs->window);
@@ -229,7 +236,12 @@ DisplayWin(VirtualScreen *vs, TwmWindow *tmp_win)
 	OtpCheckConsistency();
 }
 
-static void
+/*
+ * The same, without checking the OTP stacking before and after; for
+ * callers displaying a bunch of windows at once, to check just once
+ * themselves.
+ */
+void
 DisplayWinUnchecked(VirtualScreen *vs, TwmWindow *tmp_win)
 {
 	/*
@@ -242,6 +254,7 @@ DisplayWinUnchecked(VirtualScreen *vs, TwmWindow *tmp_win)
 
 	/* This is where we're moving it */
 	tmp_win->vs = vs;
+	FrameIndexUpdate(tmp_win);
 
 
 	/* If it's unmapped, RFAI() moves the necessary bits here */
@@ -395,4 +408,5 @@ Vanish(VirtualScreen *vs, TwmWindow *tmp_win)
 
 	/* Currently displayed nowhere */
 	tmp_win->vs = NULL;
+	FrameIndexUpdate(tmp_win);
 }
@@ -9,6 +9,7 @@ struct VirtualScreen {
 	Window window;
 	/* Boolean main; */
 	struct WorkSpaceWindow *wsw;
+	FrameIndex *frameindex;       /* frames displayed here */
 	struct VirtualScreen *next;
 };
 
@@ -20,6 +21,7 @@ bool CtwmSetVScreenMap(Display *display, Window rootw,
                        struct VirtualScreen *firstvs);
 
 void DisplayWin(VirtualScreen *vs, TwmWindow *tmp_win);
+void DisplayWinUnchecked(VirtualScreen *vs, TwmWindow *tmp_win);
 void ReparentFrameAndIcon(TwmWindow *tmp_win);
 void Vanish(VirtualScreen *vs, TwmWindow *tmp_win);
 
@@ -16,7 +16,9 @@
 #include "iconmgr.h"
 #include "screen.h"
 #include "drawing.h"
+#include "frame_index.h"
 #include "occupation.h"
+#include "text_extents.h"
 #include "win_utils.h"
 #include "workspace_manager.h"
 
@@ -326,6 +328,7 @@ SetupFrame(TwmWindow *tmp_win, int x, int y, int w, int h, int bw,
 		}
 		frame_wc.width = tmp_win->frame_width = w;
 		frame_wc.height = tmp_win->frame_height = h;
+		FrameIndexUpdate(tmp_win);
 
 		/* Move/resize the frame */
 		frame_mask |= (CWX | CWY | CWWidth | CWHeight);
@@ -1057,12 +1060,9 @@ void
 DeleteHighlightWindows(TwmWindow *tmp_win)
 {
 	if(tmp_win->HiliteImage) {
-		if(Scr->HighlightPixmapName) {
-			/*
-			 * Image obtained from GetImage(): it is in a cache
-			 * so we don't need to free it. There will not be multiple
-			 * copies if the same xpm:foo image is requested again.
-			 */
+		if(tmp_win->HiliteImage->cached) {
+			/* Image obtained from GetImage(): give it back to the cache */
+			ReleaseImage(tmp_win->HiliteImage);
 		}
 		else {
 			XFreePixmap(dpy, tmp_win->HiliteImage->pixmap);
@@ -1070,6 +1070,11 @@ DeleteHighlightWindows(TwmWindow *tmp_win)
 		}
 		tmp_win->HiliteImage = NULL;
 	}
+	if(tmp_win->LoliteImage) {
+		/* Only ever from GetImage() */
+		ReleaseImage(tmp_win->LoliteImage);
+		tmp_win->LoliteImage = NULL;
+	}
 }
 
 
@@ -1207,9 +1212,9 @@ PaintTitle(TwmWindow *tmp_win)
 		 * visible in the case of a long enough title.
 		 */
 		len    = strlen(tmp_win->name);
-		XmbTextExtents(Scr->TitleBarFont.font_set,
-		               tmp_win->name, len,
-		               &ink_rect, &logical_rect);
+		CachedTextExtents(&Scr->TitleBarFont,
+		                  tmp_win->name, len,
+		                  &ink_rect, &logical_rect);
 		width  = logical_rect.width;
 		mwidth = tmp_win->title_width  - Scr->TBInfo.titlex -
 		         Scr->TBInfo.rightoff  - Scr->TitlePadding  -
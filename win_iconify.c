@@ -10,6 +10,7 @@
 #include <X11/extensions/shape.h>
 
 #include "events.h"
+#include "frame_index.h"
 #include "functions.h"
 #include "iconmgr.h"
 #include "icons.h"
@@ -102,6 +103,7 @@ Iconify(TwmWindow *tmp_win, int def_x, int def_y)
 	 * cause a transition to the Withdrawn state.
 	 */
 	tmp_win->mapped = false;
+	FrameIndexUpdate(tmp_win);
 
 	if((Scr->IconifyStyle != ICONIFY_NORMAL) && !Scr->WindowMask) {
 		XWindowAttributes winattrs;
@@ -501,6 +503,7 @@ ReMapOne(TwmWindow *t, TwmWindow *leader)
 		XMapWindow(dpy, t->w);
 	}
 	t->mapped = true;
+	FrameIndexUpdate(t);
 	if(false && Scr->Root != Scr->CaptiveRoot) {        /* XXX dubious test */
 		ReparentWindow(dpy, t, WinWin, Scr->Root, t->frame_x, t->frame_y);
 	}
@@ -576,6 +579,7 @@ UnmapTransients(TwmWindow *tmp_win, bool iconify, long eventMask)
 			 * cause a transition to the Withdrawn state.
 			 */
 			t->mapped = false;
+			FrameIndexUpdate(t);
 
 			/*
 			 * Note that here, we're setting masks relative to what we
@@ -0,0 +1,229 @@
+/*
+ * Window -> TwmWindow/ScreenInfo index
+ *
+ * Every event we dispatch needs to know what TwmWindow and screen its
+ * window belongs to, and most of the handlers then want to know which
+ * of that TwmWindow's pieces it was.  This used to be done with Xlib's
+ * XContext's (one lookup each for TwmContext and ScreenContext, plus
+ * MenuContext for exposes), followed by comparisons against every
+ * sub-window.  Instead we keep our own open-addressed hash keyed by the
+ * window XID, which gives all that back in a single probe.
+ *
+ * Entries are stored by value in the table, so pointers returned from
+ * WinIndexFind() are only good until the next WinIndexAdd*() or
+ * WinIndexDel() call.
+ */
+
+#include "ctwm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "win_index.h"
+
+
+/*
+ * Slot states.  XID's never have the top 3 bits set, so an all-ones
+ * value can't collide with a real window.
+ */
+#define WI_EMPTY     ((Window) None)
+#define WI_DELETED   ((Window) ~0UL)
+
+#define WI_MINSIZE   256
+
+static WinRef *wi_table = NULL;
+static unsigned int wi_size  = 0;   // Always a power of 2
+static unsigned int wi_count = 0;   // Live entries
+static unsigned int wi_dead  = 0;   // Tombstones
+
+
+static inline unsigned int
+wi_hash(Window w)
+{
+	uint32_t h = (uint32_t)w;
+
+	/* XID's tend to differ only in the low bits; spread them out */
+	h ^= h >> 16;
+	h *= 0x45d9f3bU;
+	h ^= h >> 16;
+	return h & (wi_size - 1);
+}
+
+
+/*
+ * Find the slot for w.  If it's not there, returns the slot it should be
+ * inserted into (reusing the first tombstone passed).
+ */
+static WinRef *
+wi_slot(Window w)
+{
+	unsigned int i = wi_hash(w);
+	WinRef *tomb = NULL;
+
+	while(1) {
+		WinRef *wr = &wi_table[i];
+
+		if(wr->w == w) {
+			return wr;
+		}
+		if(wr->w == WI_EMPTY) {
+			return tomb ? tomb : wr;
+		}
+		if(wr->w == WI_DELETED && tomb == NULL) {
+			tomb = wr;
+		}
+		i = (i + 1) & (wi_size - 1);
+	}
+
+	/* NOTREACHED */
+}
+
+
+/*
+ * Resize (or just clean out tombstones from) the table.  We keep the
+ * load, counting tombstones, at or below 1/2.
+ */
+static void
+wi_rehash(void)
+{
+	WinRef *old = wi_table;
+	unsigned int oldsize = wi_size;
+	unsigned int nsize = WI_MINSIZE;
+
+	while(nsize < wi_count * 4) {
+		nsize *= 2;
+	}
+
+	wi_table = calloc(nsize, sizeof(WinRef));
+	if(wi_table == NULL) {
+		fprintf(stderr, "unable to allocate %lu bytes for window index\n",
+		        (unsigned long)(nsize * sizeof(WinRef)));
+		Done(0);
+	}
+	wi_size = nsize;
+	wi_dead = 0;
+
+	for(unsigned int i = 0 ; i < oldsize ; i++) {
+		if(old[i].w != WI_EMPTY && old[i].w != WI_DELETED) {
+			*wi_slot(old[i].w) = old[i];
+		}
+	}
+	free(old);
+}
+
+
+/*
+ * Stash info about a window.  Replaces anything we already had for it,
+ * like XSaveContext() would.
+ */
+static WinRef *
+wi_add(Window w, ScreenInfo *scr, WinRole role)
+{
+	WinRef *wr;
+
+	if(w == None) {
+		return NULL;
+	}
+	if(wi_table == NULL || (wi_count + wi_dead + 1) * 2 > wi_size) {
+		wi_rehash();
+	}
+
+	wr = wi_slot(w);
+	if(wr->w == WI_DELETED) {
+		wi_dead--;
+	}
+	if(wr->w != w) {
+		wi_count++;
+	}
+
+	wr->w       = w;
+	wr->role    = role;
+	wr->index   = 0;
+	wr->twm_win = NULL;
+	wr->scr     = scr;
+	wr->menu    = NULL;
+	wr->vs      = NULL;
+	return wr;
+}
+
+
+void
+WinIndexAdd(Window w, ScreenInfo *scr, TwmWindow *twm_win,
+            WinRole role, int index)
+{
+	WinRef *wr = wi_add(w, scr, role);
+
+	if(wr) {
+		wr->twm_win = twm_win;
+		wr->index   = index;
+	}
+}
+
+
+void
+WinIndexAddMenu(Window w, ScreenInfo *scr, MenuRoot *mr)
+{
+	WinRef *wr = wi_add(w, scr, WR_MENU);
+
+	if(wr) {
+		wr->menu = mr;
+	}
+}
+
+
+void
+WinIndexAddWSM(Window w, ScreenInfo *scr, TwmWindow *twm_win,
+               WinRole role, VirtualScreen *vs, int index)
+{
+	WinRef *wr = wi_add(w, scr, role);
+
+	if(wr) {
+		wr->twm_win = twm_win;
+		wr->vs      = vs;
+		wr->index   = index;
+	}
+}
+
+
+/*
+ * Forget about a window.  Quietly does nothing if we didn't know it.
+ */
+void
+WinIndexDel(Window w)
+{
+	WinRef *wr;
+
+	if(wi_table == NULL || w == None) {
+		return;
+	}
+
+	wr = wi_slot(w);
+	if(wr->w != w) {
+		return;
+	}
+	wr->w = WI_DELETED;
+	wr->role = WR_NONE;
+	wi_count--;
+	wi_dead++;
+}
+
+
+/*
+ * Look up what we know about a window, or NULL if nothing.
+ */
+const WinRef *
+WinIndexFind(Window w)
+{
+	WinRef *wr;
+
+	if(wi_table == NULL || w == None) {
+		return NULL;
+	}
+
+	wr = wi_slot(w);
+	if(wr->w != w) {
+		return NULL;
+	}
+	return wr;
+}
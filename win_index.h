@@ -0,0 +1,55 @@
+/*
+ * Window -> TwmWindow/ScreenInfo index
+ */
+#ifndef _CTWM_WIN_INDEX_H
+#define _CTWM_WIN_INDEX_H
+
+
+/*
+ * What part of our world a given X Window is.  This lets event handlers
+ * figure out which sub-window of a TwmWindow an event happened in
+ * without comparing against every one of them.
+ */
+typedef enum {
+	WR_NONE,
+	WR_ROOT,             // A root window; only scr is set
+	WR_CLIENT,           // TwmWindow.w
+	WR_FRAME,            // TwmWindow.frame
+	WR_TITLE,            // TwmWindow.title_w
+	WR_HILITE,           // hilite_w[lr] and lolite_w[lr]
+	WR_TITLEBUTTON,      // titlebuttons[index].window
+	WR_ICON,             // Icon.w
+	WR_ICONMGR_ENTRY,    // WList.w
+	WR_ICONMGR_ICON,     // WList.icon
+	WR_WSMGR_BUTTON,     // WSM button for workspace number index, on vs
+	WR_WSMGR_MAP,        // WSM map subwindow for workspace index, on vs
+	WR_WSMGR_MAPWIN,     // A window's representation in a WSM map, on vs
+	WR_OCCUPY_BUTTON,    // A button in the occupy window
+	WR_MENU,             // MenuRoot.w
+} WinRole;
+
+
+/*
+ * What we know about a given Window.  twm_win is what GetTwmWindow()
+ * returns (and is NULL for root and menu windows).
+ */
+typedef struct WinRef {
+	Window         w;
+	WinRole        role;
+	int            index;    // Role-dependent; e.g., titlebutton number
+	TwmWindow     *twm_win;
+	ScreenInfo    *scr;
+	MenuRoot      *menu;     // WR_MENU
+	VirtualScreen *vs;       // WR_WSMGR_*
+} WinRef;
+
+
+void WinIndexAdd(Window w, ScreenInfo *scr, TwmWindow *twm_win,
+                 WinRole role, int index);
+void WinIndexAddMenu(Window w, ScreenInfo *scr, MenuRoot *mr);
+void WinIndexAddWSM(Window w, ScreenInfo *scr, TwmWindow *twm_win,
+                    WinRole role, VirtualScreen *vs, int index);
+void WinIndexDel(Window w);
+const WinRef *WinIndexFind(Window w);
+
+#endif /* _CTWM_WIN_INDEX_H */
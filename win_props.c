@@ -0,0 +1,88 @@
+/*
+ * Which properties a window has, while we're adopting it
+ *
+ * AddWindow() and the things it calls look at a couple dozen properties
+ * on a new window, one XGetWindowProperty() (or a wrapper around it) at
+ * a time, and each one is a full round trip to the server.  Most
+ * windows only have a handful of them set though; there's rarely any
+ * _MOTIF_WM_HINTS, struts, WM_COLORMAP_WINDOWS, session or occupation
+ * properties.  Over a slow connection, or with a session's worth of
+ * clients mapping at once, waiting on the server to tell us about
+ * things that aren't there adds up.
+ *
+ * So AddWindow() starts by asking for the list of properties the window
+ * has, all in one go, and the property fetchers check here first and
+ * skip asking about anything that isn't on it.  A property set after we
+ * got the list is only noticed if HandlePropertyNotify() follows it
+ * (names, hints, protocols, colormap windows, occupation, icons and
+ * struts); we select for PropertyNotify first, so those get picked up
+ * once the window's been added.  Anything else that turns up in that
+ * window is missed until the next time it's fetched, same as a change
+ * made just after it would have been read.  WM_CLASS, WM_TRANSIENT_FOR
+ * and _MOTIF_WM_HINTS decide too much about how the window gets set up
+ * to risk that, so AddWindow() always asks for those.
+ *
+ * Outside of that, there's no list, and everything just gets fetched.
+ */
+
+#include "ctwm.h"
+
+#include <X11/Xlib.h>
+
+#include "win_props.h"
+
+
+static Window props_win = None;
+static Atom *props;
+static int nprops;
+
+
+/*
+ * Get the list of properties on w.  Good until WinPropsDone().
+ */
+void
+WinPropsLoad(Window w)
+{
+	WinPropsDone();
+
+	/*
+	 * No properties at all gets us NULL, as does the window already
+	 * being gone.  Either way, there's nothing to be found on it.
+	 */
+	props = XListProperties(dpy, w, &nprops);
+	props_win = w;
+}
+
+
+/*
+ * Done adding the window; go back to fetching everything.
+ */
+void
+WinPropsDone(void)
+{
+	if(props != NULL) {
+		XFree(props);
+	}
+	props = NULL;
+	nprops = 0;
+	props_win = None;
+}
+
+
+/*
+ * Is there any point asking the server for prop on w?  Only false if we
+ * know it's not there.
+ */
+bool
+WinMayHaveProp(Window w, Atom prop)
+{
+	if(w != props_win || props_win == None) {
+		return true;
+	}
+	for(int i = 0 ; i < nprops ; i++) {
+		if(props[i] == prop) {
+			return true;
+		}
+	}
+	return false;
+}
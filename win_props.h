@@ -0,0 +1,11 @@
+/*
+ * Which properties a window has, while we're adopting it
+ */
+#ifndef _CTWM_WIN_PROPS_H
+#define _CTWM_WIN_PROPS_H
+
+void WinPropsLoad(Window w);
+void WinPropsDone(void);
+bool WinMayHaveProp(Window w, Atom prop);
+
+#endif /* _CTWM_WIN_PROPS_H */
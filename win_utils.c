@@ -13,11 +13,14 @@
 #include "ctwm_atoms.h"
 #include "drawing.h"
 #include "events.h"
+#include "frame_index.h"
 #include "icons.h"
 #include "screen.h"
 #include "util.h"
 #include "win_decorations.h"
+#include "win_index.h"
 #include "win_ops.h"
+#include "win_props.h"
 #include "win_utils.h"
 #include "workspace_utils.h"
 
@@ -33,7 +36,8 @@ GetWindowSizeHints(TwmWindow *tmp)
 	long supplied = 0;
 	XSizeHints *hints = &tmp->hints;
 
-	if(!XGetWMNormalHints(dpy, tmp->w, hints, &supplied)) {
+	if(!WinMayHaveProp(tmp->w, XA_WM_NORMAL_HINTS)
+	                || !XGetWMNormalHints(dpy, tmp->w, hints, &supplied)) {
 		hints->flags = 0;
 	}
 
@@ -101,7 +105,8 @@ FetchWmProtocols(TwmWindow *tmp)
 	Atom *protocols = NULL;
 	int n;
 
-	if(XGetWMProtocols(dpy, tmp->w, &protocols, &n)) {
+	if(WinMayHaveProp(tmp->w, XA_WM_PROTOCOLS)
+	                && XGetWMProtocols(dpy, tmp->w, &protocols, &n)) {
 		int i;
 		Atom *ap;
 
@@ -171,23 +176,17 @@ GetGravityOffsets(TwmWindow *tmp, int *xp, int *yp)
  * NULL.
  *
  * This is a relatively cheap function since it does not involve
- * communication with the server. Probably faster than walking the list
- * of TwmWindows, since the lookup is by a hash table.
+ * communication with the server.  It's a single probe into the window
+ * index; x-ref win_index.c.
  *
  * Formerly in add_window.c
  */
 TwmWindow *
 GetTwmWindow(Window w)
 {
-	TwmWindow *twmwin;
-	int stat;
+	const WinRef *wr = WinIndexFind(w);
 
-	stat = XFindContext(dpy, w, TwmContext, (XPointer *)&twmwin);
-	if(stat == XCNOENT) {
-		twmwin = NULL;
-	}
-
-	return twmwin;
+	return wr ? wr->twm_win : NULL;
 }
 
 
@@ -214,6 +213,10 @@ GetWMPropertyString(Window w, Atom prop)
 	XTextProperty       text_prop;
 	char                *stringptr;
 
+	if(!WinMayHaveProp(w, prop)) {
+		return NULL;
+	}
+
 	XGetTextProperty(dpy, w, &text_prop, prop);
 	if(text_prop.value != NULL) {
 		char **text_list;
@@ -460,63 +463,138 @@ DisplayPosition(const TwmWindow *_unused_tmp_win, int x, int y)
  *
  * XXX In desperate need of better commenting.
  */
+
+/*
+ * The windows that might be in tmp_win's way in some rectangle, in
+ * Scr->FirstWindow order.  Anything displayed is in the frame index;
+ * if tmp_win isn't, we have to just list them all.  Caller frees.
+ */
+static TwmWindow **
+WindowsNear(TwmWindow *tmp_win, int x, int y, int w, int h, int *nwins)
+{
+	TwmWindow **wins, *t;
+	int n;
+
+	if(visible(tmp_win)) {
+		return FrameIndexFind(tmp_win, x, y, w, h, nwins);
+	}
+
+	n = 0;
+	for(t = Scr->FirstWindow; t != NULL; t = t->next) {
+		n++;
+	}
+	wins = malloc(n * sizeof(TwmWindow *));
+	if(wins == NULL && n > 0) {
+		fprintf(stderr, "%s: Out of memory\n", __func__);
+		Done(0);
+	}
+	n = 0;
+	for(t = Scr->FirstWindow; t != NULL; t = t->next) {
+		wins[n++] = t;
+	}
+	*nwins = n;
+	return wins;
+}
+
+
+/*
+ * Nudge (newx, newy) for tmp_win off of t, if they overlap and it's
+ * within MovePackResistance.
+ */
+static void
+PackAgainst(TwmWindow *tmp_win, TwmWindow *t, int *x, int *y)
+{
+	int         newx = *x;
+	int         newy = *y;
+	int         w, h;
+	int         winw = tmp_win->frame_width  + 2 * tmp_win->frame_bw;
+	int         winh = tmp_win->frame_height + 2 * tmp_win->frame_bw;
+
+	if(t == tmp_win) {
+		return;
+	}
+	if(t->winbox != tmp_win->winbox) {
+		return;
+	}
+	if(t->vs != tmp_win->vs) {
+		return;
+	}
+	if(!t->mapped) {
+		return;
+	}
+
+	w = t->frame_width  + 2 * t->frame_bw;
+	h = t->frame_height + 2 * t->frame_bw;
+	if(newx >= t->frame_x + w) {
+		return;
+	}
+	if(newy >= t->frame_y + h) {
+		return;
+	}
+	if(newx + winw <= t->frame_x) {
+		return;
+	}
+	if(newy + winh <= t->frame_y) {
+		return;
+	}
+
+	if(newx + Scr->MovePackResistance > t->frame_x + w) {  /* left */
+		*x = MAX(newx, t->frame_x + w);
+		return;
+	}
+	if(newx + winw < t->frame_x + Scr->MovePackResistance) {  /* right */
+		*x = MIN(newx, t->frame_x - winw);
+		return;
+	}
+	if(newy + Scr->MovePackResistance > t->frame_y + h) {  /* top */
+		*y = MAX(newy, t->frame_y + h);
+		return;
+	}
+	if(newy + winh < t->frame_y + Scr->MovePackResistance) {  /* bottom */
+		*y = MIN(newy, t->frame_y - winh);
+		return;
+	}
+}
+
+
 void
 TryToPack(TwmWindow *tmp_win, int *x, int *y)
 {
-	TwmWindow   *t;
+	TwmWindow   *t, **near;
 	int         newx, newy;
-	int         w, h;
+	int         i, nnear;
 	int         winw = tmp_win->frame_width  + 2 * tmp_win->frame_bw;
 	int         winh = tmp_win->frame_height + 2 * tmp_win->frame_bw;
+	int         r = MAX(Scr->MovePackResistance, 0);
+	int         qx = *x - r, qy = *y - r;
+	int         qw = winw + 2 * r, qh = winh + 2 * r;
 
+	/*
+	 * Each window we bump into moves us less than the resistance, so
+	 * first look only at what's that close.  As long as we stay in that
+	 * area, nothing else could be in the way.
+	 */
 	newx = *x;
 	newy = *y;
-	for(t = Scr->FirstWindow; t != NULL; t = t->next) {
-		if(t == tmp_win) {
-			continue;
-		}
-		if(t->winbox != tmp_win->winbox) {
-			continue;
-		}
-		if(t->vs != tmp_win->vs) {
-			continue;
-		}
-		if(!t->mapped) {
-			continue;
-		}
-
-		w = t->frame_width  + 2 * t->frame_bw;
-		h = t->frame_height + 2 * t->frame_bw;
-		if(newx >= t->frame_x + w) {
-			continue;
-		}
-		if(newy >= t->frame_y + h) {
-			continue;
-		}
-		if(newx + winw <= t->frame_x) {
-			continue;
-		}
-		if(newy + winh <= t->frame_y) {
-			continue;
+	near = WindowsNear(tmp_win, qx, qy, qw, qh, &nnear);
+	for(i = 0; i < nnear; i++) {
+		PackAgainst(tmp_win, near[i], &newx, &newy);
+		if(newx < qx || newy < qy
+		                || newx + winw > qx + qw || newy + winh > qy + qh) {
+			break;
 		}
+	}
+	free(near);
 
-		if(newx + Scr->MovePackResistance > t->frame_x + w) {  /* left */
-			newx = MAX(newx, t->frame_x + w);
-			continue;
-		}
-		if(newx + winw < t->frame_x + Scr->MovePackResistance) {  /* right */
-			newx = MIN(newx, t->frame_x - winw);
-			continue;
-		}
-		if(newy + Scr->MovePackResistance > t->frame_y + h) {  /* top */
-			newy = MAX(newy, t->frame_y + h);
-			continue;
-		}
-		if(newy + winh < t->frame_y + Scr->MovePackResistance) {  /* bottom */
-			newy = MIN(newy, t->frame_y - winh);
-			continue;
+	if(i < nnear) {
+		/* Bumped out of there; do it the long way */
+		newx = *x;
+		newy = *y;
+		for(t = Scr->FirstWindow; t != NULL; t = t->next) {
+			PackAgainst(tmp_win, t, &newx, &newy);
 		}
 	}
+
 	*x = newx;
 	*y = newy;
 }
@@ -544,14 +622,17 @@ TryToPush(TwmWindow *tmp_win, int x, int y)
 static void
 TryToPush_be(TwmWindow *tmp_win, int x, int y, PushDirection dir)
 {
-	TwmWindow   *t;
+	TwmWindow   *t, **near;
 	int         newx, newy, ndir;
 	bool        move;
+	int         i, nnear;
 	int         w, h;
 	int         winw = tmp_win->frame_width  + 2 * tmp_win->frame_bw;
 	int         winh = tmp_win->frame_height + 2 * tmp_win->frame_bw;
 
-	for(t = Scr->FirstWindow; t != NULL; t = t->next) {
+	near = WindowsNear(tmp_win, x, y, winw, winh, &nnear);
+	for(i = 0; i < nnear; i++) {
+		t = near[i];
 		if(t == tmp_win) {
 			continue;
 		}
@@ -618,6 +699,7 @@ TryToPush_be(TwmWindow *tmp_win, int x, int y, PushDirection dir)
 			SetupWindow(t, newx, newy, t->frame_width, t->frame_height, -1);
 		}
 	}
+	free(near);
 }
 
 
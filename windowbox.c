@@ -30,6 +30,7 @@ name_list **addWindowBox(char *boxname, char *geometry)
 	winbox->name     = strdup(boxname);
 	winbox->geometry = strdup(geometry);
 	winbox->winlist  = NULL;
+	winbox->frameindex = NULL;
 	if(!Scr->FirstWindowBox) {
 		Scr->FirstWindowBox = winbox;
 	}
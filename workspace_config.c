@@ -50,7 +50,7 @@ AddWorkSpace(const char *name, const char *background, const char *foreground,
 	ws->number = Scr->workSpaceMgr.count++;
 
 	/* We're a new entry on the "everything" list */
-	fullOccupation |= (1 << ws->number);
+	OccSet(&fullOccupation, ws->number);
 
 
 	/*
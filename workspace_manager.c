@@ -11,6 +11,7 @@
 #include <X11/Xatom.h>
 
 #include "ctwm_atoms.h"
+#include "text_extents.h"
 #include "util.h"
 #include "animate.h"
 #include "screen.h"
@@ -20,11 +21,13 @@
 #include "cursor.h"
 #include "image.h"
 #include "drawing.h"
+#include "frame_index.h"
 #include "list.h"
 #include "occupation.h"
 #include "vscreen.h"
 #include "win_decorations.h"
 #include "win_iconify.h"
+#include "win_index.h"
 #include "win_ops.h"
 #include "win_utils.h"
 #include "workspace_manager.h"
@@ -43,8 +46,23 @@ static void PaintWorkSpaceManagerBorder(VirtualScreen *vs);
 
 static void wmap_mapwin_backend(TwmWindow *win, bool handleraise);
 
+static void wmap_restack(WorkSpace *ws);
+
 static void WMapRedrawWindow(Window window, int width, int height,
-                             ColorPair cp, const char *label);
+                             ColorPair cp, WinList *wl);
+static void WMapDrawWindow(Drawable d, int x, int y, int width, int height,
+                           ColorPair cp, WinList *wl);
+static ColorPair WMapEntryColors(VirtualScreen *vs, WinList *wl);
+
+static void wmap_resize_buffer(VirtualScreen *vs, MapSubwindow *msw);
+static void wmap_damage(MapSubwindow *msw, int x, int y, int width,
+                        int height);
+static void wmap_damage_entry(MapSubwindow *msw, WinList *wl);
+static void wmap_flush(VirtualScreen *vs, MapSubwindow *msw);
+static void wmap_paint_entry(VirtualScreen *vs, MapSubwindow *msw,
+                             const XRectangle *damage, WinList *wl);
+static WinList *wmap_entry_at(MapSubwindow *msw, int x, int y);
+static void wmap_show_entry(VirtualScreen *vs, WinList *wl, bool shown);
 
 static void InvertColorPair(ColorPair *cp);
 
@@ -228,11 +246,11 @@ CreateWorkSpaceManager(void)
 		/* Setup the background/border on the active workspace */
 		if(Scr->workSpaceMgr.curImage == NULL) {
 			if(Scr->workSpaceMgr.curPaint) {
-				XSetWindowBackground(dpy, msw->w, Scr->workSpaceMgr.curColors.back);
+				WMapSetBackground(vs, ws2, None, Scr->workSpaceMgr.curColors.back);
 			}
 		}
 		else {
-			XSetWindowBackgroundPixmap(dpy, msw->w, Scr->workSpaceMgr.curImage->pixmap);
+			WMapSetBackground(vs, ws2, Scr->workSpaceMgr.curImage->pixmap, 0);
 		}
 		XSetWindowBorder(dpy, msw->w, Scr->workSpaceMgr.curBorderColor);
 		XClearWindow(dpy, msw->w);
@@ -263,8 +281,11 @@ CreateWorkSpaceManager(void)
 	{
 		char *wrkSpcList;
 		int  len;
+		Occupation every;
 
-		len = GetPropertyFromMask(0xFFFFFFFFu, &wrkSpcList);
+		/* Every bit on, so it lists them all rather than saying "all" */
+		memset(&every, 0xff, sizeof(every));
+		len = GetPropertyFromMask(&every, &wrkSpcList);
 		XChangeProperty(dpy, Scr->Root, XA_WM_WORKSPACESLIST, XA_STRING, 8,
 		                PropModeReplace, (unsigned char *) wrkSpcList, len);
 		free(wrkSpcList);
@@ -418,6 +439,14 @@ CreateWorkSpaceManagerWindow(VirtualScreen *vs)
 	vs->wsw->w = XCreateSimpleWindow(dpy, Scr->Root, x, y, width, height, 0,
 	                                 Scr->Black, Scr->workSpaceMgr.cp.back);
 
+	/* GC for filling and copying out map buffers; no NoExpose noise */
+	if(Scr->usePixmapWmap) {
+		XGCValues gcv;
+
+		gcv.graphics_exposures = False;
+		vs->wsw->gc = XCreateGC(dpy, vs->wsw->w, GCGraphicsExposures, &gcv);
+	}
+
 
 	/*
 	 * Create the map and button subwindows for each workspace
@@ -448,6 +477,16 @@ CreateWorkSpaceManagerWindow(VirtualScreen *vs)
 			                             Dummy, Dummy, Dummy, Dummy,
 			                             1, border, ws->cp.back);
 
+			/*
+			 * If we're drawing the map ourselves, the server has nothing
+			 * to fill in on its own; exposes get copied from msw->buf,
+			 * which ResizeWorkSpaceManager() creates.
+			 */
+			if(Scr->usePixmapWmap) {
+				XSetWindowBackgroundPixmap(dpy, msw->w, None);
+				msw->bgpixel = ws->cp.back;
+			}
+
 			/* Map whichever is up by default */
 			if(vs->wsw->state == WMS_buttons) {
 				XMapWindow(dpy, bsw->w);
@@ -460,18 +499,18 @@ CreateWorkSpaceManagerWindow(VirtualScreen *vs)
 			/* XXX X-ref CTAG_BGDRAW in CreateWorkSpaceManager() */
 			if(useBackgroundInfo) {
 				if(ws->image == NULL || Scr->NoImagesInWorkSpaceManager) {
-					XSetWindowBackground(dpy, msw->w, ws->backcp.back);
+					WMapSetBackground(vs, ws, None, ws->backcp.back);
 				}
 				else {
-					XSetWindowBackgroundPixmap(dpy, msw->w, ws->image->pixmap);
+					WMapSetBackground(vs, ws, ws->image->pixmap, 0);
 				}
 			}
 			else {
 				if(Scr->workSpaceMgr.defImage == NULL || Scr->NoImagesInWorkSpaceManager) {
-					XSetWindowBackground(dpy, msw->w, Scr->workSpaceMgr.defColors.back);
+					WMapSetBackground(vs, ws, None, Scr->workSpaceMgr.defColors.back);
 				}
 				else {
-					XSetWindowBackgroundPixmap(dpy, msw->w, Scr->workSpaceMgr.defImage->pixmap);
+					WMapSetBackground(vs, ws, Scr->workSpaceMgr.defImage->pixmap, 0);
 				}
 			}
 
@@ -522,6 +561,7 @@ CreateWorkSpaceManagerWindow(VirtualScreen *vs)
 		exit(1);
 	}
 	tmp_win->occupation = fullOccupation;
+	UpdateWorkSpaceMembers(tmp_win);
 	tmp_win->attr.width = width;
 	tmp_win->attr.height = height;
 	vs->wsw->twm_win = tmp_win;
@@ -551,11 +591,11 @@ CreateWorkSpaceManagerWindow(VirtualScreen *vs)
 
 	/*
 	 * Mark the buttons as listening to click and exposure events, and
-	 * stash away some pointers in contexts.  We stash the overall WSM
-	 * window in TwmContext, which means that when an event looks up the
-	 * window, it finds the WSM rather than the subwindow, and then falls
-	 * into the WMgrHandle*Event()'s, which then dig down into the event
-	 * to find where it happened in there.
+	 * stash away some pointers in the window index.  We stash the overall
+	 * WSM window as the TwmWindow, which means that when an event looks
+	 * up the window, it finds the WSM rather than the subwindow, and then
+	 * falls into the WMgrHandle*Event()'s, which then dig down into the
+	 * event to find where it happened in there.
 	 *
 	 * The map window doesn't listen to expose events; it's just empty
 	 * and background colored.  The individual subwindows in the map
@@ -574,12 +614,13 @@ CreateWorkSpaceManagerWindow(VirtualScreen *vs)
 
 		XSelectInput(dpy, buttonw, ButtonPressMask | ButtonReleaseMask
 		             | ExposureMask);
-		XSaveContext(dpy, buttonw, TwmContext, (XPointer) tmp_win);
-		XSaveContext(dpy, buttonw, ScreenContext, (XPointer) Scr);
+		WinIndexAddWSM(buttonw, Scr, tmp_win, WR_WSMGR_BUTTON, vs,
+		               ws->number);
 
-		XSelectInput(dpy, mapsubw, ButtonPressMask | ButtonReleaseMask);
-		XSaveContext(dpy, mapsubw, TwmContext, (XPointer) tmp_win);
-		XSaveContext(dpy, mapsubw, ScreenContext, (XPointer) Scr);
+		XSelectInput(dpy, mapsubw, ButtonPressMask | ButtonReleaseMask
+		             | (Scr->usePixmapWmap ? ExposureMask : 0));
+		WinIndexAddWSM(mapsubw, Scr, tmp_win, WR_WSMGR_MAP, vs,
+		               ws->number);
 	}
 
 
@@ -672,7 +713,15 @@ ResizeWorkSpaceManager(VirtualScreen *vs, TwmWindow *win)
 			wl->y      = (int)(tmp_win->frame_y * hf);
 			wl->width  = (unsigned int)((tmp_win->frame_width  * wf) + 0.5);
 			wl->height = (unsigned int)((tmp_win->frame_height * hf) + 0.5);
-			XMoveResizeWindow(dpy, wl->w, wl->x, wl->y, wl->width, wl->height);
+			if(!Scr->usePixmapWmap) {
+				XMoveResizeWindow(dpy, wl->w, wl->x, wl->y, wl->width, wl->height);
+			}
+		}
+
+		/* Or redraw the whole cell at its new size */
+		if(Scr->usePixmapWmap) {
+			wmap_resize_buffer(vs, msw);
+			wmap_flush(vs, msw);
 		}
 
 		/* And around to the next WS */
@@ -763,6 +812,28 @@ WMgrHandleExposeEvent(VirtualScreen *vs, XEvent *event)
 			PaintWsButton(WSPCWINDOW, vs, buttonw, ws->label, ws->cp, bs);
 		}
 	}
+	else if(Scr->usePixmapWmap) {
+		WorkSpace *ws;
+
+		/*
+		 * One of the workspace cells.  Copy the whole thing out of its
+		 * buffer; our caller throws away any further exposes queued up
+		 * for it, so just the exposed rectangle wouldn't be enough.
+		 */
+		for(ws = Scr->workSpaceMgr.workSpaceList; ws != NULL; ws = ws->next) {
+			MapSubwindow *msw = vs->wsw->mswl[ws->number];
+
+			if(event->xexpose.window != msw->w) {
+				continue;
+			}
+			wmap_flush(vs, msw);
+			if(msw->buf != None) {
+				XCopyArea(dpy, msw->buf, msw->w, vs->wsw->gc, 0, 0,
+				          msw->bufw, msw->bufh, 0, 0);
+			}
+			break;
+		}
+	}
 	else {
 		WinList *wl;
 
@@ -805,11 +876,16 @@ WMgrSetMapState(VirtualScreen *vs)
 	if(vs->wsw->state == WMS_map) {
 		return;
 	}
+	vs->wsw->state = WMS_map;
 	for(ws = Scr->workSpaceMgr.workSpaceList; ws != NULL; ws = ws->next) {
 		XUnmapWindow(dpy, vs->wsw->bswl [ws->number]->w);
 		XMapWindow(dpy, vs->wsw->mswl [ws->number]->w);
+
+		/* Catch up on whatever changed while we were showing buttons */
+		if(Scr->usePixmapWmap) {
+			wmap_flush(vs, vs->wsw->mswl [ws->number]);
+		}
 	}
-	vs->wsw->state = WMS_map;
 	MaybeAnimate = true;
 }
 
@@ -1024,19 +1100,31 @@ WMgrHandleButtonEvent(VirtualScreen *vs, XEvent *event)
 		return;
 	}
 
+	/*
+	 * Find the winlist entry for the window we clicked on.  With pixmap
+	 * drawing there's no subwindow to tell us, so we look it up from
+	 * where the windows are drawn; otherwise use the context on the
+	 * subwindow.
+	 */
+	wl = NULL;
+	if(Scr->usePixmapWmap) {
+		wl = wmap_entry_at(vs->wsw->mswl[oldws->number],
+		                   event->xbutton.x, event->xbutton.y);
+	}
+	else if(sw != (Window) 0) {
+		if(XFindContext(dpy, sw, MapWListContext, (XPointer *) &wl) == XCNOENT) {
+			return;
+		}
+	}
+
 	/*
 	 * If clicked in the workspace but outside a window, we can only be
 	 * switching workspaces.  So just do that, and we're done.
 	 */
-	if(sw == (Window) 0) {
+	if(wl == NULL) {
 		GotoWorkSpace(vs, oldws);
 		return;
 	}
-
-	/* Use the context to find the winlist entry for this window */
-	if(XFindContext(dpy, sw, MapWListContext, (XPointer *) &wl) == XCNOENT) {
-		return;
-	}
 	win = wl->twm_win;
 
 	/*
@@ -1107,7 +1195,7 @@ WMgrHandleButtonEvent(VirtualScreen *vs, XEvent *event)
 			 * Moving from one to another; get rid of the old location,
 			 * then fall through to the "duplicating" case below.
 			 */
-			XUnmapWindow(dpy, sw);
+			wmap_show_entry(vs, wl, false);
 			/* FALLTHRU */
 		}
 
@@ -1127,7 +1215,16 @@ WMgrHandleButtonEvent(VirtualScreen *vs, XEvent *event)
 			Window junkW;
 
 			/* [XYWH]0 = size/location of the avatar in the map */
-			XGetGeometry(dpy, sw, &junkW, &X0, &Y0, &W0, &H0, &bw, &JunkDepth);
+			if(Scr->usePixmapWmap) {
+				X0 = wl->x;
+				Y0 = wl->y;
+				W0 = wl->width;
+				H0 = wl->height;
+				bw = Scr->use3Dwmap ? 0 : 1;
+			}
+			else {
+				XGetGeometry(dpy, sw, &junkW, &X0, &Y0, &W0, &H0, &bw, &JunkDepth);
+			}
 
 			/*
 			 * [XY]0 are the coordinates of the avatar subwindow inside
@@ -1153,7 +1250,7 @@ WMgrHandleButtonEvent(VirtualScreen *vs, XEvent *event)
 			XMapRaised(dpy, w);
 
 			/* Do our dance on it to draw the name/color/etc */
-			WMapRedrawWindow(w, W0, H0, wl->cp, wl->twm_win->icon_name);
+			WMapRedrawWindow(w, W0, H0, wl->cp, wl);
 
 			/*
 			 * If we're moving the real window and
@@ -1185,9 +1282,10 @@ WMgrHandleButtonEvent(VirtualScreen *vs, XEvent *event)
 		 * anything, so they do their thing and just immediately return.
 		 */
 		case 3 : {
-			int newocc = win->occupation & ~(1 << oldws->number);
-			if(newocc != 0) {
-				ChangeOccupation(win, newocc);
+			Occupation newocc = win->occupation;
+			OccUnset(&newocc, oldws->number);
+			if(!OccEmpty(&newocc)) {
+				ChangeOccupation(win, &newocc);
 			}
 			return;
 		}
@@ -1210,9 +1308,17 @@ WMgrHandleButtonEvent(VirtualScreen *vs, XEvent *event)
 		Window junkW;
 
 		/* Figure where in the subwindow the click was, and stash in XW/YW */
-		XTranslateCoordinates(dpy, Scr->Root, sw, event->xbutton.x_root,
-		                      event->xbutton.y_root,
-		                      &XW, &YW, &junkW);
+		if(Scr->usePixmapWmap) {
+			const int bw = Scr->use3Dwmap ? 0 : 1;
+
+			XW = event->xbutton.x - wl->x - bw;
+			YW = event->xbutton.y - wl->y - bw;
+		}
+		else {
+			XTranslateCoordinates(dpy, Scr->Root, sw, event->xbutton.x_root,
+			                      event->xbutton.y_root,
+			                      &XW, &YW, &junkW);
+		}
 
 		/*
 		 * Grab the pointer, lock it into the WSM, and get the events
@@ -1242,8 +1348,7 @@ WMgrHandleButtonEvent(VirtualScreen *vs, XEvent *event)
 						 * The win we're working with?  We know how to do
 						 * that.
 						 */
-						WMapRedrawWindow(w, W0, H0, wl->cp,
-						                 wl->twm_win->icon_name);
+						WMapRedrawWindow(w, W0, H0, wl->cp, wl);
 						break;
 					}
 
@@ -1540,7 +1645,7 @@ move:
 		char keys [32];
 
 		/* Re-show old miniwindow, destroy the temp, and warp to WS */
-		XMapWindow(dpy, sw);
+		wmap_show_entry(vs, wl, true);
 		XDestroyWindow(dpy, w);
 		GotoWorkSpace(vs, oldws);
 		if(!Scr->DontWarpCursorInWMap) {
@@ -1606,20 +1711,20 @@ move:
 	/* And finish off whatever we're supposed to be doing */
 	switch(button) {
 		case 1 : { /* moving to another workspace */
-			int occupation;
+			Occupation occupation;
 
 			/* If nothing to change, re-map avatar and we're done */
 			if((newws == NULL) || (newws == oldws) ||
 			                OCCUPY(wl->twm_win, newws)) {
-				XMapWindow(dpy, sw);
+				wmap_show_entry(vs, wl, true);
 				break;
 			}
 
 			/* Out of the old, into the new */
 			occupation = win->occupation;
-			occupation |= (1 << newws->number);
-			occupation &= ~(1 << oldws->number);
-			ChangeOccupation(win, occupation);
+			OccSet(&occupation, newws->number);
+			OccUnset(&occupation, oldws->number);
+			ChangeOccupation(win, &occupation);
 
 			/*
 			 * Raise it to the top if it's in our current ws, and
@@ -1637,7 +1742,7 @@ move:
 		}
 
 		case 2 : { /* putting in extra workspace */
-			int occupation;
+			Occupation occupation;
 
 			/* Nothing to do if it's going nowhere or places it already is */
 			if((newws == NULL) || (newws == oldws) ||
@@ -1646,8 +1751,9 @@ move:
 			}
 
 			/* Move */
-			occupation = win->occupation | (1 << newws->number);
-			ChangeOccupation(win, occupation);
+			occupation = win->occupation;
+			OccSet(&occupation, newws->number);
+			ChangeOccupation(win, &occupation);
 
 			/* Raise/stack */
 			if(newws == vs->wsw->currentwspc) {
@@ -1695,7 +1801,10 @@ wmap_mapwin_backend(TwmWindow *win, bool handleraise)
 
 	for(vs = Scr->vScreenList; vs != NULL; vs = vs->next) {
 		for(ws = Scr->workSpaceMgr.workSpaceList; ws != NULL; ws = ws->next) {
-			for(wl = vs->wsw->mswl[ws->number]->wl; wl != NULL; wl = wl->next) {
+			MapSubwindow *msw = vs->wsw->mswl[ws->number];
+			WinList **prev = &msw->wl;
+
+			for(wl = msw->wl; wl != NULL; prev = &wl->next, wl = wl->next) {
 				if(win == wl->twm_win) {
 					/*
 					 * When called via deiconify, we might have to do
@@ -1704,6 +1813,17 @@ wmap_mapwin_backend(TwmWindow *win, bool handleraise)
 					 * window is always wherever it previously was in the
 					 * stack.
 					 */
+					if(Scr->usePixmapWmap) {
+						if(handleraise && !Scr->NoRaiseDeicon) {
+							/* Top of the stack is the front of the list */
+							*prev = wl->next;
+							wl->next = msw->wl;
+							msw->wl = wl;
+						}
+						wmap_show_entry(vs, wl, true);
+						break;
+					}
+
 					if(!handleraise || Scr->NoRaiseDeicon) {
 						XMapWindow(dpy, wl->w);
 					}
@@ -1773,7 +1893,7 @@ WMapIconify(TwmWindow *win)
 		for(ws = Scr->workSpaceMgr.workSpaceList; ws != NULL; ws = ws->next) {
 			for(wl = vs->wsw->mswl[ws->number]->wl; wl != NULL; wl = wl->next) {
 				if(win == wl->twm_win) {
-					XUnmapWindow(dpy, wl->w);
+					wmap_show_entry(vs, wl, false);
 					break;
 				}
 			}
@@ -1832,13 +1952,20 @@ WMapSetupWindow(TwmWindow *win, int x, int y, int w, int h)
 
 			for(WinList *wl = msw->wl; wl != NULL; wl = wl->next) {
 				if(win == wl->twm_win) {
+					/* Where it was needs redrawing too */
+					if(Scr->usePixmapWmap) {
+						wmap_damage_entry(msw, wl);
+					}
+
 					/* New positions */
 					wl->x = (int)(x * wf);
 					wl->y = (int)(y * hf);
 
 					/* Rescale if necessary and move */
 					if(w == -1) {
-						XMoveWindow(dpy, wl->w, wl->x, wl->y);
+						if(!Scr->usePixmapWmap) {
+							XMoveWindow(dpy, wl->w, wl->x, wl->y);
+						}
 					}
 					else {
 						wl->width  = (unsigned int)((w * wf) + 0.5);
@@ -1853,8 +1980,15 @@ WMapSetupWindow(TwmWindow *win, int x, int y, int w, int h)
 						if(wl->height < 1) {
 							wl->height = 1;
 						}
-						XMoveResizeWindow(dpy, wl->w, wl->x, wl->y,
-						                  wl->width, wl->height);
+						if(!Scr->usePixmapWmap) {
+							XMoveResizeWindow(dpy, wl->w, wl->x, wl->y,
+							                  wl->width, wl->height);
+						}
+					}
+
+					if(Scr->usePixmapWmap) {
+						wmap_damage_entry(msw, wl);
+						wmap_flush(vs, msw);
 					}
 					break;
 				}
@@ -1915,6 +2049,12 @@ WMapRestack(WorkSpace *ws)
 	Window  *children, *smallws;
 	unsigned int nchildren;
 
+	/* Drawing it ourselves, we can do without all the below */
+	if(Scr->usePixmapWmap) {
+		wmap_restack(ws);
+		return;
+	}
+
 	/* Get a whole list of the windows on the screen */
 	nchildren = 0;
 	XQueryTree(dpy, Scr->Root, &root, &parent, &children, &nchildren);
@@ -1983,6 +2123,69 @@ WMapRestack(WorkSpace *ws)
 }
 
 
+/*
+ * WMapRestack() for UsePixmapWMap.  There aren't any subwindows to
+ * restack; we just put each map's list in stacking order (which OTP can
+ * tell us without asking the server) and redraw whatever moved.
+ */
+static void
+wmap_restack(WorkSpace *ws)
+{
+	for(VirtualScreen *vs = Scr->vScreenList; vs != NULL; vs = vs->next) {
+		MapSubwindow *msw = vs->wsw->mswl[ws->number];
+		WinList *wl, **ents;
+		int n, i;
+
+		n = 0;
+		for(wl = msw->wl; wl != NULL; wl = wl->next) {
+			n++;
+		}
+		if(n < 2) {
+			continue;
+		}
+		ents = malloc(n * sizeof(WinList *));
+		if(ents == NULL) {
+			fprintf(stderr, "%s: Out of memory\n", __func__);
+			Done(0);
+		}
+		for(i = 0, wl = msw->wl; wl != NULL; wl = wl->next) {
+			ents[i++] = wl;
+		}
+
+		/*
+		 * It's usually only one window out of place, so insertion sort
+		 * it, top first.  That also leaves ties where they were.
+		 */
+		for(i = 1; i < n; i++) {
+			WinList *e = ents[i];
+			const unsigned long pos = OtpStackingPosition(e->twm_win);
+			int j;
+
+			for(j = i; j > 0
+			                && OtpStackingPosition(ents[j - 1]->twm_win) < pos; j--) {
+				ents[j] = ents[j - 1];
+			}
+			ents[j] = e;
+		}
+
+		/* Redraw anything that's changed places, and relink */
+		for(i = 0, wl = msw->wl; i < n; i++, wl = wl->next) {
+			if(ents[i] != wl) {
+				wmap_damage_entry(msw, ents[i]);
+			}
+		}
+		for(i = 0; i < n - 1; i++) {
+			ents[i]->next = ents[i + 1];
+		}
+		ents[n - 1]->next = NULL;
+		msw->wl = ents[0];
+		free(ents);
+
+		wmap_flush(vs, msw);
+	}
+}
+
+
 
 
 /*
@@ -2007,6 +2210,7 @@ WMapUpdateIconName(TwmWindow *win)
 		for(ws = Scr->workSpaceMgr.workSpaceList; ws != NULL; ws = ws->next) {
 			for(wl = vs->wsw->mswl[ws->number]->wl; wl != NULL; wl = wl->next) {
 				if(win == wl->twm_win) {
+					wl->label_measured = false;
 					WMapRedrawName(vs, wl);
 					break;
 				}
@@ -2022,19 +2226,51 @@ WMapUpdateIconName(TwmWindow *win)
  */
 void
 WMapRedrawName(VirtualScreen *vs, WinList *wl)
+{
+	if(Scr->usePixmapWmap) {
+		MapSubwindow *msw = vs->wsw->mswl[wl->wlist->number];
+
+		wmap_damage_entry(msw, wl);
+		wmap_flush(vs, msw);
+		return;
+	}
+	WMapRedrawWindow(wl->w, wl->width, wl->height, WMapEntryColors(vs, wl), wl);
+}
+
+
+/*
+ * The colors a window gets drawn with in the map on vs.
+ */
+static ColorPair
+WMapEntryColors(VirtualScreen *vs, WinList *wl)
 {
 	ColorPair cp = wl->cp;
 
 	if(Scr->ReverseCurrentWorkspace && wl->wlist == vs->wsw->currentwspc) {
 		InvertColorPair(&cp);
 	}
-	WMapRedrawWindow(wl->w, wl->width, wl->height, cp, wl->twm_win->icon_name);
+	return cp;
 }
 
 
 /*
  * Draw up a window's representation in the map-state WSM, with the
- * window name.
+ * window name, into its own little X window.
+ */
+static void
+WMapRedrawWindow(Window window, int width, int height,
+                 ColorPair cp, WinList *wl)
+{
+	/* Blank out window background color */
+	XClearWindow(dpy, window);
+
+	WMapDrawWindow(window, 0, 0, width, height, cp, wl);
+}
+
+
+/*
+ * Draw the borders and name of a window's representation in the map,
+ * at x/y in d.  The background should already be filled in.
  *
  * The drawing of the window name could probably be done a bit better.
  * The font size is based on a tiny fraction of the window's height, so
@@ -2042,42 +2278,28 @@ WMapRedrawName(VirtualScreen *vs, WinList *wl)
  * some odd colored pixels at the top of the window.
  */
 static void
-WMapRedrawWindow(Window window, int width, int height,
-                 ColorPair cp, const char *label)
+WMapDrawWindow(Drawable d, int x, int y, int width, int height,
+               ColorPair cp, WinList *wl)
 {
-	int x, y;
+	int strx, stry;
 	const MyFont font = Scr->workSpaceMgr.windowFont;
+	const char *label = wl->twm_win->icon_name;
 
-	/* Blank out window background color */
-	XClearWindow(dpy, window);
-
-	/* Figure out where to position the name */
-	{
+	/*
+	 * Measure the name.  That only changes when the name does
+	 * (WMapUpdateIconName() forgets it), so keep it around rather than
+	 * redoing it on every redraw.
+	 */
+	if(!wl->label_measured) {
 		XRectangle inc_rect;
 		XRectangle logical_rect;
-		int strhei, strwid;
 		int i, descent;
 		XFontStruct **xfonts;
 		char **font_names;
 		int fnum;
 
-		XmbTextExtents(font.font_set, label, strlen(label),
-		               &inc_rect, &logical_rect);
-		strwid = logical_rect.width;
-		strhei = logical_rect.height;
-
-		/*
-		 * If it's too tall to fit, just give up now.
-		 * XXX Probably should still do border stuff below...
-		 */
-		if(strhei > height) {
-			return;
-		}
-
-		x = (width - strwid) / 2;
-		if(x < 1) {
-			x = 1;
-		}
+		CachedTextExtents(&font, label, strlen(label),
+		                  &inc_rect, &logical_rect);
 
 		fnum = XFontsOfFontSet(font.font_set, &xfonts, &font_names);
 		for(i = 0, descent = 0; i < fnum; i++) {
@@ -2086,34 +2308,308 @@ WMapRedrawWindow(Window window, int width, int height,
 			           (xfonts[i]->max_bounds.descent) : descent);
 		}
 
-		y = ((height + strhei) / 2) - descent;
+		wl->label_width   = logical_rect.width;
+		wl->label_height  = logical_rect.height;
+		wl->label_descent = descent;
+		wl->label_measured = true;
+	}
+
+	/*
+	 * If it's too tall to fit, just give up now.
+	 * XXX Probably should still do border stuff below...
+	 */
+	if(wl->label_height > height) {
+		return;
 	}
 
+	/* Figure out where to position the name */
+	strx = (width - wl->label_width) / 2;
+	if(strx < 1) {
+		strx = 1;
+	}
+	stry = ((height + wl->label_height) / 2) - wl->label_descent;
+
 	/* Draw up borders around the win */
 	if(Scr->use3Dwmap) {
-		Draw3DBorder(window, 0, 0, width, height, 1, cp, off, true, false);
+		Draw3DBorder(d, x, y, width, height, 1, cp, off, true, false);
 		FB(cp.fore, cp.back);
 	}
 	else {
 		FB(cp.back, cp.fore);
-		XFillRectangle(dpy, window, Scr->NormalGC, 0, 0, width, height);
+		XFillRectangle(dpy, d, Scr->NormalGC, x, y, width, height);
 		FB(cp.fore, cp.back);
 	}
 
 	/* Write in the name */
 	if(Scr->Monochrome != COLOR) {
-		XmbDrawImageString(dpy, window, font.font_set, Scr->NormalGC, x, y,
-		                   label, strlen(label));
+		XmbDrawImageString(dpy, d, font.font_set, Scr->NormalGC,
+		                   x + strx, y + stry, label, strlen(label));
 	}
 	else {
-		XmbDrawString(dpy, window, font.font_set, Scr->NormalGC, x, y,
-		              label, strlen(label));
+		XmbDrawString(dpy, d, font.font_set, Scr->NormalGC,
+		              x + strx, y + stry, label, strlen(label));
 	}
 }
 
 
 
 
+/*
+ * With UsePixmapWMap, there aren't subwindows for all the windows in the
+ * map.  Instead, each workspace's cell of the map is drawn into a pixmap
+ * (msw->buf), which gets copied out onto the cell's window.  Changes
+ * mark part of the cell as damaged, and flushing redraws just that part
+ * into the pixmap (clipped, so whatever's stacked over it stays right)
+ * and copies it out.  While the WSM is showing buttons, the damage just
+ * piles up until it goes back to the map.
+ */
+
+/*
+ * Set the background of a workspace's cell in the map.  Normally that's
+ * just the background of its window.  Drawing it ourselves, it's what
+ * we fill in under the windows.  Callers still XClearWindow() as usual;
+ * that's a no-op here, since the window has no background of its own.
+ */
+void
+WMapSetBackground(VirtualScreen *vs, WorkSpace *ws, Pixmap pm, Pixel pixel)
+{
+	MapSubwindow *msw = vs->wsw->mswl[ws->number];
+
+	if(!Scr->usePixmapWmap) {
+		if(pm != None) {
+			XSetWindowBackgroundPixmap(dpy, msw->w, pm);
+		}
+		else {
+			XSetWindowBackground(dpy, msw->w, pixel);
+		}
+		return;
+	}
+
+	msw->bgpixmap = pm;
+	msw->bgpixel  = pixel;
+	wmap_damage(msw, 0, 0, msw->bufw, msw->bufh);
+	wmap_flush(vs, msw);
+}
+
+
+/*
+ * (Re)create the pixmap for a cell, after the WSM is resized.  Leaves
+ * the whole thing marked for drawing.
+ */
+static void
+wmap_resize_buffer(VirtualScreen *vs, MapSubwindow *msw)
+{
+	const int width  = MAX(vs->wsw->wwidth  - 2, 1);
+	const int height = MAX(vs->wsw->wheight - 2, 1);
+
+	if(msw->buf == None || width != msw->bufw || height != msw->bufh) {
+		if(msw->buf != None) {
+			XFreePixmap(dpy, msw->buf);
+		}
+		msw->buf  = XCreatePixmap(dpy, msw->w, width, height, Scr->d_depth);
+		msw->bufw = width;
+		msw->bufh = height;
+	}
+	wmap_damage(msw, 0, 0, width, height);
+}
+
+
+/*
+ * Mark part of a cell as needing redrawing.  We just keep the bounding
+ * box of everything; it's rarely more than a window or two apart.
+ */
+static void
+wmap_damage(MapSubwindow *msw, int x, int y, int width, int height)
+{
+	XRectangle *d = &msw->damage;
+	int x2 = MIN(x + width,  msw->bufw);
+	int y2 = MIN(y + height, msw->bufh);
+
+	/* Only the part in the cell matters */
+	x = MAX(x, 0);
+	y = MAX(y, 0);
+	if(x2 <= x || y2 <= y) {
+		return;
+	}
+
+	if(d->width != 0) {
+		x  = MIN(x, d->x);
+		y  = MIN(y, d->y);
+		x2 = MAX(x2, d->x + d->width);
+		y2 = MAX(y2, d->y + d->height);
+	}
+	d->x      = x;
+	d->y      = y;
+	d->width  = x2 - x;
+	d->height = y2 - y;
+}
+
+
+/*
+ * Mark where a window's drawn in a cell.
+ */
+static void
+wmap_damage_entry(MapSubwindow *msw, WinList *wl)
+{
+	const int bw = Scr->use3Dwmap ? 0 : 1;
+
+	wmap_damage(msw, wl->x, wl->y, wl->width + 2 * bw, wl->height + 2 * bw);
+}
+
+
+/*
+ * Redraw the damaged part of a cell and put it on the screen.
+ */
+static void
+wmap_flush(VirtualScreen *vs, MapSubwindow *msw)
+{
+	const int bw = Scr->use3Dwmap ? 0 : 1;
+	XRectangle r = msw->damage;
+	XGCValues gcv;
+	WinList *wl, **stack;
+	int n;
+
+	if(r.width == 0 || msw->buf == None || vs->wsw->state != WMS_map) {
+		return;
+	}
+	msw->damage.width = msw->damage.height = 0;
+
+	/* Background first */
+	if(msw->bgpixmap != None) {
+		gcv.fill_style = FillTiled;
+		gcv.tile       = msw->bgpixmap;
+		XChangeGC(dpy, vs->wsw->gc, GCFillStyle | GCTile, &gcv);
+	}
+	else {
+		gcv.fill_style = FillSolid;
+		gcv.foreground = msw->bgpixel;
+		XChangeGC(dpy, vs->wsw->gc, GCFillStyle | GCForeground, &gcv);
+	}
+	XFillRectangle(dpy, msw->buf, vs->wsw->gc, r.x, r.y, r.width, r.height);
+
+	/* Find the windows that show up in there... */
+	n = 0;
+	for(wl = msw->wl; wl != NULL; wl = wl->next) {
+		n++;
+	}
+	stack = n ? malloc(n * sizeof(WinList *)) : NULL;
+	if(n && stack == NULL) {
+		fprintf(stderr, "%s: Out of memory\n", __func__);
+		Done(0);
+	}
+	n = 0;
+	for(wl = msw->wl; wl != NULL; wl = wl->next) {
+		if(wl->shown
+		                && wl->x < r.x + r.width
+		                && wl->x + wl->width + 2 * bw > r.x
+		                && wl->y < r.y + r.height
+		                && wl->y + wl->height + 2 * bw > r.y) {
+			stack[n++] = wl;
+		}
+	}
+
+	/* ... and draw them bottom up, not straying outside it */
+	if(n) {
+		while(n-- > 0) {
+			wmap_paint_entry(vs, msw, &r, stack[n]);
+		}
+		XSetClipMask(dpy, Scr->NormalGC, None);
+		XSetClipMask(dpy, Scr->BorderGC, None);
+	}
+	free(stack);
+
+	XCopyArea(dpy, msw->buf, msw->w, vs->wsw->gc, r.x, r.y, r.width, r.height,
+	          r.x, r.y);
+}
+
+
+/*
+ * Draw one window into a cell's pixmap, within the damaged area.  It's
+ * clipped to the window's own rectangle too, since its name can be
+ * wider than it is, and would spill onto its neighbours.  Leaves
+ * NormalGC and BorderGC clipped; the caller resets them.
+ */
+static void
+wmap_paint_entry(VirtualScreen *vs, MapSubwindow *msw,
+                 const XRectangle *damage, WinList *wl)
+{
+	const int bw = Scr->use3Dwmap ? 0 : 1;
+	const ColorPair cp = WMapEntryColors(vs, wl);
+	int x = wl->x;
+	int y = wl->y;
+	XRectangle clip;
+
+	clip.x      = MAX(x, damage->x);
+	clip.y      = MAX(y, damage->y);
+	clip.width  = MIN(x + wl->width + 2 * bw, damage->x + damage->width)
+	              - clip.x;
+	clip.height = MIN(y + wl->height + 2 * bw, damage->y + damage->height)
+	              - clip.y;
+	XSetClipRectangles(dpy, Scr->NormalGC, 0, 0, &clip, 1, Unsorted);
+	XSetClipRectangles(dpy, Scr->BorderGC, 0, 0, &clip, 1, Unsorted);
+
+	/* Without 3d, they get a thin black border around them */
+	if(!Scr->use3Dwmap) {
+		FB(Scr->Black, cp.back);
+		XFillRectangle(dpy, msw->buf, Scr->NormalGC, x, y,
+		               wl->width + 2, wl->height + 2);
+		x++;
+		y++;
+	}
+
+	FB(cp.back, cp.fore);
+	XFillRectangle(dpy, msw->buf, Scr->NormalGC, x, y, wl->width, wl->height);
+	WMapDrawWindow(msw->buf, x, y, wl->width, wl->height, cp, wl);
+}
+
+
+/*
+ * Which window is drawn at x/y in a cell, if any.  The list is top of
+ * the stack first, so the first hit is the one on top.
+ */
+static WinList *
+wmap_entry_at(MapSubwindow *msw, int x, int y)
+{
+	const int bw = Scr->use3Dwmap ? 0 : 1;
+
+	for(WinList *wl = msw->wl; wl != NULL; wl = wl->next) {
+		if(wl->shown
+		                && x >= wl->x && x < wl->x + wl->width + 2 * bw
+		                && y >= wl->y && y < wl->y + wl->height + 2 * bw) {
+			return wl;
+		}
+	}
+	return NULL;
+}
+
+
+/*
+ * Show or hide a window's representation in the map.
+ */
+static void
+wmap_show_entry(VirtualScreen *vs, WinList *wl, bool shown)
+{
+	MapSubwindow *msw;
+
+	if(!Scr->usePixmapWmap) {
+		if(shown) {
+			XMapWindow(dpy, wl->w);
+		}
+		else {
+			XUnmapWindow(dpy, wl->w);
+		}
+		return;
+	}
+
+	msw = vs->wsw->mswl[wl->wlist->number];
+	wl->shown = shown;
+	wmap_damage_entry(msw, wl);
+	wmap_flush(vs, msw);
+}
+
+
+
+
 /*
  * Processes for adding/removing windows from the WSM
  */
@@ -2183,6 +2679,8 @@ WMapAddWindowToWorkspace(TwmWindow *win, WorkSpace *ws)
 		wl->height = (unsigned int)((win->frame_height * hf) + 0.5);
 		wl->cp     = cp;
 		wl->twm_win = win;
+		wl->shown  = false;
+		wl->label_measured = false;
 
 		/* Size the window bits */
 		bw = 0;
@@ -2198,6 +2696,20 @@ WMapAddWindowToWorkspace(TwmWindow *win, WorkSpace *ws)
 			wl->height = 1;
 		}
 
+		/*
+		 * Drawing into the map's pixmap, it's just an entry on the
+		 * list; draw it if its window is up.
+		 */
+		if(Scr->usePixmapWmap) {
+			wl->w = None;
+			wl->next = msw->wl;
+			msw->wl  = wl;
+			if(win->mapped) {
+				wmap_show_entry(vs, wl, true);
+			}
+			continue;
+		}
+
 		/* Create its little window */
 		wl->w = XCreateSimpleWindow(dpy, msw->w, wl->x, wl->y,
 		                            wl->width, wl->height, bw,
@@ -2221,8 +2733,8 @@ WMapAddWindowToWorkspace(TwmWindow *win, WorkSpace *ws)
 
 		/* Setup events and stash context bits */
 		XSelectInput(dpy, wl->w, ExposureMask);
-		XSaveContext(dpy, wl->w, TwmContext, (XPointer) vs->wsw->twm_win);
-		XSaveContext(dpy, wl->w, ScreenContext, (XPointer) Scr);
+		WinIndexAddWSM(wl->w, Scr, vs->wsw->twm_win, WR_WSMGR_MAPWIN, vs,
+		               ws->number);
 		XSaveContext(dpy, wl->w, MapWListContext, (XPointer) wl);
 
 		/* Link it onto the front of the list */
@@ -2269,7 +2781,9 @@ WMapRemoveWindow(TwmWindow *win)
 		OccupyWindow *occwin = Scr->workSpaceMgr.occupyWindow;
 		XUnmapWindow(dpy, occwin->twm_win->frame);
 		occwin->twm_win->mapped = false;
-		occwin->twm_win->occupation = 0;
+		FrameIndexUpdate(occwin->twm_win);
+		OccClear(&occwin->twm_win->occupation);
+		UpdateWorkSpaceMembers(occwin->twm_win);
 		occupyWin = NULL;
 	}
 }
@@ -2301,8 +2815,16 @@ WMapRemoveWindowFromWorkspace(TwmWindow *win, WorkSpace *ws)
 			/* There you are.  Unlink and kill */
 			*prev = wl->next;
 
-			XDeleteContext(dpy, wl->w, TwmContext);
-			XDeleteContext(dpy, wl->w, ScreenContext);
+			if(Scr->usePixmapWmap) {
+				MapSubwindow *msw = vs->wsw->mswl[ws->number];
+
+				wmap_damage_entry(msw, wl);
+				wmap_flush(vs, msw);
+				free(wl);
+				break;
+			}
+
+			WinIndexDel(wl->w);
 			XDeleteContext(dpy, wl->w, MapWListContext);
 			XDestroyWindow(dpy, wl->w);
 			free(wl);
@@ -2364,7 +2886,7 @@ WMapWindowMayBeAdded(TwmWindow *win)
 		return false;
 	}
 	if(Scr->workSpaceMgr.noshowoccupyall &&
-	                win->occupation == fullOccupation) {
+	                OccEqual(&win->occupation, &fullOccupation)) {
 		return false;
 	}
 	return true;
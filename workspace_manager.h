@@ -34,6 +34,8 @@ void WMapRestack(WorkSpace *ws);
 /* Map state drawing / state */
 void WMapUpdateIconName(TwmWindow *win);
 void WMapRedrawName(VirtualScreen *vs, WinList *wl);
+void WMapSetBackground(VirtualScreen *vs, WorkSpace *ws, Pixmap pm,
+                       Pixel pixel);
 
 void WMapAddWindow(TwmWindow *win);
 void WMapAddWindowToWorkspace(TwmWindow *win, WorkSpace *ws);
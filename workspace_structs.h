@@ -5,8 +5,6 @@
 #ifndef _CTWM_WORKSPACE_STRUCTS_H
 #define _CTWM_WORKSPACE_STRUCTS_H
 
-#define MAXWORKSPACE 32
-
 typedef enum {
 	WMS_map,
 	WMS_buttons,
@@ -21,12 +19,15 @@ typedef enum {
 
 struct winList {
 	struct WorkSpace    *wlist;
-	Window              w;
+	Window              w;            /* None with UsePixmapWMap */
 	int                 x, y;
 	int                 width, height;
+	bool                shown;        /* Drawn in the map; UsePixmapWMap */
 	TwmWindow           *twm_win;
 	ColorPair           cp;
 	MyFont              font;
+	bool                label_measured; /* Cached size of the name */
+	int                 label_width, label_height, label_descent;
 	struct winList      *next;
 };
 
@@ -71,6 +72,7 @@ struct WorkSpace {
 	ColorPair           cp;
 	ColorPair           backcp;
 	TwmWindow           *save_focus;  /* Used by SaveWorkspaceFocus feature */
+	WorkSpaceMember     *members;     /* Windows occupying it */
 	struct WindowRegion *FirstWindowRegion;
 	struct WorkSpace *next;
 };
@@ -78,7 +80,14 @@ struct WorkSpace {
 struct MapSubwindow {
 	Window  w;
 	int     x, y;
-	WinList *wl;
+	WinList *wl;           /* Top of the stack first */
+
+	/* With UsePixmapWMap, the map is drawn here and copied to w */
+	Pixmap     buf;
+	int        bufw, bufh;
+	XRectangle damage;     /* Needs redrawing in buf */
+	Pixmap     bgpixmap;   /* Background, if not bgpixel */
+	Pixel      bgpixel;
 };
 
 struct ButtonSubwindow {
@@ -98,6 +107,8 @@ struct WorkSpaceWindow {                /* There is one per virtual screen */
 	int           width, height;   // Window dimensions
 	int           bwidth, bheight; // Button dimensions
 	int           wwidth, wheight; // Map dimensions
+
+	GC            gc;              // For the map buffers, UsePixmapWMap
 };
 
 #endif /* _CTWM_WORKSPACE_STRUCTS_H */
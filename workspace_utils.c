@@ -17,6 +17,7 @@
 #include "functions.h"
 #include "iconmgr.h"
 #include "image.h"
+#include "occupation.h"
 #include "otp.h"
 #include "screen.h"
 #include "vscreen.h"
@@ -37,6 +38,11 @@
 bool useBackgroundInfo = false;
 
 
+static TwmWindow **SwitchingWindows(WorkSpace *oldws, WorkSpace *newws,
+                                    int *nwins);
+static int CompareStackingDown(const void *a, const void *b);
+
+
 /*
  * Move the display (of a given vs) over to a new workspace.
  */
@@ -53,6 +59,8 @@ GotoWorkSpace(VirtualScreen *vs, WorkSpace *ws)
 	Window               oldw;
 	Window               neww;
 	TwmWindow            *focuswindow;
+	TwmWindow            **wins;
+	int                  nwins;
 	VirtualScreen        *tmpvs;
 
 	if(! Scr->workSpaceManagerActive) {
@@ -93,18 +101,22 @@ GotoWorkSpace(VirtualScreen *vs, WorkSpace *ws)
 	   - unmap after mapping.
 	   The guiding factor: at any point during the transition, something
 	   should be visible only if it was visible before the transition or if
-	   it will be visible at the end.  */
-	OtpCheckConsistency();
+	   it will be visible at the end.
+
+	   Only what's in the old or new workspace can be affected, so we
+	   just look at those, rather than going over everything.  */
+	wins = SwitchingWindows(oldws, newws, &nwins);
 
-	for(twmWin = OtpTopWin(); twmWin != NULL;
-	                twmWin = OtpNextWinDown(twmWin)) {
+	for(int i = 0; i < nwins; i++) {
+		twmWin = wins[i];
 
 		if(OCCUPY(twmWin, newws)) {
 			if(!twmWin->vs) {
-				DisplayWin(vs, twmWin);
+				DisplayWinUnchecked(vs, twmWin);
 			}
 #ifdef EWMH
-			if(OCCUPY(twmWin, oldws)) {
+			if(OCCUPY(twmWin, oldws)
+			                && !OccEqual(&twmWin->occupation, &fullOccupation)) {
 				/*
 				 * If the window remains visible, re-order the workspace
 				 * numbers in NET_WM_DESKTOP.
@@ -115,8 +127,9 @@ GotoWorkSpace(VirtualScreen *vs, WorkSpace *ws)
 		}
 	}
 
-	for(twmWin = OtpBottomWin(); twmWin != NULL;
-	                twmWin = OtpNextWinUp(twmWin)) {
+	for(int i = nwins - 1; i >= 0; i--) {
+		twmWin = wins[i];
+
 		if(twmWin->vs == vs) {
 			if(!OCCUPY(twmWin, newws)) {
 				VirtualScreen *tvs;
@@ -134,7 +147,7 @@ GotoWorkSpace(VirtualScreen *vs, WorkSpace *ws)
 							continue;
 						}
 						if(OCCUPY(twmWin, tvs->wsw->currentwspc)) {
-							DisplayWin(tvs, twmWin);
+							DisplayWinUnchecked(tvs, twmWin);
 							break;
 						}
 					}
@@ -149,11 +162,13 @@ GotoWorkSpace(VirtualScreen *vs, WorkSpace *ws)
 	OtpCheckConsistency();
 
 	/*
-	   Reorganize icon manager window lists
+	   Reorganize icon manager window lists.  Only windows in the new
+	   workspace can have an entry for one of its icon managers.
 	*/
-	for(twmWin = Scr->FirstWindow; twmWin != NULL; twmWin = twmWin->next) {
+	for(int i = 0; i < nwins; i++) {
+		twmWin = wins[i];
 		wl = twmWin->iconmanagerlist;
-		if(wl == NULL) {
+		if(wl == NULL || !OCCUPY(twmWin, newws)) {
 			continue;
 		}
 		if(OCCUPY(wl->iconmgr->twm_win, newws)) {
@@ -174,6 +189,8 @@ GotoWorkSpace(VirtualScreen *vs, WorkSpace *ws)
 			twmWin->iconmanagerlist = wl;
 		}
 	}
+	free(wins);
+
 	wl = NULL;
 	for(iconmgr = newws->iconmgr; iconmgr; iconmgr = iconmgr->next) {
 		if(iconmgr->first) {
@@ -210,18 +227,18 @@ GotoWorkSpace(VirtualScreen *vs, WorkSpace *ws)
 	neww = vs->wsw->mswl [newws->number]->w;
 	if(useBackgroundInfo) {
 		if(oldws->image == NULL || Scr->NoImagesInWorkSpaceManager) {
-			XSetWindowBackground(dpy, oldw, oldws->backcp.back);
+			WMapSetBackground(vs, oldws, None, oldws->backcp.back);
 		}
 		else {
-			XSetWindowBackgroundPixmap(dpy, oldw, oldws->image->pixmap);
+			WMapSetBackground(vs, oldws, oldws->image->pixmap, 0);
 		}
 	}
 	else {
 		if(Scr->workSpaceMgr.defImage == NULL || Scr->NoImagesInWorkSpaceManager) {
-			XSetWindowBackground(dpy, oldw, Scr->workSpaceMgr.defColors.back);
+			WMapSetBackground(vs, oldws, None, Scr->workSpaceMgr.defColors.back);
 		}
 		else {
-			XSetWindowBackgroundPixmap(dpy, oldw, Scr->workSpaceMgr.defImage->pixmap);
+			WMapSetBackground(vs, oldws, Scr->workSpaceMgr.defImage->pixmap, 0);
 		}
 	}
 	attr.border_pixel = Scr->workSpaceMgr.defBorderColor;
@@ -229,11 +246,11 @@ GotoWorkSpace(VirtualScreen *vs, WorkSpace *ws)
 
 	if(Scr->workSpaceMgr.curImage == NULL) {
 		if(Scr->workSpaceMgr.curPaint) {
-			XSetWindowBackground(dpy, neww, Scr->workSpaceMgr.curColors.back);
+			WMapSetBackground(vs, newws, None, Scr->workSpaceMgr.curColors.back);
 		}
 	}
 	else {
-		XSetWindowBackgroundPixmap(dpy, neww, Scr->workSpaceMgr.curImage->pixmap);
+		WMapSetBackground(vs, newws, Scr->workSpaceMgr.curImage->pixmap, 0);
 	}
 	attr.border_pixel =  Scr->workSpaceMgr.curBorderColor;
 	XChangeWindowAttributes(dpy, neww, CWBorderPixel, &attr);
@@ -288,7 +305,8 @@ GotoWorkSpace(VirtualScreen *vs, WorkSpace *ws)
 	/* keep track of the order of the workspaces across restarts */
 	CtwmSetVScreenMap(dpy, Scr->Root, Scr->vScreenList);
 
-	XSync(dpy, 0);
+	/* No need to wait on the server; just get it all on its way */
+	XFlush(dpy);
 	if(Scr->ClickToFocus || Scr->SloppyFocus) {
 		set_last_window(newws);
 	}
@@ -297,6 +315,59 @@ GotoWorkSpace(VirtualScreen *vs, WorkSpace *ws)
 
 
 
+/*
+ * Collect what's in either of two workspaces, topmost first.
+ */
+static TwmWindow **
+SwitchingWindows(WorkSpace *oldws, WorkSpace *newws, int *nwins)
+{
+	WorkSpaceMember *m;
+	TwmWindow **wins;
+	int n = 0;
+
+	for(m = newws->members; m != NULL; m = m->next) {
+		n++;
+	}
+	for(m = oldws->members; m != NULL; m = m->next) {
+		n++;
+	}
+
+	wins = malloc((n + 1) * sizeof(TwmWindow *));
+	if(wins == NULL) {
+		fprintf(stderr, "%s: Out of memory\n", __func__);
+		Done(0);
+	}
+
+	n = 0;
+	for(m = newws->members; m != NULL; m = m->next) {
+		wins[n++] = m->twm_win;
+	}
+	for(m = oldws->members; m != NULL; m = m->next) {
+		/* Anything in both is already in there */
+		if(!OCCUPY(m->twm_win, newws)) {
+			wins[n++] = m->twm_win;
+		}
+	}
+
+	qsort(wins, n, sizeof(TwmWindow *), CompareStackingDown);
+	*nwins = n;
+	return wins;
+}
+
+
+static int
+CompareStackingDown(const void *a, const void *b)
+{
+	const unsigned long pa = OtpStackingPosition(*(TwmWindow * const *)a);
+	const unsigned long pb = OtpStackingPosition(*(TwmWindow * const *)b);
+
+	if(pa == pb) {
+		return 0;
+	}
+	return (pa < pb) ? 1 : -1;
+}
+
+
 /*
  * Various frontends to GotoWorkSpace()
  */